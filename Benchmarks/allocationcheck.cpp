@@ -0,0 +1,386 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <unistd.h>
+#include "zrtppoint.h"
+#include "zrtpPacket/packetvalidator.h"
+#include "allocationcounter.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+    Allocation accounting of handshake. INITIATOR and RESPONDER run key negotiation in memory, packets
+    wait in fixed buffers, so harness itself does not allocate while handshake runs. Heap operations of
+    every handshake phase are counted: allocations and bytes of malloc family (engine, containers,
+    crypto library), calls of operator new (C++ code only) and change of live bytes.
+
+    Aplication takes 2 arguments :
+    1. mode : check or soak (default check)
+    2. number of handshakes (default 200 for check, 1000000 for soak)
+
+    check : after warmup every handshake must stay in budget of every phase and it must not leak, live
+            bytes after points are deleted must be same as before they were created. Phase over budget
+            and leaking handshake are written out and application returns 1.
+    soak  : handshakes run one after other and resident memory is written out every SOAK_REPORT_INTERVAL
+            handshakes. Application returns 1 if resident memory grew by more than SOAK_RSS_GROWTH_LIMIT
+            after warmup or if handshakes leaked.
+
+    First WARMUP_HANDSHAKES fill slabs, secure pools, hello template cache and lazy state of libraries,
+    they are not checked.
+*/
+
+#define WARMUP_HANDSHAKES 16
+
+#define SOAK_REPORT_INTERVAL 10000
+
+// Allocator keeps some freed memory, small growth of resident memory is not leak.
+#define SOAK_RSS_GROWTH_LIMIT (8 * 1024 * 1024)
+
+// Packets in flight at once, handshake in memory never has more than one per point.
+#define IN_FLIGHT_MAX 8
+
+enum HANDSHAKE_PHASE {
+    SETUP_PHASE,
+    HELLO_PHASE,
+    COMMIT_PHASE,
+    DHPART_PHASE,
+    CONFIRM_PHASE,
+    TIMER_PHASE,
+    TEARDOWN_PHASE,
+    PHASES_COUNT
+};
+
+static const char* phaseNames[PHASES_COUNT] = {"setup", "hello", "commit", "dhpart", "confirm", "timer", "teardown"};
+
+/**
+ * @brief The PhaseBudget struct limit heap work of one phase of handshake.
+ */
+struct PhaseBudget {
+    uint64_t allocations;
+    uint64_t newCalls;
+};
+
+// Budgets of both points of handshake together. Allocations of malloc family are mostly bignums and
+// contexts of crypto library, their count depends on its build, so budgets keep small reserve and they
+// are set again when crypto library changes. Operator new is called only when session is created.
+static const PhaseBudget phaseBudgets[PHASES_COUNT] = {
+    {64, 16},       // setup : state machine, lists of supported algorithms and first arena block per point
+    {128, 0},       // hello : DH key pair of RESPONDER, hellos are copied from template
+    {20, 0},        // commit
+    {512, 0},       // dhpart : DH key pair of INITIATOR and shared secrets
+    {80, 0},        // confirm
+    {0, 0},         // timer : no timer fires without loss
+    {0, 0}          // teardown
+};
+
+struct PhaseUsage {
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t newCalls = 0;
+    int64_t liveBytes = 0;
+};
+
+struct Packet {
+    int receiver;
+    unsigned int length;
+    uint8_t data[MAXIMUM_PACKET_LENGTH];
+};
+
+struct Handshake {
+    Packet inFlight[IN_FLIGHT_MAX];
+    unsigned int first;
+    unsigned int count;
+    bool timerRunning[2];
+    bool secured[2];
+};
+
+class HarnessCallbacks : public Callbacks {
+
+private:
+    Handshake* handshake;
+    int pointIndex;
+
+public:
+    HarnessCallbacks(Handshake* _handshake, int _pointIndex) : handshake(_handshake), pointIndex(_pointIndex) {}
+
+    virtual bool sendData(const unsigned char* message, unsigned int length){
+        if (handshake->count == IN_FLIGHT_MAX || length > MAXIMUM_PACKET_LENGTH){
+            return false;
+        }
+
+        Packet& packet = handshake->inFlight[(handshake->first + handshake->count) % IN_FLIGHT_MAX];
+        packet.receiver = 1 - pointIndex;
+        packet.length = length;
+        memcpy(packet.data, message, length);
+        handshake->count++;
+        return true;
+    }
+
+    virtual bool startTimer(int){
+        handshake->timerRunning[pointIndex] = true;
+        return true;
+    }
+
+    virtual bool stopTimer(){
+        handshake->timerRunning[pointIndex] = false;
+        return true;
+    }
+
+    virtual void keyNegotitationEnded(){
+        handshake->secured[pointIndex] = true;
+    }
+
+    // Both points run in this thread, nothing to lock.
+    virtual void enterCriticalSection() {}
+
+    virtual void leaveCriticalSection() {}
+};
+
+static HANDSHAKE_PHASE phaseOfPacket(const Packet& _packet){
+
+    switch (validatePacket(_packet.data, _packet.length)){
+        case HELLO_MESSAGE: return HELLO_PHASE;
+        case HELLO_ACK_MESSAGE: return HELLO_PHASE;
+        case COMMIT_MESSAGE: return COMMIT_PHASE;
+        case DHPART1_MESSAGE: return DHPART_PHASE;
+        case DHPART2_MESSAGE: return DHPART_PHASE;
+    default: return CONFIRM_PHASE;
+    }
+}
+
+/**
+ * @brief The PhaseMeter class add heap work between begin() and end() to usage of phase.
+ */
+class PhaseMeter {
+
+    PhaseUsage* usage;
+    AllocationCounters start;
+
+public:
+
+    PhaseMeter(PhaseUsage* _usage) : usage(_usage) {}
+
+    void begin() {start = getAllocationCounters();}
+
+    void end(HANDSHAKE_PHASE _phase){
+        AllocationCounters now = getAllocationCounters();
+        usage[_phase].allocations += now.allocations - start.allocations;
+        usage[_phase].allocatedBytes += now.allocatedBytes - start.allocatedBytes;
+        usage[_phase].newCalls += now.newCalls - start.newCalls;
+        usage[_phase].liveBytes += now.liveBytes - start.liveBytes;
+    }
+};
+
+/**
+ * @brief runHandshake run one handshake and count heap work of its phases.
+ * @param _usage usage of every phase, it is filled.
+ * @return false if handshake stalled.
+ */
+static bool runHandshake(PhaseUsage* _usage){
+
+    static Handshake handshake;
+    handshake.first = handshake.count = 0;
+    handshake.timerRunning[0] = handshake.timerRunning[1] = false;
+    handshake.secured[0] = handshake.secured[1] = false;
+
+    for (int i = 0; i < PHASES_COUNT; i++){
+        _usage[i] = PhaseUsage();
+    }
+
+    // Callbacks belong to harness, they are created before setup is measured. Points delete them, so
+    // their memory is given back to teardown.
+    Callbacks* callbacks[2] = {new HarnessCallbacks(&handshake, 0), new HarnessCallbacks(&handshake, 1)};
+    int64_t callbacksBytes = malloc_usable_size(callbacks[0]) + malloc_usable_size(callbacks[1]);
+    PhaseMeter meter(_usage);
+
+    meter.begin();
+    ZrtpPoint* points[2];
+    points[0] = new ZrtpPoint(INITIATOR, callbacks[0]);
+    points[1] = new ZrtpPoint(RESPONDER, callbacks[1]);
+    points[0]->startEngine();
+    points[1]->startEngine();
+    meter.end(SETUP_PHASE);
+
+    bool stalled = false;
+    while (!(handshake.secured[0] && handshake.secured[1])){
+
+        if (handshake.count != 0){
+            Packet& packet = handshake.inFlight[handshake.first];
+            handshake.first = (handshake.first + 1) % IN_FLIGHT_MAX;
+            handshake.count--;
+
+            // Slot is taken again only after IN_FLIGHT_MAX packets are sent, replies do not overwrite it.
+            HANDSHAKE_PHASE phase = phaseOfPacket(packet);
+            meter.begin();
+            points[packet.receiver]->processMessage(packet.data, packet.length);
+            meter.end(phase);
+            continue;
+        }
+
+        bool timerFired = false;
+        meter.begin();
+        for (int i = 0; i < 2; i++){
+            if (handshake.timerRunning[i]){
+                handshake.timerRunning[i] = false;
+                points[i]->processTimeout();
+                timerFired = true;
+            }
+        }
+        meter.end(TIMER_PHASE);
+
+        if (!timerFired){
+            stalled = true;
+            break;
+        }
+    }
+
+    meter.begin();
+    delete points[0];
+    delete points[1];
+    meter.end(TEARDOWN_PHASE);
+    _usage[TEARDOWN_PHASE].liveBytes += callbacksBytes;
+
+    return !stalled;
+}
+
+static size_t residentMemory(){
+
+    long size = 0;
+    long resident = 0;
+
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr){
+        return 0;
+    }
+    if (fscanf(statm, "%ld %ld", &size, &resident) != 2){
+        resident = 0;
+    }
+    fclose(statm);
+
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static int64_t leakedBytes(const PhaseUsage* _usage){
+
+    int64_t live = 0;
+    for (int i = 0; i < PHASES_COUNT; i++){
+        live += _usage[i].liveBytes;
+    }
+    return live;
+}
+
+static void writeOutUsage(const PhaseUsage* _usage){
+
+    cerr << "phase       allocations     bytes  operator new  live bytes" << endl;
+    for (int i = 0; i < PHASES_COUNT; i++){
+        cerr << std::left << std::setw(10) << phaseNames[i] << std::right
+             << std::setw(13) << _usage[i].allocations << std::setw(10) << _usage[i].allocatedBytes
+             << std::setw(14) << _usage[i].newCalls << std::setw(12) << _usage[i].liveBytes << endl;
+    }
+}
+
+static int runCheck(int _handshakeCount){
+
+    PhaseUsage usage[PHASES_COUNT];
+    PhaseUsage most[PHASES_COUNT];
+    int failedCount = 0;
+
+    for (int run = 0; run < _handshakeCount; run++){
+
+        bool secured = runHandshake(usage);
+        if (run < WARMUP_HANDSHAKES){
+            continue;
+        }
+
+        bool failed = !secured;
+        for (int i = 0; i < PHASES_COUNT; i++){
+            most[i].allocations = std::max(most[i].allocations, usage[i].allocations);
+            most[i].allocatedBytes = std::max(most[i].allocatedBytes, usage[i].allocatedBytes);
+            most[i].newCalls = std::max(most[i].newCalls, usage[i].newCalls);
+            most[i].liveBytes = std::max(most[i].liveBytes, usage[i].liveBytes);
+
+            if (usage[i].allocations > phaseBudgets[i].allocations || usage[i].newCalls > phaseBudgets[i].newCalls){
+                failed = true;
+            }
+        }
+        if (leakedBytes(usage) != 0){
+            failed = true;
+        }
+
+        if (failed){
+            failedCount++;
+            cerr << std::dec << "Handshake " << run << (secured ? "" : " stalled")
+                 << ", leaked bytes " << leakedBytes(usage) << endl;
+            writeOutUsage(usage);
+        }
+    }
+
+    cerr << std::dec << endl << "Handshakes: " << _handshakeCount << "  checked "
+         << std::max(0, _handshakeCount - WARMUP_HANDSHAKES) << "  failed " << failedCount << endl;
+    cerr << "Most of one handshake after warmup:" << endl;
+    writeOutUsage(most);
+
+    return (failedCount == 0) ? 0 : 1;
+}
+
+static int runSoak(int _handshakeCount){
+
+    PhaseUsage usage[PHASES_COUNT];
+    size_t warmResident = 0;
+    int64_t leaked = 0;
+    int stalledCount = 0;
+
+    for (int run = 0; run < _handshakeCount; run++){
+
+        if (!runHandshake(usage)){
+            stalledCount++;
+        }
+
+        if (run < WARMUP_HANDSHAKES){
+            warmResident = residentMemory();
+            continue;
+        }
+        leaked += leakedBytes(usage);
+
+        if ((run + 1) % SOAK_REPORT_INTERVAL == 0){
+            cerr << std::dec << "Handshakes " << run + 1 << "  resident memory " << residentMemory() / 1024
+                 << " kB  leaked bytes " << leaked << "  stalled " << stalledCount << endl;
+        }
+    }
+
+    size_t resident = residentMemory();
+    int64_t growth = (int64_t) resident - (int64_t) warmResident;
+
+    cerr << std::dec << endl << "Handshakes: " << _handshakeCount << "  stalled " << stalledCount << endl;
+    cerr << "Resident memory after warmup " << warmResident / 1024 << " kB, at end " << resident / 1024
+         << " kB, growth " << growth / 1024 << " kB" << endl;
+    cerr << "Leaked bytes " << leaked << endl;
+
+    return (growth > SOAK_RSS_GROWTH_LIMIT || leaked != 0 || stalledCount != 0) ? 1 : 0;
+}
+
+int main(int argc, char * argv[]){
+
+    bool soak = (argc > 1) && strcmp(argv[1], "soak") == 0;
+    if (argc > 1 && !soak && strcmp(argv[1], "check") != 0){
+        cerr << "Unknown mode " << argv[1] << endl;
+        return 1;
+    }
+
+    int handshakeCount = (argc > 2) ? atoi(argv[2]) : (soak ? 1000000 : 200);
+    if (handshakeCount <= 0){
+        cerr << "Wrong number of handshakes" << endl;
+        return 1;
+    }
+
+    // Engine writes out every state change, we do not want to count terminal.
+    std::streambuf* coutBuffer = cout.rdbuf(nullptr);
+
+    int result = soak ? runSoak(handshakeCount) : runCheck(handshakeCount);
+
+    cout.rdbuf(coutBuffer);
+
+    return result;
+}
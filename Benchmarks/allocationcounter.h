@@ -0,0 +1,168 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <malloc.h>
+
+/*
+    Heap allocation counter of benchmarks. Functions of malloc family are replaced here and they pass
+    calls to C library, so operator new, std containers, PolarSSL bignums and OpenSSL are all counted.
+    Global operator new and delete are replaced too, their calls are counted separately, so allocations
+    of C++ code can be told apart from allocations of crypto library.
+    Counters belong to thread, work of other threads does not disturb them. With ALLOCATION_COUNTER_TIMING
+    defined before include, time spent in allocator is measured too, it shows contention of allocator.
+    Replacements are defined in this header, it must be included in one source file of program only.
+*/
+
+/**
+ * @brief The AllocationCounters struct count heap operations of one thread.
+ */
+struct AllocationCounters {
+    uint64_t allocations;
+    uint64_t deallocations;
+    uint64_t allocatedBytes;
+    int64_t liveBytes;
+    uint64_t allocatorNanoseconds;
+    uint64_t newCalls;
+    uint64_t deleteCalls;
+};
+
+extern "C" {
+    void* __libc_malloc(size_t _size);
+    void* __libc_calloc(size_t _count, size_t _size);
+    void* __libc_realloc(void* _memory, size_t _size);
+    void* __libc_memalign(size_t _alignment, size_t _size);
+    void __libc_free(void* _memory);
+}
+
+// Zero initialized, so thread needs no allocation to create it.
+static thread_local AllocationCounters allocationCounters;
+
+/**
+ * @brief getAllocationCounters getter for counters of current thread.
+ * @return copy of counters, difference of two copies is work between them.
+ */
+static inline AllocationCounters getAllocationCounters() {return allocationCounters;}
+
+/**
+ * @brief The AllocatorTimer struct add time of allocator call to counters of thread.
+ */
+struct AllocatorTimer {
+#ifdef ALLOCATION_COUNTER_TIMING
+    std::chrono::steady_clock::time_point start;
+
+    AllocatorTimer() : start(std::chrono::steady_clock::now()) {}
+    ~AllocatorTimer() {allocationCounters.allocatorNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>
+                                                                   (std::chrono::steady_clock::now() - start).count();}
+#else
+    // User provided constructor, so unused timer is not reported.
+    AllocatorTimer() {}
+#endif
+};
+
+static inline void countAllocation(void* _memory){
+    if (_memory != nullptr){
+        size_t size = malloc_usable_size(_memory);
+        allocationCounters.allocations++;
+        allocationCounters.allocatedBytes += size;
+        allocationCounters.liveBytes += size;
+    }
+}
+
+static inline void countDeallocation(void* _memory){
+    if (_memory != nullptr){
+        allocationCounters.deallocations++;
+        allocationCounters.liveBytes -= malloc_usable_size(_memory);
+    }
+}
+
+extern "C" {
+
+void* malloc(size_t _size){
+    AllocatorTimer timer;
+    void* memory = __libc_malloc(_size);
+    countAllocation(memory);
+    return memory;
+}
+
+void* calloc(size_t _count, size_t _size){
+    AllocatorTimer timer;
+    void* memory = __libc_calloc(_count, _size);
+    countAllocation(memory);
+    return memory;
+}
+
+void* realloc(void* _memory, size_t _size){
+    AllocatorTimer timer;
+    countDeallocation(_memory);
+    void* memory = __libc_realloc(_memory, _size);
+    countAllocation(memory);
+    return memory;
+}
+
+void* memalign(size_t _alignment, size_t _size){
+    AllocatorTimer timer;
+    void* memory = __libc_memalign(_alignment, _size);
+    countAllocation(memory);
+    return memory;
+}
+
+void* aligned_alloc(size_t _alignment, size_t _size){
+    return memalign(_alignment, _size);
+}
+
+int posix_memalign(void** _memory, size_t _alignment, size_t _size){
+    *_memory = memalign(_alignment, _size);
+    return (*_memory == nullptr) ? ENOMEM : 0;
+}
+
+void free(void* _memory){
+    AllocatorTimer timer;
+    countDeallocation(_memory);
+    __libc_free(_memory);
+}
+
+}
+
+void* operator new(size_t _size){
+    allocationCounters.newCalls++;
+    void* memory = malloc((_size == 0) ? 1 : _size);
+    if (memory == nullptr){
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new(size_t _size, std::align_val_t _alignment){
+    allocationCounters.newCalls++;
+    void* memory = memalign((size_t) _alignment, (_size == 0) ? 1 : _size);
+    if (memory == nullptr){
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* _memory) noexcept{
+    if (_memory != nullptr){
+        allocationCounters.deleteCalls++;
+    }
+    free(_memory);
+}
+
+void operator delete(void* _memory, size_t) noexcept{
+    operator delete(_memory);
+}
+
+void operator delete(void* _memory, std::align_val_t) noexcept{
+    operator delete(_memory);
+}
+
+void operator delete(void* _memory, size_t, std::align_val_t) noexcept{
+    operator delete(_memory);
+}
+
+#endif // ALLOCATIONCOUNTER_H
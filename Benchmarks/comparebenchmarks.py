@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+Compare two JSON results of microbenchmarks (--benchmark_out=file.json).
+
+Script takes 2 or 3 arguments :
+1. baseline result
+2. contender result
+3. allowed slowdown in percent (default 5)
+
+For every benchmark of both results CPU time per iteration in ns and allocations per iteration are written
+out. With --benchmark_repetitions median is compared, otherwise mean of runs. Script exits with 1 if any
+benchmark is slower than allowed or it allocates more than baseline, so it can guard regressions.
+"""
+
+import json
+import sys
+
+UNIT_TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as file:
+        benchmarks = json.load(file)["benchmarks"]
+
+    medians = {}
+    runs = {}
+    for benchmark in benchmarks:
+        if benchmark.get("error_occurred"):
+            continue
+        name = benchmark.get("run_name", benchmark["name"])
+        time = benchmark["cpu_time"] * UNIT_TO_NS[benchmark.get("time_unit", "ns")]
+        allocs = benchmark.get("allocs", 0.0)
+
+        if benchmark.get("run_type") == "aggregate":
+            if benchmark.get("aggregate_name") == "median":
+                medians[name] = (time, allocs)
+        else:
+            runs.setdefault(name, []).append((time, allocs))
+
+    results = {}
+    for name, values in runs.items():
+        results[name] = (sum(v[0] for v in values) / len(values), sum(v[1] for v in values) / len(values))
+    results.update(medians)
+    return results
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+
+    baseline = load(sys.argv[1])
+    contender = load(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 5.0
+
+    print("%-45s %14s %14s %9s %10s %10s" % ("Benchmark", "base [ns]", "new [ns]", "change", "base alloc", "new alloc"))
+
+    regressions = 0
+    for name in baseline:
+        if name not in contender:
+            print("%-45s missing in contender" % name)
+            continue
+
+        baseTime, baseAllocs = baseline[name]
+        newTime, newAllocs = contender[name]
+        change = (newTime - baseTime) / baseTime * 100.0 if baseTime > 0 else 0.0
+
+        mark = ""
+        if change > threshold:
+            mark = "  SLOWER"
+            regressions += 1
+        # Counters are averages, half of allocation is noise of amortized growth.
+        if newAllocs > baseAllocs + 0.5:
+            mark += "  MORE ALLOCATIONS"
+            regressions += 1
+
+        print("%-45s %14.1f %14.1f %+8.1f%% %10.2f %10.2f%s" % (name, baseTime, newTime, change, baseAllocs, newAllocs, mark))
+
+    for name in contender:
+        if name not in baseline:
+            print("%-45s new benchmark" % name)
+
+    if regressions > 0:
+        print("%d regression(s) above %.1f %%" % (regressions, threshold), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,487 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "epolltransport.h"
+#include "shardedtransport.h"
+#include "latencyhistogram.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+    Open-loop call-arrival benchmark. Handshakes start on schedule which does not wait for earlier ones,
+    arrivals are Poisson process of target rate or they are replayed from trace. Latency is measured from
+    scheduled start to SecuredState of initiator, so time in which arrival waits for stalled engine or full
+    client is counted and tail is not hidden by coordinated omission. Responders run in sharded UDP
+    transport on loopback, one shard per thread, initiators run in client threads.
+
+    Aplication takes 5 arguments :
+    1. mode : poisson, trace or sweep (default poisson)
+    2. arrivals per second for poisson (default 20), trace file for trace, p99 limit in ms for sweep (default 500)
+    3. number of threads, server shards and client threads each (default 1)
+    4. measured time in seconds of run or sweep step (default 10), it follows 1 second of warmup
+    5. seed of arrivals (default 1)
+
+    Trace file has start time of one handshake in milliseconds on every line, trace runs without warmup
+    until its last arrival. Sweep raises rate from SWEEP_START_RATE until p99 exceeds limit, handshake
+    fails or run does not finish all arrivals, then it bisects between last passed and first failed rate.
+    Summary of runs is written to cerr, JSON result to cout.
+*/
+
+typedef std::chrono::steady_clock benchmarkClock;
+
+#define LOAD_WARMUP 1.0
+#define HANDSHAKE_DEADLINE std::chrono::seconds(30)
+
+// Longest wait of client thread.
+#define CLIENT_WAIT 10
+
+// Sockets of one client thread, arrivals wait for free socket when all are busy.
+#define ARRIVAL_SOCKETS_LIMIT 1024
+
+#define SWEEP_START_RATE 10.0
+#define SWEEP_GROWTH 1.5
+#define SWEEP_BISECTIONS 4
+
+/**
+ * @brief The ArrivalSchedule class give start times of handshakes of one client thread.
+ */
+class ArrivalSchedule {
+
+    std::vector<double> trace;
+    size_t position;
+    bool replay;
+
+    std::mt19937_64 generator;
+    std::exponential_distribution<double> interval;
+    double last;
+
+public:
+
+    ArrivalSchedule(double _rate, uint64_t _seed) : position(0), replay(false), generator(_seed), interval(_rate), last(0) {}
+
+    ArrivalSchedule(const std::vector<double>& _trace) : trace(_trace), position(0), replay(true), last(0) {}
+
+    /**
+     * @brief next give start of next handshake.
+     * @param _offset time from start of run in seconds.
+     * @return false if trace has ended.
+     */
+    bool next(double& _offset){
+        if (replay){
+            if (position == trace.size()){
+                return false;
+            }
+            _offset = trace[position++];
+            return true;
+        }
+        last += interval(generator);
+        _offset = last;
+        return true;
+    }
+};
+
+struct ClientSlot {
+    EpollTransport* transport;
+    ZrtpPoint* point;
+    benchmarkClock::time_point scheduledTime;
+    benchmarkClock::time_point securedTime;
+    bool busy;
+    bool secured;
+};
+
+struct RunResult {
+    LatencyHistogram histogram;
+    uint64_t scheduled = 0;
+    uint64_t failed = 0;
+    uint64_t completed = 0;
+};
+
+static std::atomic<uint32_t> lastSourceIdentifier(0);
+
+static bool openClient(ClientSlot& _slot, int _epollDescriptor, unsigned int _index){
+
+    sockaddr_in localAddress;
+    memset(&localAddress, 0, sizeof(localAddress));
+    localAddress.sin_family = AF_INET;
+    localAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (!_slot.transport->open(localAddress)){
+        return false;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = _index;
+
+    return epoll_ctl(_epollDescriptor, EPOLL_CTL_ADD, _slot.transport->getSocketDescriptor(), &event) == 0;
+}
+
+static void startHandshake(ClientSlot& _slot, const sockaddr_in& _server, benchmarkClock::time_point _scheduledTime){
+
+    _slot.point = _slot.transport->addSession(INITIATOR, _server);
+    _slot.busy = true;
+    _slot.secured = false;
+    _slot.scheduledTime = _scheduledTime;
+
+    // Steering program takes SSRC in network order, so consecutive values go to consecutive shards.
+    _slot.point->setSourceIdentifier(htonl(++lastSourceIdentifier));
+
+    _slot.point->startEngine();
+    _slot.transport->flush();
+}
+
+static void runClient(ArrivalSchedule _schedule, benchmarkClock::time_point _start, double _warmup, double _end,
+                      sockaddr_in _server, RunResult* _result){
+
+    int epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<ClientSlot*> slots;
+    std::vector<unsigned int> freeSlots;
+    std::deque<benchmarkClock::time_point> waiting;
+    std::vector<epoll_event> events(ARRIVAL_SOCKETS_LIMIT);
+    unsigned int busySlots = 0;
+
+    benchmarkClock::time_point measureStart = _start + std::chrono::duration_cast<benchmarkClock::duration>
+                                              (std::chrono::duration<double>(_warmup));
+    double offset = 0;
+    bool arriving = _schedule.next(offset) && offset < _end;
+
+    while (arriving || !waiting.empty() || busySlots > 0){
+
+        benchmarkClock::time_point now = benchmarkClock::now();
+
+        // Arrivals come by schedule, they wait in queue when all sockets are busy.
+        while (arriving && _start + std::chrono::duration_cast<benchmarkClock::duration>
+                                    (std::chrono::duration<double>(offset)) <= now){
+            waiting.push_back(_start + std::chrono::duration_cast<benchmarkClock::duration>
+                                       (std::chrono::duration<double>(offset)));
+            arriving = _schedule.next(offset) && offset < _end;
+        }
+
+        while (!waiting.empty()){
+            if (freeSlots.empty()){
+                if (slots.size() == ARRIVAL_SOCKETS_LIMIT){
+                    break;
+                }
+
+                ClientSlot* slot = new ClientSlot;
+                slot->transport = new EpollTransport;
+                slot->busy = false;
+                slot->transport->setNegotiationHandler([slot](ZrtpPoint*){
+                    if (!slot->secured){
+                        slot->secured = true;
+                        slot->securedTime = benchmarkClock::now();
+                    }
+                });
+
+                if (!openClient(*slot, epollDescriptor, slots.size())){
+                    delete slot->transport;
+                    delete slot;
+                    break;
+                }
+                freeSlots.push_back(slots.size());
+                slots.push_back(slot);
+            }
+
+            ClientSlot& slot = *slots[freeSlots.back()];
+            freeSlots.pop_back();
+            startHandshake(slot, _server, waiting.front());
+            waiting.pop_front();
+            busySlots++;
+        }
+
+        // Handshakes are ended here, handler runs after last flush of transport loop.
+        int timeout = CLIENT_WAIT;
+
+        for (unsigned int i = 0; i < slots.size(); i++){
+            ClientSlot& slot = *slots[i];
+            if (!slot.busy){
+                continue;
+            }
+
+            bool measured = slot.scheduledTime >= measureStart;
+
+            if (slot.secured){
+                if (measured){
+                    _result->histogram.record(std::chrono::duration_cast<std::chrono::microseconds>
+                                              (slot.securedTime - slot.scheduledTime).count());
+                }
+                _result->completed++;
+            }   else if (now - slot.scheduledTime > HANDSHAKE_DEADLINE){
+                    if (measured){
+                        _result->failed++;
+                    }
+
+                    // Responder of failed handshake can stay in server, new socket has new address.
+                    slot.transport->close();
+                    openClient(slot, epollDescriptor, i);
+                }   else {
+                        int timerTimeout = slot.transport->getTimerTimeout();
+                        if (timerTimeout >= 0 && timerTimeout < timeout){
+                            timeout = timerTimeout;
+                        }
+                        continue;
+                    }
+
+            if (measured){
+                _result->scheduled++;
+            }
+            slot.transport->removeSession(slot.point);
+            slot.busy = false;
+            freeSlots.push_back(i);
+            busySlots--;
+        }
+
+        if (arriving){
+            double untilArrival = offset - std::chrono::duration<double>(benchmarkClock::now() - _start).count();
+            timeout = std::min(timeout, std::max(0, (int) (untilArrival * 1000)));
+        }
+
+        // Arrivals which wait for socket are started when some socket is freed.
+        if (!waiting.empty() && !freeSlots.empty()){
+            timeout = 0;
+        }
+
+        int ready = epoll_wait(epollDescriptor, events.data(), events.size(), timeout);
+
+        for (int i = 0; i < ready; i++){
+            slots[events[i].data.u32]->transport->runOnce(0);
+        }
+
+        for (unsigned int i = 0; i < slots.size(); i++){
+            if (slots[i]->busy && slots[i]->transport->getTimerTimeout() == 0){
+                slots[i]->transport->runOnce(0);
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < slots.size(); i++){
+        delete slots[i]->transport;
+        delete slots[i];
+    }
+
+    close(epollDescriptor);
+}
+
+static double processorTime(){
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+/**
+ * @brief runArrivals run one open-loop run and write it out.
+ * @param _rate arrivals per second, 0 for trace.
+ * @param _trace start times of trace in seconds.
+ * @param _threads count of client threads.
+ * @param _duration measured time in seconds.
+ * @param _seed seed of arrivals.
+ * @param _server address of server.
+ * @param _json JSON object of run is appended to it.
+ * @param _p99 p99 of run in milliseconds.
+ * @return true if all measured handshakes were secured.
+ */
+static bool runArrivals(double _rate, const std::vector<double>& _trace, int _threads, double _duration, uint64_t _seed,
+                        const sockaddr_in& _server, std::ostringstream& _json, double& _p99){
+
+    double warmup = _trace.empty() ? LOAD_WARMUP : 0;
+    double end = _trace.empty() ? warmup + _duration : _trace.back() + 0.001;
+
+    std::vector<RunResult> results(_threads);
+    std::vector<std::thread> clients;
+
+    double processorStart = processorTime();
+    benchmarkClock::time_point start = benchmarkClock::now();
+
+    for (int i = 0; i < _threads; i++){
+        if (_trace.empty()){
+            clients.emplace_back(runClient, ArrivalSchedule(_rate / _threads, _seed + i), start, warmup, end,
+                                 _server, &results[i]);
+        }   else {
+                // Arrivals of trace are dealt to threads in turn.
+                std::vector<double> share;
+                for (size_t arrival = i; arrival < _trace.size(); arrival += _threads){
+                    share.push_back(_trace[arrival]);
+                }
+                clients.emplace_back(runClient, ArrivalSchedule(share), start, warmup, end, _server, &results[i]);
+            }
+        pinThread(clients.back(), _threads + i);
+    }
+
+    for (int i = 0; i < _threads; i++){
+        clients[i].join();
+    }
+
+    double processorUsed = processorTime() - processorStart;
+
+    RunResult total;
+    for (int i = 0; i < _threads; i++){
+        total.histogram.add(results[i].histogram);
+        total.scheduled += results[i].scheduled;
+        total.failed += results[i].failed;
+        total.completed += results[i].completed;
+    }
+
+    double measured = end - warmup;
+    double achievedRate = total.histogram.getTotalCount() / measured;
+    double processorPerHandshake = (total.completed == 0) ? 0 : processorUsed * 1e6 / total.completed;
+
+    double percentiles[] = {50, 90, 99, 99.9};
+    const char* names[] = {"p50", "p90", "p99", "p99.9"};
+    double values[4];
+    for (int i = 0; i < 4; i++){
+        values[i] = total.histogram.getValueAtPercentile(percentiles[i]) / 1000.0;
+    }
+    double maximum = total.histogram.getMaximum() / 1000.0;
+    _p99 = values[2];
+
+    cerr << std::dec << std::fixed << std::setprecision(3);
+    cerr << "Rate " << (_trace.empty() ? _rate : _trace.size() / measured) << "/s  achieved " << achievedRate
+         << "/s  handshakes " << total.histogram.getTotalCount() << "  failed " << total.failed
+         << "  CPU [us] " << processorPerHandshake << "  latency [ms]";
+    for (int i = 0; i < 4; i++){
+        cerr << "  " << names[i] << " " << values[i];
+    }
+    cerr << "  max " << maximum << endl;
+
+    _json << std::dec << std::fixed << std::setprecision(3);
+    _json << "{\"target_rate\": " << (_trace.empty() ? _rate : _trace.size() / measured)
+          << ", \"achieved_rate\": " << achievedRate
+          << ", \"scheduled\": " << total.scheduled
+          << ", \"handshakes\": " << total.histogram.getTotalCount()
+          << ", \"failed\": " << total.failed
+          << ", \"cpu_us_per_handshake\": " << processorPerHandshake
+          << ", \"latency_ms\": {";
+    for (int i = 0; i < 4; i++){
+        _json << "\"" << names[i] << "\": " << values[i] << ", ";
+    }
+    _json << "\"max\": " << maximum << "}}";
+
+    return total.failed == 0 && total.histogram.getTotalCount() == total.scheduled;
+}
+
+int main(int argc, char * argv[]){
+
+    std::string mode = (argc > 1) ? argv[1] : "poisson";
+    int threadCount = (argc > 3) ? atoi(argv[3]) : 1;
+    double duration = (argc > 4) ? atof(argv[4]) : 10;
+    uint64_t seed = (argc > 5) ? strtoull(argv[5], nullptr, 10) : 1;
+
+    if ((mode != "poisson" && mode != "trace" && mode != "sweep") || threadCount <= 0 || duration <= 0){
+        cerr << "Wrong arguments" << endl;
+        return 1;
+    }
+
+    double rate = 20;
+    double limit = 500;
+    std::vector<double> trace;
+
+    if (mode == "poisson" && argc > 2){
+        rate = atof(argv[2]);
+    }
+    if (mode == "sweep" && argc > 2){
+        limit = atof(argv[2]);
+    }
+    if (mode == "trace"){
+        std::ifstream traceFile((argc > 2) ? argv[2] : "");
+        double start;
+        while (traceFile >> start){
+            trace.push_back(start / 1000.0);
+        }
+        std::sort(trace.begin(), trace.end());
+        if (trace.empty()){
+            cerr << "Trace file is missing or empty" << endl;
+            return 1;
+        }
+    }
+    if (rate <= 0 || limit <= 0){
+        cerr << "Wrong arguments" << endl;
+        return 1;
+    }
+
+    // Engine writes out every state change, we do not want to measure terminal.
+    std::streambuf* coutBuffer = cout.rdbuf(nullptr);
+
+    sockaddr_in serverAddress;
+    memset(&serverAddress, 0, sizeof(serverAddress));
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    ShardedTransport<EpollTransport> server(threadCount);
+    if (!server.open(serverAddress)){
+        cout.rdbuf(coutBuffer);
+        cerr << "Server sockets can not be opened" << endl;
+        return 1;
+    }
+    serverAddress = server.getShard(0)->getLocalAddress();
+
+    server.setAcceptingSessions(true);
+    server.setNegotiationHandler([](EpollTransport* _shard, ZrtpPoint* _point){_shard->removeSession(_point);});
+    server.start();
+
+    std::ostringstream json;
+    json << "{\"benchmark\": \"handshakearrival\", \"mode\": \"" << mode << "\", \"threads\": " << threadCount
+         << ", \"runs\": [";
+
+    double p99;
+
+    if (mode != "sweep"){
+        runArrivals(rate, trace, threadCount, duration, seed, serverAddress, json, p99);
+        json << "]}";
+    }   else {
+            // Rate grows until first failed step, then interval between passed and failed rate is halved.
+            double passedRate = 0;
+            double failedRate = 0;
+            rate = SWEEP_START_RATE;
+
+            for (int step = 0; failedRate == 0 || step < SWEEP_BISECTIONS; ){
+                if (passedRate != 0 || failedRate != 0){
+                    json << ", ";
+                }
+
+                bool passed = runArrivals(rate, trace, threadCount, duration, seed, serverAddress, json, p99)
+                              && p99 <= limit;
+
+                if (passed){
+                    passedRate = rate;
+                }   else {
+                        failedRate = rate;
+                    }
+
+                if (failedRate == 0){
+                    rate *= SWEEP_GROWTH;
+                }   else {
+                        step++;
+                        rate = (passedRate + failedRate) / 2;
+                    }
+            }
+
+            json << std::fixed << std::setprecision(3);
+            json << "], \"slo_p99_ms\": " << limit << ", \"max_sustainable_rate\": " << passedRate << "}";
+
+            cerr << "Maximum sustainable rate under p99 " << limit << " ms: " << passedRate << "/s" << endl;
+        }
+
+    server.stop();
+
+    cout.rdbuf(coutBuffer);
+    cout << json.str() << endl;
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "zrtppoint.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+    Handshake latency benchmark. Two ZRTP points (INITIATOR and RESPONDER) run key negotiation
+    in one process, packets are passed in memory, so measured time contains only engine work.
+
+    Aplication takes 1 argument :
+    1. number of handshakes (default 100)
+
+    For every handshake time from startEngine() to SecuredState is measured for both points.
+    Timeouts are fired immediately when no packet is in flight (no packet is lost here, so it
+    should not happen).
+*/
+
+typedef std::chrono::steady_clock benchmarkClock;
+
+struct Packet {
+    int receiver;
+    std::vector<uint8_t> data;
+};
+
+class BenchmarkCallbacks;
+
+struct Handshake {
+    std::deque<Packet> inFlight;
+    bool timerRunning[2];
+    benchmarkClock::time_point startTime;
+    benchmarkClock::time_point securedTime[2];
+    bool secured[2];
+};
+
+class BenchmarkCallbacks : public Callbacks {
+
+private:
+    Handshake* handshake;
+    int pointIndex;
+
+public:
+    BenchmarkCallbacks(Handshake* _handshake, int _pointIndex) : handshake(_handshake), pointIndex(_pointIndex) {}
+
+    virtual bool sendData(const unsigned char* message, unsigned int length){
+        handshake->inFlight.push_back({1 - pointIndex, std::vector<uint8_t>(message, message + length)});
+        return true;
+    }
+
+    virtual bool startTimer(int){
+        handshake->timerRunning[pointIndex] = true;
+        return true;
+    }
+
+    virtual bool stopTimer(){
+        handshake->timerRunning[pointIndex] = false;
+        return true;
+    }
+
+    virtual void keyNegotitationEnded(){
+        if (!handshake->secured[pointIndex]){
+            handshake->secured[pointIndex] = true;
+            handshake->securedTime[pointIndex] = benchmarkClock::now();
+        }
+    }
+
+    // Both points run in this thread, nothing to lock.
+    virtual void enterCriticalSection() {}
+
+    virtual void leaveCriticalSection() {}
+};
+
+static double percentile(std::vector<double>& _values, double _percent){
+
+    std::sort(_values.begin(), _values.end());
+    size_t index = (size_t) ((_percent / 100.0) * (_values.size() - 1) + 0.5);
+    return _values[index];
+}
+
+static void writeOutStatistics(const char* _name, std::vector<double>& _values){
+
+    double sum = 0;
+    for (size_t i = 0; i < _values.size(); i++){
+        sum += _values[i];
+    }
+
+    cerr << std::fixed << std::setprecision(3);
+    cerr << _name << " time to SecuredState [ms]: "
+         << "min " << percentile(_values, 0)
+         << "  avg " << sum / _values.size()
+         << "  p50 " << percentile(_values, 50)
+         << "  p99 " << percentile(_values, 99)
+         << "  max " << percentile(_values, 100) << endl;
+}
+
+int main(int argc, char * argv[]){
+
+    int handshakeCount = (argc > 1) ? atoi(argv[1]) : 100;
+    if (handshakeCount <= 0){
+        cerr << "Wrong number of handshakes" << endl;
+        return 1;
+    }
+
+    std::vector<double> initiatorLatency;
+    std::vector<double> responderLatency;
+    initiatorLatency.reserve(handshakeCount);
+    responderLatency.reserve(handshakeCount);
+
+    // Engine writes out every state change, we do not want to measure terminal.
+    std::streambuf* coutBuffer = cout.rdbuf(nullptr);
+
+    for (int run = 0; run < handshakeCount; run++){
+
+        Handshake handshake;
+        handshake.timerRunning[0] = handshake.timerRunning[1] = false;
+        handshake.secured[0] = handshake.secured[1] = false;
+
+        ZrtpPoint* points[2];
+        points[0] = new ZrtpPoint(INITIATOR, new BenchmarkCallbacks(&handshake, 0));
+        points[1] = new ZrtpPoint(RESPONDER, new BenchmarkCallbacks(&handshake, 1));
+
+        handshake.startTime = benchmarkClock::now();
+        points[0]->startEngine();
+        points[1]->startEngine();
+
+        while (!(handshake.secured[0] && handshake.secured[1])){
+
+            if (!handshake.inFlight.empty()){
+                Packet packet = handshake.inFlight.front();
+                handshake.inFlight.pop_front();
+                points[packet.receiver]->processMessage(packet.data.data(), packet.data.size());
+                continue;
+            }
+
+            bool timerFired = false;
+            for (int i = 0; i < 2; i++){
+                if (handshake.timerRunning[i]){
+                    handshake.timerRunning[i] = false;
+                    points[i]->processTimeout();
+                    timerFired = true;
+                }
+            }
+
+            if (!timerFired){
+                cout.rdbuf(coutBuffer);
+                cerr << "Handshake " << run << " stalled" << endl;
+                return 1;
+            }
+        }
+
+        initiatorLatency.push_back(std::chrono::duration<double, std::milli>
+                                   (handshake.securedTime[0] - handshake.startTime).count());
+        responderLatency.push_back(std::chrono::duration<double, std::milli>
+                                   (handshake.securedTime[1] - handshake.startTime).count());
+
+        delete points[0];
+        delete points[1];
+    }
+
+    cout.rdbuf(coutBuffer);
+
+    cerr << "Handshakes: " << handshakeCount << endl;
+    writeOutStatistics("INITIATOR", initiatorLatency);
+    writeOutStatistics("RESPONDER", responderLatency);
+
+    return 0;
+}
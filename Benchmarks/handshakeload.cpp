@@ -0,0 +1,315 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "epolltransport.h"
+#include "shardedtransport.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+    Closed-loop handshake load generator. Responders run in sharded UDP transport on loopback, one shard
+    per thread, initiators run in client threads. Every client keeps its share of handshakes in flight,
+    when handshake ends next one starts from same socket. Every initiator has own SSRC, so steering spreads
+    sessions over shards.
+
+    Aplication takes 4 arguments :
+    1. number of concurrent handshakes (default 64)
+    2. number of threads, server shards and client threads each (default 1)
+    3. measured time in seconds (default 10), it follows 1 second of warmup
+    4. prepared points kept by session pool of server and of every client thread, 0 creates every point
+       when session is added (default 0)
+
+    Time to SecuredState is measured from startEngine() of initiator to its SecuredState, responder is
+    secured before it. Handshake which is not secured in HANDSHAKE_DEADLINE is counted as failed and its
+    client socket is opened again. Summary is written to cerr, JSON result to cout.
+*/
+
+typedef std::chrono::steady_clock benchmarkClock;
+
+#define LOAD_WARMUP std::chrono::seconds(1)
+#define HANDSHAKE_DEADLINE std::chrono::seconds(30)
+
+// Longest wait of client thread, it checks stop flag after it.
+#define CLIENT_WAIT 10
+
+struct ClientSlot {
+    EpollTransport* transport;
+    ZrtpPoint* point;
+    benchmarkClock::time_point startTime;
+    benchmarkClock::time_point securedTime;
+    bool secured;
+};
+
+struct ClientResult {
+    std::vector<double> latency;
+    uint64_t failed = 0;
+    TransportStatistics statistics;
+};
+
+static std::atomic<bool> measuring(false);
+static std::atomic<bool> stopping(false);
+static std::atomic<uint32_t> lastSourceIdentifier(0);
+static unsigned int sessionPoolSize = 0;
+
+static bool openClient(ClientSlot& _slot, int _epollDescriptor, unsigned int _index){
+
+    sockaddr_in localAddress;
+    memset(&localAddress, 0, sizeof(localAddress));
+    localAddress.sin_family = AF_INET;
+    localAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (!_slot.transport->open(localAddress)){
+        return false;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = _index;
+
+    return epoll_ctl(_epollDescriptor, EPOLL_CTL_ADD, _slot.transport->getSocketDescriptor(), &event) == 0;
+}
+
+static void startHandshake(ClientSlot& _slot, const sockaddr_in& _server){
+
+    _slot.point = _slot.transport->addSession(INITIATOR, _server);
+    _slot.secured = false;
+
+    // Steering program takes SSRC in network order, so consecutive values go to consecutive shards.
+    _slot.point->setSourceIdentifier(htonl(++lastSourceIdentifier));
+
+    _slot.startTime = benchmarkClock::now();
+    _slot.point->startEngine();
+    _slot.transport->flush();
+}
+
+static void runClient(unsigned int _handshakes, sockaddr_in _server, ClientResult* _result){
+
+    int epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<ClientSlot> slots(_handshakes);
+
+    // Pool outlives transports of slots, they are deleted before return.
+    SessionPool sessionPool(sessionPoolSize);
+
+    for (unsigned int i = 0; i < slots.size(); i++){
+        ClientSlot* slot = &slots[i];
+        slot->transport = new EpollTransport;
+        if (sessionPoolSize != 0){
+            slot->transport->setSessionPool(&sessionPool);
+        }
+        slot->transport->setNegotiationHandler([slot](ZrtpPoint*){
+            if (!slot->secured){
+                slot->secured = true;
+                slot->securedTime = benchmarkClock::now();
+            }
+        });
+
+        if (!openClient(*slot, epollDescriptor, i)){
+            cerr << "Client socket can not be opened" << endl;
+            stopping = true;
+            break;
+        }
+        startHandshake(*slot, _server);
+    }
+
+    std::vector<epoll_event> events(slots.size());
+
+    while (!stopping){
+
+        // Handshakes are restarted here, handler runs after last flush of transport loop.
+        benchmarkClock::time_point now = benchmarkClock::now();
+        int timeout = CLIENT_WAIT;
+
+        for (unsigned int i = 0; i < slots.size(); i++){
+            ClientSlot& slot = slots[i];
+
+            if (slot.secured){
+                if (measuring){
+                    _result->latency.push_back(std::chrono::duration<double, std::milli>
+                                               (slot.securedTime - slot.startTime).count());
+                }
+                slot.transport->removeSession(slot.point);
+                startHandshake(slot, _server);
+            }   else if (now - slot.startTime > HANDSHAKE_DEADLINE){
+                    if (measuring){
+                        _result->failed++;
+                    }
+
+                    // Responder of failed handshake can stay in server, new socket has new address.
+                    slot.transport->removeSession(slot.point);
+                    slot.transport->close();
+                    openClient(slot, epollDescriptor, i);
+                    startHandshake(slot, _server);
+                }
+
+            int timerTimeout = slot.transport->getTimerTimeout();
+            if (timerTimeout >= 0 && timerTimeout < timeout){
+                timeout = timerTimeout;
+            }
+        }
+
+        int ready = epoll_wait(epollDescriptor, events.data(), events.size(), timeout);
+
+        for (int i = 0; i < ready; i++){
+            slots[events[i].data.u32].transport->runOnce(0);
+        }
+
+        for (unsigned int i = 0; i < slots.size(); i++){
+            if (slots[i].transport->getTimerTimeout() == 0){
+                slots[i].transport->runOnce(0);
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < slots.size(); i++){
+        const TransportStatistics& statistics = slots[i].transport->getStatistics();
+        _result->statistics.datagramsSent += statistics.datagramsSent;
+        _result->statistics.datagramsReceived += statistics.datagramsReceived;
+        _result->statistics.datagramsDropped += statistics.datagramsDropped;
+        _result->statistics.sendsFailed += statistics.sendsFailed;
+        delete slots[i].transport;
+    }
+
+    close(epollDescriptor);
+}
+
+static double percentile(std::vector<double>& _values, double _percent){
+
+    if (_values.empty()){
+        return 0;
+    }
+
+    size_t index = (size_t) ((_percent / 100.0) * (_values.size() - 1) + 0.5);
+    return _values[index];
+}
+
+static double processorTime(){
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char * argv[]){
+
+    int concurrency = (argc > 1) ? atoi(argv[1]) : 64;
+    int threadCount = (argc > 2) ? atoi(argv[2]) : 1;
+    int duration = (argc > 3) ? atoi(argv[3]) : 10;
+    int poolSize = (argc > 4) ? atoi(argv[4]) : 0;
+    if (concurrency <= 0 || threadCount <= 0 || duration <= 0 || poolSize < 0 || concurrency < threadCount){
+        cerr << "Wrong arguments" << endl;
+        return 1;
+    }
+    sessionPoolSize = poolSize;
+
+    // Engine writes out every state change, we do not want to measure terminal.
+    std::streambuf* coutBuffer = cout.rdbuf(nullptr);
+
+    sockaddr_in serverAddress;
+    memset(&serverAddress, 0, sizeof(serverAddress));
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // Pool is declared first, so it outlives server.
+    SessionPool serverPool(sessionPoolSize);
+
+    ShardedTransport<EpollTransport> server(threadCount);
+    if (sessionPoolSize != 0){
+        server.setSessionPool(&serverPool);
+    }
+    if (!server.open(serverAddress)){
+        cout.rdbuf(coutBuffer);
+        cerr << "Server sockets can not be opened" << endl;
+        return 1;
+    }
+    serverAddress = server.getShard(0)->getLocalAddress();
+
+    server.setAcceptingSessions(true);
+    server.setNegotiationHandler([](EpollTransport* _shard, ZrtpPoint* _point){_shard->removeSession(_point);});
+    server.start();
+
+    std::vector<ClientResult> results(threadCount);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < threadCount; i++){
+        unsigned int handshakes = concurrency / threadCount + ((i < concurrency % threadCount) ? 1 : 0);
+        clients.emplace_back(runClient, handshakes, serverAddress, &results[i]);
+        pinThread(clients.back(), threadCount + i);
+    }
+
+    std::this_thread::sleep_for(LOAD_WARMUP);
+
+    double processorStart = processorTime();
+    benchmarkClock::time_point measureStart = benchmarkClock::now();
+    measuring = true;
+
+    std::this_thread::sleep_for(std::chrono::seconds(duration));
+
+    measuring = false;
+    double processorUsed = processorTime() - processorStart;
+    double measured = std::chrono::duration<double>(benchmarkClock::now() - measureStart).count();
+
+    stopping = true;
+    for (int i = 0; i < threadCount; i++){
+        clients[i].join();
+    }
+    server.stop();
+
+    std::vector<double> latency;
+    uint64_t failed = 0;
+    TransportStatistics clientStatistics;
+    for (int i = 0; i < threadCount; i++){
+        latency.insert(latency.end(), results[i].latency.begin(), results[i].latency.end());
+        failed += results[i].failed;
+        clientStatistics.datagramsSent += results[i].statistics.datagramsSent;
+        clientStatistics.datagramsDropped += results[i].statistics.datagramsDropped;
+        clientStatistics.sendsFailed += results[i].statistics.sendsFailed;
+    }
+    std::sort(latency.begin(), latency.end());
+
+    TransportStatistics serverStatistics = server.getStatistics();
+
+    double rate = latency.size() / measured;
+    double processorPerHandshake = latency.empty() ? 0 : processorUsed * 1e6 / latency.size();
+
+    cout.rdbuf(coutBuffer);
+
+    cerr << std::dec << std::fixed << std::setprecision(3);
+    cerr << "Concurrency " << concurrency << "  threads " << threadCount << "  session pool " << sessionPoolSize
+         << "  measured " << measured << " s" << endl;
+    cerr << "Handshakes: " << latency.size() << "  failed " << failed << "  per second " << rate << endl;
+    cerr << "CPU time per handshake [us]: " << processorPerHandshake << endl;
+    cerr << "Time to SecuredState [ms]: p50 " << percentile(latency, 50) << "  p90 " << percentile(latency, 90)
+         << "  p99 " << percentile(latency, 99) << "  p99.9 " << percentile(latency, 99.9)
+         << "  max " << percentile(latency, 100) << endl;
+
+    cout << std::dec << std::fixed << std::setprecision(3);
+    cout << "{\"benchmark\": \"handshakeload\", \"concurrency\": " << concurrency
+         << ", \"threads\": " << threadCount
+         << ", \"session_pool\": " << sessionPoolSize
+         << ", \"seconds\": " << measured
+         << ", \"handshakes\": " << latency.size()
+         << ", \"failed\": " << failed
+         << ", \"handshakes_per_second\": " << rate
+         << ", \"cpu_us_per_handshake\": " << processorPerHandshake
+         << ", \"latency_ms\": {\"p50\": " << percentile(latency, 50)
+         << ", \"p90\": " << percentile(latency, 90)
+         << ", \"p99\": " << percentile(latency, 99)
+         << ", \"p99.9\": " << percentile(latency, 99.9)
+         << ", \"max\": " << percentile(latency, 100) << "}"
+         << ", \"datagrams\": {\"sent\": " << clientStatistics.datagramsSent + serverStatistics.datagramsSent
+         << ", \"dropped\": " << clientStatistics.datagramsDropped + serverStatistics.datagramsDropped
+         << ", \"send_failed\": " << clientStatistics.sendsFailed + serverStatistics.sendsFailed << "}}" << endl;
+
+    return 0;
+}
@@ -0,0 +1,414 @@
+#define ALLOCATION_COUNTER_TIMING
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "zrtppoint.h"
+#include "shardedtransport.h"
+#include "lockprofiler.h"
+#include "allocationcounter.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+    Multi-core scalability benchmark. Every thread runs in-memory handshakes of INITIATOR and RESPONDER
+    one after other, so threads share nothing but library itself: slabs of sessions and handshake states,
+    secure pools, hello templates, coroutine frames, allocator and entropy source. Run is repeated with
+    1, 2, 4 ... threads up to given number, thread i runs on core i.
+
+    Aplication takes 4 arguments :
+    1. highest number of threads (default number of processors)
+    2. measured time of every step in seconds (default 5), it follows 1 second of warmup
+    3. threads of crypto pool shared by all handshakes, 0 computes DH on thread of handshake (default 0)
+    4. workers of session scheduler shared by all handshakes, 0 runs events on thread of handshake (default 0)
+
+    With crypto pool or scheduler thread of handshake only moves packets and fires timers, engine works
+    on threads of pool and scheduler. Timers fire when handshake had no packet for ASYNC_IDLE_WAIT, handshake
+    without packet and running timer for ASYNC_STALL_WAITS waits is counted as stalled. Allocations are
+    counted per thread, so work of pool and scheduler threads is missing in allocator columns then.
+
+    For every step handshakes per second, speedup and efficiency against one thread and CPU time per
+    handshake are written out. Contention is reported per handshake:
+    - waiting in critical section of callbacks, both points of handshake share one mutex like application
+    - time spent in allocator, it grows with threads when allocator is contended
+    - acquisitions, contended acquisitions and waiting of shared locks and time of seeding random
+      generators from entropy source, only when library is built with -DZRTP_LOCK_PROFILING
+    Table is written to cerr, JSON result to cout.
+*/
+
+typedef std::chrono::steady_clock benchmarkClock;
+
+#define STEP_WARMUP std::chrono::seconds(1)
+
+#define ASYNC_IDLE_WAIT std::chrono::milliseconds(10)
+#define ASYNC_STALL_WAITS 100
+
+struct Packet {
+    int receiver;
+    std::vector<uint8_t> data;
+};
+
+// Packets, timers and results are guarded by queueMutex, engine can run on threads of pool and scheduler.
+struct Handshake {
+    std::deque<Packet> inFlight;
+    std::mutex queueMutex;
+    std::condition_variable activity;
+    std::mutex criticalSection;
+    uint64_t criticalSectionWait;
+    bool timerRunning[2];
+    bool secured[2];
+};
+
+struct ThreadResult {
+    uint64_t handshakes = 0;
+    uint64_t failed = 0;
+    uint64_t criticalSectionWait = 0;
+    uint64_t allocatorTime = 0;
+    uint64_t allocations = 0;
+};
+
+// Crypto pool and scheduler of step, nullptr when they are not used.
+struct SharedEngine {
+    CryptoPool* cryptoPool = nullptr;
+    SessionScheduler* scheduler = nullptr;
+};
+
+struct StepResult {
+    unsigned int threads;
+    double measured;
+    double processorTime;
+    ThreadResult total;
+    LockSiteStatistics sites[LOCK_SITES_COUNT];
+};
+
+class BenchmarkCallbacks : public Callbacks {
+
+private:
+    Handshake* handshake;
+    int pointIndex;
+
+public:
+    BenchmarkCallbacks(Handshake* _handshake, int _pointIndex) : handshake(_handshake), pointIndex(_pointIndex) {}
+
+    virtual bool sendData(const unsigned char* message, unsigned int length){
+        std::lock_guard<std::mutex> lock(handshake->queueMutex);
+        handshake->inFlight.push_back({1 - pointIndex, std::vector<uint8_t>(message, message + length)});
+        handshake->activity.notify_one();
+        return true;
+    }
+
+    virtual bool startTimer(int){
+        std::lock_guard<std::mutex> lock(handshake->queueMutex);
+        handshake->timerRunning[pointIndex] = true;
+        return true;
+    }
+
+    virtual bool stopTimer(){
+        std::lock_guard<std::mutex> lock(handshake->queueMutex);
+        handshake->timerRunning[pointIndex] = false;
+        return true;
+    }
+
+    virtual void keyNegotitationEnded(){
+        std::lock_guard<std::mutex> lock(handshake->queueMutex);
+        handshake->secured[pointIndex] = true;
+        handshake->activity.notify_one();
+    }
+
+    // Clock is read only when other thread holds the lock.
+    virtual void enterCriticalSection(){
+        if (handshake->criticalSection.try_lock()){
+            return;
+        }
+        benchmarkClock::time_point start = benchmarkClock::now();
+        handshake->criticalSection.lock();
+        handshake->criticalSectionWait += std::chrono::duration_cast<std::chrono::nanoseconds>
+                                          (benchmarkClock::now() - start).count();
+    }
+
+    virtual void leaveCriticalSection(){
+        handshake->criticalSection.unlock();
+    }
+};
+
+static std::atomic<bool> measuring(false);
+static std::atomic<bool> stopping(false);
+
+static bool runHandshake(Handshake& _handshake, const SharedEngine& _engine){
+
+    _handshake.criticalSectionWait = 0;
+    _handshake.timerRunning[0] = _handshake.timerRunning[1] = false;
+    _handshake.secured[0] = _handshake.secured[1] = false;
+
+    ZrtpPoint* points[2];
+    points[0] = new ZrtpPoint(INITIATOR, new BenchmarkCallbacks(&_handshake, 0));
+    points[1] = new ZrtpPoint(RESPONDER, new BenchmarkCallbacks(&_handshake, 1));
+
+    for (int i = 0; i < 2; i++){
+        if (_engine.cryptoPool != nullptr){
+            points[i]->setCryptoPool(_engine.cryptoPool);
+        }
+        if (_engine.scheduler != nullptr){
+            points[i]->setSessionScheduler(_engine.scheduler);
+        }
+    }
+
+    points[0]->startEngine();
+    points[1]->startEngine();
+
+    // Engine calls callbacks from its threads, so lock is left while points work.
+    bool asynchronous = (_engine.cryptoPool != nullptr || _engine.scheduler != nullptr);
+    int idleWaits = 0;
+    bool stalled = false;
+    std::unique_lock<std::mutex> lock(_handshake.queueMutex);
+
+    while (!(_handshake.secured[0] && _handshake.secured[1])){
+
+        if (!_handshake.inFlight.empty()){
+            Packet packet = std::move(_handshake.inFlight.front());
+            _handshake.inFlight.pop_front();
+            idleWaits = 0;
+
+            lock.unlock();
+            points[packet.receiver]->processMessage(packet.data.data(), packet.data.size());
+            lock.lock();
+            continue;
+        }
+
+        // Pool or scheduler can still work on last packet, timers fire only when it sent nothing.
+        if (asynchronous && _handshake.activity.wait_for(lock, ASYNC_IDLE_WAIT, [&_handshake](){
+                return !_handshake.inFlight.empty() || (_handshake.secured[0] && _handshake.secured[1]);})){
+            continue;
+        }
+
+        bool timerFired = false;
+        for (int i = 0; i < 2; i++){
+            if (_handshake.timerRunning[i]){
+                _handshake.timerRunning[i] = false;
+                lock.unlock();
+                points[i]->processTimeout();
+                lock.lock();
+                timerFired = true;
+            }
+        }
+
+        if (!timerFired && (!asynchronous || ++idleWaits > ASYNC_STALL_WAITS)){
+            stalled = true;
+            break;
+        }
+    }
+
+    lock.unlock();
+
+    // Scheduled point is detached from scheduler and crypto job of point is waited for by destructor.
+    delete points[0];
+    delete points[1];
+    _handshake.inFlight.clear();
+
+    return !stalled;
+}
+
+static void runWorker(ThreadResult* _result, const SharedEngine* _engine){
+
+    Handshake handshake;
+
+    while (!stopping){
+
+        // Handshake is counted if measuring runs when it starts.
+        bool counted = measuring;
+        AllocationCounters start = getAllocationCounters();
+
+        bool secured = runHandshake(handshake, *_engine);
+
+        if (counted){
+            AllocationCounters end = getAllocationCounters();
+            if (secured){
+                _result->handshakes++;
+            }   else {
+                    _result->failed++;
+                }
+            _result->criticalSectionWait += handshake.criticalSectionWait;
+            _result->allocatorTime += end.allocatorNanoseconds - start.allocatorNanoseconds;
+            _result->allocations += end.allocations - start.allocations;
+        }
+    }
+}
+
+static double processorTime(){
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static StepResult runStep(unsigned int _threads, int _duration, unsigned int _cryptoThreads, unsigned int _schedulerWorkers){
+
+    StepResult step;
+    step.threads = _threads;
+
+    std::vector<ThreadResult> results(_threads);
+    std::vector<std::thread> workers;
+
+    // Every step starts with idle pool and scheduler, their threads are not pinned.
+    SharedEngine engine;
+    if (_cryptoThreads != 0){
+        engine.cryptoPool = new CryptoPool(_cryptoThreads);
+    }
+    if (_schedulerWorkers != 0){
+        engine.scheduler = new SessionScheduler(_schedulerWorkers);
+    }
+
+    measuring = false;
+    stopping = false;
+
+    for (unsigned int i = 0; i < _threads; i++){
+        workers.emplace_back(runWorker, &results[i], &engine);
+        pinThread(workers.back(), i);
+    }
+
+    std::this_thread::sleep_for(STEP_WARMUP);
+
+    LockProfiler::reset();
+    double processorStart = processorTime();
+    benchmarkClock::time_point measureStart = benchmarkClock::now();
+    measuring = true;
+
+    std::this_thread::sleep_for(std::chrono::seconds(_duration));
+
+    measuring = false;
+    step.processorTime = processorTime() - processorStart;
+    step.measured = std::chrono::duration<double>(benchmarkClock::now() - measureStart).count();
+    for (int i = 0; i < LOCK_SITES_COUNT; i++){
+        step.sites[i] = LockProfiler::getStatistics((LOCK_SITE) i);
+    }
+
+    stopping = true;
+    for (unsigned int i = 0; i < _threads; i++){
+        workers[i].join();
+        step.total.handshakes += results[i].handshakes;
+        step.total.failed += results[i].failed;
+        step.total.criticalSectionWait += results[i].criticalSectionWait;
+        step.total.allocatorTime += results[i].allocatorTime;
+        step.total.allocations += results[i].allocations;
+    }
+
+    delete engine.scheduler;
+    delete engine.cryptoPool;
+
+    return step;
+}
+
+// Value per handshake, zero if no handshake was secured.
+static double perHandshake(const StepResult& _step, double _value){
+
+    return (_step.total.handshakes == 0) ? 0 : _value / _step.total.handshakes;
+}
+
+int main(int argc, char * argv[]){
+
+    int maximumThreads = (argc > 1) ? atoi(argv[1]) : (int) std::thread::hardware_concurrency();
+    int duration = (argc > 2) ? atoi(argv[2]) : 5;
+    int cryptoThreads = (argc > 3) ? atoi(argv[3]) : 0;
+    int schedulerWorkers = (argc > 4) ? atoi(argv[4]) : 0;
+    if (maximumThreads <= 0 || duration <= 0 || cryptoThreads < 0 || schedulerWorkers < 0){
+        cerr << "Wrong arguments" << endl;
+        return 1;
+    }
+
+    std::vector<unsigned int> threadCounts;
+    for (int threads = 1; threads < maximumThreads; threads *= 2){
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maximumThreads);
+
+    // Engine writes out every state change, we do not want to measure terminal.
+    std::streambuf* coutBuffer = cout.rdbuf(nullptr);
+
+    std::vector<StepResult> steps;
+    for (unsigned int i = 0; i < threadCounts.size(); i++){
+        steps.push_back(runStep(threadCounts[i], duration, cryptoThreads, schedulerWorkers));
+    }
+
+    cout.rdbuf(coutBuffer);
+
+    double baseRate = steps[0].total.handshakes / steps[0].measured;
+
+    cerr << std::dec << std::fixed << std::setprecision(2);
+    cerr << "Crypto pool threads " << cryptoThreads << "  scheduler workers " << schedulerWorkers << endl;
+    cerr << "threads  handshakes/s  speedup  efficiency  CPU/hs [us]  callback wait/hs [us]  allocator/hs [us]"
+            "  allocs/hs" << endl;
+    for (unsigned int i = 0; i < steps.size(); i++){
+        const StepResult& step = steps[i];
+        double rate = step.total.handshakes / step.measured;
+        double speedup = (baseRate == 0) ? 0 : rate / baseRate;
+
+        cerr << std::setw(7) << step.threads << std::setw(14) << rate << std::setw(9) << speedup
+             << std::setw(12) << speedup / step.threads
+             << std::setw(13) << perHandshake(step, step.processorTime * 1e6)
+             << std::setw(23) << perHandshake(step, step.total.criticalSectionWait / 1e3)
+             << std::setw(19) << perHandshake(step, step.total.allocatorTime / 1e3)
+             << std::setw(11) << perHandshake(step, step.total.allocations) << endl;
+        if (step.total.failed != 0){
+            cerr << "        " << step.total.failed << " handshakes stalled" << endl;
+        }
+    }
+
+    if (LockProfiler::isEnabled()){
+        cerr << endl << "threads  site              acquisitions/hs  contended/hs  wait/hs [us]" << endl;
+        for (unsigned int i = 0; i < steps.size(); i++){
+            for (int j = 0; j < LOCK_SITES_COUNT; j++){
+                const LockSiteStatistics& site = steps[i].sites[j];
+                cerr << std::setw(7) << steps[i].threads << "  " << std::left << std::setw(16)
+                     << LockProfiler::getSiteName((LOCK_SITE) j) << std::right
+                     << std::setw(17) << perHandshake(steps[i], site.acquisitions)
+                     << std::setw(14) << perHandshake(steps[i], site.contended)
+                     << std::setw(14) << perHandshake(steps[i], site.waitNanoseconds / 1e3) << endl;
+            }
+        }
+    }   else {
+            cerr << endl << "Lock sites are not counted, build library with -DZRTP_LOCK_PROFILING" << endl;
+        }
+
+    cout << std::dec << std::fixed << std::setprecision(3);
+    cout << "{\"benchmark\": \"handshakescaling\", \"seconds\": " << duration
+         << ", \"crypto_pool_threads\": " << cryptoThreads
+         << ", \"scheduler_workers\": " << schedulerWorkers
+         << ", \"lock_profiling\": " << (LockProfiler::isEnabled() ? "true" : "false") << ", \"steps\": [";
+    for (unsigned int i = 0; i < steps.size(); i++){
+        const StepResult& step = steps[i];
+        double rate = step.total.handshakes / step.measured;
+        double speedup = (baseRate == 0) ? 0 : rate / baseRate;
+
+        cout << ((i == 0) ? "" : ", ") << "{\"threads\": " << step.threads
+             << ", \"handshakes\": " << step.total.handshakes
+             << ", \"failed\": " << step.total.failed
+             << ", \"handshakes_per_second\": " << rate
+             << ", \"speedup\": " << speedup
+             << ", \"efficiency\": " << speedup / step.threads
+             << ", \"cpu_us_per_handshake\": " << perHandshake(step, step.processorTime * 1e6)
+             << ", \"callback_wait_us_per_handshake\": " << perHandshake(step, step.total.criticalSectionWait / 1e3)
+             << ", \"allocator_us_per_handshake\": " << perHandshake(step, step.total.allocatorTime / 1e3)
+             << ", \"allocations_per_handshake\": " << perHandshake(step, step.total.allocations)
+             << ", \"locks\": {";
+        for (int j = 0; j < LOCK_SITES_COUNT; j++){
+            cout << ((j == 0) ? "" : ", ") << "\"" << LockProfiler::getSiteName((LOCK_SITE) j) << "\": "
+                 << "{\"acquisitions\": " << step.sites[j].acquisitions
+                 << ", \"contended\": " << step.sites[j].contended
+                 << ", \"wait_us\": " << step.sites[j].waitNanoseconds / 1e3 << "}";
+        }
+        cout << "}}";
+    }
+    cout << "]}" << endl;
+
+    return 0;
+}
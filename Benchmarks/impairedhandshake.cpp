@@ -0,0 +1,261 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "impairedtransport.h"
+#include "loopbacktransport.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+    Handshake under impaired network. INITIATOR and RESPONDER run key negotiation over loopback
+    transport connected to itself, every packet passes impairment model (Gilbert-Elliott loss, delay
+    with jitter, duplication, reordering and truncation). Time is simulated, so timers T1 and T2 fire
+    without waiting and run with same seed gives same results. Handshakes run one after other.
+
+    Aplication takes 4 arguments :
+    1. number of handshakes (default 100)
+    2. network profile : none, wifi, mobile or congested (default mobile)
+    3. seed of impairment model (default 1)
+    4. highest share of failed handshakes in percent (default limit of profile)
+
+    For every handshake simulated time from startEngine() to SecuredState and count of packets resent
+    by T1 and T2 is written out for both points. Work of engine takes no simulated time. Application
+    returns 1 if more handshakes failed than limit allows, so run can gate regressions of engine.
+*/
+
+typedef std::chrono::steady_clock benchmarkClock;
+
+typedef ImpairedTransport<LoopbackTransport> SimulatedTransport;
+
+// Simulated time after which running handshake is counted as failed.
+#define HANDSHAKE_TIME_LIMIT std::chrono::minutes(5)
+
+// Default limits of failed handshakes in percent. Handshakes which fail under them ran out of T1 or T2
+// retransmissions, 100 handshakes of seeds 1-12 fail at most 0 (wifi), 2 (mobile) and 35 (congested).
+// Engine which does not answer resent Confirm2 in SecuredState, so lost Conf2ACK fails handshake,
+// fails 1-3, 4-16 and 32-49 handshakes of same runs.
+#define NONE_FAILURE_LIMIT 0
+#define WIFI_FAILURE_LIMIT 0
+#define MOBILE_FAILURE_LIMIT 3
+#define CONGESTED_FAILURE_LIMIT 36
+
+struct Handshake {
+    ZrtpPoint* points[2];
+    SimulatedTransport::transportClock::time_point startTime;
+    double latency[2];
+    unsigned int retransmissions[2];
+    bool secured[2];
+};
+
+static bool selectProfile(const char* _name, ImpairmentProfile& _profile, double& _failureLimit){
+
+    _profile = ImpairmentProfile();
+
+    if (strcmp(_name, "none") == 0){
+        _failureLimit = NONE_FAILURE_LIMIT;
+        return true;
+    }
+
+    if (strcmp(_name, "wifi") == 0){
+        _profile.lossRate = 0.01;
+        _profile.delay = 5;
+        _profile.jitter = 10;
+        _profile.duplicateRate = 0.001;
+        _profile.reorderRate = 0.01;
+        _profile.reorderDelay = 20;
+        _failureLimit = WIFI_FAILURE_LIMIT;
+        return true;
+    }
+
+    if (strcmp(_name, "mobile") == 0){
+        _profile.lossRate = 0.02;
+        _profile.burstLossRate = 0.6;
+        _profile.enterBurstRate = 0.05;
+        _profile.leaveBurstRate = 0.3;
+        _profile.delay = 60;
+        _profile.jitter = 40;
+        _profile.duplicateRate = 0.005;
+        _profile.reorderRate = 0.02;
+        _profile.reorderDelay = 80;
+        _profile.truncateRate = 0.002;
+        _failureLimit = MOBILE_FAILURE_LIMIT;
+        return true;
+    }
+
+    if (strcmp(_name, "congested") == 0){
+        _profile.lossRate = 0.05;
+        _profile.burstLossRate = 0.8;
+        _profile.enterBurstRate = 0.1;
+        _profile.leaveBurstRate = 0.2;
+        _profile.delay = 150;
+        _profile.jitter = 100;
+        _profile.duplicateRate = 0.01;
+        _profile.reorderRate = 0.05;
+        _profile.reorderDelay = 100;
+        _profile.truncateRate = 0.01;
+        _failureLimit = CONGESTED_FAILURE_LIMIT;
+        return true;
+    }
+
+    return false;
+}
+
+static double percentile(std::vector<double>& _values, double _percent){
+
+    std::sort(_values.begin(), _values.end());
+    size_t index = (size_t) ((_percent / 100.0) * (_values.size() - 1) + 0.5);
+    return _values[index];
+}
+
+static void writeOutStatistics(const char* _name, std::vector<double>& _values){
+
+    if (_values.empty()){
+        cerr << _name << " time to SecuredState [ms]: no handshake secured" << endl;
+        return;
+    }
+
+    double sum = 0;
+    for (size_t i = 0; i < _values.size(); i++){
+        sum += _values[i];
+    }
+
+    cerr << std::fixed << std::setprecision(3);
+    cerr << _name << " time to SecuredState [ms]: "
+         << "min " << percentile(_values, 0)
+         << "  avg " << sum / _values.size()
+         << "  p50 " << percentile(_values, 50)
+         << "  p99 " << percentile(_values, 99)
+         << "  max " << percentile(_values, 100) << endl;
+}
+
+int main(int argc, char * argv[]){
+
+    int handshakeCount = (argc > 1) ? atoi(argv[1]) : 100;
+    if (handshakeCount <= 0){
+        cerr << "Wrong number of handshakes" << endl;
+        return 1;
+    }
+
+    const char* profileName = (argc > 2) ? argv[2] : "mobile";
+    ImpairmentProfile profile;
+    double failureLimit;
+    if (!selectProfile(profileName, profile, failureLimit)){
+        cerr << "Unknown network profile " << profileName << endl;
+        return 1;
+    }
+
+    uint64_t seed = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 1;
+
+    if (argc > 4){
+        failureLimit = atof(argv[4]);
+    }
+    if (failureLimit < 0 || failureLimit > 100){
+        cerr << "Wrong limit of failed handshakes" << endl;
+        return 1;
+    }
+
+    SimulatedTransport transport(profile, seed, true);
+    Handshake handshake;
+
+    transport.setNegotiationHandler([&](ZrtpPoint* _point){
+        int index = (_point == handshake.points[0]) ? 0 : 1;
+        if (!handshake.secured[index]){
+            handshake.secured[index] = true;
+            handshake.latency[index] = std::chrono::duration<double, std::milli>
+                                       (transport.getTime() - handshake.startTime).count();
+            handshake.retransmissions[index] = _point->getRetransmissionsCount();
+        }
+    });
+
+    std::vector<double> initiatorLatency;
+    std::vector<double> responderLatency;
+    uint64_t totalRetransmissions = 0;
+    unsigned int mostRetransmissions = 0;
+    int failedCount = 0;
+
+    // Engine writes out every state change, we do not want to measure terminal.
+    std::streambuf* coutBuffer = cout.rdbuf(nullptr);
+
+    benchmarkClock::time_point benchmarkStart = benchmarkClock::now();
+
+    for (int run = 0; run < handshakeCount; run++){
+
+        LoopbackTransport::addSessionPair(transport, transport, handshake.points[0], handshake.points[1]);
+        handshake.secured[0] = handshake.secured[1] = false;
+        handshake.startTime = transport.getTime();
+
+        handshake.points[0]->startEngine();
+        handshake.points[1]->startEngine();
+
+        // Packets are delivered at current time, clock moves when nothing is left to deliver. Run which
+        // delivers nothing can fire timers and release delayed packets, so clock moves after second one.
+        bool failed = false;
+        while (!(handshake.secured[0] && handshake.secured[1])){
+            if (transport.runOnce() || transport.runOnce()){
+                continue;
+            }
+            if (!transport.advanceClock() || transport.getTime() - handshake.startTime > HANDSHAKE_TIME_LIMIT){
+                failed = true;
+                break;
+            }
+        }
+
+        cerr << std::dec << std::fixed << std::setprecision(3) << "Handshake " << run << ": ";
+        if (failed){
+            failedCount++;
+            cerr << "failed, retransmissions INITIATOR " << handshake.points[0]->getRetransmissionsCount()
+                 << "  RESPONDER " << handshake.points[1]->getRetransmissionsCount() << endl;
+        }   else {
+                initiatorLatency.push_back(handshake.latency[0]);
+                responderLatency.push_back(handshake.latency[1]);
+
+                for (int i = 0; i < 2; i++){
+                    totalRetransmissions += handshake.retransmissions[i];
+                    mostRetransmissions = std::max(mostRetransmissions, handshake.retransmissions[i]);
+                }
+
+                cerr << "INITIATOR " << handshake.latency[0] << " ms " << handshake.retransmissions[0]
+                     << " retransmissions  RESPONDER " << handshake.latency[1] << " ms "
+                     << handshake.retransmissions[1] << " retransmissions" << endl;
+            }
+
+        transport.removeSession(handshake.points[0]);
+        transport.removeSession(handshake.points[1]);
+        handshake.points[0] = handshake.points[1] = nullptr;
+    }
+
+    double wallTime = std::chrono::duration<double>(benchmarkClock::now() - benchmarkStart).count();
+
+    cout.rdbuf(coutBuffer);
+
+    const ImpairmentStatistics& impairment = transport.getImpairmentStatistics();
+
+    cerr << std::dec << endl << "Handshakes: " << handshakeCount << "  profile " << profileName << "  seed " << seed
+         << "  failed " << failedCount << endl;
+    writeOutStatistics("INITIATOR", initiatorLatency);
+    writeOutStatistics("RESPONDER", responderLatency);
+
+    if (!initiatorLatency.empty()){
+        cerr << "Retransmissions per point: avg "
+             << (double) totalRetransmissions / (2 * initiatorLatency.size())
+             << "  max " << mostRetransmissions << endl;
+    }
+
+    cerr << "Packets passed " << impairment.packetsPassed << "  lost " << impairment.packetsLost
+         << "  duplicated " << impairment.packetsDuplicated << "  reordered " << impairment.packetsReordered
+         << "  truncated " << impairment.packetsTruncated << "  bursts " << impairment.burstsEntered << endl;
+    cerr << "Wall time [s]: " << wallTime << endl;
+
+    double failureRate = 100.0 * failedCount / handshakeCount;
+    if (failureRate > failureLimit){
+        cerr << "Failed handshakes " << failureRate << " % over limit " << failureLimit << " %" << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Values below 2^LATENCY_SUB_BUCKET_BITS are counted exactly, bigger ones with relative error below
+// 2^-(LATENCY_SUB_BUCKET_BITS - 1), which is 3 significant digits.
+#define LATENCY_SUB_BUCKET_BITS 11
+
+// Values are in microseconds, bigger values than 2^LATENCY_MAXIMUM_BITS (about 76 minutes) are clamped.
+#define LATENCY_MAXIMUM_BITS 32
+
+/**
+ * @brief The LatencyHistogram class record latencies in log-linear buckets like HdrHistogram. Memory and time
+ *        of recording do not depend on count of values, so histogram can record whole run and percentiles
+ *        are not sampled. Histograms of threads are merged by add().
+ */
+class LatencyHistogram{
+
+    static const uint64_t subBucketCount = 1 << LATENCY_SUB_BUCKET_BITS;
+    static const uint64_t halfCount = subBucketCount / 2;
+
+    std::vector<uint64_t> counts;
+    uint64_t totalCount;
+    uint64_t maximum;
+    double sum;
+
+    /**
+     * @brief indexOf bucket of value.
+     * @param _value value.
+     * @return index to counts.
+     */
+    static size_t indexOf(uint64_t _value){
+        if (_value < subBucketCount){
+            return _value;
+        }
+        unsigned int shift = 63 - __builtin_clzll(_value) - (LATENCY_SUB_BUCKET_BITS - 1);
+        return subBucketCount + (shift - 1) * halfCount + ((_value >> shift) - halfCount);
+    }
+
+    /**
+     * @brief highestOf highest value which falls to bucket.
+     * @param _index index to counts.
+     * @return value.
+     */
+    static uint64_t highestOf(size_t _index){
+        if (_index < subBucketCount){
+            return _index;
+        }
+        unsigned int shift = (_index - subBucketCount) / halfCount + 1;
+        uint64_t subBucket = (_index - subBucketCount) % halfCount + halfCount;
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+public:
+
+    LatencyHistogram() : counts(indexOf((1ULL << LATENCY_MAXIMUM_BITS) - 1) + 1, 0) {reset();}
+
+    /**
+     * @brief record count one value.
+     * @param _value value in microseconds.
+     */
+    void record(uint64_t _value){
+        _value = std::min(_value, (uint64_t) (1ULL << LATENCY_MAXIMUM_BITS) - 1);
+        counts[indexOf(_value)]++;
+        totalCount++;
+        maximum = std::max(maximum, _value);
+        sum += _value;
+    }
+
+    /**
+     * @brief add count all values of other histogram.
+     * @param _other histogram.
+     */
+    void add(const LatencyHistogram& _other){
+        for (size_t i = 0; i < counts.size(); i++){
+            counts[i] += _other.counts[i];
+        }
+        totalCount += _other.totalCount;
+        maximum = std::max(maximum, _other.maximum);
+        sum += _other.sum;
+    }
+
+    /**
+     * @brief reset remove all values.
+     */
+    void reset(){
+        std::fill(counts.begin(), counts.end(), 0);
+        totalCount = 0;
+        maximum = 0;
+        sum = 0;
+    }
+
+    /**
+     * @brief getValueAtPercentile value which given percent of values does not exceed.
+     * @param _percent percent from 0 to 100.
+     * @return highest value of bucket in which percentile lies, 0 if histogram is empty.
+     */
+    uint64_t getValueAtPercentile(double _percent){
+        if (totalCount == 0){
+            return 0;
+        }
+        uint64_t wanted = std::max((uint64_t) 1, (uint64_t) (_percent / 100.0 * totalCount + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++){
+            seen += counts[i];
+            if (seen >= wanted){
+                return std::min(highestOf(i), maximum);
+            }
+        }
+        return maximum;
+    }
+
+    /**
+     * @brief getTotalCount getter for count of recorded values.
+     * @return count of values.
+     */
+    uint64_t getTotalCount() {return totalCount;}
+
+    /**
+     * @brief getMaximum getter for biggest recorded value.
+     * @return exact maximum.
+     */
+    uint64_t getMaximum() {return maximum;}
+
+    /**
+     * @brief getMean getter for mean of recorded values.
+     * @return exact mean, 0 if histogram is empty.
+     */
+    double getMean() {return totalCount == 0 ? 0 : sum / totalCount;}
+};
+
+#endif // LATENCYHISTOGRAM_H
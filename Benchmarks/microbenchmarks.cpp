@@ -0,0 +1,694 @@
+#include <iostream>
+#include <deque>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "zrtppoint.h"
+#include "zrtpPacket/packetvalidator.h"
+#include "allocationcounter.h"
+
+using std::cout;
+
+/*
+    Microbenchmarks of cryptographic primitives, message serialization and parsing, algorithm negotiation
+    and whole in-memory handshake. They run on Google Benchmark, build links -lbenchmark -lpthread.
+
+    Aplication takes arguments of Google Benchmark, for example :
+    --benchmark_filter=Confirm           run only benchmarks whose name matches
+    --benchmark_format=json              write JSON result to cout
+    --benchmark_out=result.json          write JSON result to file, comparebenchmarks.py compares two of them
+    --benchmark_repetitions=10           repeat runs for mean, median and deviation
+
+    Primitives run on INITIATOR of handshake which was stopped just before responder received Confirm2,
+    so both points keep handshake state with real DH key, messages and key material. Every benchmark
+    has own handshake, because primitives overwrite state (calculateAll() zeroes s0, so KDF benchmarks
+    after it derive keys from zeroes, which takes same time). Besides time, every benchmark reports heap
+    allocations and allocated bytes per iteration.
+*/
+
+struct Packet {
+    int receiver;
+    std::vector<uint8_t> data;
+};
+
+struct Handshake {
+    std::deque<Packet> inFlight;
+    std::vector<uint8_t> lastSent[MESSAGE_TYPES_COUNT];
+    bool timerRunning[2];
+    bool secured[2];
+    bool holdConfirm2;
+};
+
+class BenchmarkCallbacks : public Callbacks {
+
+private:
+    Handshake* handshake;
+    int pointIndex;
+
+public:
+    BenchmarkCallbacks(Handshake* _handshake, int _pointIndex) : handshake(_handshake), pointIndex(_pointIndex) {}
+
+    virtual bool sendData(const unsigned char* message, unsigned int length){
+        MESSAGE_TYPE type = validatePacket(message, length);
+        handshake->lastSent[type].assign(message, message + length);
+
+        if (type == CONFIRM2_MESSAGE && handshake->holdConfirm2){
+            return true;
+        }
+
+        handshake->inFlight.push_back({1 - pointIndex, std::vector<uint8_t>(message, message + length)});
+        return true;
+    }
+
+    virtual bool startTimer(int){
+        handshake->timerRunning[pointIndex] = true;
+        return true;
+    }
+
+    virtual bool stopTimer(){
+        handshake->timerRunning[pointIndex] = false;
+        return true;
+    }
+
+    virtual void keyNegotitationEnded(){
+        handshake->secured[pointIndex] = true;
+    }
+
+    // Both points run in this thread, nothing to lock.
+    virtual void enterCriticalSection() {}
+
+    virtual void leaveCriticalSection() {}
+};
+
+/**
+ * @brief The SilentEngine struct hide messages which engine writes out on every state change while it lives.
+ *        Google Benchmark writes results to cout too, so it can not be hidden for whole run.
+ */
+struct SilentEngine {
+    std::streambuf* coutBuffer;
+
+    SilentEngine() : coutBuffer(cout.rdbuf(nullptr)) {}
+    ~SilentEngine() {cout.rdbuf(coutBuffer);}
+};
+
+/**
+ * @brief The HandshakeRun class run key negotiation of two points in memory. With held Confirm2 it stops
+ *        when INITIATOR sent Confirm2, points then keep handshake state for benchmarks of primitives.
+ */
+class HandshakeRun {
+
+    Handshake handshake;
+    ZrtpPoint* points[2];
+
+public:
+
+    HandshakeRun(bool _holdConfirm2){
+        SilentEngine silent;
+        handshake.timerRunning[0] = handshake.timerRunning[1] = false;
+        handshake.secured[0] = handshake.secured[1] = false;
+        handshake.holdConfirm2 = _holdConfirm2;
+
+        points[0] = new ZrtpPoint(INITIATOR, new BenchmarkCallbacks(&handshake, 0));
+        points[1] = new ZrtpPoint(RESPONDER, new BenchmarkCallbacks(&handshake, 1));
+    }
+
+    ~HandshakeRun(){
+        SilentEngine silent;
+        delete points[0];
+        delete points[1];
+    }
+
+    /**
+     * @brief run start points and pass packets until both are secured or Confirm2 is held.
+     * @return false if handshake stalled.
+     */
+    bool run(){
+        SilentEngine silent;
+        points[0]->startEngine();
+        points[1]->startEngine();
+
+        while (!(handshake.secured[0] && handshake.secured[1])){
+
+            if (!handshake.inFlight.empty()){
+                Packet packet = std::move(handshake.inFlight.front());
+                handshake.inFlight.pop_front();
+                points[packet.receiver]->processMessage(packet.data.data(), packet.data.size());
+                continue;
+            }
+
+            // T2 of INITIATOR would only resend held Confirm2.
+            if (handshake.holdConfirm2 && !handshake.lastSent[CONFIRM2_MESSAGE].empty()){
+                return true;
+            }
+
+            bool timerFired = false;
+            for (int i = 0; i < 2; i++){
+                if (handshake.timerRunning[i]){
+                    handshake.timerRunning[i] = false;
+                    points[i]->processTimeout();
+                    timerFired = true;
+                }
+            }
+
+            if (!timerFired){
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    ZrtpPoint* getInitiator() {return points[0];}
+
+    /**
+     * @brief getPacket last sent packet of given type.
+     * @param _type type of message.
+     * @return packet, it is empty if no such message was sent.
+     */
+    std::vector<uint8_t>& getPacket(MESSAGE_TYPE _type) {return handshake.lastSent[_type];}
+};
+
+/**
+ * @brief The AllocationReport class count heap allocations of benchmark loop and report them per iteration.
+ */
+class AllocationReport {
+
+    AllocationCounters start;
+
+public:
+
+    AllocationReport() : start(getAllocationCounters()) {}
+
+    void finish(benchmark::State& _state){
+        AllocationCounters end = getAllocationCounters();
+        _state.counters["allocs"] = benchmark::Counter(end.allocations - start.allocations,
+                                                       benchmark::Counter::kAvgIterations);
+        _state.counters["bytes"] = benchmark::Counter(end.allocatedBytes - start.allocatedBytes,
+                                                      benchmark::Counter::kAvgIterations);
+    }
+};
+
+static bool prepareHandshake(HandshakeRun& _run, benchmark::State& _state){
+
+    if (!_run.run()){
+        _state.SkipWithError("Handshake stalled");
+        return false;
+    }
+    return true;
+}
+
+static void BM_CalculatePublicValue(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculatePublicValue();
+
+        // Key pair is computed only once per handshake, calculateS0() frees it.
+        _state.PauseTiming();
+        point->calculateS0();
+        _state.ResumeTiming();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculatePublicValue)->Unit(benchmark::kMicrosecond);
+
+static void BM_ReadPublicValue(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    DHPart dhPart1;
+    std::vector<uint8_t>& packet = run.getPacket(DHPART1_MESSAGE);
+    dhPart1.parseDhMessage(DHPartView(packet.data(), packet.size()));
+
+    // DH context was freed by calculateS0(), new key pair is needed.
+    point->calculatePublicValue();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(point->readPublicValue(&dhPart1));
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_ReadPublicValue)->Unit(benchmark::kMicrosecond);
+
+static void BM_CalculateTotalHash(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateTotalHash();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateTotalHash);
+
+static void BM_CalculateS0(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateS0();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateS0);
+
+static void BM_KeyDerivationFunction(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    uint8_t key[HASH_LENGTH_SHA256] = {};
+    uint8_t context[KDF_CONTEXT_LENGTH] = {};
+    uint8_t derived[HASH_LENGTH_SHA256];
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->keyDerivationFunction(derived, sizeof(derived), key, sizeof(key), (uint8_t*) "ZRTP Session Key",
+                                     context, sizeof(context), 256);
+        benchmark::DoNotOptimize(derived);
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_KeyDerivationFunction);
+
+static void BM_CalculateZrtpSessAndExportedKey(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateZrtpSessAndExportedKey();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateZrtpSessAndExportedKey);
+
+static void BM_CalculateSas(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateSas();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateSas);
+
+static void BM_CalculateZrtpKeyMaterial(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateZrtpKeyMaterial();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateZrtpKeyMaterial);
+
+static void BM_CalculateAll(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateAll();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateAll);
+
+static void BM_CalculateHashChain(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateHashChain();
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateHashChain);
+
+static void BM_CalculateMac(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    std::vector<uint8_t> packet = run.getPacket(COMMIT_MESSAGE);
+    CommitMessage commit;
+    commit.parseCommitMessage(CommitView(packet.data(), packet.size()));
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->calculateMac(packet.data(), commit.getMessageLength(), COMMIT_MESSAGE);
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CalculateMac);
+
+static void BM_VerifyMac(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    std::vector<uint8_t> packet = run.getPacket(HELLO_MESSAGE);
+    HelloMessage hello;
+    HelloMessage respondersHello;
+    hello.parseHelloMessage(&respondersHello, HelloView(packet.data(), packet.size()));
+
+    if (!point->verifyMac(packet.data(), respondersHello.getMessageLength(), HELLO_MESSAGE)){
+        _state.SkipWithError("Mac of responders Hello does not match");
+        return;
+    }
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(point->verifyMac(packet.data(), respondersHello.getMessageLength(), HELLO_MESSAGE));
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_VerifyMac);
+
+static void BM_ConfirmEncrypt(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    ConfirmMessage confirm;
+    confirm.setMessageType((uint8_t*) "Confirm2");
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->createEncryptPart(&confirm);
+        point->calculateConfirmMac(&confirm);
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_ConfirmEncrypt);
+
+static void BM_ConfirmDecrypt(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    std::vector<uint8_t>& packet = run.getPacket(CONFIRM1_MESSAGE);
+    ConfirmMessage confirm1;
+    confirm1.parseConfirmMessage(ConfirmView(packet.data(), packet.size()));
+
+    if (!point->verifyConfirmMac(&confirm1)){
+        _state.SkipWithError("Confirm mac of Confirm1 does not match");
+        return;
+    }
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(point->verifyConfirmMac(&confirm1));
+        point->decryptConfirmMessage(&confirm1);
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_ConfirmDecrypt);
+
+static void BM_RenderSAS(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    uint8_t rendered[WORD_LENGTH];
+
+    AllocationReport report;
+    for (auto _ : _state){
+        point->renderSAS(rendered);
+        benchmark::DoNotOptimize(rendered);
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_RenderSAS);
+
+static void BM_AlgorithmNegotiation(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+    ZrtpPoint* point = run.getInitiator();
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(point->algorithmNegotiation());
+    }
+    report.finish(_state);
+}
+// Intersection of algorithms is taken from session arena, which is released only with handshake,
+// so count of iterations is fixed to keep memory small.
+BENCHMARK(BM_AlgorithmNegotiation)->Iterations(100000);
+
+static void BM_HelloSerialize(benchmark::State& _state){
+
+    HelloMessage hello;
+    hello.addHashAlgorithm((uint8_t*) "S256");
+    hello.addCipherAlgorithm((uint8_t*) "AES1");
+    hello.addAuthTagType((uint8_t*) "HS32");
+    hello.addKeyAgreementType((uint8_t*) "DH3k");
+    hello.addSasType((uint8_t*) "B32 ");
+
+    AllocationReport report;
+    for (auto _ : _state){
+        hello.initializeMessageData();
+        benchmark::DoNotOptimize(hello.getHelloData());
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_HelloSerialize);
+
+static void BM_HelloParse(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+
+    std::vector<uint8_t>& packet = run.getPacket(HELLO_MESSAGE);
+    HelloMessage hello;
+    HelloMessage respondersHello;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(hello.parseHelloMessage(&respondersHello, HelloView(packet.data(), packet.size())));
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_HelloParse);
+
+static void BM_HelloAckSerialize(benchmark::State& _state){
+
+    HelloACKmessage helloAck;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        helloAck.initializeMessageData();
+        benchmark::DoNotOptimize(helloAck.getHelloAckData());
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_HelloAckSerialize);
+
+static void BM_CommitSerialize(benchmark::State& _state){
+
+    CommitMessage commit;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        commit.initializeMessageData();
+        benchmark::DoNotOptimize(commit.getCommitData());
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CommitSerialize);
+
+static void BM_CommitParse(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+
+    std::vector<uint8_t>& packet = run.getPacket(COMMIT_MESSAGE);
+    CommitMessage commit;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(commit.parseCommitMessage(CommitView(packet.data(), packet.size())));
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_CommitParse);
+
+static void BM_DHPartSerialize(benchmark::State& _state){
+
+    DHPart dhPart;
+    dhPart.setMessageType((uint8_t*) "DHPart1 ");
+
+    AllocationReport report;
+    for (auto _ : _state){
+        dhPart.initializeMessageData();
+        benchmark::DoNotOptimize(dhPart.getDHData());
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_DHPartSerialize);
+
+static void BM_DHPartParse(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+
+    std::vector<uint8_t>& packet = run.getPacket(DHPART1_MESSAGE);
+    DHPart dhPart;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(dhPart.parseDhMessage(DHPartView(packet.data(), packet.size())));
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_DHPartParse);
+
+static void BM_ConfirmSerialize(benchmark::State& _state){
+
+    ConfirmMessage confirm;
+    confirm.setMessageType((uint8_t*) "Confirm1");
+
+    AllocationReport report;
+    for (auto _ : _state){
+        confirm.initializeMessageData();
+        benchmark::DoNotOptimize(confirm.getConfirmData());
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_ConfirmSerialize);
+
+static void BM_ConfirmParse(benchmark::State& _state){
+
+    HandshakeRun run(true);
+    if (!prepareHandshake(run, _state)){
+        return;
+    }
+
+    std::vector<uint8_t>& packet = run.getPacket(CONFIRM1_MESSAGE);
+    ConfirmMessage confirm;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        benchmark::DoNotOptimize(confirm.parseConfirmMessage(ConfirmView(packet.data(), packet.size())));
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_ConfirmParse);
+
+static void BM_Conf2AckSerialize(benchmark::State& _state){
+
+    Conf2AckMessage conf2Ack;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        conf2Ack.initializeMessageData();
+        benchmark::DoNotOptimize(conf2Ack.getConf2AckData());
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_Conf2AckSerialize);
+
+static void BM_ErrorSerialize(benchmark::State& _state){
+
+    ErrorMessage error(MALFORMED_PACKET);
+    ErrorAckMessage errorAck;
+
+    AllocationReport report;
+    for (auto _ : _state){
+        error.initializeMessageData();
+        errorAck.initializeMessageData();
+        benchmark::DoNotOptimize(error.getErrorData());
+        benchmark::DoNotOptimize(errorAck.getErrorAckData());
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_ErrorSerialize);
+
+static void BM_Handshake(benchmark::State& _state){
+
+    AllocationReport report;
+    for (auto _ : _state){
+        HandshakeRun run(false);
+        if (!run.run()){
+            _state.SkipWithError("Handshake stalled");
+            break;
+        }
+    }
+    report.finish(_state);
+}
+BENCHMARK(BM_Handshake)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,172 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "zrtpPacket/packetvalidator.h"
+#include "zrtpPacket/crc32c.h"
+
+using std::cerr;
+using std::endl;
+
+/*
+    Packet validation throughput benchmark. Front-end validator runs over three sets of datagrams:
+    valid packets of every message type, junk traffic (random bytes, truncated packets, packets with
+    broken cookie, preamble or length) and, for comparison, CRC check of valid packets.
+
+    Aplication takes 1 argument :
+    1. number of validated datagrams per set (default 10000000)
+
+    Result is average time and rate per datagram. Every validated datagram is counted, so compiler
+    can not drop the loop.
+*/
+
+typedef std::chrono::steady_clock benchmarkClock;
+
+static std::vector<uint8_t> toPacket(ZrtpPacket* _message, uint8_t* _data){
+
+    _message->initializeMessageData();
+
+    std::vector<uint8_t> packet(_data, _data + _message->getWholePacketLength());
+    setPacketCrc(packet.data(), packet.size());
+
+    return packet;
+}
+
+static std::vector<std::vector<uint8_t>> createValidPackets(){
+
+    std::vector<std::vector<uint8_t>> packets;
+
+    HelloMessage hello;
+    hello.addHashAlgorithm((uint8_t*) "S256");
+    hello.addCipherAlgorithm((uint8_t*) "AES1");
+    hello.addAuthTagType((uint8_t*) "HS32");
+    hello.addKeyAgreementType((uint8_t*) "DH3k");
+    hello.addSasType((uint8_t*) "B32 ");
+    packets.push_back(toPacket(&hello, hello.getHelloData()));
+
+    HelloACKmessage helloAck;
+    packets.push_back(toPacket(&helloAck, helloAck.getHelloAckData()));
+
+    CommitMessage commit;
+    packets.push_back(toPacket(&commit, commit.getCommitData()));
+
+    DHPart dhPart;
+    dhPart.setMessageType((uint8_t*) "DHPart1 ");
+    packets.push_back(toPacket(&dhPart, dhPart.getDHData()));
+    dhPart.setMessageType((uint8_t*) "DHPart2 ");
+    packets.push_back(toPacket(&dhPart, dhPart.getDHData()));
+
+    ConfirmMessage confirm;
+    confirm.setMessageType((uint8_t*) "Confirm1");
+    packets.push_back(toPacket(&confirm, confirm.getConfirmData()));
+    confirm.setMessageType((uint8_t*) "Confirm2");
+    packets.push_back(toPacket(&confirm, confirm.getConfirmData()));
+
+    Conf2AckMessage conf2Ack;
+    packets.push_back(toPacket(&conf2Ack, conf2Ack.getConf2AckData()));
+
+    ErrorMessage error(MALFORMED_PACKET);
+    packets.push_back(toPacket(&error, error.getErrorData()));
+
+    ErrorAckMessage errorAck;
+    packets.push_back(toPacket(&errorAck, errorAck.getErrorAckData()));
+
+    return packets;
+}
+
+static std::vector<std::vector<uint8_t>> createJunkPackets(const std::vector<std::vector<uint8_t>>& _validPackets){
+
+    std::vector<std::vector<uint8_t>> packets;
+    std::mt19937 generator(2015);
+
+    for (unsigned int i = 0; i < _validPackets.size(); i++){
+        const std::vector<uint8_t>& valid = _validPackets[i];
+
+        // Random bytes of same length.
+        std::vector<uint8_t> random(valid.size());
+        for (unsigned int j = 0; j < random.size(); j++){
+            random[j] = generator();
+        }
+        packets.push_back(random);
+
+        // Truncated packet.
+        packets.push_back(std::vector<uint8_t>(valid.begin(), valid.begin() + valid.size() / 2));
+
+        // Broken magic cookie.
+        std::vector<uint8_t> cookie = valid;
+        cookie[PacketHeadLayout::MagicCookie::offset] ^= 0x20;
+        packets.push_back(cookie);
+
+        // Broken preamble.
+        std::vector<uint8_t> preamble = valid;
+        preamble[PacketHeadLayout::Preamble::offset] ^= 0x01;
+        packets.push_back(preamble);
+
+        // Declared length does not match datagram.
+        std::vector<uint8_t> length = valid;
+        length.resize(valid.size() + WORD_LENGTH);
+        packets.push_back(length);
+    }
+
+    return packets;
+}
+
+static void writeOutRate(const char* _name, benchmarkClock::duration _time, long _count, long _accepted){
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(_time).count() / _count;
+
+    cerr << std::fixed << std::setprecision(2);
+    cerr << _name << ": " << nanoseconds << " ns per datagram  "
+         << 1000.0 / nanoseconds << " M datagrams/s  accepted " << _accepted << "/" << _count << endl;
+}
+
+static void runValidation(const char* _name, const std::vector<std::vector<uint8_t>>& _packets, long _count){
+
+    long accepted = 0;
+
+    benchmarkClock::time_point start = benchmarkClock::now();
+    for (long i = 0; i < _count; i++){
+        const std::vector<uint8_t>& packet = _packets[i % _packets.size()];
+        accepted += (validatePacket(packet.data(), packet.size()) != UNKNOWN_MESSAGE);
+    }
+    writeOutRate(_name, benchmarkClock::now() - start, _count, accepted);
+}
+
+static void runCrcCheck(const char* _name, const std::vector<std::vector<uint8_t>>& _packets, long _count){
+
+    long accepted = 0;
+
+    benchmarkClock::time_point start = benchmarkClock::now();
+    for (long i = 0; i < _count; i++){
+        const std::vector<uint8_t>& packet = _packets[i % _packets.size()];
+        accepted += checkPacketCrc(packet.data(), packet.size());
+    }
+    writeOutRate(_name, benchmarkClock::now() - start, _count, accepted);
+}
+
+int main(int argc, char * argv[]){
+
+    long datagramCount = (argc > 1) ? atol(argv[1]) : 10000000;
+    if (datagramCount <= 0){
+        cerr << "Wrong number of datagrams" << endl;
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> validPackets = createValidPackets();
+    std::vector<std::vector<uint8_t>> junkPackets = createJunkPackets(validPackets);
+
+    for (unsigned int i = 0; i < validPackets.size(); i++){
+        if (validatePacket(validPackets[i].data(), validPackets[i].size()) != (MESSAGE_TYPE) i){
+            cerr << "Valid " << messageTypeString((MESSAGE_TYPE) i) << " packet was rejected" << endl;
+            return 1;
+        }
+    }
+
+    cerr << "Datagrams per set: " << datagramCount << endl;
+    runValidation("Validation of valid packets", validPackets, datagramCount);
+    runValidation("Validation of junk packets", junkPackets, datagramCount);
+    runCrcCheck("CRC check of valid packets", validPackets, datagramCount);
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "uringtransport.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+    Check of io_uring transport. Both checks use UringTransport only, application returns 1 if one fails.
+
+    Aplication takes 1 argument :
+    1. number of concurrent handshakes (default 64)
+
+    setup    : open() runs under address space limit, which is raised by one page after every failed
+               open() until open() succeeds, so ring mappings and registrations fail one after other.
+               Every failed open() must leave transport closed and transport must work after it.
+    loopback : responders run in transport on own thread, every initiator in own transport on main thread,
+               all bound to loopback. All handshakes must reach SecuredState in HANDSHAKE_DEADLINE.
+*/
+
+#define HANDSHAKE_DEADLINE std::chrono::seconds(30)
+
+// Address space added to limit in setup check, open() which does not succeed in it has failed.
+#define SETUP_LIMIT_MAXIMUM (16 * 1024 * 1024)
+
+typedef std::chrono::steady_clock checkClock;
+
+static sockaddr_in loopbackAddress(){
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    return address;
+}
+
+static size_t addressSpace(){
+
+    long pages = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm != nullptr){
+        if (fscanf(statm, "%ld", &pages) != 1){
+            pages = 0;
+        }
+        fclose(statm);
+    }
+
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
+static bool checkSetup(){
+
+    UringTransport transport;
+
+    rlimit original;
+    getrlimit(RLIMIT_AS, &original);
+
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t base = addressSpace();
+    int failedOpens = 0;
+    bool opened = false;
+
+    for (size_t margin = 0; margin <= SETUP_LIMIT_MAXIMUM && !opened; margin += pageSize){
+        rlimit limited = original;
+        limited.rlim_cur = std::min<rlim_t>(base + margin, original.rlim_cur);
+        setrlimit(RLIMIT_AS, &limited);
+
+        opened = transport.open(loopbackAddress());
+
+        setrlimit(RLIMIT_AS, &original);
+
+        if (!opened){
+            failedOpens++;
+            if (transport.getSocketDescriptor() >= 0){
+                cerr << "Failed open left socket open" << endl;
+                return false;
+            }
+        }
+    }
+
+    if (!opened && !transport.open(loopbackAddress())){
+        cerr << "Transport can not be opened after failed opens" << endl;
+        return false;
+    }
+
+    // Transport must still receive, datagram which is not ZRTP packet is counted and dropped.
+    sockaddr_in localAddress = transport.getLocalAddress();
+    uint8_t datagram[16];
+    memset(datagram, 0, sizeof(datagram));
+
+    int sender = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sendto(sender, datagram, sizeof(datagram), 0, (const sockaddr*) &localAddress, sizeof(localAddress));
+    ::close(sender);
+
+    checkClock::time_point start = checkClock::now();
+    while (transport.getStatistics().datagramsReceived == 0 && checkClock::now() - start < std::chrono::seconds(5)){
+        transport.runOnce(10);
+    }
+
+    cerr << std::dec << "Setup: " << failedOpens << " failed opens before open succeeded, datagrams received "
+         << transport.getStatistics().datagramsReceived << endl;
+
+    return transport.getStatistics().datagramsReceived == 1;
+}
+
+static bool checkLoopback(int _handshakes){
+
+    UringTransport server;
+    if (!server.open(loopbackAddress())){
+        cerr << "Server transport can not be opened" << endl;
+        return false;
+    }
+
+    server.setAcceptingSessions(true);
+    server.setNegotiationHandler([&server](ZrtpPoint* _point){server.removeSession(_point);});
+
+    int secured = 0;
+    bool opened = true;
+    std::vector<UringTransport*> clients;
+    sockaddr_in serverAddress = server.getLocalAddress();
+
+    // Transport keeps one session per remote address, so every initiator has own transport.
+    for (int i = 0; i < _handshakes; i++){
+        UringTransport* client = new UringTransport;
+        clients.push_back(client);
+
+        if (!client->open(loopbackAddress())){
+            cerr << "Client transport can not be opened" << endl;
+            opened = false;
+            break;
+        }
+        client->setNegotiationHandler([&secured](ZrtpPoint*){secured++;});
+
+        ZrtpPoint* point = client->addSession(INITIATOR, serverAddress);
+        point->setSourceIdentifier(i + 1);
+        point->startEngine();
+    }
+
+    std::thread serverThread([&server](){server.run();});
+
+    checkClock::time_point start = checkClock::now();
+    while (opened && secured < _handshakes && checkClock::now() - start < HANDSHAKE_DEADLINE){
+        for (unsigned int i = 0; i < clients.size(); i++){
+            clients[i]->runOnce(0);
+        }
+    }
+
+    server.stop();
+    serverThread.join();
+
+    double elapsed = std::chrono::duration<double, std::milli>(checkClock::now() - start).count();
+
+    TransportStatistics statistics = server.getStatistics();
+    for (unsigned int i = 0; i < clients.size(); i++){
+        statistics.datagramsSent += clients[i]->getStatistics().datagramsSent;
+        statistics.datagramsReceived += clients[i]->getStatistics().datagramsReceived;
+        statistics.sendsFailed += clients[i]->getStatistics().sendsFailed;
+        delete clients[i];
+    }
+
+    cerr << std::dec << std::fixed << std::setprecision(3);
+    cerr << "Loopback: " << secured << " of " << _handshakes << " handshakes secured in " << elapsed << " ms, sent "
+         << statistics.datagramsSent << " received " << statistics.datagramsReceived << " send failed "
+         << statistics.sendsFailed << endl;
+
+    return secured == _handshakes;
+}
+
+int main(int argc, char * argv[]){
+
+    int handshakeCount = (argc > 1) ? atoi(argv[1]) : 64;
+    if (handshakeCount <= 0){
+        cerr << "Wrong number of handshakes" << endl;
+        return 1;
+    }
+
+    // Engine writes out every state change, we do not want it in output of check.
+    std::streambuf* coutBuffer = cout.rdbuf(nullptr);
+
+    bool setupPassed = checkSetup();
+    bool loopbackPassed = checkLoopback(handshakeCount);
+
+    cout.rdbuf(coutBuffer);
+
+    return (setupPassed && loopbackPassed) ? 0 : 1;
+}
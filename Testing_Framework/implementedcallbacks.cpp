@@ -10,15 +10,15 @@ ImplementedCallbacks::~ImplementedCallbacks(){
 
 bool ImplementedCallbacks::sendData(const unsigned char *message, unsigned int length){
 
-    QByteArray dataToSend = QByteArray((char*) message, length);
-
     std::cout << "Sent message: ";
     for(int i = 16; i < 24; i++){
        std::cout << *(message + i);
     }
 
+    // Datagram is written from data of message, it is not copied to QByteArray.
     // If the datagram is too large, this function will return -1
-    if ( cbNetHandler->sendingSocket->writeDatagram(dataToSend, cbNetHandler->currentAddresses->sendingIPAdress,
+    if ( cbNetHandler->sendingSocket->writeDatagram((const char*) message, length,
+                                                    cbNetHandler->currentAddresses->sendingIPAdress,
                                                     cbNetHandler->currentAddresses->sendingPort) == -1){
 
         return false;
@@ -16,7 +16,6 @@ NetworkHandler::NetworkHandler(char *argv[], QObject *parent) :
     mutex = new QMutex();
     currentAddresses = new Addresses;    
     myThreads.reserve(20);
-    zrtpPointVector.reserve(applicationRunCounter);
 
     // Initiator send to 1234 and receive on 1244
     // Responder send to 1244 and receive on 1234
@@ -43,8 +42,8 @@ NetworkHandler::~NetworkHandler(){
 
     delete (receivingSocket);
     delete (sendingSocket);
+    // Callbacks are owned and deleted by ZRTP point.
     delete (zrtpPoint);
-    delete (callbacks);
     delete (currentAddresses);
 
     delete(timer);
@@ -54,12 +53,6 @@ NetworkHandler::~NetworkHandler(){
     delete(semaphore2);
 
     eraseThreads();
-
-    ZrtpPoint* pointToDelete;
-    for(std::vector<ZrtpPoint*>::iterator it = zrtpPointVector.begin(); it != zrtpPointVector.end(); ++it){
-        pointToDelete = *it;
-        delete  pointToDelete;
-    }
 }
 
 void NetworkHandler::setAddresses(Addresses *_addresses, quint16 _sendingPort,
@@ -196,8 +189,8 @@ void NetworkHandler::endAplication() {
         qDebug() << "**************************************************" ;
         qDebug();
 
-        zrtpPointVector.push_back(zrtpPoint);
-        zrtpPoint = new ZrtpPoint(currentRole, callbacks);
+        // Same point is used again, it keeps ZID and supported algorithms.
+        zrtpPoint->reset();
 
         (currentRole == INITIATOR) ? semaphore1->release() : semaphore2->release();
         (currentRole == INITIATOR) ? semaphore2->acquire() : semaphore1->acquire();
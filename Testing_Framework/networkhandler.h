@@ -78,7 +78,6 @@ private:
     role currentRole;
 
     std::vector<QThread*> myThreads;
-    std::vector<ZrtpPoint*> zrtpPointVector;
 };
 
 #endif // NETWORKHANDLER_H
@@ -7,3 +7,18 @@ Callbacks::Callbacks()
 Callbacks::~Callbacks(){
 
 }
+
+unsigned char* Callbacks::leaseSendBuffer(unsigned int){
+
+    // Transport does not lease buffers by default.
+    return nullptr;
+}
+
+bool Callbacks::sendLeasedData(unsigned char *buffer, unsigned int length){
+
+    return sendData(buffer, length);
+}
+
+void Callbacks::releaseSendBuffer(unsigned char *){
+
+}
@@ -26,6 +26,29 @@ public:
      */
     virtual bool sendData(const unsigned char* message, unsigned int length) = 0;
 
+    // Leasing of send buffers is optional, transport which does not lease buffers keeps default implementation.
+    /**
+     * @brief leaseSendBuffer lease buffer for packet which is kept for retransmission. Packet is written to buffer
+     *        once and it is not changed until buffer is released, so transport can hand it to kernel without copy.
+     * @param length of packet.
+     * @return leased buffer or nullptr, packet is then sent from data of message by sendData().
+     */
+    virtual unsigned char* leaseSendBuffer(unsigned int length);
+
+    /**
+     * @brief sendLeasedData send packet from leased buffer, buffer stays leased and it is sent again on timeout.
+     * @param buffer leased by leaseSendBuffer().
+     * @param length of sended message.
+     * @return true if succesfull false otherwise.
+     */
+    virtual bool sendLeasedData(unsigned char* buffer, unsigned int length);
+
+    /**
+     * @brief releaseSendBuffer return leased buffer, packet in it is not resent any more.
+     * @param buffer leased by leaseSendBuffer().
+     */
+    virtual void releaseSendBuffer(unsigned char* buffer);
+
     /**
      * @brief startTimer start implemented timer.
      * @param time in milisecond.
@@ -45,7 +68,7 @@ public:
     virtual void keyNegotitationEnded() = 0;
 
 
-    // Critical Section handling
+    // Critical Section handling, it is not used for sessions run by SessionScheduler.
     /**
      * @brief enterCriticalSection this function should lock the mutex in your implementation.
      */
@@ -0,0 +1,139 @@
+#include "cryptopool.h"
+
+CryptoPool::CryptoPool(unsigned int _threadsCount){
+
+    stopping = false;
+
+    if (_threadsCount == 0){
+        _threadsCount = std::thread::hardware_concurrency();
+    }
+
+    if (_threadsCount == 0){
+        _threadsCount = 1;
+    }
+
+    workers.reserve(_threadsCount);
+    for (unsigned int i = 0; i < _threadsCount; i++){
+        workers.push_back(std::thread(&CryptoPool::workerLoop, this));
+    }
+}
+
+CryptoPool::~CryptoPool(){
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobAvailable.notify_all();
+
+    for (unsigned int i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+}
+
+void CryptoPool::submit(const void *_owner, cryptoTask _task, cryptoTask _completion){
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        jobs.push_back({_owner, _task, _completion});
+    }
+    jobAvailable.notify_one();
+}
+
+void CryptoPool::cancel(const void *_owner){
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    for (std::deque<CryptoJob>::iterator it = jobs.begin(); it != jobs.end();){
+        if (it->owner == _owner){
+            it = jobs.erase(it);
+        }   else {
+                ++it;
+            }
+    }
+
+    jobFinished.notify_all();
+}
+
+bool CryptoPool::isOwnerBusy(const void *_owner){
+
+    for (unsigned int i = 0; i < jobs.size(); i++){
+        if (jobs[i].owner == _owner){
+            return true;
+        }
+    }
+
+    for (unsigned int i = 0; i < runningJobs.size(); i++){
+        if (runningJobs[i].owner == _owner && runningJobs[i].thread != std::this_thread::get_id()){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CryptoPool::isOwnerComputing(const void *_owner){
+
+    for (unsigned int i = 0; i < runningJobs.size(); i++){
+        if (runningJobs[i].owner == _owner && runningJobs[i].computing && runningJobs[i].thread != std::this_thread::get_id()){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CryptoPool::waitForOwner(const void *_owner){
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    jobFinished.wait(lock, [this, _owner](){return !isOwnerBusy(_owner);});
+}
+
+void CryptoPool::waitForComputation(const void *_owner){
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    jobFinished.wait(lock, [this, _owner](){return !isOwnerComputing(_owner);});
+}
+
+void CryptoPool::workerLoop(){
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+
+    while (true){
+        jobAvailable.wait(lock, [this](){return stopping || !jobs.empty();});
+
+        if (stopping){
+            return;
+        }
+
+        CryptoJob job = jobs.front();
+        jobs.pop_front();
+        runningJobs.push_back({job.owner, std::this_thread::get_id(), true});
+
+        // Computation and completion run without pool lock, completion takes owners lock.
+        lock.unlock();
+        job.task();
+        lock.lock();
+
+        std::vector<RunningJob>::iterator running = runningJobs.begin();
+        while (running->thread != std::this_thread::get_id()){
+            ++running;
+        }
+        running->computing = false;
+        jobFinished.notify_all();
+
+        lock.unlock();
+        job.completion();
+        lock.lock();
+
+        // Other jobs could be added or removed while completion ran, so entry is looked up again.
+        for (std::vector<RunningJob>::iterator it = runningJobs.begin(); it != runningJobs.end(); ++it){
+            if (it->thread == std::this_thread::get_id()){
+                runningJobs.erase(it);
+                break;
+            }
+        }
+        jobFinished.notify_all();
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef CRYPTOPOOL_H
+#define CRYPTOPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <deque>
+
+/**
+ * @brief The CryptoPool class represent pool of threads, which compute heavy cryptographic operations
+ *        (DH result and key derivation) outside of state machine critical section.
+ *        One pool can be shared by many ZRTP points.
+ */
+class CryptoPool{
+
+public:
+
+    typedef std::function<void(void)> cryptoTask;
+
+private:
+
+    // Job waiting in queue.
+    typedef struct{
+        const void* owner;
+        cryptoTask task;
+        cryptoTask completion;
+    } CryptoJob;
+
+    // Job which is computed by one of pool threads, computing is cleared when task is done and
+    // completion runs.
+    typedef struct{
+        const void* owner;
+        std::thread::id thread;
+        bool computing;
+    } RunningJob;
+
+    std::vector<std::thread> workers;
+    std::deque<CryptoJob> jobs;
+    std::vector<RunningJob> runningJobs;
+
+    std::mutex poolMutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobFinished;
+
+    bool stopping;
+
+    /**
+     * @brief workerLoop take jobs from queue and compute them until pool is destroyed.
+     */
+    void workerLoop();
+
+    /**
+     * @brief isOwnerBusy check if owner has job in queue or job computed by other thread.
+     * @param _owner to check.
+     * @return true if owner has unfinished job.
+     */
+    bool isOwnerBusy(const void* _owner);
+
+    /**
+     * @brief isOwnerComputing check if task of owner is computed by other thread.
+     * @param _owner to check.
+     * @return true if task of owner runs.
+     */
+    bool isOwnerComputing(const void* _owner);
+
+public:
+
+    /**
+     * @brief CryptoPool constructor start pool threads.
+     * @param _threadsCount count of threads, 0 means one thread per core.
+     */
+    CryptoPool(unsigned int _threadsCount = 0);
+
+    /**
+     * @brief ~CryptoPool stop all threads, jobs which were not started are dropped.
+     */
+    ~CryptoPool();
+
+    /**
+     * @brief submit put job to queue.
+     * @param _owner session which submited job, jobs can be cancelled by owner.
+     * @param _task heavy computation, it runs in pool thread without any lock held.
+     * @param _completion called in the same pool thread right after task, it should
+     *        pass result back to owner.
+     */
+    void submit(const void* _owner, cryptoTask _task, cryptoTask _completion);
+
+    /**
+     * @brief cancel remove all jobs of owner from queue. Job which is already computed is not
+     *        interrupted, owner must drop its result. Function does not block.
+     * @param _owner whose jobs are cancelled.
+     */
+    void cancel(const void* _owner);
+
+    /**
+     * @brief waitForOwner block until owner has no job in queue and no job computed
+     *        (job computed by calling thread is not waited for).
+     * @param _owner to wait for.
+     */
+    void waitForOwner(const void* _owner);
+
+    /**
+     * @brief waitForComputation block until no task of owner is computed by other thread. Completions
+     *        are not waited for, so owner can wait with its lock held, which completion takes.
+     * @param _owner to wait for.
+     */
+    void waitForComputation(const void* _owner);
+
+    /**
+     * @brief getThreadsCount getter for count of pool threads.
+     * @return count of threads.
+     */
+    unsigned int getThreadsCount() {return workers.size();}
+};
+
+#endif // CRYPTOPOOL_H
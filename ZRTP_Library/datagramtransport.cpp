@@ -0,0 +1,232 @@
+#include "datagramtransport.h"
+#include "zrtpPacket/packetvalidator.h"
+
+bool DatagramTransport::SessionCallbacks::sendData(const unsigned char *message, unsigned int length){
+
+    return transport->queueSend(session->remote, message, length, false);
+}
+
+unsigned char* DatagramTransport::SessionCallbacks::leaseSendBuffer(unsigned int length){
+
+    return transport->leaseBuffer(length);
+}
+
+bool DatagramTransport::SessionCallbacks::sendLeasedData(unsigned char *buffer, unsigned int length){
+
+    return transport->queueSend(session->remote, buffer, length, true);
+}
+
+void DatagramTransport::SessionCallbacks::releaseSendBuffer(unsigned char *buffer){
+
+    transport->releaseBuffer(buffer);
+}
+
+bool DatagramTransport::SessionCallbacks::startTimer(int time){
+
+    session->timerGeneration++;
+    transport->timers.push({transport->getTime() + std::chrono::milliseconds(time), session->key, session->timerGeneration});
+
+    return true;
+}
+
+bool DatagramTransport::SessionCallbacks::stopTimer(){
+
+    session->timerGeneration++;
+
+    return true;
+}
+
+void DatagramTransport::SessionCallbacks::keyNegotitationEnded(){
+
+    transport->endedNegotiations.push_back(session->point);
+}
+
+DatagramTransport::DatagramTransport(){
+
+    acceptingSessions = false;
+    sessionPool = nullptr;
+}
+
+DatagramTransport::~DatagramTransport(){
+
+    removeAllSessions();
+
+    for (unsigned int i = 0; i < sendBuffers.size(); i++){
+        delete[] sendBuffers[i];
+    }
+}
+
+ZrtpPoint* DatagramTransport::addSession(role _role, const sockaddr_in &_remote){
+
+    uint64_t key = addressKey(_remote);
+    if (sessions.count(key) != 0){
+        return nullptr;
+    }
+
+    Session* session = new Session;
+    session->remote = _remote;
+    session->key = key;
+    session->timerGeneration = 0;
+
+    if (sessionPool != nullptr){
+        session->point = sessionPool->acquire(_role, new SessionCallbacks(this, session));
+    }   else {
+            session->point = new ZrtpPoint(_role, new SessionCallbacks(this, session));
+        }
+
+    sessions[key] = session;
+    sessionsByPoint[session->point] = session;
+
+    return session->point;
+}
+
+void DatagramTransport::removeAllSessions(){
+
+    for (auto& entry : sessions){
+        releasePoint(entry.second->point);
+        delete entry.second;
+    }
+
+    sessions.clear();
+    sessionsByPoint.clear();
+}
+
+void DatagramTransport::removeSession(ZrtpPoint *_point){
+
+    auto found = sessionsByPoint.find(_point);
+    if (found == sessionsByPoint.end()){
+        return;
+    }
+
+    Session* session = found->second;
+    sessionsByPoint.erase(found);
+    sessions.erase(session->key);
+
+    // Timer entries of session are skipped, key is not found any more.
+    releasePoint(session->point);
+    delete session;
+}
+
+void DatagramTransport::releasePoint(ZrtpPoint *_point){
+
+    if (sessionPool == nullptr){
+        delete _point;
+        return;
+    }
+
+    // Leased buffer of point goes back to transport on loop thread, pool thread resets point without callbacks.
+    _point->setCallbacks(nullptr);
+    sessionPool->release(_point);
+}
+
+uint8_t* DatagramTransport::leaseBuffer(unsigned int _length){
+
+    if (_length > MAXIMUM_PACKET_LENGTH){
+        return nullptr;
+    }
+
+    if (freeSendBuffers.empty()){
+        uint8_t* buffer = new uint8_t[MAXIMUM_PACKET_LENGTH];
+        sendBuffers.push_back(buffer);
+        return buffer;
+    }
+
+    uint8_t* buffer = freeSendBuffers.back();
+    freeSendBuffers.pop_back();
+
+    return buffer;
+}
+
+void DatagramTransport::deliver(const sockaddr_in &_remote, uint8_t *_data, unsigned int _length){
+
+    statistics.datagramsReceived++;
+
+    // Junk is dropped before session lookup.
+    MESSAGE_TYPE messageType = validatePacket(_data, _length);
+    if (messageType == UNKNOWN_MESSAGE){
+        statistics.datagramsDropped++;
+        return;
+    }
+
+    ZrtpPoint* point;
+    auto found = sessions.find(addressKey(_remote));
+
+    if (found != sessions.end()){
+        point = found->second->point;
+    }   else if (acceptingSessions && messageType == HELLO_MESSAGE){
+            point = addSession(RESPONDER, _remote);
+            point->startEngine();
+        }   else {
+                statistics.datagramsDropped++;
+                return;
+            }
+
+    // Datagram was validated above, point checks only its CRC.
+    point->processValidatedMessage(_data, _length);
+}
+
+void DatagramTransport::fireExpiredTimers(){
+
+    transportClock::time_point now = getTime();
+
+    while (!timers.empty() && timers.top().deadline <= now){
+        TimerEntry entry = timers.top();
+        timers.pop();
+
+        auto found = sessions.find(entry.sessionKey);
+        if (found == sessions.end() || found->second->timerGeneration != entry.generation){
+            continue;
+        }
+
+        found->second->point->processTimeout();
+    }
+}
+
+bool DatagramTransport::getNextDeadline(transportClock::time_point &_deadline){
+
+    // Old entries on top would wake loop for nothing.
+    while (!timers.empty()){
+        auto found = sessions.find(timers.top().sessionKey);
+        if (found != sessions.end() && found->second->timerGeneration == timers.top().generation){
+            _deadline = timers.top().deadline;
+            return true;
+        }
+        timers.pop();
+    }
+
+    return false;
+}
+
+int DatagramTransport::getTimerTimeout(){
+
+    transportClock::time_point deadline;
+    if (!getNextDeadline(deadline)){
+        return -1;
+    }
+
+    transportClock::duration remaining = deadline - getTime();
+    if (remaining <= transportClock::duration::zero()){
+        return 0;
+    }
+
+    return std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+}
+
+void DatagramTransport::reportEndedNegotiations(){
+
+    // Handler can remove points, so list is swapped out before it is called.
+    std::vector<ZrtpPoint*> ended;
+    ended.swap(endedNegotiations);
+
+    for (unsigned int i = 0; i < ended.size(); i++){
+        if (negotiationEnded && sessionsByPoint.count(ended[i]) != 0){
+            negotiationEnded(ended[i]);
+        }
+    }
+}
+
+void DatagramTransport::recycleSendBuffers(){
+
+    freeSendBuffers.insert(freeSendBuffers.end(), releasedSendBuffers.begin(), releasedSendBuffers.end());
+    releasedSendBuffers.clear();
+}
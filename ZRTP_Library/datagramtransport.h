@@ -0,0 +1,248 @@
+#ifndef DATAGRAMTRANSPORT_H
+#define DATAGRAMTRANSPORT_H
+
+#include "zrtppoint.h"
+#include "sessionpool.h"
+#include <netinet/in.h>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The TransportStatistics struct count work of transport since it was opened.
+ */
+struct TransportStatistics{
+    uint64_t datagramsReceived = 0;
+    uint64_t datagramsDropped = 0;
+    uint64_t datagramsSent = 0;
+    uint64_t sendsFailed = 0;
+    uint64_t receiveCalls = 0;
+    uint64_t sendCalls = 0;
+    uint64_t systemCalls = 0;
+};
+
+/**
+ * @brief The DatagramTransport class is base class for native UDP transports and loopback transport. It keeps
+ *        ZRTP points of remote addresses, implements their callbacks and runs their timers, derived transport
+ *        only moves datagrams between socket or channel and deliver() / queueSend(). All points of transport run on
+ *        thread which runs its loop, so they must not use crypto pool or session scheduler.
+ */
+class DatagramTransport{
+
+public:
+
+    typedef std::chrono::steady_clock transportClock;
+    typedef std::function<void(ZrtpPoint*)> negotiationHandler;
+
+protected:
+
+    typedef struct{
+        sockaddr_in remote;
+        ZrtpPoint* point;
+        uint64_t key;
+        uint32_t timerGeneration;
+    } Session;
+
+    // Timer entry is not removed on stop or restart, it is skipped when its generation is old.
+    typedef struct TimerEntry{
+        transportClock::time_point deadline;
+        uint64_t sessionKey;
+        uint32_t generation;
+
+        bool operator>(const TimerEntry& _other) const {return deadline > _other.deadline;}
+    } TimerEntry;
+
+    /**
+     * @brief The SessionCallbacks class connect one ZRTP point to transport.
+     */
+    class SessionCallbacks : public Callbacks{
+
+        DatagramTransport* transport;
+        Session* session;
+
+    public:
+
+        SessionCallbacks(DatagramTransport* _transport, Session* _session) : transport(_transport), session(_session) {}
+
+        virtual bool sendData(const unsigned char* message, unsigned int length);
+        virtual unsigned char* leaseSendBuffer(unsigned int length);
+        virtual bool sendLeasedData(unsigned char* buffer, unsigned int length);
+        virtual void releaseSendBuffer(unsigned char* buffer);
+        virtual bool startTimer(int time);
+        virtual bool stopTimer();
+        virtual void keyNegotitationEnded();
+
+        // Points of transport run only on its loop thread.
+        virtual void enterCriticalSection() {}
+        virtual void leaveCriticalSection() {}
+    };
+
+    std::unordered_map<uint64_t, Session*> sessions;
+    std::unordered_map<ZrtpPoint*, Session*> sessionsByPoint;
+
+    std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timers;
+
+    // Buffers of retained packets, released buffer can still wait in send batch, so it is reused after flush.
+    std::vector<uint8_t*> sendBuffers;
+    std::vector<uint8_t*> freeSendBuffers;
+    std::vector<uint8_t*> releasedSendBuffers;
+
+    negotiationHandler negotiationEnded;
+    bool acceptingSessions;
+
+    // Points of sessions are taken from pool and returned to it, when pool is set.
+    SessionPool* sessionPool;
+
+    // Handler is called after point returns, so it can remove the point.
+    std::vector<ZrtpPoint*> endedNegotiations;
+
+    TransportStatistics statistics;
+
+    /**
+     * @brief queueSend put datagram to send batch of transport.
+     * @param _remote address of receiver.
+     * @param _data datagram.
+     * @param _length length of datagram.
+     * @param _retained true if data stay unchanged until flush (leased buffer), false if they must be copied.
+     * @return true if datagram was queued or sent.
+     */
+    virtual bool queueSend(const sockaddr_in& _remote, const uint8_t* _data, unsigned int _length, bool _retained) = 0;
+
+    /**
+     * @brief leaseBuffer lease buffer for retained packet of point.
+     * @param _length length of packet.
+     * @return buffer of MAXIMUM_PACKET_LENGTH bytes, nullptr if packet is longer.
+     */
+    virtual uint8_t* leaseBuffer(unsigned int _length);
+
+    /**
+     * @brief releaseBuffer return leased buffer, it is reused after send batch which can hold it is flushed.
+     * @param _buffer leased buffer.
+     */
+    virtual void releaseBuffer(uint8_t* _buffer) {releasedSendBuffers.push_back(_buffer);}
+
+    /**
+     * @brief deliver validate received datagram and pass it to point of sender. Hello from unknown address
+     *        creates RESPONDER session when sessions are accepted.
+     * @param _remote address of sender.
+     * @param _data datagram.
+     * @param _length length of datagram.
+     */
+    void deliver(const sockaddr_in& _remote, uint8_t* _data, unsigned int _length);
+
+    /**
+     * @brief fireExpiredTimers process timeout of every session whose timer expired.
+     */
+    virtual void fireExpiredTimers();
+
+    /**
+     * @brief getNextDeadline find nearest deadline of running timer, old timer entries are dropped.
+     * @param _deadline nearest deadline.
+     * @return false if no timer runs.
+     */
+    virtual bool getNextDeadline(transportClock::time_point& _deadline);
+
+    /**
+     * @brief reportEndedNegotiations call negotiation handler for points which ended key negotiation.
+     */
+    void reportEndedNegotiations();
+
+    /**
+     * @brief removeAllSessions delete all points, derived transport calls it while its buffers still exist.
+     */
+    void removeAllSessions();
+
+    /**
+     * @brief releasePoint delete point of removed session or return it to session pool.
+     * @param _point point of session.
+     */
+    void releasePoint(ZrtpPoint* _point);
+
+    /**
+     * @brief recycleSendBuffers make buffers released before flush of send batch free again.
+     */
+    void recycleSendBuffers();
+
+    /**
+     * @brief addressKey key of session in table of sessions.
+     * @param _remote IPv4 address and port.
+     * @return key of address.
+     */
+    static uint64_t addressKey(const sockaddr_in& _remote)
+        {return ((uint64_t) _remote.sin_addr.s_addr << 16) | _remote.sin_port;}
+
+public:
+
+    DatagramTransport();
+
+    /**
+     * @brief ~DatagramTransport delete all points of transport.
+     */
+    virtual ~DatagramTransport();
+
+    DatagramTransport(const DatagramTransport&) = delete;
+    DatagramTransport& operator=(const DatagramTransport&) = delete;
+
+    /**
+     * @brief addSession create ZRTP point which exchanges packets with remote address. Point is owned by
+     *        transport and it is started by caller on loop thread.
+     * @param _role INITIATOR or RESPONDER.
+     * @param _remote IPv4 address and port of other endpoint.
+     * @return new point, nullptr if address has session already.
+     */
+    ZrtpPoint* addSession(role _role, const sockaddr_in& _remote);
+
+    /**
+     * @brief removeSession delete point and its session.
+     * @param _point point created by transport.
+     */
+    void removeSession(ZrtpPoint* _point);
+
+    /**
+     * @brief getTime current time of transport, timers of points are measured by it.
+     * @return steady clock time, decorator can replace it with simulated time.
+     */
+    virtual transportClock::time_point getTime() {return transportClock::now();}
+
+    /**
+     * @brief setNegotiationHandler set function called on loop thread when point ends key negotiation.
+     * @param _handler handler, it can remove the point.
+     */
+    void setNegotiationHandler(negotiationHandler _handler) {negotiationEnded = _handler;}
+
+    /**
+     * @brief setAcceptingSessions allow Hello from unknown address to create RESPONDER session.
+     * @param _accepting true to accept sessions.
+     */
+    void setAcceptingSessions(bool _accepting) {acceptingSessions = _accepting;}
+
+    /**
+     * @brief setSessionPool take points of new sessions from pool and return points of removed sessions
+     *        to it, instead of creating and deleting them. Pool must outlive transport.
+     * @param _sessionPool pool of prepared points, nullptr creates every point again.
+     */
+    void setSessionPool(SessionPool* _sessionPool) {sessionPool = _sessionPool;}
+
+    /**
+     * @brief getTimerTimeout time until nearest timer expires, loop which waits for several transports
+     *        uses it for its wait.
+     * @return time in milliseconds rounded up, -1 if no timer runs.
+     */
+    int getTimerTimeout();
+
+    /**
+     * @brief getSessionsCount getter for count of sessions.
+     * @return count of points owned by transport.
+     */
+    unsigned int getSessionsCount() {return sessions.size();}
+
+    /**
+     * @brief getStatistics getter for counters of transport.
+     * @return statistics.
+     */
+    const TransportStatistics& getStatistics() {return statistics;}
+};
+
+#endif // DATAGRAMTRANSPORT_H
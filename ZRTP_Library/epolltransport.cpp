@@ -0,0 +1,256 @@
+#include "epolltransport.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+EpollTransport::EpollTransport(){
+
+    socketDescriptor = -1;
+    epollDescriptor = -1;
+    wakeDescriptor = -1;
+    sendCount = 0;
+    stopping = false;
+
+    for (unsigned int i = 0; i < TRANSPORT_RECEIVE_BATCH; i++){
+        receiveVectors[i].iov_base = receiveBuffers[i];
+        receiveVectors[i].iov_len = MAXIMUM_PACKET_LENGTH;
+
+        memset(&receiveMessages[i], 0, sizeof(mmsghdr));
+        receiveMessages[i].msg_hdr.msg_name = &receiveAddresses[i];
+        receiveMessages[i].msg_hdr.msg_iov = &receiveVectors[i];
+        receiveMessages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for (unsigned int i = 0; i < TRANSPORT_SEND_BATCH; i++){
+        memset(&sendMessages[i], 0, sizeof(mmsghdr));
+        sendMessages[i].msg_hdr.msg_name = &sendAddresses[i];
+        sendMessages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        sendMessages[i].msg_hdr.msg_iov = &sendVectors[i];
+        sendMessages[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+EpollTransport::~EpollTransport(){
+
+    close();
+}
+
+bool EpollTransport::open(const sockaddr_in &_localAddress, bool _reusePort){
+
+    socketDescriptor = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socketDescriptor < 0){
+        return false;
+    }
+
+    int reusePort = 1;
+    if (_reusePort && setsockopt(socketDescriptor, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort)) != 0){
+        close();
+        return false;
+    }
+
+    if (bind(socketDescriptor, (const sockaddr*) &_localAddress, sizeof(_localAddress)) != 0){
+        close();
+        return false;
+    }
+
+    epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    wakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollDescriptor < 0 || wakeDescriptor < 0){
+        close();
+        return false;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+
+    event.data.fd = socketDescriptor;
+    if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, socketDescriptor, &event) != 0){
+        close();
+        return false;
+    }
+
+    event.data.fd = wakeDescriptor;
+    if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeDescriptor, &event) != 0){
+        close();
+        return false;
+    }
+
+    stopping = false;
+
+    return true;
+}
+
+void EpollTransport::close(){
+
+    if (socketDescriptor >= 0){
+        flush();
+        ::close(socketDescriptor);
+        socketDescriptor = -1;
+    }
+
+    if (epollDescriptor >= 0){
+        ::close(epollDescriptor);
+        epollDescriptor = -1;
+    }
+
+    if (wakeDescriptor >= 0){
+        ::close(wakeDescriptor);
+        wakeDescriptor = -1;
+    }
+}
+
+sockaddr_in EpollTransport::getLocalAddress(){
+
+    sockaddr_in localAddress;
+    socklen_t addressLength = sizeof(localAddress);
+
+    memset(&localAddress, 0, sizeof(localAddress));
+    getsockname(socketDescriptor, (sockaddr*) &localAddress, &addressLength);
+
+    return localAddress;
+}
+
+bool EpollTransport::queueSend(const sockaddr_in &_remote, const uint8_t *_data, unsigned int _length, bool _retained){
+
+    if (socketDescriptor < 0 || _length > MAXIMUM_PACKET_LENGTH){
+        statistics.sendsFailed++;
+        return false;
+    }
+
+    if (sendCount == TRANSPORT_SEND_BATCH){
+        flush();
+    }
+
+    // Leased buffer is not changed until flush, other data are copied.
+    if (_retained){
+        sendVectors[sendCount].iov_base = (void*) _data;
+    }   else {
+            memcpy(sendCopies[sendCount], _data, _length);
+            sendVectors[sendCount].iov_base = sendCopies[sendCount];
+        }
+
+    sendVectors[sendCount].iov_len = _length;
+    sendAddresses[sendCount] = _remote;
+    sendCount++;
+
+    return true;
+}
+
+void EpollTransport::flush(){
+
+    unsigned int sent = 0;
+
+    while (sent < sendCount){
+        int result = sendmmsg(socketDescriptor, sendMessages + sent, sendCount - sent, 0);
+        statistics.sendCalls++;
+        statistics.systemCalls++;
+
+        if (result < 0){
+            if (errno == EINTR){
+                continue;
+            }
+
+            // Datagram which could not be sent is dropped, retransmission timer of point sends it again.
+            statistics.sendsFailed++;
+            sent++;
+            continue;
+        }
+
+        statistics.datagramsSent += result;
+        sent += result;
+    }
+
+    sendCount = 0;
+    recycleSendBuffers();
+}
+
+void EpollTransport::receiveBatches(){
+
+    for (int round = 0; round < TRANSPORT_RECEIVE_ROUNDS; round++){
+
+        for (unsigned int i = 0; i < TRANSPORT_RECEIVE_BATCH; i++){
+            receiveMessages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+
+        int received = recvmmsg(socketDescriptor, receiveMessages, TRANSPORT_RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+        statistics.receiveCalls++;
+        statistics.systemCalls++;
+
+        if (received <= 0){
+            return;
+        }
+
+        for (int i = 0; i < received; i++){
+
+            // Datagram longer than any ZRTP packet is junk.
+            if (receiveMessages[i].msg_hdr.msg_flags & MSG_TRUNC){
+                statistics.datagramsReceived++;
+                statistics.datagramsDropped++;
+                continue;
+            }
+
+            deliver(receiveAddresses[i], receiveBuffers[i], receiveMessages[i].msg_len);
+        }
+
+        // Answers to whole batch leave in one call.
+        flush();
+        reportEndedNegotiations();
+
+        if (received < TRANSPORT_RECEIVE_BATCH){
+            return;
+        }
+    }
+}
+
+bool EpollTransport::runOnce(int _maximumWait){
+
+    if (epollDescriptor < 0 || stopping){
+        return false;
+    }
+
+    // Packets queued by points started outside of loop are sent before wait.
+    flush();
+
+    int timeout = getTimerTimeout();
+    if (timeout < 0 || (_maximumWait >= 0 && _maximumWait < timeout)){
+        timeout = _maximumWait;
+    }
+
+    epoll_event events[2];
+    int ready = epoll_wait(epollDescriptor, events, 2, timeout);
+    statistics.systemCalls++;
+
+    if (ready < 0 && errno != EINTR){
+        return false;
+    }
+
+    for (int i = 0; i < ready; i++){
+        if (events[i].data.fd == socketDescriptor){
+            receiveBatches();
+        }
+    }
+
+    fireExpiredTimers();
+    flush();
+    reportEndedNegotiations();
+
+    return !stopping;
+}
+
+void EpollTransport::run(){
+
+    while (runOnce(-1)){
+    }
+}
+
+void EpollTransport::stop(){
+
+    stopping = true;
+
+    uint64_t wake = 1;
+    if (write(wakeDescriptor, &wake, sizeof(wake)) < 0){
+        return;
+    }
+}
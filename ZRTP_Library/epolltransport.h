@@ -0,0 +1,114 @@
+#ifndef EPOLLTRANSPORT_H
+#define EPOLLTRANSPORT_H
+
+#include "datagramtransport.h"
+#include "zrtpPacket/packetvalidator.h"
+#include <sys/socket.h>
+#include <atomic>
+
+// Count of datagrams read by one recvmmsg() and sent by one sendmmsg().
+#define TRANSPORT_RECEIVE_BATCH 32
+#define TRANSPORT_SEND_BATCH 32
+
+// Batches read at one wake up, timers are not delayed by flood of packets.
+#define TRANSPORT_RECEIVE_ROUNDS 8
+
+/**
+ * @brief The EpollTransport class represent native Linux UDP transport. Non-blocking socket is waited
+ *        for by epoll, datagrams are read in batches by recvmmsg() to receive buffers registered once
+ *        at open and they are passed to points one after another. Packets sent by points are collected
+ *        and sent by one sendmmsg() after every batch, retained packets are sent from leased buffers
+ *        without copy.
+ */
+class EpollTransport : public DatagramTransport{
+
+    int socketDescriptor;
+    int epollDescriptor;
+
+    // Event which wakes loop from other thread on stop().
+    int wakeDescriptor;
+
+    std::atomic<bool> stopping;
+
+    // Receive buffers, addresses and headers are connected once at open.
+    uint8_t receiveBuffers[TRANSPORT_RECEIVE_BATCH][MAXIMUM_PACKET_LENGTH];
+    sockaddr_in receiveAddresses[TRANSPORT_RECEIVE_BATCH];
+    iovec receiveVectors[TRANSPORT_RECEIVE_BATCH];
+    mmsghdr receiveMessages[TRANSPORT_RECEIVE_BATCH];
+
+    // Send batch, copied datagrams are kept in send buffers.
+    uint8_t sendCopies[TRANSPORT_SEND_BATCH][MAXIMUM_PACKET_LENGTH];
+    sockaddr_in sendAddresses[TRANSPORT_SEND_BATCH];
+    iovec sendVectors[TRANSPORT_SEND_BATCH];
+    mmsghdr sendMessages[TRANSPORT_SEND_BATCH];
+    unsigned int sendCount;
+
+protected:
+
+    virtual bool queueSend(const sockaddr_in& _remote, const uint8_t* _data, unsigned int _length, bool _retained);
+
+private:
+
+    /**
+     * @brief receiveBatches read datagrams until socket is empty or rounds limit is reached.
+     */
+    void receiveBatches();
+
+public:
+
+    EpollTransport();
+
+    /**
+     * @brief ~EpollTransport close socket and delete all points of transport.
+     */
+    virtual ~EpollTransport();
+
+    /**
+     * @brief open create socket bound to local address and register it in epoll.
+     * @param _localAddress IPv4 address and port, port 0 lets system choose one.
+     * @param _reusePort true to join SO_REUSEPORT group of sockets bound to same address.
+     * @return true if succesfull false otherwise.
+     */
+    bool open(const sockaddr_in& _localAddress, bool _reusePort = false);
+
+    /**
+     * @brief close close socket, points are kept.
+     */
+    void close();
+
+    /**
+     * @brief getLocalAddress getter for address to which socket is bound.
+     * @return bound address.
+     */
+    sockaddr_in getLocalAddress();
+
+    /**
+     * @brief getSocketDescriptor getter for socket of transport.
+     * @return socket, -1 if transport is closed.
+     */
+    int getSocketDescriptor() {return socketDescriptor;}
+
+    /**
+     * @brief flush send all datagrams of send batch.
+     */
+    void flush();
+
+    /**
+     * @brief runOnce wait for datagrams or timer at most given time, handle them and send answers.
+     * @param _maximumWait longest wait in milliseconds, -1 waits until event comes.
+     * @return false if loop was stopped or socket failed.
+     */
+    bool runOnce(int _maximumWait);
+
+    /**
+     * @brief run handle datagrams and timers until stop() is called.
+     */
+    void run();
+
+    /**
+     * @brief stop end run(), it can be called from any thread.
+     */
+    void stop();
+};
+
+#endif // EPOLLTRANSPORT_H
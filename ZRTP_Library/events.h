@@ -6,13 +6,15 @@ typedef enum _ZrtpEventType{
     START,
     STOP,
     MESSAGE,
-    TIME
+    TIME,
+    CRYPTO  // Internal event, crypto job computed outside of state machine has finished.
 } ZrtpEventType;
 
 typedef struct{
     ZrtpEventType eventType;
     unsigned char* messageData;
     int messageDataLength;
+    unsigned int cryptoJobId;
 } ZrtpEvent;
 
 #endif // EVENTS_H
@@ -0,0 +1,86 @@
+#include "handshakecoroutine.h"
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+
+#include <new>
+
+CoroutineFramePool::~CoroutineFramePool(){
+
+    for (unsigned int i = 0; i < freeFrames.size(); i++){
+        ::operator delete(freeFrames[i]);
+    }
+}
+
+void* CoroutineFramePool::allocate(size_t _size){
+
+    if (_size > HANDSHAKE_FRAME_SIZE){
+        return ::operator new(_size);
+    }
+
+    {
+        std::lock_guard<ProfiledMutex> lock(poolMutex);
+        if (!freeFrames.empty()){
+            void* frame = freeFrames.back();
+            freeFrames.pop_back();
+            return frame;
+        }
+    }
+
+    return ::operator new(HANDSHAKE_FRAME_SIZE);
+}
+
+void CoroutineFramePool::release(void *_frame, size_t _size){
+
+    if (_size <= HANDSHAKE_FRAME_SIZE){
+        std::lock_guard<ProfiledMutex> lock(poolMutex);
+        if (freeFrames.size() < HANDSHAKE_FRAME_POOL_LIMIT){
+            freeFrames.push_back(_frame);
+            return;
+        }
+    }
+
+    ::operator delete(_frame);
+}
+
+CoroutineFramePool& CoroutineFramePool::getInstance(){
+
+    static CoroutineFramePool framePool;
+    return framePool;
+}
+
+bool HandshakeTask::promise_type::accepts(ZrtpEvent *_event, MESSAGE_TYPE _messageType){
+
+    // While crypto job computes, retransmissions and timeouts are ignored.
+    if (waitsForCrypto){
+        return _event->eventType == CRYPTO;
+    }
+
+    if (_event->eventType == TIME){
+        return true;
+    }
+
+    if (_event->eventType != MESSAGE){
+        return false;
+    }
+
+    for (size_t i = 0; i < expectedMessagesCount; i++){
+        if (expectedMessages[i] == _messageType){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+HandshakeTask& HandshakeTask::operator=(HandshakeTask&& _other){
+
+    if (this != &_other){
+        destroy();
+        handle = _other.handle;
+        _other.handle = nullptr;
+    }
+
+    return *this;
+}
+
+#endif // ZRTP_COROUTINE_HANDSHAKE
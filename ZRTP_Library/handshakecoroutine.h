@@ -0,0 +1,180 @@
+#ifndef HANDSHAKECOROUTINE_H
+#define HANDSHAKECOROUTINE_H
+
+// Coroutine handshake needs C++20 coroutines, without them only handler map is available.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+  #if __has_include(<coroutine>)
+    #define ZRTP_COROUTINE_HANDSHAKE 1
+  #endif
+#endif
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <stddef.h>
+#include "events.h"
+#include "lockprofiler.h"
+#include "zrtpPacket/messages.h"
+
+// Size of pooled coroutine frame, bigger frames are allocated from heap.
+#define HANDSHAKE_FRAME_SIZE 512
+
+// Count of free frames kept in pool.
+#define HANDSHAKE_FRAME_POOL_LIMIT 1024
+
+/**
+ * @brief The CoroutineFramePool class represent free list of fixed size blocks for handshake coroutine frames.
+ *        Frame is allocated once per handshake and can be released by other thread than allocated it.
+ */
+class CoroutineFramePool{
+
+    ProfiledMutex poolMutex{COROUTINE_FRAME_LOCK};
+    std::vector<void*> freeFrames;
+
+public:
+
+    ~CoroutineFramePool();
+
+    /**
+     * @brief allocate take frame from pool or heap.
+     * @param _size size of coroutine frame.
+     * @return memory for coroutine frame.
+     */
+    void* allocate(size_t _size);
+
+    /**
+     * @brief release return frame to pool or heap.
+     * @param _frame memory of coroutine frame.
+     * @param _size size of coroutine frame.
+     */
+    void release(void* _frame, size_t _size);
+
+    /**
+     * @brief getInstance getter for pool shared by all handshakes.
+     * @return frame pool.
+     */
+    static CoroutineFramePool& getInstance();
+};
+
+/**
+ * @brief The HandshakeTask class represent running handshake coroutine. Coroutine suspends on every
+ *        co_await and it is resumed by state machine with event which it waits for.
+ */
+class HandshakeTask{
+
+public:
+
+    struct promise_type{
+
+        // Event which resumed coroutine, it is valid until coroutine suspends again.
+        ZrtpEvent* event = nullptr;
+
+        // Filter of events which coroutine waits for.
+        const MESSAGE_TYPE* expectedMessages = nullptr;
+        size_t expectedMessagesCount = 0;
+        bool waitsForCrypto = false;
+
+        HandshakeTask get_return_object() {return HandshakeTask(std::coroutine_handle<promise_type>::from_promise(*this));}
+
+        // Coroutine is started by first resume with START event.
+        std::suspend_always initial_suspend() noexcept {return {};}
+        std::suspend_always final_suspend() noexcept {return {};}
+
+        void return_void() {}
+        void unhandled_exception() {std::terminate();}
+
+        static void* operator new(size_t _size) {return CoroutineFramePool::getInstance().allocate(_size);}
+        static void operator delete(void* _frame, size_t _size) {CoroutineFramePool::getInstance().release(_frame, _size);}
+
+        /**
+         * @brief accepts check if coroutine waits for event.
+         * @param _event event to check.
+         * @param _messageType classified type of received message.
+         * @return true if coroutine should be resumed with event.
+         */
+        bool accepts(ZrtpEvent* _event, MESSAGE_TYPE _messageType);
+    };
+
+    /**
+     * @brief MessageAwaiter suspend coroutine until one of expected messages or timeout comes.
+     */
+    struct MessageAwaiter{
+
+        const MESSAGE_TYPE* expectedMessages;
+        size_t expectedMessagesCount;
+        promise_type* promise;
+
+        bool await_ready() {return false;}
+        void await_suspend(std::coroutine_handle<promise_type> _handle){
+            promise = &_handle.promise();
+            promise->expectedMessages = expectedMessages;
+            promise->expectedMessagesCount = expectedMessagesCount;
+            promise->waitsForCrypto = false;
+        }
+        ZrtpEvent* await_resume() {return promise->event;}
+    };
+
+    HandshakeTask() : handle(nullptr) {}
+    HandshakeTask(HandshakeTask&& _other) : handle(_other.handle) {_other.handle = nullptr;}
+    HandshakeTask& operator=(HandshakeTask&& _other);
+    HandshakeTask(const HandshakeTask&) = delete;
+    HandshakeTask& operator=(const HandshakeTask&) = delete;
+    ~HandshakeTask() {destroy();}
+
+    /**
+     * @brief resume pass event to coroutine and run it until next co_await or end.
+     * @param _event event to pass.
+     */
+    void resume(ZrtpEvent* _event) {handle.promise().event = _event; handle.resume();}
+
+    /**
+     * @brief destroy release coroutine frame. Coroutine must be suspended.
+     */
+    void destroy() {if (handle) {handle.destroy(); handle = nullptr;}}
+
+    /**
+     * @brief isActive check if coroutine exists.
+     * @return true if coroutine frame is allocated.
+     */
+    bool isActive() {return (bool) handle;}
+
+    /**
+     * @brief isDone check if coroutine has finished.
+     * @return true if coroutine reached end.
+     */
+    bool isDone() {return handle.done();}
+
+    /**
+     * @brief getPromise getter for coroutine promise.
+     * @return promise of coroutine.
+     */
+    promise_type& getPromise() {return handle.promise();}
+
+private:
+
+    explicit HandshakeTask(std::coroutine_handle<promise_type> _handle) : handle(_handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Message types which are awaited together, array lives in static storage for whole suspension.
+template <MESSAGE_TYPE... _messageTypes>
+struct ExpectedMessages{
+    static constexpr MESSAGE_TYPE types[] = {_messageTypes...};
+};
+
+/**
+ * @brief recv suspend handshake until one of given messages or timeout comes.
+ *        Usage: ZrtpEvent* event = co_await recv<COMMIT_MESSAGE>();
+ * @return awaiter which returns event, it is TIME event or MESSAGE of one of given types.
+ */
+template <MESSAGE_TYPE... _messageTypes>
+HandshakeTask::MessageAwaiter recv(){
+    return {ExpectedMessages<_messageTypes...>::types, sizeof...(_messageTypes), nullptr};
+}
+
+#endif // ZRTP_COROUTINE_HANDSHAKE
+
+#endif // HANDSHAKECOROUTINE_H
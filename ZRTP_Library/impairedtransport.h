@@ -0,0 +1,143 @@
+#ifndef IMPAIREDTRANSPORT_H
+#define IMPAIREDTRANSPORT_H
+
+#include "datagramtransport.h"
+#include "impairment.h"
+#include <queue>
+#include <vector>
+
+/**
+ * @brief The ImpairedTransport class put simulated network between points of transport and other endpoint.
+ *        Every sent packet passes impairment model, it can be lost, delayed, duplicated, reordered or
+ *        truncated. Delayed packets wait in transport and they are sent when timers of transport are fired,
+ *        so run() and runOnce() of Transport handle them. All sessions of transport share one link, burst
+ *        of losses hits all of them like sessions behind one radio link.
+ *        With simulated time timers of points and delays run on clock moved by advanceClock(), so handshake
+ *        does not wait for real time and run with same seed gives same results. Simulated time is meant
+ *        for LoopbackTransport, socket transports wait for real time.
+ *        Transport is LoopbackTransport, EpollTransport or UringTransport.
+ */
+template <class Transport>
+class ImpairedTransport : public Transport{
+
+public:
+
+    typedef DatagramTransport::transportClock transportClock;
+
+private:
+
+    typedef struct HeldPacket{
+        transportClock::time_point due;
+        uint64_t sequence;
+        sockaddr_in remote;
+        std::vector<uint8_t> data;
+
+        // Copies due at same time leave in order in which they were sent.
+        bool operator>(const HeldPacket& _other) const
+            {return due > _other.due || (due == _other.due && sequence > _other.sequence);}
+    } HeldPacket;
+
+    ImpairmentModel model;
+
+    std::priority_queue<HeldPacket, std::vector<HeldPacket>, std::greater<HeldPacket>> heldPackets;
+    uint64_t lastSequence;
+
+    bool simulatedTime;
+    transportClock::time_point simulatedNow;
+
+protected:
+
+    virtual bool queueSend(const sockaddr_in& _remote, const uint8_t* _data, unsigned int _length, bool _retained){
+
+        ImpairmentModel::PacketCopy copies[2];
+        unsigned int count = model.impair(_length, copies);
+
+        for (unsigned int i = 0; i < count; i++){
+            if (copies[i].delay == ImpairmentModel::delayDuration::zero()){
+                Transport::queueSend(_remote, _data, copies[i].length, _retained);
+                continue;
+            }
+
+            // Leased buffer is released before delayed copy leaves, so copy keeps own data.
+            heldPackets.push({getTime() + copies[i].delay, ++lastSequence, _remote,
+                              std::vector<uint8_t>(_data, _data + copies[i].length)});
+        }
+
+        // Lost packet looks sent for point, network does not report it.
+        return true;
+    }
+
+    virtual void fireExpiredTimers(){
+
+        transportClock::time_point now = getTime();
+
+        while (!heldPackets.empty() && heldPackets.top().due <= now){
+            const HeldPacket& packet = heldPackets.top();
+            Transport::queueSend(packet.remote, packet.data.data(), packet.data.size(), false);
+            heldPackets.pop();
+        }
+
+        Transport::fireExpiredTimers();
+    }
+
+    virtual bool getNextDeadline(transportClock::time_point& _deadline){
+
+        bool running = Transport::getNextDeadline(_deadline);
+
+        if (!heldPackets.empty() && (!running || heldPackets.top().due < _deadline)){
+            _deadline = heldPackets.top().due;
+            return true;
+        }
+
+        return running;
+    }
+
+public:
+
+    /**
+     * @brief ImpairedTransport create transport with simulated network.
+     * @param _profile network between transport and other endpoint.
+     * @param _seed seed of impairment model.
+     * @param _simulatedTime true if time is moved only by advanceClock().
+     */
+    ImpairedTransport(const ImpairmentProfile& _profile, uint64_t _seed, bool _simulatedTime = false)
+        : model(_profile, _seed){
+        lastSequence = 0;
+        simulatedTime = _simulatedTime;
+        simulatedNow = transportClock::now();
+    }
+
+    virtual transportClock::time_point getTime()
+        {return simulatedTime ? simulatedNow : transportClock::now();}
+
+    /**
+     * @brief advanceClock move simulated time to nearest timer deadline or departure of delayed packet,
+     *        next run of loop handles them.
+     * @return false if no timer runs and no packet waits, so time can not move.
+     */
+    bool advanceClock(){
+        transportClock::time_point deadline;
+        if (!simulatedTime || !getNextDeadline(deadline)){
+            return false;
+        }
+
+        if (deadline > simulatedNow){
+            simulatedNow = deadline;
+        }
+        return true;
+    }
+
+    /**
+     * @brief getHeldPacketsCount getter for count of delayed packets.
+     * @return count of packets which wait for departure.
+     */
+    unsigned int getHeldPacketsCount() {return heldPackets.size();}
+
+    /**
+     * @brief getImpairmentStatistics getter for counters of impairment model.
+     * @return statistics.
+     */
+    const ImpairmentStatistics& getImpairmentStatistics() {return model.getStatistics();}
+};
+
+#endif // IMPAIREDTRANSPORT_H
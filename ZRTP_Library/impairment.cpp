@@ -0,0 +1,59 @@
+#include "impairment.h"
+
+ImpairmentModel::ImpairmentModel(const ImpairmentProfile &_profile, uint64_t _seed)
+    : profile(_profile), generator(_seed), uniform(0.0, 1.0){
+
+    burst = false;
+}
+
+ImpairmentModel::delayDuration ImpairmentModel::drawDelay(){
+
+    double delay = profile.delay;
+
+    if (profile.jitter > 0){
+        delay += profile.jitter * uniform(generator);
+    }
+
+    if (happens(profile.reorderRate)){
+        delay += profile.reorderDelay;
+        statistics.packetsReordered++;
+    }
+
+    return std::chrono::duration_cast<delayDuration>(std::chrono::duration<double, std::milli>(delay));
+}
+
+unsigned int ImpairmentModel::impair(unsigned int _length, PacketCopy _copies[2]){
+
+    // State changes before packet, so burst length is counted in packets as in Gilbert-Elliott model.
+    if (!burst && happens(profile.enterBurstRate)){
+        burst = true;
+        statistics.burstsEntered++;
+    }   else if (burst && happens(profile.leaveBurstRate)){
+            burst = false;
+        }
+
+    if (happens(burst ? profile.burstLossRate : profile.lossRate)){
+        statistics.packetsLost++;
+        return 0;
+    }
+
+    unsigned int copies = 1;
+    if (happens(profile.duplicateRate)){
+        copies = 2;
+        statistics.packetsDuplicated++;
+    }
+
+    for (unsigned int i = 0; i < copies; i++){
+        _copies[i].delay = drawDelay();
+        _copies[i].length = _length;
+
+        if (_length > 1 && happens(profile.truncateRate)){
+            _copies[i].length = 1 + (unsigned int) (uniform(generator) * (_length - 1));
+            statistics.packetsTruncated++;
+        }
+    }
+
+    statistics.packetsPassed++;
+
+    return copies;
+}
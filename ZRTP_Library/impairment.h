@@ -0,0 +1,115 @@
+#ifndef IMPAIRMENT_H
+#define IMPAIRMENT_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/**
+ * @brief The ImpairmentProfile struct describe network between two endpoints. Loss follows Gilbert-Elliott
+ *        model, link is in good or burst state and every state has own loss rate, plain random loss
+ *        is good state which is never left. Rates are probabilities per packet, times are in milliseconds.
+ */
+struct ImpairmentProfile{
+    double lossRate = 0;
+    double burstLossRate = 0;
+
+    // Probability of transition between states checked before every packet.
+    double enterBurstRate = 0;
+    double leaveBurstRate = 1;
+
+    // Every packet is delayed by delay and uniform random jitter from 0 to jitter.
+    double delay = 0;
+    double jitter = 0;
+
+    double duplicateRate = 0;
+
+    // Reordered packet waits reorderDelay more, so packets sent after it overtake it.
+    double reorderRate = 0;
+    double reorderDelay = 0;
+
+    // Truncated packet loses random count of bytes from its end, at least one byte stays.
+    double truncateRate = 0;
+};
+
+/**
+ * @brief The ImpairmentStatistics struct count packets changed by impairment model.
+ */
+struct ImpairmentStatistics{
+    uint64_t packetsPassed = 0;
+    uint64_t packetsLost = 0;
+    uint64_t packetsDuplicated = 0;
+    uint64_t packetsReordered = 0;
+    uint64_t packetsTruncated = 0;
+    uint64_t burstsEntered = 0;
+};
+
+/**
+ * @brief The ImpairmentModel class decide what network does with sent packet. Decisions depend only on seed
+ *        and order of packets, so run with same seed and same traffic is repeated exactly.
+ */
+class ImpairmentModel{
+
+public:
+
+    typedef std::chrono::microseconds delayDuration;
+
+    typedef struct{
+        delayDuration delay;
+        unsigned int length;
+    } PacketCopy;
+
+private:
+
+    ImpairmentProfile profile;
+    std::mt19937_64 generator;
+    std::uniform_real_distribution<double> uniform;
+
+    bool burst;
+
+    ImpairmentStatistics statistics;
+
+    /**
+     * @brief happens draw event of given probability.
+     * @param _probability probability from 0 to 1.
+     * @return true if event happens.
+     */
+    bool happens(double _probability) {return _probability > 0 && uniform(generator) < _probability;}
+
+    /**
+     * @brief drawDelay draw delay of one copy of packet.
+     * @return delay.
+     */
+    delayDuration drawDelay();
+
+public:
+
+    /**
+     * @brief ImpairmentModel create model in good state.
+     * @param _profile network.
+     * @param _seed seed of random generator.
+     */
+    ImpairmentModel(const ImpairmentProfile& _profile, uint64_t _seed);
+
+    /**
+     * @brief impair decide fate of sent packet.
+     * @param _length length of packet.
+     * @param _copies filled with delay and length of every copy which arrives.
+     * @return count of copies, 0 if packet is lost, 2 if it is duplicated.
+     */
+    unsigned int impair(unsigned int _length, PacketCopy _copies[2]);
+
+    /**
+     * @brief isInBurst getter for state of link.
+     * @return true if link is in burst state.
+     */
+    bool isInBurst() {return burst;}
+
+    /**
+     * @brief getStatistics getter for counters of model.
+     * @return statistics.
+     */
+    const ImpairmentStatistics& getStatistics() {return statistics;}
+};
+
+#endif // IMPAIRMENT_H
@@ -0,0 +1,64 @@
+#include "lockprofiler.h"
+#include <atomic>
+
+// Every site has own cache line, counting on one site does not slow down others.
+typedef struct alignas(64) SiteCounters{
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> waitNanoseconds{0};
+} SiteCounters;
+
+static SiteCounters siteCounters[LOCK_SITES_COUNT];
+
+bool LockProfiler::isEnabled(){
+
+#ifdef ZRTP_LOCK_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void LockProfiler::record(LOCK_SITE _site, bool _contended, uint64_t _waitNanoseconds){
+
+    SiteCounters& counters = siteCounters[_site];
+    counters.acquisitions.fetch_add(1, std::memory_order_relaxed);
+
+    if (_contended){
+        counters.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (_waitNanoseconds != 0){
+        counters.waitNanoseconds.fetch_add(_waitNanoseconds, std::memory_order_relaxed);
+    }
+}
+
+LockSiteStatistics LockProfiler::getStatistics(LOCK_SITE _site){
+
+    LockSiteStatistics statistics;
+    statistics.acquisitions = siteCounters[_site].acquisitions.load(std::memory_order_relaxed);
+    statistics.contended = siteCounters[_site].contended.load(std::memory_order_relaxed);
+    statistics.waitNanoseconds = siteCounters[_site].waitNanoseconds.load(std::memory_order_relaxed);
+
+    return statistics;
+}
+
+void LockProfiler::reset(){
+
+    for (int i = 0; i < LOCK_SITES_COUNT; i++){
+        siteCounters[i].acquisitions = 0;
+        siteCounters[i].contended = 0;
+        siteCounters[i].waitNanoseconds = 0;
+    }
+}
+
+const char* LockProfiler::getSiteName(LOCK_SITE _site){
+
+    switch (_site){
+        case SLAB_LOCK: return "slab";
+        case SECURE_POOL_LOCK: return "secure_pool";
+        case HELLO_TEMPLATE_LOCK: return "hello_template";
+        case COROUTINE_FRAME_LOCK: return "coroutine_frame";
+        case ENTROPY_SOURCE: return "entropy_source";
+    default: return "unknown";
+    }
+}
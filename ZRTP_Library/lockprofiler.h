@@ -0,0 +1,118 @@
+#ifndef LOCKPROFILER_H
+#define LOCKPROFILER_H
+
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+
+/*
+    Locks shared by all sessions count their acquisitions and time of waiting when library is built
+    with ZRTP_LOCK_PROFILING, seeding of random generators from entropy source is timed too. Without it
+    ProfiledMutex is plain mutex and nothing is counted.
+*/
+
+enum LOCK_SITE {
+    SLAB_LOCK,
+    SECURE_POOL_LOCK,
+    HELLO_TEMPLATE_LOCK,
+    COROUTINE_FRAME_LOCK,
+    ENTROPY_SOURCE,
+    LOCK_SITES_COUNT
+};
+
+/**
+ * @brief The LockSiteStatistics struct count work of one lock site. For ENTROPY_SOURCE acquisition is
+ *        one seeding and waiting is whole time of seeding.
+ */
+typedef struct LockSiteStatistics{
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t waitNanoseconds = 0;
+} LockSiteStatistics;
+
+/**
+ * @brief The LockProfiler class keep statistics of lock sites for whole process.
+ */
+class LockProfiler{
+
+public:
+
+    typedef std::chrono::steady_clock profilerClock;
+
+    /**
+     * @brief isEnabled check if library was built with ZRTP_LOCK_PROFILING.
+     * @return true if sites are counted.
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief record count one acquisition of site.
+     * @param _site lock site.
+     * @param _contended true if lock was held by other thread.
+     * @param _waitNanoseconds time of waiting.
+     */
+    static void record(LOCK_SITE _site, bool _contended, uint64_t _waitNanoseconds);
+
+    /**
+     * @brief getStatistics getter for statistics of site.
+     * @param _site lock site.
+     * @return copy of statistics.
+     */
+    static LockSiteStatistics getStatistics(LOCK_SITE _site);
+
+    /**
+     * @brief reset set statistics of all sites to zero.
+     */
+    static void reset();
+
+    /**
+     * @brief getSiteName name of site for reports.
+     * @param _site lock site.
+     * @return name.
+     */
+    static const char* getSiteName(LOCK_SITE _site);
+};
+
+/**
+ * @brief The ProfiledMutex class represent mutex of lock site, it can be used with std::lock_guard.
+ *        Uncontended lock costs only try_lock(), clock is read only when lock has to wait.
+ */
+class ProfiledMutex{
+
+    std::mutex mutex;
+
+#ifdef ZRTP_LOCK_PROFILING
+    LOCK_SITE site;
+#endif
+
+public:
+
+#ifdef ZRTP_LOCK_PROFILING
+    ProfiledMutex(LOCK_SITE _site) : site(_site) {}
+
+    void lock(){
+        if (mutex.try_lock()){
+            LockProfiler::record(site, false, 0);
+            return;
+        }
+
+        LockProfiler::profilerClock::time_point start = LockProfiler::profilerClock::now();
+        mutex.lock();
+        LockProfiler::record(site, true, std::chrono::duration_cast<std::chrono::nanoseconds>
+                             (LockProfiler::profilerClock::now() - start).count());
+    }
+#else
+    ProfiledMutex(LOCK_SITE) {}
+
+    void lock() {mutex.lock();}
+#endif
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    bool try_lock() {return mutex.try_lock();}
+
+    void unlock() {mutex.unlock();}
+};
+
+#endif // LOCKPROFILER_H
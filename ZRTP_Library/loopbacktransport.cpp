@@ -0,0 +1,119 @@
+#include "loopbacktransport.h"
+#include <thread>
+
+// Ids of transports and session pairs are unique in process.
+static std::atomic<uint16_t> lastTransportId(0);
+static std::atomic<uint32_t> lastPairId(0);
+
+uint32_t LoopbackTransport::createPairId(){
+
+    return lastPairId.fetch_add(2) + 2;
+}
+
+LoopbackTransport::LoopbackTransport(){
+
+    transportId = ++lastTransportId;
+    stopping = false;
+}
+
+LoopbackTransport::~LoopbackTransport(){
+
+    removeAllSessions();
+}
+
+void LoopbackTransport::connect(LoopbackTransport &_first, LoopbackTransport &_second){
+
+    if (_first.outboundChannels.count(_second.transportId) != 0){
+        return;
+    }
+
+    std::shared_ptr<PacketChannel> forward = std::make_shared<PacketChannel>();
+    _first.outboundChannels[_second.transportId] = forward;
+    _second.inboundChannels.push_back({_first.transportId, forward});
+
+    // Transport connected to itself reads what it writes.
+    if (&_first == &_second){
+        return;
+    }
+
+    std::shared_ptr<PacketChannel> backward = std::make_shared<PacketChannel>();
+    _second.outboundChannels[_first.transportId] = backward;
+    _first.inboundChannels.push_back({_second.transportId, backward});
+}
+
+void LoopbackTransport::addSessionPair(LoopbackTransport &_first, LoopbackTransport &_second,
+                                       ZrtpPoint *&_initiator, ZrtpPoint *&_responder){
+
+    connect(_first, _second);
+
+    uint32_t pair = createPairId();
+    _initiator = _first.addSession(INITIATOR, _second.getAddress(pair));
+    _responder = _second.addSession(RESPONDER, _first.getAddress(pair ^ 1));
+}
+
+sockaddr_in LoopbackTransport::getAddress(uint32_t _pair){
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = _pair;
+    address.sin_port = transportId;
+
+    return address;
+}
+
+bool LoopbackTransport::queueSend(const sockaddr_in &_remote, const uint8_t *_data, unsigned int _length, bool /*_retained*/){
+
+    auto found = outboundChannels.find(_remote.sin_port);
+
+    // Full channel drops packet like network, retransmission timer of point sends it again.
+    if (found == outboundChannels.end() || !found->second->push(_remote.sin_addr.s_addr, _data, _length)){
+        statistics.sendsFailed++;
+        return false;
+    }
+
+    statistics.datagramsSent++;
+    return true;
+}
+
+bool LoopbackTransport::runOnce(){
+
+    bool delivered = false;
+
+    for (unsigned int i = 0; i < inboundChannels.size(); i++){
+        PacketChannel* channel = inboundChannels[i].second.get();
+
+        // Packet is processed in its slot, sender is other session of pair in transport of channel.
+        sockaddr_in sender = getAddress(0);
+        sender.sin_port = inboundChannels[i].first;
+
+        for (int packet = 0; packet < LOOPBACK_RECEIVE_BATCH; packet++){
+            PacketChannel::ChannelSlot* slot = channel->front();
+            if (slot == nullptr){
+                break;
+            }
+
+            sender.sin_addr.s_addr = slot->pair ^ 1;
+            deliver(sender, slot->data, slot->length);
+            channel->pop();
+            delivered = true;
+        }
+    }
+
+    fireExpiredTimers();
+    reportEndedNegotiations();
+
+    // Packets are copied to channel when they are sent, so released buffers are free at once.
+    recycleSendBuffers();
+
+    return delivered;
+}
+
+void LoopbackTransport::run(){
+
+    while (!stopping){
+        if (!runOnce()){
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef LOOPBACKTRANSPORT_H
+#define LOOPBACKTRANSPORT_H
+
+#include "datagramtransport.h"
+#include "packetchannel.h"
+#include <atomic>
+#include <memory>
+
+// Packets taken from one channel before next channel and timers are handled.
+#define LOOPBACK_RECEIVE_BATCH 32
+
+/**
+ * @brief The LoopbackTransport class connect ZRTP points in one process without sockets. Every transport
+ *        is one loop, connected transports exchange packets by lock-free channels, one in each direction,
+ *        so legs of session pair run on the same thread (transport connected to itself) or on two threads.
+ *        Address of session is id of peers transport and id of session pair, so fleet of sessions shares
+ *        channels of two transports. Sessions of pair have ids which differ in lowest bit, so both can
+ *        live in one transport. Transports are connected and pairs are added before loops run.
+ */
+class LoopbackTransport : public DatagramTransport{
+
+    // Transport id is port of its addresses.
+    uint16_t transportId;
+
+    std::unordered_map<uint16_t, std::shared_ptr<PacketChannel>> outboundChannels;
+    std::vector<std::pair<uint16_t, std::shared_ptr<PacketChannel>>> inboundChannels;
+
+    std::atomic<bool> stopping;
+
+protected:
+
+    virtual bool queueSend(const sockaddr_in& _remote, const uint8_t* _data, unsigned int _length, bool _retained);
+
+public:
+
+    LoopbackTransport();
+
+    /**
+     * @brief ~LoopbackTransport delete all points of transport, connected transports must not run.
+     */
+    virtual ~LoopbackTransport();
+
+    /**
+     * @brief connect create channels between two transports, transport can be connected to itself.
+     * @param _first transport.
+     * @param _second transport.
+     */
+    static void connect(LoopbackTransport& _first, LoopbackTransport& _second);
+
+    /**
+     * @brief addSessionPair connect transports and create INITIATOR in first and RESPONDER in second.
+     *        Points are started by caller.
+     * @param _first transport of initiator.
+     * @param _second transport of responder, it can be the first one.
+     * @param _initiator created initiator.
+     * @param _responder created responder.
+     */
+    static void addSessionPair(LoopbackTransport& _first, LoopbackTransport& _second,
+                               ZrtpPoint*& _initiator, ZrtpPoint*& _responder);
+
+    /**
+     * @brief createPairId create id of new session pair.
+     * @return even id, id of other session of pair is one bigger.
+     */
+    static uint32_t createPairId();
+
+    /**
+     * @brief getAddress address of session in this transport, peer adds session with this address
+     *        by addSession() and this transport creates other session of pair when it accepts sessions.
+     * @param _pair id of session pair.
+     * @return address.
+     */
+    sockaddr_in getAddress(uint32_t _pair);
+
+    /**
+     * @brief runOnce deliver waiting packets, process expired timers and report ended negotiations.
+     * @return true if any packet was delivered.
+     */
+    bool runOnce();
+
+    /**
+     * @brief run handle packets and timers until stop() is called, thread yields when it has no work.
+     */
+    void run();
+
+    /**
+     * @brief stop end run(), it can be called from any thread.
+     */
+    void stop() {stopping = true;}
+};
+
+#endif // LOOPBACKTRANSPORT_H
@@ -0,0 +1,51 @@
+#include "packetchannel.h"
+#include <string.h>
+
+static_assert((PACKET_CHANNEL_CAPACITY & (PACKET_CHANNEL_CAPACITY - 1)) == 0, "Channel capacity must be power of 2");
+
+PacketChannel::PacketChannel(){
+
+    readPosition.store(0);
+    writePosition.store(0);
+    cachedReadPosition = 0;
+    cachedWritePosition = 0;
+}
+
+bool PacketChannel::push(uint32_t _pair, const uint8_t *_data, unsigned int _length){
+
+    if (_length > MAXIMUM_PACKET_LENGTH){
+        return false;
+    }
+
+    size_t position = writePosition.load(std::memory_order_relaxed);
+
+    if (position - cachedReadPosition == PACKET_CHANNEL_CAPACITY){
+        cachedReadPosition = readPosition.load(std::memory_order_acquire);
+        if (position - cachedReadPosition == PACKET_CHANNEL_CAPACITY){
+            return false;
+        }
+    }
+
+    ChannelSlot* slot = &slots[position & (PACKET_CHANNEL_CAPACITY - 1)];
+    slot->pair = _pair;
+    slot->length = _length;
+    memcpy(slot->data, _data, _length);
+
+    writePosition.store(position + 1, std::memory_order_release);
+
+    return true;
+}
+
+PacketChannel::ChannelSlot* PacketChannel::front(){
+
+    size_t position = readPosition.load(std::memory_order_relaxed);
+
+    if (position == cachedWritePosition){
+        cachedWritePosition = writePosition.load(std::memory_order_acquire);
+        if (position == cachedWritePosition){
+            return nullptr;
+        }
+    }
+
+    return &slots[position & (PACKET_CHANNEL_CAPACITY - 1)];
+}
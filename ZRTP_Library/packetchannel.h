@@ -0,0 +1,62 @@
+#ifndef PACKETCHANNEL_H
+#define PACKETCHANNEL_H
+
+#include "zrtpPacket/packetvalidator.h"
+#include <atomic>
+
+// Count of packets which can wait in channel, must be power of 2.
+#define PACKET_CHANNEL_CAPACITY 256
+
+/**
+ * @brief The PacketChannel class represent lock-free queue of packets from one thread to one thread.
+ *        Packets are copied to slots of channel, so nothing is allocated per packet, and receiver
+ *        processes them in place. Producer and consumer can be the same thread.
+ */
+class PacketChannel{
+
+public:
+
+    typedef struct{
+        uint32_t pair;
+        uint16_t length;
+        uint8_t data[MAXIMUM_PACKET_LENGTH];
+    } ChannelSlot;
+
+private:
+
+    ChannelSlot slots[PACKET_CHANNEL_CAPACITY];
+
+    // Every side keeps last seen position of other side, so shared position is read only when channel
+    // looks full or empty.
+    alignas(64) std::atomic<size_t> readPosition;
+    size_t cachedWritePosition;
+
+    alignas(64) std::atomic<size_t> writePosition;
+    size_t cachedReadPosition;
+
+public:
+
+    PacketChannel();
+
+    /**
+     * @brief push copy packet to channel, only producer can call it.
+     * @param _pair id of session pair to which packet belongs.
+     * @param _data packet.
+     * @param _length length of packet.
+     * @return false if channel is full or packet is too long (packet is dropped), true otherwise.
+     */
+    bool push(uint32_t _pair, const uint8_t* _data, unsigned int _length);
+
+    /**
+     * @brief front return oldest packet, it stays in channel until pop() is called. Only consumer can call it.
+     * @return oldest packet or nullptr if channel is empty.
+     */
+    ChannelSlot* front();
+
+    /**
+     * @brief pop release oldest packet. Only consumer can call it.
+     */
+    void pop() {readPosition.store(readPosition.load(std::memory_order_relaxed) + 1, std::memory_order_release);}
+};
+
+#endif // PACKETCHANNEL_H
@@ -0,0 +1,141 @@
+#include "securepool.h"
+#include <iostream>
+#include <cstddef>
+#include <new>
+#include <string.h>
+
+#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(__WINDOWS__) || defined(__TOS_WIN__)
+  #include <windows.h>
+#else  /* presume POSIX */
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+// Call through volatile pointer can not be proven dead, so compiler keeps it.
+static void* (* const volatile zeroMemory)(void*, int, size_t) = memset;
+
+void secureZero(void *_data, size_t _length){
+
+    zeroMemory(_data, 0, _length);
+}
+
+static size_t pageSize(){
+
+#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(__WINDOWS__) || defined(__TOS_WIN__)
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwPageSize;
+#else
+    long size = sysconf(_SC_PAGESIZE);
+    return (size > 0) ? (size_t) size : 4096;
+#endif
+}
+
+SecurePool::SecurePool(size_t _slotSize){
+
+    // Every slot keeps alignment of chunk and can hold link of free list.
+    const size_t alignment = alignof(std::max_align_t);
+    slotSize = (_slotSize < sizeof(void*)) ? sizeof(void*) : _slotSize;
+    slotSize = (slotSize + alignment - 1) / alignment * alignment;
+
+    size_t page = pageSize();
+    chunkSize = (slotSize * SECURE_POOL_SLOTS_PER_CHUNK + page - 1) / page * page;
+
+    freeSlots = nullptr;
+    locked = true;
+}
+
+SecurePool::~SecurePool(){
+
+    for (unsigned int i = 0; i < chunks.size(); i++){
+        releaseChunk(chunks[i]);
+    }
+}
+
+void* SecurePool::allocateChunk(){
+
+    void* chunk;
+    bool chunkLocked;
+
+#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(__WINDOWS__) || defined(__TOS_WIN__)
+    chunk = VirtualAlloc(NULL, chunkSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (chunk == NULL){
+        throw std::bad_alloc();
+    }
+    chunkLocked = (VirtualLock(chunk, chunkSize) != 0);
+#else
+    chunk = mmap(NULL, chunkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (chunk == MAP_FAILED){
+        throw std::bad_alloc();
+    }
+    chunkLocked = (mlock(chunk, chunkSize) == 0);
+
+  #ifdef MADV_DONTDUMP
+    madvise(chunk, chunkSize, MADV_DONTDUMP);
+  #endif
+#endif
+
+    // Secrets still work without lock, but they can be swapped out, so user is told once.
+    if (!chunkLocked && locked){
+        std::cerr << "Secure pool: memory for secrets could not be locked" << std::endl;
+    }
+    locked = locked && chunkLocked;
+
+    return chunk;
+}
+
+void SecurePool::releaseChunk(void *_chunk){
+
+    secureZero(_chunk, chunkSize);
+
+#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(__WINDOWS__) || defined(__TOS_WIN__)
+    VirtualUnlock(_chunk, chunkSize);
+    VirtualFree(_chunk, 0, MEM_RELEASE);
+#else
+    munlock(_chunk, chunkSize);
+    munmap(_chunk, chunkSize);
+#endif
+}
+
+void* SecurePool::allocate(){
+
+    std::lock_guard<ProfiledMutex> lock(poolMutex);
+
+    if (freeSlots == nullptr){
+        char* chunk = (char*) allocateChunk();
+        chunks.push_back(chunk);
+
+        // Link slots of new chunk to free list, first slot ends on top.
+        for (int i = (int) (chunkSize / slotSize) - 1; i >= 0; i--){
+            *(void**) (chunk + i * slotSize) = freeSlots;
+            freeSlots = chunk + i * slotSize;
+        }
+    }
+
+    void* slot = freeSlots;
+    freeSlots = *(void**) slot;
+
+    // Rest of slot was zeroised on release or is fresh from system.
+    *(void**) slot = nullptr;
+
+    return slot;
+}
+
+void SecurePool::release(void *_slot){
+
+    if (_slot == nullptr){
+        return;
+    }
+
+    secureZero(_slot, slotSize);
+
+    std::lock_guard<ProfiledMutex> lock(poolMutex);
+    *(void**) _slot = freeSlots;
+    freeSlots = _slot;
+}
+
+bool SecurePool::isLocked(){
+
+    std::lock_guard<ProfiledMutex> lock(poolMutex);
+    return locked;
+}
@@ -0,0 +1,85 @@
+#ifndef SECUREPOOL_H
+#define SECUREPOOL_H
+
+#include "lockprofiler.h"
+#include <vector>
+#include <stddef.h>
+
+// Count of slots which pool takes from system at once, chunk is rounded up to whole pages.
+#define SECURE_POOL_SLOTS_PER_CHUNK 64
+
+/**
+ * @brief secureZero overwrite memory with zeros. Unlike memset, call can not be removed by compiler
+ *        even if memory is not read anymore.
+ * @param _data memory to clear.
+ * @param _length length of memory.
+ */
+void secureZero(void* _data, size_t _length);
+
+/**
+ * @brief The SecurePool class represent pool of fixed size slots for secret data. Memory is taken from
+ *        system in chunks, whole chunk is locked in RAM and excluded from core dumps at once, so sessions
+ *        do not pay system call per allocation. Allocated slot is zeroed and released slot is zeroised.
+ */
+class SecurePool{
+
+    size_t slotSize;
+    size_t chunkSize;
+
+    ProfiledMutex poolMutex{SECURE_POOL_LOCK};
+
+    // Released slots are linked through their first bytes.
+    void* freeSlots;
+    std::vector<void*> chunks;
+
+    // False if some chunk could not be locked, for example because of RLIMIT_MEMLOCK.
+    bool locked;
+
+    /**
+     * @brief allocateChunk take chunk from system, lock it and exclude it from core dumps.
+     * @return memory of chunk.
+     */
+    void* allocateChunk();
+
+    /**
+     * @brief releaseChunk zeroise chunk and return it to system.
+     * @param _chunk memory of chunk.
+     */
+    void releaseChunk(void* _chunk);
+
+public:
+
+    /**
+     * @brief SecurePool constructor for empty pool, first chunk is taken with first allocation.
+     * @param _slotSize size of secret data stored in slot.
+     */
+    SecurePool(size_t _slotSize);
+
+    /**
+     * @brief ~SecurePool return all chunks to system. All slots must be released before.
+     */
+    ~SecurePool();
+
+    SecurePool(const SecurePool&) = delete;
+    SecurePool& operator=(const SecurePool&) = delete;
+
+    /**
+     * @brief allocate take zeroed slot from pool.
+     * @return memory for secret data.
+     */
+    void* allocate();
+
+    /**
+     * @brief release zeroise slot and return it to pool.
+     * @param _slot memory of secret data.
+     */
+    void release(void* _slot);
+
+    /**
+     * @brief isLocked check if all memory of pool is locked in RAM.
+     * @return false if system refused to lock some chunk.
+     */
+    bool isLocked();
+};
+
+#endif // SECUREPOOL_H
@@ -0,0 +1,14 @@
+#include "sessionarena.h"
+
+SessionArena::SessionArena(std::pmr::memory_resource *_upstream) :
+    upstream(_upstream),
+    initialBlock(_upstream->allocate(SESSION_ARENA_SIZE, alignof(std::max_align_t))),
+    resource(initialBlock, SESSION_ARENA_SIZE, _upstream){
+}
+
+SessionArena::~SessionArena(){
+
+    // Blocks taken after first one are returned by resource itself.
+    resource.release();
+    upstream->deallocate(initialBlock, SESSION_ARENA_SIZE, alignof(std::max_align_t));
+}
@@ -0,0 +1,77 @@
+#ifndef SESSIONARENA_H
+#define SESSIONARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <stddef.h>
+
+// First block of arena, it is big enough for all messages of one handshake.
+#define SESSION_ARENA_SIZE 4096
+
+/**
+ * @brief The SessionArena class represent monotonic memory of one ZRTP session. Messages of handshake
+ *        are allocated from it and whole memory is released at once when session ends or starts again.
+ *        First block is taken from upstream resource when arena is created, further blocks are taken only
+ *        if handshake does not fit to it. After release() arena starts again from first block, so
+ *        repeated handshakes do not touch upstream resource at all.
+ */
+class SessionArena{
+
+    std::pmr::memory_resource* upstream;
+    void* initialBlock;
+    std::pmr::monotonic_buffer_resource resource;
+
+public:
+
+    /**
+     * @brief SessionArena constructor take first block from upstream resource.
+     * @param _upstream resource supplied by application, it must outlive arena.
+     */
+    SessionArena(std::pmr::memory_resource* _upstream);
+
+    /**
+     * @brief ~SessionArena return all blocks to upstream resource. Objects must be destroyed before.
+     */
+    ~SessionArena();
+
+    SessionArena(const SessionArena&) = delete;
+    SessionArena& operator=(const SessionArena&) = delete;
+
+    /**
+     * @brief create allocate object from arena and construct it.
+     * @param _args arguments for constructor.
+     * @return constructed object, it must be destroyed by destroy() before release().
+     */
+    template <typename T, typename... Args>
+    T* create(Args&&... _args){
+        void* memory = resource.allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(_args)...);
+    }
+
+    /**
+     * @brief destroy call destructor of object, its memory is reused only after release().
+     * @param _object object to destroy, it is set to nullptr.
+     */
+    template <typename T>
+    static void destroy(T*& _object){
+        if (_object != nullptr){
+            _object->~T();
+            _object = nullptr;
+        }
+    }
+
+    /**
+     * @brief release free all memory at once and start again from first block.
+     */
+    void release() {resource.release();}
+
+    /**
+     * @brief getResource getter for memory resource of arena, it can be used with std::pmr containers.
+     * @return arena resource.
+     */
+    std::pmr::memory_resource* getResource() {return &resource;}
+};
+
+#endif // SESSIONARENA_H
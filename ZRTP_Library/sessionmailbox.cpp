@@ -0,0 +1,69 @@
+#include "sessionmailbox.h"
+
+SessionMailbox::SessionMailbox(){
+
+    static_assert((MAILBOX_CAPACITY & (MAILBOX_CAPACITY - 1)) == 0, "Mailbox capacity must be power of 2");
+
+    for (size_t i = 0; i < MAILBOX_CAPACITY; i++){
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    enqueuePosition.store(0, std::memory_order_relaxed);
+    dequeuePosition.store(0, std::memory_order_relaxed);
+}
+
+bool SessionMailbox::post(const uint8_t *_messageData, int _messageDataLength){
+
+    if (_messageDataLength < 0 || _messageDataLength > MAILBOX_PACKET_LENGTH){
+        return false;
+    }
+
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    MailboxSlot* slot;
+
+    while (true){
+
+        slot = &slots[position & (MAILBOX_CAPACITY - 1)];
+        intptr_t difference = (intptr_t) slot->sequence.load(std::memory_order_acquire) - (intptr_t) position;
+
+        if (difference == 0){
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                break;
+            }
+        }   else if (difference < 0){
+                return false;
+            }   else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+    }
+
+    memcpy(slot->packetData, _messageData, _messageDataLength);
+    slot->event.eventType = MESSAGE;
+    slot->event.messageData = slot->packetData;
+    slot->event.messageDataLength = _messageDataLength;
+    slot->event.cryptoJobId = 0;
+
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+ZrtpEvent* SessionMailbox::front(){
+
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    MailboxSlot* slot = &slots[position & (MAILBOX_CAPACITY - 1)];
+
+    if (slot->sequence.load(std::memory_order_acquire) != position + 1){
+        return nullptr;
+    }
+
+    return &slot->event;
+}
+
+void SessionMailbox::pop(){
+
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    MailboxSlot* slot = &slots[position & (MAILBOX_CAPACITY - 1)];
+
+    slot->sequence.store(position + MAILBOX_CAPACITY, std::memory_order_release);
+    dequeuePosition.store(position + 1, std::memory_order_release);
+}
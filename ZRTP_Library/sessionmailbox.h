@@ -0,0 +1,68 @@
+#ifndef SESSIONMAILBOX_H
+#define SESSIONMAILBOX_H
+
+#include <atomic>
+#include "events.h"
+#include "zrtpPacket/dhpart.h"
+
+// Count of packets which can wait in mailbox, must be power of 2.
+#define MAILBOX_CAPACITY 8
+
+// Biggest packet we can receive is DHPart with DH3k public value.
+#define MAILBOX_PACKET_LENGTH DH3K_PACKET_SIZE
+
+/**
+ * @brief The SessionMailbox class represent lock-free queue of received packets for one ZRTP session.
+ *        Any thread can post packet, only thread which currently runs session takes them.
+ *        Packets are copied to mailbox slot, so no memory is allocated per packet. Timeouts and crypto
+ *        results do not go through mailbox, ZRTP point counts them, so they are never dropped.
+ */
+class SessionMailbox{
+
+    typedef struct{
+        std::atomic<size_t> sequence;
+        ZrtpEvent event;
+        uint8_t packetData[MAILBOX_PACKET_LENGTH];
+    } MailboxSlot;
+
+    MailboxSlot slots[MAILBOX_CAPACITY];
+
+    // Producers and consumer positions are on own cache lines, they are written by different threads.
+    alignas(64) std::atomic<size_t> enqueuePosition;
+    alignas(64) std::atomic<size_t> dequeuePosition;
+
+public:
+
+    /**
+     * @brief SessionMailbox constructor for empty mailbox.
+     */
+    SessionMailbox();
+
+    /**
+     * @brief post put received packet to mailbox, can be called from any thread.
+     * @param _messageData received packet, it is copied to mailbox.
+     * @param _messageDataLength length of received packet.
+     * @return false if mailbox is full or packet is too long (packet is dropped), true otherwise.
+     */
+    bool post(const uint8_t* _messageData, int _messageDataLength);
+
+    /**
+     * @brief front return MESSAGE event of oldest packet, it stays in mailbox until pop() is called.
+     *        Only thread which runs session can call it.
+     * @return oldest event or nullptr if mailbox is empty.
+     */
+    ZrtpEvent* front();
+
+    /**
+     * @brief pop release oldest packet slot. Only thread which runs session can call it.
+     */
+    void pop();
+
+    /**
+     * @brief isEmpty check if any packet waits in mailbox.
+     * @return true if mailbox is empty.
+     */
+    bool isEmpty() {return front() == nullptr;}
+};
+
+#endif // SESSIONMAILBOX_H
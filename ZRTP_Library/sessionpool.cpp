@@ -0,0 +1,113 @@
+#include "sessionpool.h"
+
+SessionPool::SessionPool(unsigned int _targetSize, std::pmr::memory_resource *_memoryResource){
+
+    memoryResource = _memoryResource;
+    targetSize = _targetSize;
+    stopping = false;
+
+    idlePoints.reserve(targetSize);
+    releasedPoints.reserve(targetSize);
+
+    refiller = std::thread(&SessionPool::refillLoop, this);
+}
+
+SessionPool::~SessionPool(){
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    refillNeeded.notify_all();
+    refiller.join();
+
+    for (unsigned int i = 0; i < idlePoints.size(); i++){
+        delete idlePoints[i];
+    }
+
+    for (unsigned int i = 0; i < releasedPoints.size(); i++){
+        delete releasedPoints[i];
+    }
+}
+
+ZrtpPoint* SessionPool::acquire(role _role, Callbacks *_callbacks){
+
+    ZrtpPoint* point = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+
+        if (!idlePoints.empty()){
+            point = idlePoints.back();
+            idlePoints.pop_back();
+        }
+    }
+    refillNeeded.notify_one();
+
+    // Pool thread did not keep up, point is constructed by caller.
+    if (point == nullptr){
+        return new ZrtpPoint(_role, _callbacks, memoryResource);
+    }
+
+    point->setRole(_role);
+    point->setCallbacks(_callbacks);
+
+    return point;
+}
+
+void SessionPool::release(ZrtpPoint *_point){
+
+    if (_point == nullptr){
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        releasedPoints.push_back(_point);
+    }
+    refillNeeded.notify_one();
+}
+
+unsigned int SessionPool::getIdleCount(){
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return idlePoints.size();
+}
+
+void SessionPool::refillLoop(){
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+
+    while (!stopping){
+        ZrtpPoint* point;
+
+        if (!releasedPoints.empty()){
+            point = releasedPoints.back();
+            releasedPoints.pop_back();
+
+            // Reset computes outside of lock, acquire() is not blocked by it.
+            lock.unlock();
+            point->setCallbacks(nullptr);
+            point->reset();
+            point->prepareNegotiation();
+            lock.lock();
+        }   else if (idlePoints.size() < targetSize){
+                lock.unlock();
+                point = new ZrtpPoint(INITIATOR, nullptr, memoryResource);
+                point->prepareNegotiation();
+                lock.lock();
+            }   else {
+                    refillNeeded.wait(lock);
+                    continue;
+                }
+
+        // Pool is full, point released over target count is not kept.
+        if (idlePoints.size() >= targetSize){
+            lock.unlock();
+            delete point;
+            lock.lock();
+        }   else {
+                idlePoints.push_back(point);
+            }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef SESSIONPOOL_H
+#define SESSIONPOOL_H
+
+#include "zrtppoint.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory_resource>
+
+/**
+ * @brief The SessionPool class represent pool of ZRTP points prepared for new calls. Idle points have
+ *        fresh hash chain and DH key pair, so call setup does not pay construction and key generation on
+ *        first packet. Pool thread replenishes idle points in background and resets released ones.
+ */
+class SessionPool{
+
+    std::pmr::memory_resource* memoryResource;
+    unsigned int targetSize;
+
+    // Points ready for acquire().
+    std::vector<ZrtpPoint*> idlePoints;
+
+    // Points returned by release(), they wait for reset.
+    std::vector<ZrtpPoint*> releasedPoints;
+
+    std::thread refiller;
+    std::mutex poolMutex;
+    std::condition_variable refillNeeded;
+
+    bool stopping;
+
+    /**
+     * @brief refillLoop reset released points and create new ones until pool has target count of
+     *        idle points, then wait for acquire() or release().
+     */
+    void refillLoop();
+
+public:
+
+    /**
+     * @brief SessionPool constructor start pool thread, which fills pool in background.
+     * @param _targetSize count of idle points kept in pool.
+     * @param _memoryResource resource for memory of handshake messages, it must outlive pool and its points.
+     */
+    SessionPool(unsigned int _targetSize,
+                std::pmr::memory_resource* _memoryResource = std::pmr::get_default_resource());
+
+    /**
+     * @brief ~SessionPool stop pool thread and delete idle and released points. Acquired points are not
+     *        owned by pool.
+     */
+    ~SessionPool();
+
+    SessionPool(const SessionPool&) = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+
+    /**
+     * @brief acquire take prepared point from pool. Empty pool constructs new point.
+     * @param _role INITIATOR or RESPONDER.
+     * @param _callbacks callbacks of application, they are owned by ZRTP point.
+     * @return point ready for startEngine(), it is owned by caller until release().
+     */
+    ZrtpPoint* acquire(role _role, Callbacks* _callbacks);
+
+    /**
+     * @brief release return point to pool. Point is reset and its callbacks are deleted by pool thread,
+     *        so events of point must not be handled any more.
+     * @param _point point taken by acquire() or created by application.
+     */
+    void release(ZrtpPoint* _point);
+
+    /**
+     * @brief getIdleCount getter for count of points ready for acquire().
+     * @return count of idle points.
+     */
+    unsigned int getIdleCount();
+};
+
+#endif // SESSIONPOOL_H
@@ -0,0 +1,167 @@
+#include "sessionscheduler.h"
+#include "zrtppoint.h"
+
+// Index of worker which runs in this thread, sessions scheduled by worker go to its own queue.
+static thread_local SessionScheduler* currentScheduler = nullptr;
+static thread_local unsigned int currentWorkerIndex = 0;
+
+// Session which worker of this thread runs, and whether its handler detached it.
+static thread_local ZrtpPoint* runningSession = nullptr;
+static thread_local bool runningSessionDetached = false;
+
+SessionScheduler::SessionScheduler(unsigned int _workersCount){
+
+    stopping = false;
+    nextWorker.store(0);
+    idleWorkers.store(0);
+    queuedSessions.store(0);
+    detachingSessions.store(0);
+
+    if (_workersCount == 0){
+        _workersCount = std::thread::hardware_concurrency();
+    }
+
+    if (_workersCount == 0){
+        _workersCount = 1;
+    }
+
+    workers.reserve(_workersCount);
+    for (unsigned int i = 0; i < _workersCount; i++){
+        workers.push_back(new Worker());
+    }
+
+    threads.reserve(_workersCount);
+    for (unsigned int i = 0; i < _workersCount; i++){
+        threads.push_back(std::thread(&SessionScheduler::workerLoop, this, i));
+    }
+}
+
+SessionScheduler::~SessionScheduler(){
+
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (unsigned int i = 0; i < threads.size(); i++){
+        threads[i].join();
+    }
+
+    for (unsigned int i = 0; i < workers.size(); i++){
+        delete workers[i];
+    }
+}
+
+void SessionScheduler::schedule(ZrtpPoint *_session){
+
+    unsigned int workerIndex;
+
+    if (currentScheduler == this){
+        workerIndex = currentWorkerIndex;
+    }   else {
+            workerIndex = nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        }
+
+    {
+        std::lock_guard<std::mutex> lock(workers[workerIndex]->queueMutex);
+        workers[workerIndex]->runQueue.push_back(_session);
+    }
+
+    queuedSessions.fetch_add(1);
+
+    // Wake up parked worker, it steals session if it is not its own.
+    if (idleWorkers.load() > 0){
+        std::lock_guard<std::mutex> lock(idleMutex);
+        workAvailable.notify_one();
+    }
+}
+
+void SessionScheduler::detach(ZrtpPoint *_session){
+
+    // Worker leaves session after handler returns, waiting here would never end.
+    if (runningSession == _session){
+        runningSessionDetached = true;
+        return;
+    }
+
+    // Counter is raised before events are checked, so worker which handled last event sees it and signals.
+    detachingSessions.fetch_add(1);
+    {
+        std::unique_lock<std::mutex> lock(detachMutex);
+        sessionFinished.wait(lock, [_session](){return _session->getPendingEvents() == 0;});
+    }
+    detachingSessions.fetch_sub(1);
+}
+
+void SessionScheduler::sessionIdle(){
+
+    if (detachingSessions.load() != 0){
+        std::lock_guard<std::mutex> lock(detachMutex);
+        sessionFinished.notify_all();
+    }
+}
+
+bool SessionScheduler::leaveDetachedSession(){
+
+    return runningSessionDetached;
+}
+
+ZrtpPoint* SessionScheduler::takeSession(unsigned int _workerIndex){
+
+    ZrtpPoint* session = nullptr;
+
+    {
+        Worker* worker = workers[_workerIndex];
+        std::lock_guard<std::mutex> lock(worker->queueMutex);
+        if (!worker->runQueue.empty()){
+            session = worker->runQueue.front();
+            worker->runQueue.pop_front();
+        }
+    }
+
+    // Steal from back of other queues, oldest work stays with its owner.
+    for (unsigned int i = 1; session == nullptr && i < workers.size(); i++){
+        Worker* victim = workers[(_workerIndex + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim->queueMutex);
+        if (!victim->runQueue.empty()){
+            session = victim->runQueue.back();
+            victim->runQueue.pop_back();
+        }
+    }
+
+    if (session != nullptr){
+        queuedSessions.fetch_sub(1);
+    }
+
+    return session;
+}
+
+void SessionScheduler::workerLoop(unsigned int _workerIndex){
+
+    currentScheduler = this;
+    currentWorkerIndex = _workerIndex;
+
+    while (true){
+
+        ZrtpPoint* session = takeSession(_workerIndex);
+
+        if (session != nullptr){
+            runningSession = session;
+            runningSessionDetached = false;
+            session->runSession();
+            runningSession = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idleWorkers.fetch_add(1);
+        workAvailable.wait(lock, [this](){return stopping || queuedSessions.load() > 0;});
+        idleWorkers.fetch_sub(1);
+
+        // Stopping scheduler runs queued sessions first, so events which were counted are handled.
+        if (stopping && queuedSessions.load() == 0){
+            return;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef SESSIONSCHEDULER_H
+#define SESSIONSCHEDULER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <deque>
+
+// Count of events which session handles before it gives worker to other sessions.
+#define SESSION_EVENTS_BATCH 16
+
+class ZrtpPoint;
+
+/**
+ * @brief The SessionScheduler class represent work-stealing pool of workers, which run ZRTP sessions.
+ *        Session with events in its mailbox is put to run queue of one worker, idle workers steal
+ *        sessions from other workers. Session is run by at most one worker at a time, so its events
+ *        are handled in order without any global lock.
+ */
+class SessionScheduler{
+
+    // Every worker has own run queue, its lock is taken only by owner and stealing workers.
+    typedef struct{
+        std::mutex queueMutex;
+        std::deque<ZrtpPoint*> runQueue;
+    } Worker;
+
+    std::vector<Worker*> workers;
+    std::vector<std::thread> threads;
+
+    // Used for sessions scheduled from threads which are not workers.
+    std::atomic<unsigned int> nextWorker;
+
+    // Parking of idle workers.
+    std::mutex idleMutex;
+    std::condition_variable workAvailable;
+    std::atomic<unsigned int> idleWorkers;
+    std::atomic<unsigned int> queuedSessions;
+
+    // Detached session which is queued or runs in other worker is waited for, worker signals when session
+    // has no event.
+    std::mutex detachMutex;
+    std::condition_variable sessionFinished;
+    std::atomic<unsigned int> detachingSessions;
+
+    bool stopping;
+
+    /**
+     * @brief workerLoop run sessions from own queue or stolen ones until scheduler is destroyed.
+     * @param _workerIndex index of worker.
+     */
+    void workerLoop(unsigned int _workerIndex);
+
+    /**
+     * @brief takeSession take session from front of own queue or steal one from back of other queue.
+     * @param _workerIndex index of worker which looks for work.
+     * @return session to run or nullptr if all queues are empty.
+     */
+    ZrtpPoint* takeSession(unsigned int _workerIndex);
+
+public:
+
+    /**
+     * @brief SessionScheduler constructor start workers.
+     * @param _workersCount count of workers, 0 means one worker per core.
+     */
+    SessionScheduler(unsigned int _workersCount = 0);
+
+    /**
+     * @brief ~SessionScheduler run sessions which are still queued and stop workers. Sessions must be
+     *        detached before, scheduler must not be used by them any more.
+     */
+    ~SessionScheduler();
+
+    /**
+     * @brief schedule put session to run queue. It is called by session, when first event
+     *        comes to its empty mailbox.
+     * @param _session session to run.
+     */
+    void schedule(ZrtpPoint* _session);
+
+    /**
+     * @brief detach make sure no worker runs session and none will run it, so session can be deleted.
+     *        Session which is queued or run by other worker is waited for, worker drops its events. Session
+     *        which is detached from its own event handler is left by worker after handler returns.
+     * @param _session session to detach, its events which were not handled are dropped with it.
+     */
+    void detach(ZrtpPoint* _session);
+
+    /**
+     * @brief sessionIdle called by session, when worker handled its last event. Session itself can be
+     *        deleted at this moment, it is not touched.
+     */
+    void sessionIdle();
+
+    /**
+     * @brief leaveDetachedSession check if session run by calling worker was detached by its event handler.
+     *        Worker must not touch such session any more.
+     * @return true if session was detached.
+     */
+    static bool leaveDetachedSession();
+
+    /**
+     * @brief getWorkersCount getter for count of workers.
+     * @return count of workers.
+     */
+    unsigned int getWorkersCount() {return workers.size();}
+};
+
+#endif // SESSIONSCHEDULER_H
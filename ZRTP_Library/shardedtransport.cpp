@@ -0,0 +1,40 @@
+#include "shardedtransport.h"
+#include "zrtpPacket/packetlayout.h"
+#include <linux/filter.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <pthread.h>
+
+bool attachSourceSteering(int _socketDescriptor, unsigned int _sockets){
+
+    // Kernel runs program on UDP payload, word load reads SSRC in network order and its modulo is index
+    // of socket in group. Datagram shorter than head aborts program, it goes to first socket then.
+    sock_filter program[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, PacketHeadLayout::SourceId::offset},
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, _sockets},
+        {BPF_RET | BPF_A, 0, 0, 0}
+    };
+
+    sock_fprog filter;
+    filter.len = sizeof(program) / sizeof(sock_filter);
+    filter.filter = program;
+
+    return setsockopt(_socketDescriptor, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &filter, sizeof(filter)) == 0;
+}
+
+unsigned int sourceShard(uint32_t _sourceIdentifier, unsigned int _shards){
+
+    // SSRC is written in host byte order, program reads same bytes in network order.
+    return ntohl(_sourceIdentifier) % _shards;
+}
+
+bool pinThread(std::thread &_thread, unsigned int _core){
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(_core % cores, &set);
+
+    return pthread_setaffinity_np(_thread.native_handle(), sizeof(set), &set) == 0;
+}
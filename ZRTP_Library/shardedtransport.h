@@ -0,0 +1,212 @@
+#ifndef SHARDEDTRANSPORT_H
+#define SHARDEDTRANSPORT_H
+
+#include "datagramtransport.h"
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief attachSourceSteering attach classic BPF program to SO_REUSEPORT group of socket. Program picks
+ *        socket of group by SSRC in head of ZRTP packet, so all packets of one session come to same socket.
+ * @param _socketDescriptor any socket of group.
+ * @param _sockets count of sockets in group.
+ * @return true if succesfull false otherwise.
+ */
+bool attachSourceSteering(int _socketDescriptor, unsigned int _sockets);
+
+/**
+ * @brief sourceShard index of socket to which steering program passes packets of given SSRC.
+ * @param _sourceIdentifier SSRC as read from packet.
+ * @param _shards count of sockets in group.
+ * @return index of socket in order in which sockets were bound.
+ */
+unsigned int sourceShard(uint32_t _sourceIdentifier, unsigned int _shards);
+
+/**
+ * @brief pinThread let thread run only on one CPU core.
+ * @param _thread running thread.
+ * @param _core index of core, it is taken modulo count of cores.
+ * @return true if succesfull false otherwise.
+ */
+bool pinThread(std::thread& _thread, unsigned int _core);
+
+/**
+ * @brief The ShardedTransport class receive on one address by several transports, one per core. Every
+ *        shard has own SO_REUSEPORT socket, points and timers and runs on own pinned thread, kernel passes
+ *        every datagram to shard chosen by SSRC of packet, so session is handled by one core only and no
+ *        lock is shared by shards. Sessions are created by Hello from peers (RESPONDER), point which
+ *        initiates must be added to shard of peers SSRC on thread of that shard.
+ *        Transport is EpollTransport or UringTransport.
+ */
+template <class Transport>
+class ShardedTransport{
+
+public:
+
+    typedef std::function<void(Transport*, ZrtpPoint*)> shardNegotiationHandler;
+
+private:
+
+    std::vector<Transport*> shards;
+    std::vector<std::thread> threads;
+
+public:
+
+    /**
+     * @brief ShardedTransport create shards, they are opened by open().
+     * @param _shards count of shards, 0 creates one shard per core.
+     */
+    ShardedTransport(unsigned int _shards = 0){
+        if (_shards == 0){
+            _shards = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned int i = 0; i < _shards; i++){
+            shards.push_back(new Transport);
+        }
+    }
+
+    /**
+     * @brief ~ShardedTransport stop shards and delete them with all their points.
+     */
+    ~ShardedTransport(){
+        stop();
+        for (unsigned int i = 0; i < shards.size(); i++){
+            delete shards[i];
+        }
+    }
+
+    ShardedTransport(const ShardedTransport&) = delete;
+    ShardedTransport& operator=(const ShardedTransport&) = delete;
+
+    /**
+     * @brief open bind sockets of all shards to local address and attach steering program to their group.
+     * @param _localAddress IPv4 address and port, port 0 lets system choose one for all shards.
+     * @return true if succesfull false otherwise.
+     */
+    bool open(const sockaddr_in& _localAddress){
+
+        // Index of shard is index of its socket in group, so sockets are bound in order of shards.
+        sockaddr_in localAddress = _localAddress;
+        for (unsigned int i = 0; i < shards.size(); i++){
+            if (!shards[i]->open(localAddress, true)){
+                close();
+                return false;
+            }
+            localAddress = shards[0]->getLocalAddress();
+        }
+
+        if (!attachSourceSteering(shards[0]->getSocketDescriptor(), shards.size())){
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief close close sockets of all shards, points are kept.
+     */
+    void close(){
+        for (unsigned int i = 0; i < shards.size(); i++){
+            shards[i]->close();
+        }
+    }
+
+    /**
+     * @brief start run every shard on own thread pinned to own core. Stopped shards start again after open().
+     */
+    void start(){
+        for (unsigned int i = 0; i < shards.size(); i++){
+            Transport* shard = shards[i];
+            threads.emplace_back([shard]{shard->run();});
+            pinThread(threads.back(), i);
+        }
+    }
+
+    /**
+     * @brief stop stop all shards and wait for their threads.
+     */
+    void stop(){
+        for (unsigned int i = 0; i < threads.size(); i++){
+            shards[i]->stop();
+        }
+        for (unsigned int i = 0; i < threads.size(); i++){
+            threads[i].join();
+        }
+        threads.clear();
+    }
+
+    /**
+     * @brief setNegotiationHandler set function called on thread of shard when point ends key negotiation.
+     *        Handlers of different shards run at the same time.
+     * @param _handler handler, it gets shard of point and it can remove the point from it.
+     */
+    void setNegotiationHandler(shardNegotiationHandler _handler){
+        for (unsigned int i = 0; i < shards.size(); i++){
+            Transport* shard = shards[i];
+            shard->setNegotiationHandler([shard, _handler](ZrtpPoint* _point){_handler(shard, _point);});
+        }
+    }
+
+    /**
+     * @brief setAcceptingSessions allow Hello from unknown address to create RESPONDER session in shard.
+     * @param _accepting true to accept sessions.
+     */
+    void setAcceptingSessions(bool _accepting){
+        for (unsigned int i = 0; i < shards.size(); i++){
+            shards[i]->setAcceptingSessions(_accepting);
+        }
+    }
+
+    /**
+     * @brief setSessionPool share pool of prepared points by all shards, pool is thread safe.
+     * @param _sessionPool pool of prepared points, it must outlive transport.
+     */
+    void setSessionPool(SessionPool* _sessionPool){
+        for (unsigned int i = 0; i < shards.size(); i++){
+            shards[i]->setSessionPool(_sessionPool);
+        }
+    }
+
+    /**
+     * @brief getShardsCount getter for count of shards.
+     * @return count of shards.
+     */
+    unsigned int getShardsCount() {return shards.size();}
+
+    /**
+     * @brief getShard getter for shard.
+     * @param _index index of shard.
+     * @return shard.
+     */
+    Transport* getShard(unsigned int _index) {return shards[_index];}
+
+    /**
+     * @brief getShardOfSource getter for shard which receives packets of given SSRC.
+     * @param _sourceIdentifier SSRC of peer.
+     * @return shard.
+     */
+    Transport* getShardOfSource(uint32_t _sourceIdentifier) {return shards[sourceShard(_sourceIdentifier, shards.size())];}
+
+    /**
+     * @brief getStatistics sum counters of all shards, shards must be stopped.
+     * @return statistics.
+     */
+    TransportStatistics getStatistics(){
+        TransportStatistics total;
+        for (unsigned int i = 0; i < shards.size(); i++){
+            const TransportStatistics& statistics = shards[i]->getStatistics();
+            total.datagramsReceived += statistics.datagramsReceived;
+            total.datagramsDropped += statistics.datagramsDropped;
+            total.datagramsSent += statistics.datagramsSent;
+            total.sendsFailed += statistics.sendsFailed;
+            total.receiveCalls += statistics.receiveCalls;
+            total.sendCalls += statistics.sendCalls;
+            total.systemCalls += statistics.systemCalls;
+        }
+        return total;
+    }
+};
+
+#endif // SHARDEDTRANSPORT_H
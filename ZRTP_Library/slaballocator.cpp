@@ -0,0 +1,67 @@
+#include "slaballocator.h"
+#include "securepool.h"
+#include <cstddef>
+#include <new>
+
+SlabAllocator::SlabAllocator(size_t _slotSize, bool _zeroOnRelease){
+
+    // Every slot keeps alignment of page and can hold link of free list.
+    const size_t alignment = alignof(std::max_align_t);
+    slotSize = (_slotSize < sizeof(void*)) ? sizeof(void*) : _slotSize;
+    slotSize = (slotSize + alignment - 1) / alignment * alignment;
+
+    zeroOnRelease = _zeroOnRelease;
+    freeSlots = nullptr;
+}
+
+SlabAllocator::~SlabAllocator(){
+
+    for (unsigned int i = 0; i < pages.size(); i++){
+        ::operator delete(pages[i]);
+    }
+}
+
+void* SlabAllocator::allocate(size_t _size){
+
+    if (_size > slotSize){
+        return ::operator new(_size);
+    }
+
+    std::lock_guard<ProfiledMutex> lock(slabMutex);
+
+    if (freeSlots == nullptr){
+        char* page = (char*) ::operator new(slotSize * SLAB_SLOTS_PER_PAGE);
+        pages.push_back(page);
+
+        // Link slots of new page to free list, first slot ends on top.
+        for (int i = SLAB_SLOTS_PER_PAGE - 1; i >= 0; i--){
+            *(void**) (page + i * slotSize) = freeSlots;
+            freeSlots = page + i * slotSize;
+        }
+    }
+
+    void* slot = freeSlots;
+    freeSlots = *(void**) slot;
+
+    return slot;
+}
+
+void SlabAllocator::release(void *_slot, size_t _size){
+
+    if (_slot == nullptr){
+        return;
+    }
+
+    if (_size > slotSize){
+        ::operator delete(_slot);
+        return;
+    }
+
+    if (zeroOnRelease){
+        secureZero(_slot, slotSize);
+    }
+
+    std::lock_guard<ProfiledMutex> lock(slabMutex);
+    *(void**) _slot = freeSlots;
+    freeSlots = _slot;
+}
@@ -0,0 +1,60 @@
+#ifndef SLABALLOCATOR_H
+#define SLABALLOCATOR_H
+
+#include "lockprofiler.h"
+#include <vector>
+#include <stddef.h>
+
+// Count of slots which slab takes from heap at once.
+#define SLAB_SLOTS_PER_PAGE 64
+
+/**
+ * @brief The SlabAllocator class represent allocator of fixed size slots. Slots are taken from heap in pages
+ *        and released slots are kept in free list, so objects of one type are packed together and heap is
+ *        not fragmented by sessions which live for whole call. Slot can be released by other thread than
+ *        allocated it.
+ */
+class SlabAllocator{
+
+    size_t slotSize;
+    bool zeroOnRelease;
+
+    ProfiledMutex slabMutex{SLAB_LOCK};
+
+    // Released slots are linked through their first bytes.
+    void* freeSlots;
+    std::vector<void*> pages;
+
+public:
+
+    /**
+     * @brief SlabAllocator constructor for empty slab, first page is taken with first allocation.
+     * @param _slotSize size of object stored in slot.
+     * @param _zeroOnRelease true if released slot is overwritten with zeros.
+     */
+    SlabAllocator(size_t _slotSize, bool _zeroOnRelease = false);
+
+    /**
+     * @brief ~SlabAllocator return all pages to heap. All slots must be released before.
+     */
+    ~SlabAllocator();
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    /**
+     * @brief allocate take slot from free list or new page.
+     * @param _size size of object, bigger objects than slot are allocated from heap.
+     * @return memory for object.
+     */
+    void* allocate(size_t _size);
+
+    /**
+     * @brief release return slot to free list.
+     * @param _slot memory of object.
+     * @param _size size of object.
+     */
+    void release(void* _slot, size_t _size);
+};
+
+#endif // SLABALLOCATOR_H
@@ -1,9 +1,73 @@
 #include "statemachine.h"
+#include "zrtpPacket/crc32c.h"
 #include <unistd.h>
 
 using std::cout;
 using std::endl;
 
+// Handler of every state, indexed by ZrtpStates. WaitForHelloAck is never entered.
+static constexpr handler stateHandlers[] = {
+    &StateMachine::handleInitialState,              // InitialState
+    &StateMachine::handleHelloSentState,            // HelloSent
+    &StateMachine::handleHelloAckSentState,         // HelloAckSent
+    &StateMachine::handleHelloAckReceivedState,     // HelloAckReceived
+    nullptr,                                        // WaitForHelloAck
+    &StateMachine::handleCommitSentState,           // CommitSent
+    &StateMachine::handleCommitSentComputingState,  // CommitSentComputing
+    &StateMachine::handleWaitForCommitState,        // WaitForCommit
+    &StateMachine::handleWaitForDH2state,           // WaitForDH2
+    &StateMachine::handleWaitForDH2ComputingState,  // WaitForDH2Computing
+    &StateMachine::handleWaitForConfirm1State,      // WaitForConfirm1
+    &StateMachine::handleWaitForConfirm2State,      // WaitForConfirm2
+    &StateMachine::handleWaitForConfAckState,       // WaitForConfAck
+    &StateMachine::handleWaitForErrorAckState,      // WaitForErrorAck
+    &StateMachine::handleSecuredState               // SecuredState
+};
+
+// Messages handled by every state, indexed by [ZrtpStates][MESSAGE_TYPE]. Error is handled before
+// state handlers, other messages are rejected before handler is called.
+static constexpr bool stateMessages[][MESSAGE_TYPES_COUNT] = {
+//   Hello  HelloACK Commit DHPart1 DHPart2 Confirm1 Confirm2 Conf2ACK Error  ErrorACK Unknown
+    {false, false,   false, false,  false,  false,   false,   false,   false, false,   false},  // InitialState
+    {true,  true,    true,  false,  false,  false,   false,   false,   false, false,   false},  // HelloSent
+    {true,  true,    true,  false,  false,  false,   false,   false,   false, false,   false},  // HelloAckSent
+    {true,  false,   false, false,  false,  false,   false,   false,   false, false,   false},  // HelloAckReceived
+    {false, false,   false, false,  false,  false,   false,   false,   false, false,   false},  // WaitForHelloAck
+    {false, false,   true,  true,   false,  true,    false,   false,   false, false,   false},  // CommitSent
+    {false, false,   false, false,  false,  false,   false,   false,   false, false,   false},  // CommitSentComputing
+    {true,  false,   true,  false,  false,  false,   false,   false,   false, false,   false},  // WaitForCommit
+    {false, false,   true,  false,  true,   false,   false,   false,   false, false,   false},  // WaitForDH2
+    {false, false,   false, false,  false,  false,   false,   false,   false, false,   false},  // WaitForDH2Computing
+    {false, false,   false, false,  false,  true,    false,   false,   false, false,   false},  // WaitForConfirm1
+    {false, false,   false, false,  true,   false,   true,    false,   false, false,   false},  // WaitForConfirm2
+    {false, false,   false, false,  false,  false,   false,   true,    false, false,   false},  // WaitForConfAck
+    {false, false,   false, false,  false,  false,   false,   false,   false, true,    false},  // WaitForErrorAck
+    {false, false,   false, false,  false,  false,   true,    false,   false, false,   false}   // SecuredState
+};
+
+static_assert(sizeof(stateHandlers) / sizeof(stateHandlers[0]) == ZRTP_STATES_COUNT,
+              "Every state needs entry in stateHandlers");
+static_assert(sizeof(stateMessages) / sizeof(stateMessages[0]) == ZRTP_STATES_COUNT,
+              "Every state needs row in stateMessages");
+
+// Every state except WaitForHelloAck has handler, only states with handler accept messages.
+constexpr bool statesCovered(unsigned int _state = 0, unsigned int _messageType = 0){
+    return _state == ZRTP_STATES_COUNT ||
+           (_messageType == MESSAGE_TYPES_COUNT ?
+                ((stateHandlers[_state] != nullptr || _state == WaitForHelloAck) && statesCovered(_state + 1, 0)) :
+                ((stateHandlers[_state] != nullptr || !stateMessages[_state][_messageType]) &&
+                 statesCovered(_state, _messageType + 1)));
+}
+static_assert(statesCovered(), "State without handler in stateHandlers or with messages but no handler");
+
+// Error and unknown messages never reach state handlers.
+constexpr bool columnUnused(unsigned int _messageType, unsigned int _state = 0){
+    return _state == ZRTP_STATES_COUNT ||
+           (!stateMessages[_state][_messageType] && columnUnused(_messageType, _state + 1));
+}
+static_assert(columnUnused(ERROR_MESSAGE), "Error message is handled before state handlers");
+static_assert(columnUnused(UNKNOWN_MESSAGE), "Unknown message can not be dispatched");
+
 void StateMachine::initTimers(){
     T1.capping = 200;
     T1.startTime = 50;
@@ -14,27 +78,23 @@ void StateMachine::initTimers(){
     T2.startTime = 150;
     T2.maxResend = 10;
     T2.timeoutsCounter = 0;
+
+    retransmissionsCount = 0;
 }
 
 StateMachine::StateMachine(ZrtpPoint *_zrtpPoint){
 
     zrtpPoint = _zrtpPoint;
+    stateMachineEvent = nullptr;
     currentErrorCode = N_ERROR;
     helloReceived = false;
     commitHandled = false;
+    coroutineHandshake = false;
+    receivedMessage = UNKNOWN_MESSAGE;
 
-    currentStateMap[InitialState]     = &StateMachine::handleInitialState;
-    currentStateMap[HelloSent]        = &StateMachine::handleHelloSentState;
-    currentStateMap[HelloAckSent]     = &StateMachine::handleHelloAckSentState;
-    currentStateMap[HelloAckReceived] = &StateMachine::handleHelloAckReceivedState;
-    currentStateMap[CommitSent]       = &StateMachine::handleCommitSentState;
-    currentStateMap[WaitForCommit]    = &StateMachine::handleWaitForCommitState;
-    currentStateMap[WaitForDH2]       = &StateMachine::handleWaitForDH2state;
-    currentStateMap[WaitForConfirm1]  = &StateMachine::handleWaitForConfirm1State;
-    currentStateMap[WaitForConfirm2]  = &StateMachine::handleWaitForConfirm2State;
-    currentStateMap[WaitForConfAck]   = &StateMachine::handleWaitForConfAckState;
-    currentStateMap[WaitForErrorAck]  = &StateMachine::handleWaitForErrorAckState;
-    currentStateMap[SecuredState]     = &StateMachine::handleSecuredState;
+    pendingCryptoJob = 0;
+    lastCryptoJob = 0;
+    cryptoErrorCode = N_ERROR;
 
     setState(InitialState);
     std::cout << std::endl << "## Current state: INITIAL ##" << std::endl;
@@ -43,8 +103,42 @@ StateMachine::StateMachine(ZrtpPoint *_zrtpPoint){
 }
 
 StateMachine::~StateMachine(){
+}
+
+void StateMachine::reset(){
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+    handshake.destroy();
+#endif
+
+    stateMachineEvent = nullptr;
+    currentErrorCode = N_ERROR;
+    helloReceived = false;
+    commitHandled = false;
+    receivedMessage = UNKNOWN_MESSAGE;
+
+    cancelCryptoJob();
+    cryptoErrorCode = N_ERROR;
+
+    setState(InitialState);
+    initTimers();
+}
+
+bool StateMachine::setCoroutineHandshake(bool _enabled){
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+    coroutineHandshake = _enabled;
+    return true;
+#else
+    coroutineHandshake = false;
+    return !_enabled;
+#endif
+}
+
+void StateMachine::reportState(ZrtpStates _state, const char *_stateName){
 
-    delete stateMachineEvent;
+    setState(_state);
+    std::cout << std::endl << std::endl << "## Current state: " << _stateName << " ##" << std::endl;
 }
 
 void StateMachine::resetTimer(){
@@ -55,6 +149,101 @@ void StateMachine::resetTimer(){
     T2.actualTime = 0;
 }
 
+void StateMachine::sendPacket(uint8_t *_data, uint16_t _length){
+
+    stampPacketHead(_data);
+    setPacketCrc(_data, _length);
+    zrtpPoint->zrtpPointCallbacks->sendData(_data, _length);
+}
+
+void StateMachine::stampPacketHead(uint8_t *_data){
+
+    // Head is not covered by hashes and MACs of messages, so it is written just before CRC.
+    uint32_t sourceIdentifier = zrtpPoint->getSourceIdentifier();
+    PacketHeadLayout::SourceId::write(_data, &sourceIdentifier);
+}
+
+void StateMachine::sendRetainedPacket(uint8_t *_data, uint16_t _length){
+
+    setLastSentPacket(_data, _length);
+    resendLastPacket();
+}
+
+void StateMachine::setLastSentPacket(uint8_t *_data, uint16_t _length){
+
+    HandshakeState* handshakeState = zrtpPoint->getHandshakeState();
+    zrtpPoint->releaseLastSentPacket();
+
+    // CRC is computed once, resent packet is not changed.
+    stampPacketHead(_data);
+    setPacketCrc(_data, _length);
+
+    // Message keeps its own data, hashes, MACs and later messages are computed from it after leased buffer
+    // is released. Packet is copied to leased buffer once, then every send and resend passes buffer itself.
+    uint8_t* leasedBuffer = zrtpPoint->zrtpPointCallbacks->leaseSendBuffer(_length);
+    if (leasedBuffer != nullptr){
+        memcpy(leasedBuffer, _data, _length);
+        handshakeState->lastSentMessageData = leasedBuffer;
+        handshakeState->lastSentMessageLeased = true;
+    }   else {
+            handshakeState->lastSentMessageData = _data;
+        }
+    handshakeState->lastSentMessageLength = _length;
+}
+
+void StateMachine::resendLastPacket(){
+
+    HandshakeState* handshakeState = zrtpPoint->handshakeState;
+
+    if (handshakeState == nullptr || handshakeState->lastSentMessageData == nullptr){
+        return;
+    }
+
+    if (handshakeState->lastSentMessageLeased){
+        zrtpPoint->zrtpPointCallbacks->sendLeasedData(handshakeState->lastSentMessageData,
+                                                      handshakeState->lastSentMessageLength);
+    }   else {
+            zrtpPoint->zrtpPointCallbacks->sendData(handshakeState->lastSentMessageData,
+                                                    handshakeState->lastSentMessageLength);
+        }
+}
+
+void StateMachine::startCryptoJob(CryptoPool::cryptoTask _task){
+
+    // Job id 0 is reserved for no pending job.
+    if (++lastCryptoJob == 0){
+        ++lastCryptoJob;
+    }
+    pendingCryptoJob = lastCryptoJob;
+
+    if (zrtpPoint->cryptoPool == nullptr){
+
+        // Without pool we compute here and handle result as nested CRYPTO event.
+        _task();
+
+        ZrtpEvent cryptoEvent = {CRYPTO, nullptr, 0, pendingCryptoJob};
+        ZrtpEvent* interruptedEvent = stateMachineEvent;
+
+        stateMachineEvent = &cryptoEvent;
+        (this->*stateHandlers[currentState])();
+        stateMachineEvent = interruptedEvent;
+        return;
+    }
+
+    ZrtpPoint* point = zrtpPoint;
+    unsigned int jobId = pendingCryptoJob;
+    zrtpPoint->cryptoPool->submit(zrtpPoint, _task, [point, jobId](){point->processCryptoResult(jobId);});
+}
+
+void StateMachine::cancelCryptoJob(){
+
+    if (pendingCryptoJob != 0 && zrtpPoint->cryptoPool != nullptr){
+        zrtpPoint->cryptoPool->cancel(zrtpPoint);
+    }
+
+    pendingCryptoJob = 0;
+}
+
 bool StateMachine::startTimer(ZrtpTimer *_timer){
 
     _timer->actualTime = _timer->startTime;
@@ -62,6 +251,13 @@ bool StateMachine::startTimer(ZrtpTimer *_timer){
     return (zrtpPoint->zrtpPointCallbacks->startTimer(_timer->startTime));
 }
 
+bool StateMachine::startDeferredTimer(ZrtpTimer *_timer, uint16_t _deferral){
+
+    _timer->actualTime = _timer->startTime;
+
+    return (zrtpPoint->zrtpPointCallbacks->startTimer(_timer->startTime + _deferral));
+}
+
 bool StateMachine::nextTimer(ZrtpTimer *_timer){
 
     if (_timer->actualTime <= _timer->capping){
@@ -70,6 +266,7 @@ bool StateMachine::nextTimer(ZrtpTimer *_timer){
 
     if (_timer->timeoutsCounter <  _timer->maxResend){
         _timer->timeoutsCounter++;
+        retransmissionsCount++;
     }   else {
             return false;
         }
@@ -79,13 +276,70 @@ bool StateMachine::nextTimer(ZrtpTimer *_timer){
 
 void StateMachine::processEvent(ZrtpEvent* _event){
 
-    zrtpPoint->zrtpPointCallbacks->enterCriticalSection();
+    // Scheduled session is run by one worker at a time, so it needs no lock.
+    bool locked = !zrtpPoint->isScheduled();
+
+    if (locked){
+        zrtpPoint->zrtpPointCallbacks->enterCriticalSection();
+    }
+
+    // Session which was secured before handles only retransmissions, application is signalled once.
+    bool securedBefore = (getCurrentState() == SecuredState);
 
     stateMachineEvent = _event;
+    dispatchEvent();
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+    // Handshake which finished, failed or was stopped releases its frame.
+    if (handshake.isActive() && (handshake.isDone() || currentState == InitialState || currentState == WaitForErrorAck)){
+        handshake.destroy();
+    }
+#endif
+
+    // State is read before leaving, crypto pool thread can change it right after.
+    bool secured = (getCurrentState() == SecuredState);
+
+    // Secured session keeps only keys, memory of handshake is zeroised and released.
+    if (secured){
+        zrtpPoint->compactSession();
+    }
+
+    if (locked){
+        zrtpPoint->zrtpPointCallbacks->leaveCriticalSection();
+    }
+
+    // This gives signal to aplication that key negotiation has ended
+    // (we can start negotiation again for tests purposes).
+    if(secured && !securedBefore){
+        zrtpPoint->zrtpPointCallbacks->keyNegotitationEnded();
+    }
+}
+
+void StateMachine::dispatchEvent(){
+
+    receivedMessage = UNKNOWN_MESSAGE;
+
+    // Result of cancelled crypto job or job from previous negotiation is dropped.
+    if (stateMachineEvent->eventType == CRYPTO && stateMachineEvent->cryptoJobId != pendingCryptoJob){
+        return;
+    }
+
+    // Every negotiation runs with fresh handshake state, previous one is released.
+    if (stateMachineEvent->eventType == START && getCurrentState() == InitialState){
+        zrtpPoint->beginNegotiation();
+    }
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+    if (coroutineHandshake && stateMachineEvent->eventType == START && getCurrentState() == InitialState){
+        handshake = runHandshake();
+        handshake.resume(stateMachineEvent);
+        return;
+    }
+#endif
 
     // If EventType is START , engine send Hello message and start key negotiation.
     if ((stateMachineEvent->eventType == START) && (getCurrentState() == InitialState)){
-        (this->*currentStateMap[currentState])();
+        (this->*stateHandlers[currentState])();
     }
 
     if (stateMachineEvent->eventType == MESSAGE && currentState != InitialState){
@@ -93,34 +347,26 @@ void StateMachine::processEvent(ZrtpEvent* _event){
         // Check if messageData are not NULL
         assert(stateMachineEvent->messageData != NULL);
 
-        // We skip packet head and one word (length and unused zeros) to get to message
-        setReceivedMessageType( stateMachineEvent->messageData + PACKET_HEAD_LENGTH + WORD_LENGTH);
-
-        //We skip packet head length which is 12 Bytes and +2 to get to message length field.
-        uint16_t receivedMessageLenght = *(uint16_t*) ( stateMachineEvent->messageData + PACKET_HEAD_LENGTH + 2);
-
-        // Check if length in message is equal to received packet length
-        if (((receivedMessageLenght * 4) != (stateMachineEvent->messageDataLength) - PACKET_WITHOUT_MESSAGE_LENGTH) &&
-             currentState != WaitForErrorAck){
-
-            // If no, send Eroor with mallformed packed
-            zrtpPoint->errorMessage = new ErrorMessage(MALFORMED_PACKET);
-            setErrorCode(MALFORMED_PACKET);
-            sendErroMessage(MALFORMED_PACKET);
-            return;
-        }
+        // Declared length was compared with packet length by validatePacket(), before message was queued.
+        setReceivedMessageType(PacketHeadLayout::MessageType::in(stateMachineEvent->messageData));
+        receivedMessage = classifyMessageType(receivedMessageType);
 
         // Check if received message is error message.
-        if (strncmp((const char *) receivedMessageType, (const char *) "Error   ", 8) == 0){
+        if (receivedMessage == ERROR_MESSAGE){
 
-            // Copy received error code.
-            memcpy(&currentErrorCode,
-                  (uint32_t *) (stateMachineEvent->messageData + PACKET_HEAD_LENGTH + WORD_LENGTH + MESSAGE_TYPE_LENGTH),
-                   WORD_LENGTH);
+            cancelCryptoJob();
 
-            zrtpPoint->errorAckMessage = new ErrorAckMessage();
-            zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->errorAckMessage->getErrorAckData(),
-                                                           ERRORACK_PACKET_SIZE);
+            // Copy received error code, Error of other length carries no code.
+            PacketView errorView(stateMachineEvent->messageData, stateMachineEvent->messageDataLength);
+            if (errorView.hasLayout<ErrorLayout>()){
+                ErrorLayout::ErrorCode::read(errorView.getData(), &currentErrorCode);
+            }   else {
+                    currentErrorCode = MALFORMED_PACKET;
+                }
+
+            zrtpPoint->createMessage(zrtpPoint->errorAckMessage);
+            sendPacket(zrtpPoint->errorAckMessage->getErrorAckData(),
+                       ERRORACK_PACKET_SIZE);
 
             std::cerr << std::endl << "## Received Error message with error code: " << std::hex << currentErrorCode << " ##" << std::endl;
 
@@ -132,34 +378,37 @@ void StateMachine::processEvent(ZrtpEvent* _event){
 
     // If event is STOP, we stop timer here and continue to state where STOP is handled.
     if (stateMachineEvent->eventType == STOP){
+        cancelCryptoJob();
         zrtpPoint->zrtpPointCallbacks->stopTimer();
         setState(InitialState );
         std::cout << std::endl << "## Current state: INITIAL ##" << std::endl;
         return;
     }
 
-    (this->*currentStateMap[currentState])();
-
-    zrtpPoint->zrtpPointCallbacks->leaveCriticalSection();
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+    if (handshake.isActive()){
+        resumeHandshake();
+        return;
+    }
+#endif
 
-    // This gives signal to aplication that key negotiation has ended
-    // (we can start negotiation again for tests purposes).
-    if(getCurrentState() == SecuredState){
-        zrtpPoint->zrtpPointCallbacks->keyNegotitationEnded();
+    // Message which current state does not handle is rejected before handler is called.
+    if (stateMachineEvent->eventType == MESSAGE && !stateMessages[currentState][receivedMessage]){
+        return;
     }
+
+    assert(stateHandlers[currentState] != nullptr);
+    (this->*stateHandlers[currentState])();
 }
 
 void StateMachine::handleInitialState(){
 
     if (stateMachineEvent->eventType == START){
 
-        zrtpPoint->helloMessage = new HelloMessage();
+        zrtpPoint->createMessage(zrtpPoint->helloMessage);
         zrtpPoint->prepareHelloMessage();
 
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->helloMessage->getHelloData(),
-                                                      zrtpPoint->helloMessage->getWholePacketLength());
-
-        setLastSentPacket(zrtpPoint->helloMessage->getHelloData(), zrtpPoint->helloMessage->getWholePacketLength());
+        sendRetainedPacket(zrtpPoint->helloMessage->getHelloData(), zrtpPoint->helloMessage->getWholePacketLength());
 
         if (!startTimer(&T1)){
             sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
@@ -174,14 +423,13 @@ void StateMachine::handleInitialState(){
 
 void StateMachine::handleHelloSentState(){
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Hello   ",
-        MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == HELLO_MESSAGE){
 
         // Save responders hello for further calculation.
         // Check error code : MALFORMED PACKET, EQUAL ZID.
-        zrtpPoint->respondersHello = new HelloMessage();
+        zrtpPoint->createMessage(zrtpPoint->respondersHello);
         if ((currentErrorCode = zrtpPoint->helloMessage->parseHelloMessage(zrtpPoint->respondersHello,
-                                stateMachineEvent->messageData)) != N_ERROR) {
+                                HelloView(stateMachineEvent->messageData, stateMachineEvent->messageDataLength))) != N_ERROR) {
 
             sendErroMessage(currentErrorCode);
             return;
@@ -198,7 +446,7 @@ void StateMachine::handleHelloSentState(){
                    zrtpPoint->helloMessage->getProtocolVersion(), WORD_LENGTH) > 0){
 
             if (nextTimer(&T1)){
-                zrtpPoint->zrtpPointCallbacks->sendData(lastSentMessageData, lastSentMessageLength);
+                resendLastPacket();
             }   else {
                   sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
                   return;
@@ -221,7 +469,7 @@ void StateMachine::handleHelloSentState(){
 
 
             if (nextTimer(&T1)){
-             zrtpPoint->zrtpPointCallbacks->sendData(lastSentMessageData, lastSentMessageLength);
+             resendLastPacket();
             }   else {
                   sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
                   return;
@@ -232,23 +480,22 @@ void StateMachine::handleHelloSentState(){
         if (memcmp(zrtpPoint->respondersHello->getProtocolVersion(),
                    zrtpPoint->helloMessage->getProtocolVersion(), WORD_LENGTH) == 0){
 
-            zrtpPoint->zrtpPointCallbacks->stopTimer();
+            // T1 keeps running, our Hello is retransmitted until HelloACK comes.
 
             // Store hash from hello message.
-            zrtpPoint->setPeersHash(zrtpPoint->respondersHello->getHashImageH3(), zrtpPoint->peersH3);
+            zrtpPoint->setPeersHash(zrtpPoint->respondersHello->getHashImageH3(), zrtpPoint->handshakeState->peersH3);
 
             helloReceived = true;
-            zrtpPoint->helloAckmessage = new HelloACKmessage();
-            zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->helloAckmessage->getHelloAckData(),
-                                                           HELLOACK_PACKET_SIZE);
+            zrtpPoint->createMessage(zrtpPoint->helloAckmessage);
+            sendPacket(zrtpPoint->helloAckmessage->getHelloAckData(),
+                       HELLOACK_PACKET_SIZE);
 
             setState(HelloAckSent);
             std::cout << std::endl << std::endl << "## Current state: HELLO ACK SENT ##" << std::endl;
         }
     }
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "HelloACK",
-        MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == HELLO_ACK_MESSAGE){
 
         zrtpPoint->zrtpPointCallbacks->stopTimer();
         setState(HelloAckReceived);
@@ -256,8 +503,7 @@ void StateMachine::handleHelloSentState(){
         std::cout << std::endl << std::endl << "## Current state: HelloAck received ##" << std::endl;
     }
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Commit  ",
-        MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == COMMIT_MESSAGE){
 
         // Check if we received hello message
         if(!helloReceived){
@@ -267,26 +513,14 @@ void StateMachine::handleHelloSentState(){
 
         zrtpPoint->zrtpPointCallbacks->stopTimer();
 
-        zrtpPoint->commitMessage = new CommitMessage();
-        zrtpPoint->commitMessage->parseCommitMessage(zrtpPoint->commitMessage, stateMachineEvent->messageData);
-        zrtpPoint->setPeersHash(zrtpPoint->commitMessage->getHashImageH2(), zrtpPoint->peersH2);
-
-        // Check hello message, we have key from commit message.
-        if (!(zrtpPoint->verifyMac(zrtpPoint->respondersHello->getHelloData(), zrtpPoint->respondersHello->getMessageLength(),
-                                    HELLO_MESSAGE))) {
-
-            sendErroMessage(MALFORMED_PACKET);
+        if ((currentErrorCode = acceptCommit()) != N_ERROR){
+            sendErroMessage(currentErrorCode);
             return;
         }
 
-        // Compare H2 and H3
-        if (!(zrtpPoint->compareHashValues(zrtpPoint->peersH3, zrtpPoint->peersH2))){
-                std::cerr << "Hash chain error !" << std::endl;
-        }
-
         zrtpPoint->prepareDhPart1Message();
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->dhPart1Message->getDHData(),
-                                                zrtpPoint->dhPart1Message->getWholePacketLength());
+        sendPacket(zrtpPoint->dhPart1Message->getDHData(),
+                   zrtpPoint->dhPart1Message->getWholePacketLength());
 
         setState(WaitForDH2);
         std::cout << std::endl << std::endl << "## Current state: WAIT FOR DHPART 2 ##" << std::endl;
@@ -294,7 +528,7 @@ void StateMachine::handleHelloSentState(){
 
     if (stateMachineEvent->eventType == TIME){
         if(nextTimer(&T1)){
-            zrtpPoint->zrtpPointCallbacks->sendData(lastSentMessageData, lastSentMessageLength);
+            resendLastPacket();
         }   else {
                sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
             }
@@ -303,8 +537,7 @@ void StateMachine::handleHelloSentState(){
 
 void StateMachine::handleHelloAckSentState(){
 
-    if ( stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "HelloACK",
-         MESSAGE_TYPE_LENGTH) == 0){
+    if ( stateMachineEvent->eventType == MESSAGE && receivedMessage == HELLO_ACK_MESSAGE){
 
         // Stop hello retransmision
         setState(HelloAckReceived);
@@ -316,11 +549,11 @@ void StateMachine::handleHelloAckSentState(){
             commitHandled = true;
 
             // Prepare Dhpart2 message and calculate Hvi
-            zrtpPoint->dhPart2Message = new DHPart();
+            zrtpPoint->createMessage(zrtpPoint->dhPart2Message);
             zrtpPoint->prepareDhPart2Message();
             zrtpPoint->calculateHvi(zrtpPoint->respondersHello);
 
-            zrtpPoint->commitMessage = new CommitMessage();
+            zrtpPoint->createMessage(zrtpPoint->commitMessage);
 
             // Check if we support key algorithm
             if ((currentErrorCode = zrtpPoint->algorithmNegotiation()) != N_ERROR){
@@ -329,10 +562,7 @@ void StateMachine::handleHelloAckSentState(){
             }
 
             zrtpPoint->prepareCommitMessage();
-            zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->commitMessage->getCommitData(),
-                                                           DH_COMMIT_PACKET_LENGTH);
-
-            setLastSentPacket(zrtpPoint->commitMessage->getCommitData(), DH_COMMIT_PACKET_LENGTH);
+            sendRetainedPacket(zrtpPoint->commitMessage->getCommitData(), DH_COMMIT_PACKET_LENGTH);
 
             if (startTimer(&T2) == false){
                 sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
@@ -346,16 +576,43 @@ void StateMachine::handleHelloAckSentState(){
                 commitHandled = true;
 
                 // Calculate secret to speed up processing
-                zrtpPoint->dhPart1Message = new DHPart();
+                zrtpPoint->createMessage(zrtpPoint->dhPart1Message);
                 zrtpPoint->prepareDhPart1Message();
                 setState(WaitForCommit);
                 std::cout << std::endl << std::endl << "## Current state: WAIT FOR COMMIT ##" << std::endl;
         }
     }
 
+    // Peer resends Hello, because our HelloACK was lost.
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == HELLO_MESSAGE){
+        sendPacket(zrtpPoint->helloAckmessage->getHelloAckData(), HELLOACK_PACKET_SIZE);
+        return;
+    }
+
+    // Commit acknowledges our Hello too and peer becomes initiator, its HelloACK was lost.
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == COMMIT_MESSAGE){
+
+        zrtpPoint->zrtpPointCallbacks->stopTimer();
+        commitHandled = true;
+        zrtpPoint->setRole(RESPONDER);
+
+        if ((currentErrorCode = acceptCommit()) != N_ERROR){
+            sendErroMessage(currentErrorCode);
+            return;
+        }
+
+        zrtpPoint->createMessage(zrtpPoint->dhPart1Message);
+        zrtpPoint->prepareDhPart1Message();
+        sendPacket(zrtpPoint->dhPart1Message->getDHData(), zrtpPoint->dhPart1Message->getWholePacketLength());
+
+        setState(WaitForDH2);
+        std::cout << std::endl << std::endl << "## Current state: WAIT FOR DHPART 2 ##" << std::endl;
+        return;
+    }
+
     if (stateMachineEvent->eventType == TIME){
         if(nextTimer(&T1)){
-            zrtpPoint->zrtpPointCallbacks->sendData(lastSentMessageData, lastSentMessageLength);
+            resendLastPacket();
         }   else {
                sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
             }
@@ -364,17 +621,37 @@ void StateMachine::handleHelloAckSentState(){
 
 void StateMachine::handleHelloAckReceivedState(){
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Hello   ",
-        MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == HELLO_MESSAGE){
+
+        // Peers HelloACK came before its Hello, so Hello is parsed and acknowledged here.
+        zrtpPoint->createMessage(zrtpPoint->respondersHello);
+        if ((currentErrorCode = zrtpPoint->helloMessage->parseHelloMessage(zrtpPoint->respondersHello,
+                                HelloView(stateMachineEvent->messageData, stateMachineEvent->messageDataLength))) != N_ERROR) {
+
+            sendErroMessage(currentErrorCode);
+            return;
+        }
+
+        if ((currentErrorCode = zrtpPoint->respondersHello->checkProtocolVersion()) != 0){
+            sendErroMessage(currentErrorCode);
+            return;
+        }
+
+        zrtpPoint->setPeersHash(zrtpPoint->respondersHello->getHashImageH3(), zrtpPoint->handshakeState->peersH3);
+
+        helloReceived = true;
+        zrtpPoint->createMessage(zrtpPoint->helloAckmessage);
+        sendPacket(zrtpPoint->helloAckmessage->getHelloAckData(),
+                   HELLOACK_PACKET_SIZE);
 
         if (zrtpPoint->getCurrentRole() == INITIATOR && commitHandled == false){
 
             // Prepare Dhpart2 message and calculate Hvi
-            zrtpPoint->dhPart2Message = new DHPart();
+            zrtpPoint->createMessage(zrtpPoint->dhPart2Message);
             zrtpPoint->prepareDhPart2Message();
             zrtpPoint->calculateHvi(zrtpPoint->respondersHello);
 
-            zrtpPoint->commitMessage = new CommitMessage();
+            zrtpPoint->createMessage(zrtpPoint->commitMessage);
 
             // Check if we support key algorithm
             if ((currentErrorCode = zrtpPoint->algorithmNegotiation()) != N_ERROR){
@@ -383,10 +660,7 @@ void StateMachine::handleHelloAckReceivedState(){
             }
 
             zrtpPoint->prepareCommitMessage();
-            zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->commitMessage->getCommitData(),
-                                                           DH_COMMIT_PACKET_LENGTH);
-
-            setLastSentPacket(zrtpPoint->commitMessage->getCommitData(), DH_COMMIT_PACKET_LENGTH);
+            sendRetainedPacket(zrtpPoint->commitMessage->getCommitData(), DH_COMMIT_PACKET_LENGTH);
 
             if (startTimer(&T2) == false){
                 sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
@@ -397,7 +671,7 @@ void StateMachine::handleHelloAckReceivedState(){
             std::cout << std::endl << std::endl << "## State: COMMIT SENT ##" << std::endl;
         }
             else {
-                zrtpPoint->dhPart1Message = new DHPart();
+                zrtpPoint->createMessage(zrtpPoint->dhPart1Message);
                 zrtpPoint->prepareDhPart1Message();
                 setState(WaitForCommit);
                 std::cout << std::endl << std::endl << "## Current state:: WAIT FOR COMMIT ##" << std::endl;
@@ -407,28 +681,20 @@ void StateMachine::handleHelloAckReceivedState(){
 
 void StateMachine::handleWaitForCommitState(){
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Commit  ",
-                 MESSAGE_TYPE_LENGTH) == 0){
-
-        zrtpPoint->commitMessage = new CommitMessage();
-        zrtpPoint->commitMessage->parseCommitMessage(zrtpPoint->commitMessage, stateMachineEvent->messageData);
-        zrtpPoint->setPeersHash(zrtpPoint->commitMessage->getHashImageH2(), zrtpPoint->peersH2);
+    // Peer resends Hello, because our HelloACK was lost.
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == HELLO_MESSAGE){
+        sendPacket(zrtpPoint->helloAckmessage->getHelloAckData(), HELLOACK_PACKET_SIZE);
+        return;
+    }
 
-        // Compare hello mac we have H2
-        if (!(zrtpPoint->verifyMac(zrtpPoint->respondersHello->getHelloData(),
-                                   zrtpPoint->respondersHello->getMessageLength(),
-                                   HELLO_MESSAGE))){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == COMMIT_MESSAGE){
 
-            sendErroMessage(MALFORMED_PACKET);
+        if ((currentErrorCode = acceptCommit()) != N_ERROR){
+            sendErroMessage(currentErrorCode);
             return;
         }
 
-        // Compare H2 and H3
-        if (!(zrtpPoint->compareHashValues(zrtpPoint->peersH3, zrtpPoint->peersH2))){
-                std::cerr << "Hash chain error !" << std::endl;
-        }
-
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->dhPart1Message->getDHData(), zrtpPoint->dhPart1Message->getWholePacketLength());
+        sendPacket(zrtpPoint->dhPart1Message->getDHData(), zrtpPoint->dhPart1Message->getWholePacketLength());
         setState(WaitForDH2);
         std::cout << std::endl << std::endl << "## Current state: WAIT FOR DHPART 2 ##" << std::endl;
     }
@@ -436,75 +702,42 @@ void StateMachine::handleWaitForCommitState(){
 
 void StateMachine::handleCommitSentState(){
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "DHPart1 ",
-        MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == DHPART1_MESSAGE){
 
         zrtpPoint->zrtpPointCallbacks->stopTimer();
 
-        // Store received Dhpar1
-        zrtpPoint->dhPart1Message = new DHPart();
-        zrtpPoint->dhPart1Message->setMessageType((uint8_t*) "DHPart1 ");
-        zrtpPoint->dhPart1Message->parseDhMessage(zrtpPoint->dhPart1Message, stateMachineEvent->messageData);
-
-        // Copy H1 from Dhpart
-        zrtpPoint->setPeersHash(zrtpPoint->dhPart1Message->getHashImageH1(), zrtpPoint->peersH1);
-        zrtpPoint->readPublicValue(zrtpPoint->dhPart1Message);
-        zrtpPoint->calculateAll();
-
-        // Calculate H2 from H1 and verify Hello of responder
-        sha256(zrtpPoint->peersH1, 32, zrtpPoint->peersH2, 0);
-        if (!(zrtpPoint->verifyMac(zrtpPoint->respondersHello->getHelloData(),
-                                   zrtpPoint->respondersHello->getMessageLength(),
-                                   HELLO_MESSAGE))){
-
-            sendErroMessage(MALFORMED_PACKET);
+        if ((currentErrorCode = acceptDhPart1()) != N_ERROR){
+            sendErroMessage(currentErrorCode);
             return;
         }
 
-        // Check hash chain of calculated H2 and H3 from responders hello
-        if (!(zrtpPoint->compareHashValues(zrtpPoint->peersH3, zrtpPoint->peersH2))){
-            std::cerr << "Hash chain error !" << std::endl;
-        }
-
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->dhPart2Message->getDHData(),
-                                                zrtpPoint->dhPart2Message->getWholePacketLength());
+        // DH result and keys are computed by crypto job, DHPart2 is sent when it is finished.
+        setState(CommitSentComputing);
+        std::cout << std::endl << std::endl << "## Current state: COMMIT SENT - COMPUTING ##" << std::endl;
 
-        setLastSentPacket(zrtpPoint->dhPart2Message->getDHData(), zrtpPoint->dhPart2Message->getWholePacketLength());
-
-        setState(WaitForConfirm1);
-        // We must wait in this state because peers computation in waitForConfirm1 state take too much time.
-        #if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(__WINDOWS__) || defined(__TOS_WIN__)
-            delay(570);
-        #else  /* presume POSIX */
-             delay(70);
-       #endif
-
-        if (startTimer(&T2) == false){
-            sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
-            return;
-        }
-
-        std::cout << std::endl << std::endl << "## Current state: WAIT FOR CONFIRM 1 ##" << std::endl;
+        startCryptoJob(sharedSecretTask(zrtpPoint->dhPart1Message));
+        return;
     }
 
     // We can not accept commit, we support DH mode only
-    if (strncmp((const char *) getReceivedMessageType(), (const char *) "Confirm1",
-                 MESSAGE_TYPE_LENGTH) == 0){
+    if (receivedMessage == CONFIRM1_MESSAGE){
 
         zrtpPoint->zrtpPointCallbacks->stopTimer();
         sendErroMessage(DH_MODE_REQUIRED);
         return;
     }
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Commit  ",
-        MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == COMMIT_MESSAGE){
 
         // If our hvi value is lower than responder, we continue as a initiator.
-        // stateMachineEvent->messageData + 88 = position of HVI in DH mode.
-        if(memcmp(zrtpPoint->commitMessage->getHvi(), stateMachineEvent->messageData + 88, 32) < 0){
+        // Commit which is not in DH mode is dropped.
+        CommitView peersCommit(stateMachineEvent->messageData, stateMachineEvent->messageDataLength);
+        if(!peersCommit.isValid() || memcmp(zrtpPoint->commitMessage->getHvi(), peersCommit.getHvi(), HVI_LENGTH) < 0){
             // stay INITIATOR, commit is resend by timout.
             return;
         }   else {
+                // Our commit is replaced by commit of peer, it is not resent.
+                zrtpPoint->releaseLastSentPacket();
                 zrtpPoint->setRole(RESPONDER);
                 setState(WaitForCommit);
             }
@@ -512,7 +745,7 @@ void StateMachine::handleCommitSentState(){
 
     if (stateMachineEvent->eventType == TIME){
         if (nextTimer(&T2)){
-            zrtpPoint->zrtpPointCallbacks->sendData(lastSentMessageData, lastSentMessageLength);
+            resendLastPacket();
         }   else{
                 resetTimer();
                 sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
@@ -521,101 +754,101 @@ void StateMachine::handleCommitSentState(){
     }
 }
 
-void StateMachine::handleWaitForDH2state(){
+void StateMachine::handleCommitSentComputingState(){
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "DHPart2 ",
-                 MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == CRYPTO){
 
-        // Store responders DhPart2 message and calculate Hvi from our Hello and received DHpar2
-        zrtpPoint->dhPart2Message = new DHPart();
-        zrtpPoint->dhPart2Message->setMessageType((uint8_t*) "DHPart2 ");
-        zrtpPoint->dhPart2Message->parseDhMessage(zrtpPoint->dhPart2Message, stateMachineEvent->messageData);
+        pendingCryptoJob = 0;
+
+        if (cryptoErrorCode != N_ERROR){
+            sendErroMessage(cryptoErrorCode);
+            return;
+        }
 
-        zrtpPoint->setPeersHash(zrtpPoint->dhPart2Message->getHashImageH1(), zrtpPoint->peersH1);
+        sendRetainedPacket(zrtpPoint->dhPart2Message->getDHData(), zrtpPoint->dhPart2Message->getWholePacketLength());
 
-        // Compare calculated Hvi with Hvi in commit message
-        zrtpPoint->calculateHvi(zrtpPoint->helloMessage);
+        setState(WaitForConfirm1);
 
-        // Send error if Hvi is not equal
-        if(memcmp(zrtpPoint->hvi, zrtpPoint->commitMessage->getHvi(), HVI_LENGTH) != 0){
-           sendErroMessage(DH_ERROR_HASHED_DATA);
-           return;
+        // Peer computes DH result and Confirm1 now, we do not wait for it here. Timer T2 is started with
+        // deferred first timeout, so DHPart2 is not resent until peer had time to answer.
+        if (startDeferredTimer(&T2, PEER_COMPUTATION_DEFERRAL) == false){
+            sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+            return;
         }
 
-        // We can verify MAC of commit, we have H1
-        if((zrtpPoint->verifyMac(zrtpPoint->commitMessage->getCommitData(),zrtpPoint->commitMessage->getMessageLength(),
-                                 COMMIT_MESSAGE)) == false){
+        std::cout << std::endl << std::endl << "## Current state: WAIT FOR CONFIRM 1 ##" << std::endl;
+    }
+
+    // Retransmitted DHPart1 is ignored. Commit timer was stopped when DHPart1 came,
+    // so timeout which was already queued is ignored too.
+}
+
+void StateMachine::handleWaitForDH2state(){
 
-            sendErroMessage(MALFORMED_PACKET);
+    // Resent Commit means our DHPart1 was lost.
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == COMMIT_MESSAGE){
+        sendPacket(zrtpPoint->dhPart1Message->getDHData(), zrtpPoint->dhPart1Message->getWholePacketLength());
+        return;
+    }
+
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == DHPART2_MESSAGE){
+
+        if ((currentErrorCode = acceptDhPart2()) != N_ERROR){
+            sendErroMessage(currentErrorCode);
             return;
         }
 
-        // Check hash chain of H1 and H2
-        if (!zrtpPoint->compareHashValues(zrtpPoint->commitMessage->getHashImageH2(), zrtpPoint->dhPart2Message->getHashImageH1())){
-            std::cerr << "Hash chain error !" << std::endl;
-        }
+        // DH result and keys are computed by crypto job, Confirm1 is sent when it is finished.
+        setState(WaitForDH2Computing);
+        std::cout << std::endl << std::endl << "## Current state: WAIT FOR DHPART 2 - COMPUTING ##" << std::endl;
+
+        startCryptoJob(sharedSecretTask(zrtpPoint->dhPart2Message));
+        return;
+    }
+}
+
+void StateMachine::handleWaitForDH2ComputingState(){
 
-        zrtpPoint->readPublicValue(zrtpPoint->dhPart2Message);
-        zrtpPoint->calculateAll();
+    if (stateMachineEvent->eventType == CRYPTO){
 
-        zrtpPoint->confirmMessage1 = new ConfirmMessage();
+        pendingCryptoJob = 0;
+
+        if (cryptoErrorCode != N_ERROR){
+            sendErroMessage(cryptoErrorCode);
+            return;
+        }
+
+        zrtpPoint->createMessage(zrtpPoint->confirmMessage1);
         zrtpPoint->prepareConfirm1Message();
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->confirmMessage1->getConfirmData(),
-                                                      CONFIRM_PACKET_LENGTH);
+        sendPacket(zrtpPoint->confirmMessage1->getConfirmData(),
+                   CONFIRM_PACKET_LENGTH);
 
         setState(WaitForConfirm2);
         std::cout << std::endl << std::endl << "## Current state: WAIT FOR CONFIRM 2 ##" << std::endl;
     }
+
+    // DHPart2 resent by initiator while we compute is ignored.
 }
 
 void StateMachine::handleWaitForConfirm1State(){
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Confirm1",
-                 MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == CONFIRM1_MESSAGE){
 
         // STOP retransmision of dhpart2
         zrtpPoint->zrtpPointCallbacks->stopTimer();
         resetTimer();
 
-        zrtpPoint->confirmMessage1 = new ConfirmMessage();
-        zrtpPoint->confirmMessage1->parseConfirmMessage(zrtpPoint->confirmMessage1, stateMachineEvent->messageData);
-
-        // Check confirm mac
-        if (!(zrtpPoint->verifyConfirmMac(zrtpPoint->confirmMessage1))){
-            sendErroMessage(AUTH_ERROR);
-            return;
-        }
-        zrtpPoint->decryptConfirmMessage(zrtpPoint->confirmMessage1);
-
-        // Save h0 from confirm
-        zrtpPoint->setPeersHash(zrtpPoint->confirmMessage1->getHashPreimageH0(), zrtpPoint->peersH0);
-
-        if (!(zrtpPoint->compareHashValues(zrtpPoint->peersH1, zrtpPoint->peersH0))){
-                std::cerr << "Hash chain error !" << std::endl;
-        }
-
-        // We can verify DH message with H0 from confirm
-        if (!(zrtpPoint->verifyMac(zrtpPoint->dhPart1Message->getDHData(),
-                                   zrtpPoint->dhPart1Message->getMessageLength(),
-                                   DHPART1_MESSAGE))) {
-
-            sendErroMessage(MALFORMED_PACKET);
+        zrtpPoint->createMessage(zrtpPoint->confirmMessage1);
+        if ((currentErrorCode = acceptConfirm(zrtpPoint->confirmMessage1, zrtpPoint->dhPart1Message,
+                                              DHPART1_MESSAGE)) != N_ERROR){
+            sendErroMessage(currentErrorCode);
             return;
         }
 
-        // Compare my h0 and responders h0 = nonce reused
-        if ((memcmp(zrtpPoint->peersH0, zrtpPoint->myH0, 32) == 0)){
-           sendErroMessage(NONCE_REUSE);
-           return;
-        }
-
-        zrtpPoint->confirmMessage2 = new ConfirmMessage();
+        zrtpPoint->createMessage(zrtpPoint->confirmMessage2);
         zrtpPoint->prepareConfirm2Message();
 
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->confirmMessage2->getConfirmData(),
-                                                CONFIRM_PACKET_LENGTH);
-
-        setLastSentPacket(zrtpPoint->confirmMessage2->getConfirmData(), CONFIRM_PACKET_LENGTH);
+        sendRetainedPacket(zrtpPoint->confirmMessage2->getConfirmData(), CONFIRM_PACKET_LENGTH);
 
         if (startTimer(&T2) == false){
             sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
@@ -629,7 +862,7 @@ void StateMachine::handleWaitForConfirm1State(){
 
     if (stateMachineEvent->eventType == TIME){
         if (nextTimer(&T2)){
-            zrtpPoint->zrtpPointCallbacks->sendData(lastSentMessageData, lastSentMessageLength);
+            resendLastPacket();
         }   else{
                 resetTimer();
                 sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
@@ -640,41 +873,24 @@ void StateMachine::handleWaitForConfirm1State(){
 
 void StateMachine::handleWaitForConfirm2State(){
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Confirm2",
-                 MESSAGE_TYPE_LENGTH) == 0){
+    // Resent DHPart2 means our Confirm1 was lost.
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == DHPART2_MESSAGE){
+        sendPacket(zrtpPoint->confirmMessage1->getConfirmData(), CONFIRM_PACKET_LENGTH);
+        return;
+    }
 
-        zrtpPoint->confirmMessage2 = new ConfirmMessage();
-        zrtpPoint->confirmMessage2->parseConfirmMessage(zrtpPoint->confirmMessage2, stateMachineEvent->messageData);
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == CONFIRM2_MESSAGE){
 
-        if (!(zrtpPoint->verifyConfirmMac(zrtpPoint->confirmMessage2))){
-            sendErroMessage(AUTH_ERROR);
+        zrtpPoint->createMessage(zrtpPoint->confirmMessage2);
+        if ((currentErrorCode = acceptConfirm(zrtpPoint->confirmMessage2, zrtpPoint->dhPart2Message,
+                                              DHPART2_MESSAGE)) != N_ERROR){
+            sendErroMessage(currentErrorCode);
             return;
         }
 
-        zrtpPoint->decryptConfirmMessage(zrtpPoint->confirmMessage2);
-        zrtpPoint->setPeersHash(zrtpPoint->confirmMessage2->getHashPreimageH0(), zrtpPoint->peersH0);
-
-        if (!(zrtpPoint->compareHashValues(zrtpPoint->peersH1, zrtpPoint->peersH0))){
-                std::cerr << "Hash chain error !" << std::endl;
-        }
-
-        if(!(zrtpPoint->verifyMac(zrtpPoint->dhPart2Message->getDHData(),
-                                  zrtpPoint->dhPart2Message->getMessageLength(),
-                                  DHPART2_MESSAGE))){
-
-            sendErroMessage(MALFORMED_PACKET);
-            return;
-        }
-
-        // Compare my h0 and responders h0 = nonce reused
-        if ((memcmp(zrtpPoint->peersH0, zrtpPoint->myH0, 32) == 0)){
-           sendErroMessage(NONCE_REUSE);
-           return;
-        }
-
-        zrtpPoint->conf2AckMessage = new Conf2AckMessage();
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->conf2AckMessage->getConf2AckData(),
-                                                CONF2ACK_PAKET_SIZE);
+        zrtpPoint->createMessage(zrtpPoint->conf2AckMessage);
+        sendPacket(zrtpPoint->conf2AckMessage->getConf2AckData(),
+                   CONF2ACK_PAKET_SIZE);
 
         setState(SecuredState);        
         std::cout  << std::endl << std::endl << "## Current state: SECURED STATE ##" << std::endl;
@@ -684,8 +900,7 @@ void StateMachine::handleWaitForConfirm2State(){
 
 void StateMachine::handleWaitForConfAckState(){
 
-     if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "Conf2ACK",
-         MESSAGE_TYPE_LENGTH) == 0){
+     if (stateMachineEvent->eventType == MESSAGE && receivedMessage == CONF_ACK_MESSAGE){
 
          zrtpPoint->zrtpPointCallbacks->stopTimer();
          resetTimer();
@@ -697,7 +912,7 @@ void StateMachine::handleWaitForConfAckState(){
 
      if (stateMachineEvent->eventType == TIME){
          if (nextTimer(&T2)){
-             zrtpPoint->zrtpPointCallbacks->sendData(lastSentMessageData, lastSentMessageLength);
+             resendLastPacket();
          }   else{
                  resetTimer();
                  sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
@@ -710,20 +925,19 @@ void StateMachine::handleWaitForErrorAckState(){
 
    if (stateMachineEvent->eventType == TIME){
        if(nextTimer(&T2)){
-           zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->errorMessage->getErrorData(),
-                                                          ERROR_MESSAGE_LENGTH);
+           sendPacket(zrtpPoint->errorMessage->getErrorData(),
+                      ERROR_MESSAGE_LENGTH);
        }   else {
                zrtpPoint->errorMessage->setErrorCode(PROTOCOL_TIMEOUT_ERROR);
-               zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->errorMessage->getErrorData(),
-                                              ERROR_MESSAGE_LENGTH);;
+               sendPacket(zrtpPoint->errorMessage->getErrorData(),
+                          ERROR_MESSAGE_LENGTH);;
                setState(InitialState);
                std::cout << std::endl << "## Current state: INITIAL ##" << std::endl;
                return;
        }
    }
 
-    if (stateMachineEvent->eventType == MESSAGE && strncmp((const char *) getReceivedMessageType(), (const char *) "ErrorACK",
-        MESSAGE_TYPE_LENGTH) == 0){
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == ERROR_ACK_MESSAGE){
 
             zrtpPoint->zrtpPointCallbacks->stopTimer();
             setState(InitialState);
@@ -734,18 +948,156 @@ void StateMachine::handleWaitForErrorAckState(){
 
 void StateMachine::handleSecuredState(){
 
+    // Resent Confirm2 means our Conf2ACK was lost, initiator waits for it (RFC 6189, 9.2). Handshake
+    // state is already released, Conf2ACK carries no data of session, so it is built here.
+    if (stateMachineEvent->eventType == MESSAGE && receivedMessage == CONFIRM2_MESSAGE &&
+        zrtpPoint->getCurrentRole() == RESPONDER){
+
+        Conf2AckMessage conf2Ack;
+        sendPacket(conf2Ack.getConf2AckData(), CONF2ACK_PAKET_SIZE);
+    }
+}
+
+zrtpErrorCode StateMachine::acceptCommit(){
+
+    zrtpPoint->createMessage(zrtpPoint->commitMessage);
+    if (zrtpPoint->commitMessage->parseCommitMessage(CommitView(stateMachineEvent->messageData,
+                                                                stateMachineEvent->messageDataLength)) != N_ERROR){
+        return MALFORMED_PACKET;
+    }
+    zrtpPoint->setPeersHash(zrtpPoint->commitMessage->getHashImageH2(), zrtpPoint->handshakeState->peersH2);
+
+    // Check hello message, we have key from commit message.
+    if (!(zrtpPoint->verifyMac(zrtpPoint->respondersHello->getHelloData(),
+                               zrtpPoint->respondersHello->getMessageLength(),
+                               HELLO_MESSAGE))){
+        return MALFORMED_PACKET;
+    }
+
+    // Compare H2 and H3
+    if (!(zrtpPoint->compareHashValues(zrtpPoint->handshakeState->peersH3, zrtpPoint->handshakeState->peersH2))){
+            std::cerr << "Hash chain error !" << std::endl;
+    }
+
+    return N_ERROR;
+}
+
+zrtpErrorCode StateMachine::acceptDhPart1(){
+
+    // Store received Dhpar1
+    zrtpPoint->createMessage(zrtpPoint->dhPart1Message);
+    if (zrtpPoint->dhPart1Message->parseDhMessage(DHPartView(stateMachineEvent->messageData,
+                                                              stateMachineEvent->messageDataLength)) != N_ERROR){
+        return MALFORMED_PACKET;
+    }
+
+    // Copy H1 from Dhpart
+    zrtpPoint->setPeersHash(zrtpPoint->dhPart1Message->getHashImageH1(), zrtpPoint->handshakeState->peersH1);
+
+    // Calculate H2 from H1 and verify Hello of responder
+    sha256(zrtpPoint->handshakeState->peersH1, 32, zrtpPoint->handshakeState->peersH2, 0);
+    if (!(zrtpPoint->verifyMac(zrtpPoint->respondersHello->getHelloData(),
+                               zrtpPoint->respondersHello->getMessageLength(),
+                               HELLO_MESSAGE))){
+        return MALFORMED_PACKET;
+    }
+
+    // Check hash chain of calculated H2 and H3 from responders hello
+    if (!(zrtpPoint->compareHashValues(zrtpPoint->handshakeState->peersH3, zrtpPoint->handshakeState->peersH2))){
+        std::cerr << "Hash chain error !" << std::endl;
+    }
+
+    return N_ERROR;
+}
+
+zrtpErrorCode StateMachine::acceptDhPart2(){
+
+    // Store responders DhPart2 message and calculate Hvi from our Hello and received DHpar2
+    zrtpPoint->createMessage(zrtpPoint->dhPart2Message);
+    if (zrtpPoint->dhPart2Message->parseDhMessage(DHPartView(stateMachineEvent->messageData,
+                                                              stateMachineEvent->messageDataLength)) != N_ERROR){
+        return MALFORMED_PACKET;
+    }
+
+    zrtpPoint->setPeersHash(zrtpPoint->dhPart2Message->getHashImageH1(), zrtpPoint->handshakeState->peersH1);
+
+    // Compare calculated Hvi with Hvi in commit message
+    zrtpPoint->calculateHvi(zrtpPoint->helloMessage);
+
+    if(memcmp(zrtpPoint->handshakeState->hvi, zrtpPoint->commitMessage->getHvi(), HVI_LENGTH) != 0){
+       return DH_ERROR_HASHED_DATA;
+    }
+
+    // We can verify MAC of commit, we have H1
+    if((zrtpPoint->verifyMac(zrtpPoint->commitMessage->getCommitData(),zrtpPoint->commitMessage->getMessageLength(),
+                             COMMIT_MESSAGE)) == false){
+        return MALFORMED_PACKET;
+    }
+
+    // Check hash chain of H1 and H2
+    if (!zrtpPoint->compareHashValues(zrtpPoint->commitMessage->getHashImageH2(), zrtpPoint->dhPart2Message->getHashImageH1())){
+        std::cerr << "Hash chain error !" << std::endl;
+    }
+
+    return N_ERROR;
+}
+
+zrtpErrorCode StateMachine::acceptConfirm(ConfirmMessage *_confirmMessage, DHPart *_peersDhPart,
+                                          MESSAGE_TYPE _dhPartType){
+
+    if (_confirmMessage->parseConfirmMessage(ConfirmView(stateMachineEvent->messageData,
+                                                         stateMachineEvent->messageDataLength)) != N_ERROR){
+        return MALFORMED_PACKET;
+    }
+
+    // Check confirm mac
+    if (!(zrtpPoint->verifyConfirmMac(_confirmMessage))){
+        return AUTH_ERROR;
+    }
+    zrtpPoint->decryptConfirmMessage(_confirmMessage);
+
+    // Save h0 from confirm
+    zrtpPoint->setPeersHash(_confirmMessage->getHashPreimageH0(), zrtpPoint->handshakeState->peersH0);
+
+    if (!(zrtpPoint->compareHashValues(zrtpPoint->handshakeState->peersH1, zrtpPoint->handshakeState->peersH0))){
+            std::cerr << "Hash chain error !" << std::endl;
+    }
+
+    // We can verify DH message with H0 from confirm
+    if (!(zrtpPoint->verifyMac(_peersDhPart->getDHData(), _peersDhPart->getMessageLength(), _dhPartType))){
+        return MALFORMED_PACKET;
+    }
+
+    // Compare my h0 and peers h0 = nonce reused
+    if ((memcmp(zrtpPoint->handshakeState->peersH0, zrtpPoint->handshakeState->secrets->myH0, 32) == 0)){
+       return NONCE_REUSE;
+    }
+
+    return N_ERROR;
+}
+
+CryptoPool::cryptoTask StateMachine::sharedSecretTask(DHPart *_peersDhPart){
+
+    return [this, _peersDhPart](){
+        if ((cryptoErrorCode = zrtpPoint->readPublicValue(_peersDhPart)) == N_ERROR){
+            zrtpPoint->calculateAll();
+        }
+    };
 }
 
 void StateMachine::sendErroMessage(zrtpErrorCode _errorCode){
 
+        cancelCryptoJob();
+
         currentErrorCode = _errorCode;
-        zrtpPoint->errorMessage = new ErrorMessage(currentErrorCode);
+        zrtpPoint->createMessage(zrtpPoint->errorMessage, currentErrorCode);
 
         // Set to 0 (causes conditional jump error)
         memset(receivedMessageType, 0, 8);
+        receivedMessage = UNKNOWN_MESSAGE;
 
-        zrtpPoint->zrtpPointCallbacks->sendData(zrtpPoint->errorMessage->getErrorData(),
-                                                  ERROR_MESSAGE_LENGTH);
+        sendPacket(zrtpPoint->errorMessage->getErrorData(),
+                   ERROR_MESSAGE_LENGTH);
 
         setState(WaitForErrorAck);
 
@@ -756,3 +1108,370 @@ void StateMachine::sendErroMessage(zrtpErrorCode _errorCode){
     std::cout << std::endl << "## Current state: WAIT FOR ERROR ACK ##" << std::endl;
 }
 
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+
+bool StateMachine::CryptoAwaiter::await_ready(){
+
+    // Without pool there is nothing to wait for.
+    if (stateMachine->zrtpPoint->cryptoPool == nullptr){
+        task();
+        return true;
+    }
+
+    return false;
+}
+
+void StateMachine::CryptoAwaiter::await_suspend(std::coroutine_handle<HandshakeTask::promise_type> _handle){
+
+    _handle.promise().waitsForCrypto = true;
+    stateMachine->startCryptoJob(task);
+}
+
+zrtpErrorCode StateMachine::CryptoAwaiter::await_resume(){
+
+    stateMachine->pendingCryptoJob = 0;
+    return stateMachine->cryptoErrorCode;
+}
+
+void StateMachine::resumeHandshake(){
+
+    if (handshake.isDone()){
+        return;
+    }
+
+    // Events which handshake does not wait for are dropped without resuming it.
+    if (!handshake.getPromise().accepts(stateMachineEvent, receivedMessage)){
+        return;
+    }
+
+    handshake.resume(stateMachineEvent);
+}
+
+HandshakeTask StateMachine::runHandshake(){
+
+    ZrtpEvent* event;
+    bool helloAcknowledged = false;
+
+    // Data of received message are valid only until next co_await.
+    bool commitReceived = false;
+
+    helloReceived = false;
+    commitHandled = false;
+
+    // Discovery, our Hello is resent until peer acknowledges it and we have peers Hello.
+    zrtpPoint->createMessage(zrtpPoint->helloMessage);
+    zrtpPoint->prepareHelloMessage();
+
+    sendRetainedPacket(zrtpPoint->helloMessage->getHelloData(), zrtpPoint->helloMessage->getWholePacketLength());
+
+    if (!startTimer(&T1)){
+        sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+        co_return;
+    }
+    reportState(HelloSent, "HELLO SENT");
+
+    while (!helloReceived || !helloAcknowledged){
+
+        event = co_await recv<HELLO_MESSAGE, HELLO_ACK_MESSAGE, COMMIT_MESSAGE>();
+
+        if (event->eventType == TIME){
+            if (!nextTimer(&T1)){
+                sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+                co_return;
+            }
+            resendLastPacket();
+            continue;
+        }
+
+        MESSAGE_TYPE messageType = receivedMessage;
+
+        if (messageType == HELLO_MESSAGE){
+
+            // Peer resends Hello, because our HelloACK was lost.
+            if (helloReceived){
+                sendPacket(zrtpPoint->helloAckmessage->getHelloAckData(),
+                           HELLOACK_PACKET_SIZE);
+                continue;
+            }
+
+            zrtpPoint->createMessage(zrtpPoint->respondersHello);
+            if ((currentErrorCode = zrtpPoint->helloMessage->parseHelloMessage(zrtpPoint->respondersHello,
+                                    HelloView(event->messageData, event->messageDataLength))) != N_ERROR){
+                sendErroMessage(currentErrorCode);
+                co_return;
+            }
+
+            if ((currentErrorCode = zrtpPoint->respondersHello->checkProtocolVersion()) != 0){
+                sendErroMessage(currentErrorCode);
+                co_return;
+            }
+
+            int versionOrder = memcmp(zrtpPoint->respondersHello->getProtocolVersion(),
+                                      zrtpPoint->helloMessage->getProtocolVersion(), WORD_LENGTH);
+
+            // Peer with higher version will accept ours, we keep resending it.
+            if (versionOrder > 0){
+                continue;
+            }
+
+            // Peer has lower version, we offer next lower version we support.
+            if (versionOrder < 0){
+                zrtpPoint->findHighestVersion();
+                zrtpPoint->calculateMac(zrtpPoint->helloMessage->getHelloData(),
+                                        zrtpPoint->helloMessage->getMessageLength(), HELLO_MESSAGE);
+                sendRetainedPacket(zrtpPoint->helloMessage->getHelloData(),
+                                   zrtpPoint->helloMessage->getWholePacketLength());
+                continue;
+            }
+
+            zrtpPoint->setPeersHash(zrtpPoint->respondersHello->getHashImageH3(), zrtpPoint->handshakeState->peersH3);
+
+            helloReceived = true;
+            zrtpPoint->createMessage(zrtpPoint->helloAckmessage);
+            sendPacket(zrtpPoint->helloAckmessage->getHelloAckData(),
+                       HELLOACK_PACKET_SIZE);
+
+            if (!helloAcknowledged){
+                reportState(HelloAckSent, "HELLO ACK SENT");
+            }
+        }
+
+        if (messageType == HELLO_ACK_MESSAGE && !helloAcknowledged){
+
+            helloAcknowledged = true;
+
+            // Our Hello is not resent anymore, peer resends its Hello until we acknowledge it.
+            if (!helloReceived){
+                zrtpPoint->zrtpPointCallbacks->stopTimer();
+                reportState(HelloAckReceived, "HELLO ACK RECEIVED");
+            }
+        }
+
+        // Commit acknowledges our Hello too and peer becomes initiator.
+        if (messageType == COMMIT_MESSAGE){
+
+            if (!helloReceived){
+                sendErroMessage(HELLO_COMPONENTS_MISMATCH);
+                co_return;
+            }
+
+            helloAcknowledged = true;
+            commitReceived = true;
+            zrtpPoint->setRole(RESPONDER);
+        }
+    }
+
+    zrtpPoint->zrtpPointCallbacks->stopTimer();
+    commitHandled = true;
+
+    if (zrtpPoint->getCurrentRole() == INITIATOR){
+
+        zrtpPoint->createMessage(zrtpPoint->dhPart2Message);
+        zrtpPoint->prepareDhPart2Message();
+        zrtpPoint->calculateHvi(zrtpPoint->respondersHello);
+
+        zrtpPoint->createMessage(zrtpPoint->commitMessage);
+
+        if ((currentErrorCode = zrtpPoint->algorithmNegotiation()) != N_ERROR){
+            sendErroMessage(currentErrorCode);
+            co_return;
+        }
+
+        zrtpPoint->prepareCommitMessage();
+        sendRetainedPacket(zrtpPoint->commitMessage->getCommitData(), DH_COMMIT_PACKET_LENGTH);
+
+        if (!startTimer(&T2)){
+            sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+            co_return;
+        }
+        reportState(CommitSent, "COMMIT SENT");
+
+        while (true){
+
+            event = co_await recv<DHPART1_MESSAGE, COMMIT_MESSAGE, CONFIRM1_MESSAGE>();
+
+            if (event->eventType == TIME){
+                if (!nextTimer(&T2)){
+                    resetTimer();
+                    sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+                    co_return;
+                }
+                resendLastPacket();
+                continue;
+            }
+
+            MESSAGE_TYPE messageType = receivedMessage;
+
+            // We can not accept Confirm1 without DHPart1, we support DH mode only.
+            if (messageType == CONFIRM1_MESSAGE){
+                zrtpPoint->zrtpPointCallbacks->stopTimer();
+                sendErroMessage(DH_MODE_REQUIRED);
+                co_return;
+            }
+
+            // Both sides sent Commit, one with lower hvi stays initiator.
+            // Commit which is not in DH mode is dropped.
+            if (messageType == COMMIT_MESSAGE){
+                CommitView peersCommit(event->messageData, event->messageDataLength);
+                if (!peersCommit.isValid() || memcmp(zrtpPoint->commitMessage->getHvi(), peersCommit.getHvi(), HVI_LENGTH) < 0){
+                    continue;
+                }
+
+                zrtpPoint->zrtpPointCallbacks->stopTimer();
+                resetTimer();
+                zrtpPoint->releaseLastSentPacket();
+                zrtpPoint->setRole(RESPONDER);
+                commitReceived = true;
+                break;
+            }
+
+            zrtpPoint->zrtpPointCallbacks->stopTimer();
+            break;
+        }
+    }
+
+    if (zrtpPoint->getCurrentRole() == INITIATOR){
+
+        if ((currentErrorCode = acceptDhPart1()) != N_ERROR){
+            sendErroMessage(currentErrorCode);
+            co_return;
+        }
+
+        reportState(CommitSentComputing, "COMMIT SENT - COMPUTING");
+        if ((currentErrorCode = co_await crypto(sharedSecretTask(zrtpPoint->dhPart1Message))) != N_ERROR){
+            sendErroMessage(currentErrorCode);
+            co_return;
+        }
+
+        sendRetainedPacket(zrtpPoint->dhPart2Message->getDHData(), zrtpPoint->dhPart2Message->getWholePacketLength());
+
+        if (!startDeferredTimer(&T2, PEER_COMPUTATION_DEFERRAL)){
+            sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+            co_return;
+        }
+        reportState(WaitForConfirm1, "WAIT FOR CONFIRM 1");
+
+        while ((event = co_await recv<CONFIRM1_MESSAGE>())->eventType == TIME){
+            if (!nextTimer(&T2)){
+                resetTimer();
+                sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+                co_return;
+            }
+            resendLastPacket();
+        }
+
+        zrtpPoint->zrtpPointCallbacks->stopTimer();
+        resetTimer();
+
+        zrtpPoint->createMessage(zrtpPoint->confirmMessage1);
+        if ((currentErrorCode = acceptConfirm(zrtpPoint->confirmMessage1, zrtpPoint->dhPart1Message,
+                                              DHPART1_MESSAGE)) != N_ERROR){
+            sendErroMessage(currentErrorCode);
+            co_return;
+        }
+
+        zrtpPoint->createMessage(zrtpPoint->confirmMessage2);
+        zrtpPoint->prepareConfirm2Message();
+        sendRetainedPacket(zrtpPoint->confirmMessage2->getConfirmData(), CONFIRM_PACKET_LENGTH);
+
+        if (!startTimer(&T2)){
+            sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+            co_return;
+        }
+        reportState(WaitForConfAck, "WAIT FOR CONFACK");
+
+        while ((event = co_await recv<CONF_ACK_MESSAGE>())->eventType == TIME){
+            if (!nextTimer(&T2)){
+                resetTimer();
+                sendErroMessage(PROTOCOL_TIMEOUT_ERROR);
+                co_return;
+            }
+            resendLastPacket();
+        }
+
+        zrtpPoint->zrtpPointCallbacks->stopTimer();
+        resetTimer();
+
+        reportState(SecuredState, "SECURED STATE");
+        zrtpPoint->writeOutKeys();
+        co_return;
+    }
+
+    // Responder, DHPart1 is prepared before Commit comes.
+    zrtpPoint->createMessage(zrtpPoint->dhPart1Message);
+    zrtpPoint->prepareDhPart1Message();
+
+    if (!commitReceived){
+        reportState(WaitForCommit, "WAIT FOR COMMIT");
+
+        // Responder has no timer running, only Commit can resume us. Resent Hello means our HelloACK was lost.
+        while ((event = co_await recv<COMMIT_MESSAGE, HELLO_MESSAGE>())->eventType != MESSAGE ||
+               receivedMessage == HELLO_MESSAGE){
+
+            if (event->eventType == MESSAGE){
+                sendPacket(zrtpPoint->helloAckmessage->getHelloAckData(), HELLOACK_PACKET_SIZE);
+            }
+        }
+    }
+
+    if ((currentErrorCode = acceptCommit()) != N_ERROR){
+        sendErroMessage(currentErrorCode);
+        co_return;
+    }
+
+    sendPacket(zrtpPoint->dhPart1Message->getDHData(),
+               zrtpPoint->dhPart1Message->getWholePacketLength());
+    reportState(WaitForDH2, "WAIT FOR DHPART 2");
+
+    // Resent Commit means our DHPart1 was lost.
+    while ((event = co_await recv<DHPART2_MESSAGE, COMMIT_MESSAGE>())->eventType != MESSAGE ||
+           receivedMessage == COMMIT_MESSAGE){
+
+        if (event->eventType == MESSAGE){
+            sendPacket(zrtpPoint->dhPart1Message->getDHData(),
+                       zrtpPoint->dhPart1Message->getWholePacketLength());
+        }
+    }
+
+    if ((currentErrorCode = acceptDhPart2()) != N_ERROR){
+        sendErroMessage(currentErrorCode);
+        co_return;
+    }
+
+    reportState(WaitForDH2Computing, "WAIT FOR DHPART 2 - COMPUTING");
+    if ((currentErrorCode = co_await crypto(sharedSecretTask(zrtpPoint->dhPart2Message))) != N_ERROR){
+        sendErroMessage(currentErrorCode);
+        co_return;
+    }
+
+    zrtpPoint->createMessage(zrtpPoint->confirmMessage1);
+    zrtpPoint->prepareConfirm1Message();
+    sendPacket(zrtpPoint->confirmMessage1->getConfirmData(), CONFIRM_PACKET_LENGTH);
+    reportState(WaitForConfirm2, "WAIT FOR CONFIRM 2");
+
+    // Resent DHPart2 means our Confirm1 was lost.
+    while ((event = co_await recv<CONFIRM2_MESSAGE, DHPART2_MESSAGE>())->eventType != MESSAGE ||
+           receivedMessage == DHPART2_MESSAGE){
+
+        if (event->eventType == MESSAGE){
+            sendPacket(zrtpPoint->confirmMessage1->getConfirmData(), CONFIRM_PACKET_LENGTH);
+        }
+    }
+
+    zrtpPoint->createMessage(zrtpPoint->confirmMessage2);
+    if ((currentErrorCode = acceptConfirm(zrtpPoint->confirmMessage2, zrtpPoint->dhPart2Message,
+                                          DHPART2_MESSAGE)) != N_ERROR){
+        sendErroMessage(currentErrorCode);
+        co_return;
+    }
+
+    zrtpPoint->createMessage(zrtpPoint->conf2AckMessage);
+    sendPacket(zrtpPoint->conf2AckMessage->getConf2AckData(), CONF2ACK_PAKET_SIZE);
+
+    // Finished handshake releases its frame, Confirm2 resent after this is answered by handleSecuredState.
+    reportState(SecuredState, "SECURED STATE");
+    zrtpPoint->writeOutKeys();
+}
+
+#endif // ZRTP_COROUTINE_HANDSHAKE
@@ -1,29 +1,18 @@
 #ifndef STATEMACHINE_H
 #define STATEMACHINE_H
 
+// Time in milisecond which peer needs to compute DH result and Confirm1 message.
+// First retransmission of DHPart2 is deferred by this time, so we do not resend it while peer computes.
 #if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(__WINDOWS__) || defined(__TOS_WIN__)
-
-  #include <windows.h>
-
-  inline void delay( unsigned long ms )
-    {
-    Sleep( ms );
-    }
-
+  #define PEER_COMPUTATION_DEFERRAL 570
 #else  /* presume POSIX */
-
-  #include <unistd.h>
-
-  inline void delay( unsigned long ms )
-    {
-    usleep( ms * 1000 );
-    }
-
+  #define PEER_COMPUTATION_DEFERRAL 70
 #endif
 
 #include "zrtppoint.h"
 #include "events.h"
-#include <map>
+#include "cryptopool.h"
+#include "handshakecoroutine.h"
 #include <ctime>
 
 class StateMachine;
@@ -37,8 +26,10 @@ typedef enum _ZrtpStates{
     HelloAckReceived,
     WaitForHelloAck,
     CommitSent,
+    CommitSentComputing,   // DHPart1 accepted, DH result is computed by crypto job.
     WaitForCommit,
     WaitForDH2,
+    WaitForDH2Computing,   // DHPart2 accepted, DH result is computed by crypto job.
     WaitForConfirm1,
     WaitForConfirm2,
     WaitForConfAck,
@@ -46,6 +37,8 @@ typedef enum _ZrtpStates{
     SecuredState
 } ZrtpStates;
 
+#define ZRTP_STATES_COUNT (SecuredState + 1)
+
 // Struct that represent Zrtp Timers
 typedef struct _ZrtpTimer{
      uint16_t startTime;
@@ -56,7 +49,6 @@ typedef struct _ZrtpTimer{
 } ZrtpTimer;
 
 typedef void (StateMachine::* handler)(void);
-typedef std::map<ZrtpStates, handler> stateMap;
 
 class StateMachine{
 
@@ -65,21 +57,117 @@ private:
     ZrtpPoint* zrtpPoint;
     ZrtpEvent* stateMachineEvent;
     ZrtpStates currentState;
-    stateMap currentStateMap;
 
     ZrtpTimer T1;
     ZrtpTimer T2;
 
+    // Packets resent by T1 or T2 since negotiation started.
+    uint16_t retransmissionsCount;
+
     zrtpErrorCode currentErrorCode;
     uint8_t receivedMessageType[8];
 
-    // Store resending packet
-    uint8_t lastSentMessageData[500];
-    uint16_t lastSentMessageLength;
+    // Type of received message classified once per packet, UNKNOWN_MESSAGE for other events.
+    MESSAGE_TYPE receivedMessage;
 
     bool helloReceived;
     bool commitHandled;
 
+    // Crypto job which result we wait for, 0 if no job is pending.
+    unsigned int pendingCryptoJob;
+    unsigned int lastCryptoJob;
+    zrtpErrorCode cryptoErrorCode;
+
+    // Handshake is driven by coroutine instead of handler map.
+    bool coroutineHandshake;
+
+    /**
+     * @brief dispatchEvent handle current event, it is called with critical section entered.
+     */
+    void dispatchEvent();
+
+    /**
+     * @brief acceptCommit parse received Commit, verify peers Hello with H2 and hash chain.
+     * @return error code, N_ERROR if Commit is accepted.
+     */
+    zrtpErrorCode acceptCommit();
+
+    /**
+     * @brief acceptDhPart1 parse received DHPart1, verify responders Hello with H2 and hash chain.
+     * @return error code, N_ERROR if DHPart1 is accepted.
+     */
+    zrtpErrorCode acceptDhPart1();
+
+    /**
+     * @brief acceptDhPart2 parse received DHPart2, verify Hvi, Commit MAC and hash chain.
+     * @return error code, N_ERROR if DHPart2 is accepted.
+     */
+    zrtpErrorCode acceptDhPart2();
+
+    /**
+     * @brief acceptConfirm parse and decrypt received Confirm, verify peers DHPart with H0 and nonce reuse.
+     * @param _confirmMessage message to fill.
+     * @param _peersDhPart DHPart message received from peer.
+     * @param _dhPartType DHPART1_MESSAGE or DHPART2_MESSAGE.
+     * @return error code, N_ERROR if Confirm is accepted.
+     */
+    zrtpErrorCode acceptConfirm(ConfirmMessage* _confirmMessage, DHPart* _peersDhPart, MESSAGE_TYPE _dhPartType);
+
+    /**
+     * @brief sharedSecretTask crypto task, which computes DH result and all keys.
+     * @param _peersDhPart DHPart message with peers public value.
+     * @return task for startCryptoJob().
+     */
+    CryptoPool::cryptoTask sharedSecretTask(DHPart* _peersDhPart);
+
+    /**
+     * @brief reportState set state and write it out.
+     * @param _state to set.
+     * @param _stateName name of state to write out.
+     */
+    void reportState(ZrtpStates _state, const char* _stateName);
+
+#ifdef ZRTP_COROUTINE_HANDSHAKE
+
+    HandshakeTask handshake;
+
+    /**
+     * @brief CryptoAwaiter suspend handshake until crypto job is computed. Without crypto pool
+     *        task is computed immediately and handshake continues without suspension.
+     */
+    struct CryptoAwaiter{
+
+        StateMachine* stateMachine;
+        CryptoPool::cryptoTask task;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<HandshakeTask::promise_type> _handle);
+        zrtpErrorCode await_resume();
+    };
+
+    /**
+     * @brief crypto suspend handshake until task is computed in crypto pool.
+     *        Usage: if ((currentErrorCode = co_await crypto(task)) != N_ERROR) ...
+     * @param _task heavy computation, it must not touch state machine.
+     * @return awaiter which returns error code of computation.
+     */
+    CryptoAwaiter crypto(CryptoPool::cryptoTask _task) {return {this, _task};}
+
+    /**
+     * @brief runHandshake whole key negotiation written as linear sequence, it is started by START event.
+     *        Coroutine runs in context which handles events of this ZRTP point: thread in critical section
+     *        or SessionScheduler worker.
+     * @return handshake coroutine.
+     */
+    HandshakeTask runHandshake();
+
+    /**
+     * @brief resumeHandshake resume coroutine, if it waits for current event.
+     */
+    void resumeHandshake();
+
+#endif // ZRTP_COROUTINE_HANDSHAKE
+
 public:
 
     /**
@@ -105,6 +193,20 @@ public:
      */
     void processEvent(ZrtpEvent* _event);
 
+    /**
+     * @brief setCoroutineHandshake select coroutine driven handshake instead of handler map.
+     *        Set it before START event.
+     * @param _enabled true for coroutine handshake.
+     * @return false if coroutines are not supported by compiler, handler map is used then.
+     */
+    bool setCoroutineHandshake(bool _enabled);
+
+    /**
+     * @brief reset return state machine to initial state with initial timers, so it can run new negotiation.
+     *        Pending crypto job is forgotten, its result is dropped.
+     */
+    void reset();
+
     /**
      * @brief handleInitialState
      */
@@ -130,6 +232,11 @@ public:
      */
     void handleCommitSentState();
 
+    /**
+     * @brief handleCommitSentComputingState
+     */
+    void handleCommitSentComputingState();
+
     /**
      * @brief handleWaitForCommitState
      */
@@ -140,6 +247,11 @@ public:
      */
     void handleWaitForDH2state();
 
+    /**
+     * @brief handleWaitForDH2ComputingState
+     */
+    void handleWaitForDH2ComputingState();
+
     /**
      * @brief handleWaitForConfirm1State
      */
@@ -161,7 +273,7 @@ public:
     void handleWaitForErrorAckState();
 
     /**
-     * @brief handleSecuredState
+     * @brief handleSecuredState resend Conf2ACK when responder receives resent Confirm2.
      */
     void handleSecuredState();
 
@@ -189,6 +301,12 @@ public:
      */
     uint32_t getErrorCode(){return currentErrorCode;}
 
+    /**
+     * @brief getRetransmissionsCount getter for count of packets resent after timeout of T1 or T2.
+     * @return retransmissions since negotiation started.
+     */
+    uint16_t getRetransmissionsCount(){return retransmissionsCount;}
+
     /**
      * @brief setReceivedMessageType setter for received message.
      * @param _messageType to set.
@@ -208,6 +326,19 @@ public:
      */
     void sendErroMessage(zrtpErrorCode _errorCode);
 
+    /**
+     * @brief startCryptoJob compute task in crypto pool, result comes back as CRYPTO event
+     *        to current state. If ZRTP point has no crypto pool, task is computed immediately
+     *        and CRYPTO event is handled before this function returns.
+     * @param _task heavy computation, it must not touch state machine.
+     */
+    void startCryptoJob(CryptoPool::cryptoTask _task);
+
+    /**
+     * @brief cancelCryptoJob cancel pending crypto job, its result will be dropped.
+     */
+    void cancelCryptoJob();
+
     /**
      * @brief startTimer start given timer.
      * @param _timer to be start.
@@ -215,6 +346,15 @@ public:
      */
     bool startTimer(ZrtpTimer* _timer);
 
+    /**
+     * @brief startDeferredTimer start given timer, first timeout is prolonged by deferral.
+     *        Engine does not block while waiting, timeout is handled as usual TIME event.
+     * @param _timer to be start.
+     * @param _deferral time in milisecond added to first timeout.
+     * @return true if timer started, false otherwise.
+     */
+    bool startDeferredTimer(ZrtpTimer* _timer, uint16_t _deferral);
+
     /**
      * @brief nextTimer start next timer value.
      * @param _timer to be start.
@@ -228,12 +368,38 @@ public:
     void resetTimer();
 
     /**
-     * @brief setLastSentPacket setter for last message data, also set length.
-     * @param _data of last sent message.
-     * @param _lengt of last sent message.
+     * @brief stampPacketHead write SSRC of session to head of packet, messages are built with random one.
+     * @param _data of message.
+     */
+    void stampPacketHead(uint8_t* _data);
+
+    /**
+     * @brief sendPacket send packet which is not resent, all packets of session leave through this function
+     *        or sendRetainedPacket().
+     * @param _data of message.
+     * @param _length of message.
+     */
+    void sendPacket(uint8_t* _data, uint16_t _length);
+
+    /**
+     * @brief sendRetainedPacket send packet and keep it as last packet for retransmission. Packet is written once
+     *        to buffer leased from transport, or data of message is referred when transport does not lease buffers.
+     * @param _data of message, it is not changed until other packet is retained.
+     * @param _length of message.
+     */
+    void sendRetainedPacket(uint8_t* _data, uint16_t _length);
+
+    /**
+     * @brief setLastSentPacket keep packet for retransmission without sending it.
+     * @param _data of message, it is not changed until other packet is retained.
+     * @param _length of message.
+     */
+    void setLastSentPacket(uint8_t* _data, uint16_t _length);
+
+    /**
+     * @brief resendLastPacket send last retained packet again.
      */
-    void setLastSentPacket(uint8_t* _data, uint16_t _length) {memcpy(lastSentMessageData, _data, _length);
-                                                                     lastSentMessageLength = _length;}
+    void resendLastPacket();
 };
 
 #endif // STATEMACHINE_H
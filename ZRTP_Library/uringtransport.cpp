@@ -0,0 +1,744 @@
+#include "uringtransport.h"
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+
+// Waits for cancelled operations on close, every wait is at most 10 ms.
+#define URING_CLOSE_ROUNDS 50
+#define URING_CLOSE_WAIT_NANOSECONDS 10000000
+
+static_assert(MAXIMUM_PACKET_LENGTH <= URING_SEND_SLOT_LENGTH, "ZRTP packet must fit to send slot");
+static_assert((URING_RECEIVE_BUFFERS & (URING_RECEIVE_BUFFERS - 1)) == 0, "Buffer ring size must be power of 2");
+static_assert(URING_SEND_SLOTS <= 0x10000, "Slot index is kept in 16 bits of user data");
+
+static inline uint64_t operationData(uint64_t _kind, uint64_t _value){
+
+    return (_kind << 56) | _value;
+}
+
+UringTransport::UringTransport(){
+
+    ringDescriptor = -1;
+    socketDescriptor = -1;
+    wakeDescriptor = -1;
+    wakeValue = 0;
+    stopping = false;
+    closing = false;
+    failed = false;
+
+    submissionRing = nullptr;
+    completionRing = nullptr;
+    submissionEntries = nullptr;
+    submissionRingLength = 0;
+    completionRingLength = 0;
+    submissionEntriesLength = 0;
+    pendingOperations = 0;
+    unsubmitted = 0;
+
+    receiveArmed = false;
+    receiveRingTail = 0;
+    receiveRingLength = URING_RECEIVE_BUFFERS * sizeof(io_uring_buf);
+    receiveRing = (io_uring_buf*) mmap(nullptr, receiveRingLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (receiveRing == MAP_FAILED){
+        receiveRing = nullptr;
+    }
+    receiveBuffers = new uint8_t[URING_RECEIVE_BUFFERS * URING_RECEIVE_BUFFER_LENGTH];
+
+    // Kernel writes address of sender behind io_uring_recvmsg_out and payload behind the address.
+    memset(&receiveHeader, 0, sizeof(receiveHeader));
+    receiveHeader.msg_namelen = sizeof(sockaddr_in);
+
+    // Send buffer is page aligned, kernel pins its pages once when it is registered.
+    sendArena = (uint8_t*) mmap(nullptr, URING_SEND_SLOTS * URING_SEND_SLOT_LENGTH, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (sendArena == MAP_FAILED){
+        sendArena = nullptr;
+    }
+
+    for (int i = URING_SEND_SLOTS - 1; i >= 0; i--){
+        sendSlots[i].length = 0;
+        sendSlots[i].inFlight = 0;
+        sendSlots[i].leased = false;
+        freeSendSlots.push_back(i);
+    }
+
+    zeroCopySends = false;
+    timeoutGeneration = 0;
+    timeoutArmed = false;
+}
+
+UringTransport::~UringTransport(){
+
+    close();
+
+    // Points release their leased slots, so they are deleted before send buffer.
+    removeAllSessions();
+
+    if (receiveRing != nullptr){
+        munmap(receiveRing, receiveRingLength);
+    }
+
+    if (sendArena != nullptr){
+        munmap(sendArena, URING_SEND_SLOTS * URING_SEND_SLOT_LENGTH);
+    }
+
+    delete[] receiveBuffers;
+}
+
+bool UringTransport::setupRing(){
+
+    io_uring_params parameters;
+    memset(&parameters, 0, sizeof(parameters));
+    parameters.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    parameters.cq_entries = URING_COMPLETION_ENTRIES;
+
+    int descriptor = syscall(__NR_io_uring_setup, URING_SUBMISSION_ENTRIES, &parameters);
+
+    // Cooperative task running is not known to kernels older than 5.19.
+    if (descriptor < 0 && errno == EINVAL){
+        memset(&parameters, 0, sizeof(parameters));
+        parameters.flags = IORING_SETUP_CQSIZE;
+        parameters.cq_entries = URING_COMPLETION_ENTRIES;
+        descriptor = syscall(__NR_io_uring_setup, URING_SUBMISSION_ENTRIES, &parameters);
+    }
+
+    if (descriptor < 0){
+        return false;
+    }
+
+    submissionRingLength = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned int);
+    completionRingLength = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+
+    bool singleMapping = parameters.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMapping){
+        submissionRingLength = std::max(submissionRingLength, completionRingLength);
+        completionRingLength = submissionRingLength;
+    }
+
+    // Ring descriptor is kept only when all queues are mapped, close() uses queues of every open ring.
+    // Mappings made before failure are unmapped by close().
+    void* mapping = mmap(nullptr, submissionRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+    if (mapping == MAP_FAILED){
+        ::close(descriptor);
+        return false;
+    }
+    submissionRing = (uint8_t*) mapping;
+
+    if (singleMapping){
+        completionRing = submissionRing;
+    }   else {
+            mapping = mmap(nullptr, completionRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+            if (mapping == MAP_FAILED){
+                ::close(descriptor);
+                return false;
+            }
+            completionRing = (uint8_t*) mapping;
+        }
+
+    submissionEntriesLength = parameters.sq_entries * sizeof(io_uring_sqe);
+    mapping = mmap(nullptr, submissionEntriesLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES);
+    if (mapping == MAP_FAILED){
+        ::close(descriptor);
+        return false;
+    }
+    submissionEntries = (io_uring_sqe*) mapping;
+
+    ringDescriptor = descriptor;
+
+    submissionHead = (unsigned int*) (submissionRing + parameters.sq_off.head);
+    submissionTail = (unsigned int*) (submissionRing + parameters.sq_off.tail);
+    submissionArray = (unsigned int*) (submissionRing + parameters.sq_off.array);
+    submissionMask = *(unsigned int*) (submissionRing + parameters.sq_off.ring_mask);
+    submissionEntriesCount = parameters.sq_entries;
+    submissionLocalTail = *submissionTail;
+
+    completionHead = (unsigned int*) (completionRing + parameters.cq_off.head);
+    completionTail = (unsigned int*) (completionRing + parameters.cq_off.tail);
+    completionMask = *(unsigned int*) (completionRing + parameters.cq_off.ring_mask);
+    completions = (io_uring_cqe*) (completionRing + parameters.cq_off.cqes);
+
+    // Entries are used in ring order, so index array maps every slot to itself once.
+    for (unsigned int i = 0; i < submissionEntriesCount; i++){
+        submissionArray[i] = i;
+    }
+
+    return true;
+}
+
+bool UringTransport::open(const sockaddr_in &_localAddress, bool _reusePort){
+
+    if (ringDescriptor >= 0 || receiveRing == nullptr || sendArena == nullptr){
+        return false;
+    }
+
+    // Ring waits for blocking socket by poll, non-blocking socket would fail sends with EAGAIN.
+    socketDescriptor = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (socketDescriptor < 0){
+        return false;
+    }
+
+    int reusePort = 1;
+    if (_reusePort && setsockopt(socketDescriptor, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort)) != 0){
+        close();
+        return false;
+    }
+
+    if (bind(socketDescriptor, (const sockaddr*) &_localAddress, sizeof(_localAddress)) != 0){
+        close();
+        return false;
+    }
+
+    wakeDescriptor = eventfd(0, EFD_CLOEXEC);
+    if (wakeDescriptor < 0 || !setupRing()){
+        close();
+        return false;
+    }
+
+    // Without registered buffer slots are sent by plain send, which copies them.
+    iovec arena;
+    arena.iov_base = sendArena;
+    arena.iov_len = URING_SEND_SLOTS * URING_SEND_SLOT_LENGTH;
+    zeroCopySends = syscall(__NR_io_uring_register, ringDescriptor, IORING_REGISTER_BUFFERS, &arena, 1) == 0;
+
+    memset(receiveRing, 0, receiveRingLength);
+    receiveRingTail = 0;
+
+    io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = (uint64_t) receiveRing;
+    registration.ring_entries = URING_RECEIVE_BUFFERS;
+    registration.bgid = 0;
+
+    if (syscall(__NR_io_uring_register, ringDescriptor, IORING_REGISTER_PBUF_RING, &registration, 1) != 0){
+        close();
+        return false;
+    }
+
+    for (uint16_t i = 0; i < URING_RECEIVE_BUFFERS; i++){
+        provideReceiveBuffer(i);
+    }
+
+    stopping = false;
+    failed = false;
+
+    armReceive();
+    armWake();
+
+    if (!submit(0)){
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void UringTransport::close(){
+
+    if (ringDescriptor >= 0){
+        closing = true;
+
+        // Cancelled receive, wake and timeout post their last completions, sends finish on their own.
+        io_uring_sqe* entry = getSubmissionEntry(operationData(CANCEL_OPERATION, 0));
+        if (entry != nullptr){
+            entry->opcode = IORING_OP_ASYNC_CANCEL;
+            entry->fd = -1;
+            entry->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        }
+
+        __kernel_timespec wait;
+        wait.tv_sec = 0;
+        wait.tv_nsec = URING_CLOSE_WAIT_NANOSECONDS;
+
+        for (int round = 0; round < URING_CLOSE_ROUNDS && pendingOperations > 0; round++){
+            if (!submit(1, &wait)){
+                break;
+            }
+            reapCompletions();
+        }
+
+        ::close(ringDescriptor);
+        ringDescriptor = -1;
+    }
+
+    if (submissionEntries != nullptr){
+        munmap(submissionEntries, submissionEntriesLength);
+        submissionEntries = nullptr;
+    }
+
+    if (completionRing != nullptr && completionRing != submissionRing){
+        munmap(completionRing, completionRingLength);
+    }
+    completionRing = nullptr;
+
+    if (submissionRing != nullptr){
+        munmap(submissionRing, submissionRingLength);
+        submissionRing = nullptr;
+    }
+
+    if (socketDescriptor >= 0){
+        ::close(socketDescriptor);
+        socketDescriptor = -1;
+    }
+
+    if (wakeDescriptor >= 0){
+        ::close(wakeDescriptor);
+        wakeDescriptor = -1;
+    }
+
+    // Sends which did not complete are gone with ring, their slots are free unless point holds them.
+    freeSendSlots.clear();
+    for (int i = URING_SEND_SLOTS - 1; i >= 0; i--){
+        sendSlots[i].inFlight = 0;
+        if (!sendSlots[i].leased){
+            freeSendSlots.push_back(i);
+        }
+    }
+
+    pendingOperations = 0;
+    unsubmitted = 0;
+    receiveArmed = false;
+    timeoutArmed = false;
+    closing = false;
+}
+
+sockaddr_in UringTransport::getLocalAddress(){
+
+    sockaddr_in localAddress;
+    socklen_t addressLength = sizeof(localAddress);
+
+    memset(&localAddress, 0, sizeof(localAddress));
+    getsockname(socketDescriptor, (sockaddr*) &localAddress, &addressLength);
+
+    return localAddress;
+}
+
+io_uring_sqe* UringTransport::getSubmissionEntry(uint64_t _userData){
+
+    if (ringDescriptor < 0){
+        return nullptr;
+    }
+
+    if (submissionLocalTail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE) >= submissionEntriesCount){
+        if (!submit(0) || submissionLocalTail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE) >= submissionEntriesCount){
+            return nullptr;
+        }
+    }
+
+    io_uring_sqe* entry = &submissionEntries[submissionLocalTail & submissionMask];
+    memset(entry, 0, sizeof(io_uring_sqe));
+    entry->user_data = _userData;
+
+    submissionLocalTail++;
+    unsubmitted++;
+    pendingOperations++;
+
+    return entry;
+}
+
+bool UringTransport::submit(unsigned int _waitFor, const __kernel_timespec *_timeout){
+
+    if (ringDescriptor < 0 || failed){
+        return false;
+    }
+
+    __atomic_store_n(submissionTail, submissionLocalTail, __ATOMIC_RELEASE);
+
+    // Completions of cooperative ring are posted when it is entered, so it is entered even without wait.
+    unsigned int flags = IORING_ENTER_GETEVENTS;
+    void* argument = nullptr;
+    size_t argumentLength = 0;
+
+    io_uring_getevents_arg eventsArgument;
+    if (_timeout != nullptr){
+        memset(&eventsArgument, 0, sizeof(eventsArgument));
+        eventsArgument.sigmask_sz = _NSIG / 8;
+        eventsArgument.ts = (uint64_t) _timeout;
+
+        flags |= IORING_ENTER_EXT_ARG;
+        argument = &eventsArgument;
+        argumentLength = sizeof(eventsArgument);
+    }
+
+    int result = syscall(__NR_io_uring_enter, ringDescriptor, unsubmitted, _waitFor, flags, argument, argumentLength);
+    statistics.systemCalls++;
+
+    if (result >= 0){
+        unsubmitted -= result;
+        return true;
+    }
+
+    // Interrupted or expired wait and full completion queue are handled by reaping completions.
+    if (errno == EINTR || errno == ETIME || errno == EAGAIN || errno == EBUSY){
+        return true;
+    }
+
+    failed = true;
+    return false;
+}
+
+void UringTransport::reapCompletions(){
+
+    if (ringDescriptor < 0){
+        return;
+    }
+
+    unsigned int head = *completionHead;
+
+    for (unsigned int handled = 0; handled < URING_COMPLETION_BATCH; handled++){
+        if (head == __atomic_load_n(completionTail, __ATOMIC_ACQUIRE)){
+            return;
+        }
+
+        // Entry is copied and released before it is handled, handling can submit and post new entries.
+        io_uring_cqe completion = completions[head & completionMask];
+        head++;
+        __atomic_store_n(completionHead, head, __ATOMIC_RELEASE);
+
+        handleCompletion(completion);
+    }
+}
+
+void UringTransport::handleCompletion(const io_uring_cqe &_completion){
+
+    switch (_completion.user_data >> 56){
+
+    case RECEIVE_OPERATION:
+        handleReceive(_completion);
+        break;
+
+    case SEND_OPERATION:
+        handleSend(_completion);
+        break;
+
+    case TIMEOUT_OPERATION:
+        pendingOperations--;
+        if ((uint32_t) _completion.user_data == timeoutGeneration){
+            timeoutArmed = false;
+        }
+        break;
+
+    case WAKE_OPERATION:
+        pendingOperations--;
+        if (!closing && !stopping){
+            armWake();
+        }
+        break;
+
+    default:
+        pendingOperations--;
+        break;
+    }
+}
+
+void UringTransport::handleReceive(const io_uring_cqe &_completion){
+
+    // Multishot receive ends on error or when kernel has no buffer, it is armed again.
+    if (!(_completion.flags & IORING_CQE_F_MORE)){
+        pendingOperations--;
+        receiveArmed = false;
+    }
+
+    if (_completion.res < 0 && _completion.res != -ENOBUFS && _completion.res != -ECANCELED){
+        failed = true;
+    }
+
+    if (_completion.flags & IORING_CQE_F_BUFFER){
+        uint16_t bufferIndex = _completion.flags >> IORING_CQE_BUFFER_SHIFT;
+        uint8_t* buffer = receiveBuffers + bufferIndex * URING_RECEIVE_BUFFER_LENGTH;
+
+        if (_completion.res >= 0 && !closing){
+            io_uring_recvmsg_out* header = (io_uring_recvmsg_out*) buffer;
+
+            sockaddr_in remote;
+            memcpy(&remote, buffer + sizeof(io_uring_recvmsg_out), sizeof(remote));
+
+            // Datagram longer than any ZRTP packet is junk.
+            if ((header->flags & MSG_TRUNC) || header->namelen != sizeof(sockaddr_in)){
+                statistics.datagramsReceived++;
+                statistics.datagramsDropped++;
+            }   else {
+                    deliver(remote, buffer + sizeof(io_uring_recvmsg_out) + receiveHeader.msg_namelen + receiveHeader.msg_controllen,
+                            header->payloadlen);
+                }
+        }
+
+        provideReceiveBuffer(bufferIndex);
+    }
+
+    if (!receiveArmed && !closing && !failed){
+        armReceive();
+    }
+}
+
+void UringTransport::handleSend(const io_uring_cqe &_completion){
+
+    uint16_t slot = _completion.user_data & 0xffff;
+
+    // Zero copy send posts result and then notification that kernel does not read slot any more.
+    if (!(_completion.flags & IORING_CQE_F_NOTIF)){
+        if (_completion.res >= 0){
+            statistics.datagramsSent++;
+        }   else if ((_completion.res == -EINVAL || _completion.res == -EOPNOTSUPP) && zeroCopySends && !closing){
+                // Socket refuses zero copy, slot is sent again by plain send and so are all later packets.
+                zeroCopySends = false;
+                if (!submitSend(slot)){
+                    statistics.sendsFailed++;
+                }
+            }   else {
+                    // Datagram which could not be sent is dropped, retransmission timer of point sends it again.
+                    statistics.sendsFailed++;
+                }
+    }
+
+    if (!(_completion.flags & IORING_CQE_F_MORE)){
+        pendingOperations--;
+        sendSlots[slot].inFlight--;
+
+        if (sendSlots[slot].inFlight == 0 && !sendSlots[slot].leased){
+            freeSendSlots.push_back(slot);
+        }
+    }
+}
+
+void UringTransport::armReceive(){
+
+    io_uring_sqe* entry = getSubmissionEntry(operationData(RECEIVE_OPERATION, 0));
+    if (entry == nullptr){
+        failed = true;
+        return;
+    }
+
+    entry->opcode = IORING_OP_RECVMSG;
+    entry->fd = socketDescriptor;
+    entry->addr = (uint64_t) &receiveHeader;
+    entry->flags = IOSQE_BUFFER_SELECT;
+    entry->buf_group = 0;
+    entry->ioprio = IORING_RECV_MULTISHOT;
+
+    receiveArmed = true;
+    statistics.receiveCalls++;
+}
+
+void UringTransport::armWake(){
+
+    io_uring_sqe* entry = getSubmissionEntry(operationData(WAKE_OPERATION, 0));
+    if (entry == nullptr){
+        failed = true;
+        return;
+    }
+
+    entry->opcode = IORING_OP_READ;
+    entry->fd = wakeDescriptor;
+    entry->addr = (uint64_t) &wakeValue;
+    entry->len = sizeof(wakeValue);
+}
+
+void UringTransport::armTimeout(transportClock::time_point _deadline){
+
+    // Steady clock is monotonic clock of kernel, so deadline is passed as absolute time.
+    transportClock::duration sinceEpoch = _deadline.time_since_epoch();
+    std::chrono::seconds seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+
+    timeoutSpecification.tv_sec = seconds.count();
+    timeoutSpecification.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch - seconds).count();
+
+    io_uring_sqe* entry;
+
+    // Armed timeout is moved to earlier deadline, so only one timeout is on ring.
+    if (timeoutArmed){
+        entry = getSubmissionEntry(operationData(CANCEL_OPERATION, 0));
+        if (entry == nullptr){
+            return;
+        }
+
+        entry->opcode = IORING_OP_TIMEOUT_REMOVE;
+        entry->fd = -1;
+        entry->addr = operationData(TIMEOUT_OPERATION, timeoutGeneration);
+        entry->addr2 = (uint64_t) &timeoutSpecification;
+        entry->timeout_flags = IORING_TIMEOUT_UPDATE | IORING_TIMEOUT_ABS;
+    }   else {
+            entry = getSubmissionEntry(operationData(TIMEOUT_OPERATION, timeoutGeneration + 1));
+            if (entry == nullptr){
+                return;
+            }
+
+            timeoutGeneration++;
+            timeoutArmed = true;
+
+            entry->opcode = IORING_OP_TIMEOUT;
+            entry->fd = -1;
+            entry->addr = (uint64_t) &timeoutSpecification;
+            entry->len = 1;
+            entry->timeout_flags = IORING_TIMEOUT_ABS;
+        }
+
+    armedDeadline = _deadline;
+}
+
+bool UringTransport::submitSend(uint16_t _slot){
+
+    io_uring_sqe* entry = getSubmissionEntry(operationData(SEND_OPERATION, _slot));
+    if (entry == nullptr){
+        return false;
+    }
+
+    SendSlot& slot = sendSlots[_slot];
+
+    entry->fd = socketDescriptor;
+    entry->addr = (uint64_t) (sendArena + _slot * URING_SEND_SLOT_LENGTH);
+    entry->len = slot.length;
+    entry->addr2 = (uint64_t) &slot.remote;
+    entry->addr_len = sizeof(sockaddr_in);
+
+    if (zeroCopySends){
+        entry->opcode = IORING_OP_SEND_ZC;
+        entry->ioprio = IORING_RECVSEND_FIXED_BUF;
+        entry->buf_index = 0;
+    }   else {
+            entry->opcode = IORING_OP_SEND;
+        }
+
+    slot.inFlight++;
+    statistics.sendCalls++;
+
+    return true;
+}
+
+bool UringTransport::queueSend(const sockaddr_in &_remote, const uint8_t *_data, unsigned int _length, bool _retained){
+
+    if (ringDescriptor < 0 || closing || _length > URING_SEND_SLOT_LENGTH){
+        statistics.sendsFailed++;
+        return false;
+    }
+
+    uint16_t slot;
+
+    // Leased packet was built in its slot, other data are copied to free slot.
+    if (_retained){
+        slot = (_data - sendArena) / URING_SEND_SLOT_LENGTH;
+    }   else {
+            if (freeSendSlots.empty()){
+                statistics.sendsFailed++;
+                return false;
+            }
+
+            slot = freeSendSlots.back();
+            freeSendSlots.pop_back();
+            memcpy(sendArena + slot * URING_SEND_SLOT_LENGTH, _data, _length);
+        }
+
+    sendSlots[slot].remote = _remote;
+    sendSlots[slot].length = _length;
+
+    if (!submitSend(slot)){
+        if (!_retained){
+            freeSendSlots.push_back(slot);
+        }
+        statistics.sendsFailed++;
+        return false;
+    }
+
+    return true;
+}
+
+uint8_t* UringTransport::leaseBuffer(unsigned int _length){
+
+    if (_length > URING_SEND_SLOT_LENGTH || freeSendSlots.empty()){
+        return nullptr;
+    }
+
+    uint16_t slot = freeSendSlots.back();
+    freeSendSlots.pop_back();
+    sendSlots[slot].leased = true;
+
+    return sendArena + slot * URING_SEND_SLOT_LENGTH;
+}
+
+void UringTransport::releaseBuffer(uint8_t *_buffer){
+
+    uint16_t slot = (_buffer - sendArena) / URING_SEND_SLOT_LENGTH;
+
+    // Slot still sent by kernel is freed by completion of send.
+    sendSlots[slot].leased = false;
+    if (sendSlots[slot].inFlight == 0){
+        freeSendSlots.push_back(slot);
+    }
+}
+
+void UringTransport::provideReceiveBuffer(uint16_t _buffer){
+
+    io_uring_buf* entry = &receiveRing[receiveRingTail & (URING_RECEIVE_BUFFERS - 1)];
+    entry->addr = (uint64_t) (receiveBuffers + _buffer * URING_RECEIVE_BUFFER_LENGTH);
+    entry->len = URING_RECEIVE_BUFFER_LENGTH;
+    entry->bid = _buffer;
+
+    receiveRingTail++;
+    __atomic_store_n(&receiveRing[0].resv, receiveRingTail, __ATOMIC_RELEASE);
+}
+
+bool UringTransport::runIteration(int _maximumWait, bool _flushAnswers){
+
+    if (ringDescriptor < 0 || stopping || failed){
+        return false;
+    }
+
+    transportClock::time_point now = transportClock::now();
+    transportClock::time_point deadline;
+    bool hasDeadline = getNextDeadline(deadline);
+
+    if (_maximumWait >= 0){
+        transportClock::time_point waitEnd = now + std::chrono::milliseconds(_maximumWait);
+        if (!hasDeadline || waitEnd < deadline){
+            deadline = waitEnd;
+        }
+        hasDeadline = true;
+    }
+
+    unsigned int waitFor = 1;
+    if (hasDeadline){
+        if (deadline <= now){
+            waitFor = 0;
+        }   else if (!timeoutArmed || deadline < armedDeadline){
+                armTimeout(deadline);
+            }
+    }
+
+    // Sends queued since last call, timeout and wait for completions go in one call.
+    if (!submit(waitFor)){
+        return false;
+    }
+
+    reapCompletions();
+    fireExpiredTimers();
+    reportEndedNegotiations();
+
+    if (_flushAnswers && unsubmitted > 0){
+        submit(0);
+    }
+
+    return !stopping && !failed;
+}
+
+bool UringTransport::runOnce(int _maximumWait){
+
+    return runIteration(_maximumWait, true);
+}
+
+void UringTransport::run(){
+
+    // Answers are submitted by wait of next iteration.
+    while (runIteration(-1, false)){
+    }
+}
+
+void UringTransport::stop(){
+
+    stopping = true;
+
+    uint64_t wake = 1;
+    if (write(wakeDescriptor, &wake, sizeof(wake)) < 0){
+        return;
+    }
+}
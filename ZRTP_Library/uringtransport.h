@@ -0,0 +1,232 @@
+#ifndef URINGTRANSPORT_H
+#define URINGTRANSPORT_H
+
+#include "datagramtransport.h"
+#include "zrtpPacket/packetvalidator.h"
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/socket.h>
+#include <atomic>
+
+// Submission queue is flushed when it is full, completion queue is larger because multishot receive
+// and zero copy sends post more completions than submissions.
+#define URING_SUBMISSION_ENTRIES 256
+#define URING_COMPLETION_ENTRIES 4096
+
+// Receive buffers provided to kernel, count must be power of 2.
+#define URING_RECEIVE_BUFFERS 256
+#define URING_RECEIVE_BUFFER_LENGTH (sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + MAXIMUM_PACKET_LENGTH)
+
+// Slots of registered send buffer, every leased packet and every packet in flight holds one.
+#define URING_SEND_SLOTS 1024
+#define URING_SEND_SLOT_LENGTH 512
+
+// Completions read before timers are checked again.
+#define URING_COMPLETION_BATCH 256
+
+/**
+ * @brief The UringTransport class represent native Linux UDP transport on io_uring. One multishot recvmsg
+ *        receives datagrams to buffers provided to kernel by buffer ring, packets are sent from slots of
+ *        one registered buffer, leased packets of points are built in the slots directly. Timer of points
+ *        is one absolute timeout on the ring, so sends, receives and timers are submitted and reaped by
+ *        one io_uring_enter() per loop iteration. Linux 6.0 or newer is required.
+ */
+class UringTransport : public DatagramTransport{
+
+    // Upper byte of user data tells kind of operation, lower bytes carry slot or timer generation.
+    enum operationKind : uint64_t {RECEIVE_OPERATION = 1, SEND_OPERATION, TIMEOUT_OPERATION, WAKE_OPERATION, CANCEL_OPERATION};
+
+    typedef struct{
+        sockaddr_in remote;
+        uint16_t length;
+        uint16_t inFlight;
+        bool leased;
+    } SendSlot;
+
+    int ringDescriptor;
+    int socketDescriptor;
+
+    // Event which wakes loop from other thread on stop().
+    int wakeDescriptor;
+    uint64_t wakeValue;
+
+    std::atomic<bool> stopping;
+    bool closing;
+    bool failed;
+
+    // Rings shared with kernel.
+    uint8_t* submissionRing;
+    size_t submissionRingLength;
+    uint8_t* completionRing;
+    size_t completionRingLength;
+    io_uring_sqe* submissionEntries;
+    size_t submissionEntriesLength;
+
+    unsigned int* submissionHead;
+    unsigned int* submissionTail;
+    unsigned int* submissionArray;
+    unsigned int submissionMask;
+    unsigned int submissionEntriesCount;
+    unsigned int submissionLocalTail;
+    unsigned int unsubmitted;
+
+    unsigned int* completionHead;
+    unsigned int* completionTail;
+    unsigned int completionMask;
+    io_uring_cqe* completions;
+
+    // Operations whose last completion did not come yet.
+    unsigned int pendingOperations;
+
+    // Receive buffers and ring which provides them to kernel. Ring is array of entries, its tail overlays
+    // reserved field of first entry (flexible array of io_uring_buf_ring is misplaced in C++).
+    io_uring_buf* receiveRing;
+    size_t receiveRingLength;
+    uint8_t* receiveBuffers;
+    uint16_t receiveRingTail;
+    msghdr receiveHeader;
+    bool receiveArmed;
+
+    // Registered send buffer split to slots.
+    uint8_t* sendArena;
+    SendSlot sendSlots[URING_SEND_SLOTS];
+    std::vector<uint16_t> freeSendSlots;
+    bool zeroCopySends;
+
+    // Timeout on ring, completion of older timeout is recognized by generation.
+    __kernel_timespec timeoutSpecification;
+    transportClock::time_point armedDeadline;
+    uint32_t timeoutGeneration;
+    bool timeoutArmed;
+
+protected:
+
+    virtual bool queueSend(const sockaddr_in& _remote, const uint8_t* _data, unsigned int _length, bool _retained);
+    virtual uint8_t* leaseBuffer(unsigned int _length);
+    virtual void releaseBuffer(uint8_t* _buffer);
+
+private:
+
+    /**
+     * @brief getSubmissionEntry get free entry of submission queue, full queue is submitted first.
+     * @param _userData user data of operation.
+     * @return cleared entry, nullptr if queue stays full.
+     */
+    io_uring_sqe* getSubmissionEntry(uint64_t _userData);
+
+    /**
+     * @brief submit pass entries to kernel and wait for completions.
+     * @param _waitFor count of completions to wait for, 0 does not wait.
+     * @param _timeout longest wait, nullptr waits until completions come.
+     * @return false if ring failed.
+     */
+    bool submit(unsigned int _waitFor, const __kernel_timespec* _timeout = nullptr);
+
+    /**
+     * @brief reapCompletions handle completions posted by kernel.
+     */
+    void reapCompletions();
+
+    /**
+     * @brief handleCompletion handle one completion.
+     * @param _completion copy of completion entry.
+     */
+    void handleCompletion(const io_uring_cqe& _completion);
+
+    /**
+     * @brief handleReceive deliver datagram of receive completion and return its buffer to buffer ring.
+     * @param _completion completion of multishot recvmsg.
+     */
+    void handleReceive(const io_uring_cqe& _completion);
+
+    /**
+     * @brief handleSend count sent datagram and free its slot when kernel does not use it any more.
+     * @param _completion completion of send.
+     */
+    void handleSend(const io_uring_cqe& _completion);
+
+    void armReceive();
+    void armWake();
+    void armTimeout(transportClock::time_point _deadline);
+
+    /**
+     * @brief submitSend put send of slot to submission queue.
+     * @param _slot index of slot.
+     * @return true if send was queued.
+     */
+    bool submitSend(uint16_t _slot);
+
+    /**
+     * @brief provideReceiveBuffer return receive buffer to buffer ring.
+     * @param _buffer index of buffer.
+     */
+    void provideReceiveBuffer(uint16_t _buffer);
+
+    /**
+     * @brief runIteration submit queued sends and wait for completions or timer at most given time, handle them.
+     * @param _maximumWait longest wait in milliseconds, -1 waits until event comes.
+     * @param _flushAnswers true to submit answers before return, otherwise they wait for next iteration.
+     * @return false if loop was stopped or ring failed.
+     */
+    bool runIteration(int _maximumWait, bool _flushAnswers);
+
+    /**
+     * @brief setupRing create ring and map its queues.
+     * @return true if succesfull false otherwise.
+     */
+    bool setupRing();
+
+public:
+
+    UringTransport();
+
+    /**
+     * @brief ~UringTransport close ring and socket and delete all points of transport.
+     */
+    virtual ~UringTransport();
+
+    /**
+     * @brief open create socket bound to local address, ring and its registered buffers, and arm receive.
+     * @param _localAddress IPv4 address and port, port 0 lets system choose one.
+     * @param _reusePort true to join SO_REUSEPORT group of sockets bound to same address.
+     * @return true if succesfull false otherwise.
+     */
+    bool open(const sockaddr_in& _localAddress, bool _reusePort = false);
+
+    /**
+     * @brief close cancel operations on ring, close ring and socket, points are kept.
+     */
+    void close();
+
+    /**
+     * @brief getLocalAddress getter for address to which socket is bound.
+     * @return bound address.
+     */
+    sockaddr_in getLocalAddress();
+
+    /**
+     * @brief getSocketDescriptor getter for socket of transport.
+     * @return socket, -1 if transport is closed.
+     */
+    int getSocketDescriptor() {return socketDescriptor;}
+
+    /**
+     * @brief runOnce submit queued sends and wait for completions or timer at most given time, handle them
+     *        and submit answers.
+     * @param _maximumWait longest wait in milliseconds, -1 waits until event comes.
+     * @return false if loop was stopped or ring failed.
+     */
+    bool runOnce(int _maximumWait);
+
+    /**
+     * @brief run handle datagrams and timers until stop() is called.
+     */
+    void run();
+
+    /**
+     * @brief stop end run(), it can be called from any thread.
+     */
+    void stop();
+};
+
+#endif // URINGTRANSPORT_H
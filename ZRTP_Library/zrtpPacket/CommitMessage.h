@@ -7,22 +7,56 @@
 #define DH_COMMIT_PACKET_LENGTH 132
 
 /**
- * @brief The CommitMessage class represent Commint message for DH mode.
+ * @brief The CommitLayout struct describe fields of Commit packet in DH mode.
  */
-class CommitMessage : public ZrtpPacket {
+struct CommitLayout{
+
+    using HashImageH2      = NextField<PacketHeadLayout::MessageType, HASH_LENGTH_SHA256>;
+    using Zid              = NextField<HashImageH2, ZID_LENGTH>;
+    using HashAlgorithm    = NextField<Zid, WORD_LENGTH>;
+    using CipherAlgorithm  = NextField<HashAlgorithm, WORD_LENGTH>;
+    using AuthTagAlgorithm = NextField<CipherAlgorithm, WORD_LENGTH>;
+    using KeyAgreementType = NextField<AuthTagAlgorithm, WORD_LENGTH>;
+    using SasType          = NextField<KeyAgreementType, WORD_LENGTH>;
+    using Hvi              = NextField<SasType, HVI_LENGTH>;
+    using Mac              = NextField<Hvi, MAC_LENGTH>;
+    using Crc              = NextField<Mac, CRC_LENGTH>;
+
+    static constexpr uint16_t packetLength = Crc::end;
+};
 
-    // hashImage = hash(initiator’s DHPart2 message || responder’s Hello message)
-    uint8_t hashImageH2 [HASH_LENGTH_SHA256];
-    uint8_t zid         [ZID_LENGTH];
-    uint8_t hvi         [HVI_LENGTH];
-    uint8_t mac         [MAC_LENGTH];
+static_assert(CommitLayout::Hvi::offset == 88, "hvi is at word 22 of Commit");
+static_assert(CommitLayout::packetLength == DH_COMMIT_PACKET_LENGTH, "Commit in DH mode is 33 words");
+
+/**
+ * @brief The CommitView class represent received Commit in DH mode.
+ */
+class CommitView : public PacketView{
+
+public:
+
+    CommitView(const uint8_t* _data, uint16_t _length) : PacketView(_data, _length) {}
+
+    /**
+     * @brief isValid check if packet is complete and has length of Commit in DH mode.
+     * @return true if all fields can be read.
+     */
+    bool isValid() const {return hasLayout<CommitLayout>();}
 
-    uint8_t agreedHashAlgorithm [WORD_LENGTH];     // = "SHA-256 Hash";
-    uint8_t agreedCipherAlgorithm [WORD_LENGTH];   // = "AES-CM with 128 bit Keys";
-    uint8_t agreedAuthTagAlgorithm [WORD_LENGTH] ; // = "HMAC-SHA1 32 bit authentication tag";
-    uint8_t agreedKeyAgreementType [WORD_LENGTH];  // = "DH mode with p=3072 prime";
-    uint8_t agreedSasType [WORD_LENGTH] ;          // = "Short authentication string using base 32";
+    const uint8_t* getHashImageH2() const {return CommitLayout::HashImageH2::in(data);}
+    const uint8_t* getZid() const {return CommitLayout::Zid::in(data);}
+    const uint8_t* getHvi() const {return CommitLayout::Hvi::in(data);}
+    const uint8_t* getMac() const {return CommitLayout::Mac::in(data);}
+};
+
+/**
+ * @brief The CommitMessage class represent Commint message for DH mode. Fields are stored directly
+ *        in data of packet, received Commit is kept as it came.
+ */
+class CommitMessage : public ZrtpPacket {
 
+    // hashImage = hash(initiator’s DHPart2 message || responder’s Hello message)
+    // Agreed algorithms: hash, cipher, auth tag, key agreement and SAS type.
     uint8_t dataToSend[DH_COMMIT_PACKET_LENGTH];
 
 public:
@@ -48,122 +82,124 @@ public:
      * @param _agreedHashAlgorithm new algorithm to set.
      */
     void setAgreedHashAlgorithm (uint8_t* _agreedHashAlgorithm)
-        {memcpy(agreedHashAlgorithm, _agreedHashAlgorithm, WORD_LENGTH);}
+        {CommitLayout::HashAlgorithm::write(dataToSend, _agreedHashAlgorithm);}
 
     /**
      * @brief setAgreedCipherAlgorithm setter for agreedCipherAlgorithm.
      * @param _agreedCipherAlgorithm new algorithm to set.
      */
     void setAgreedCipherAlgorithm (uint8_t* _agreedCipherAlgorithm)
-        {memcpy(agreedCipherAlgorithm, _agreedCipherAlgorithm, WORD_LENGTH);}
+        {CommitLayout::CipherAlgorithm::write(dataToSend, _agreedCipherAlgorithm);}
 
     /**
      * @brief setAgreedAuthTagAlgorithm setter for agreedAuthTagAlgorithm.
      * @param _agreedAuthTagAlgorithm new algorithm to set.
      */
     void setAgreedAuthTagAlgorithm (uint8_t* _agreedAuthTagAlgorithm)
-        {memcpy(agreedAuthTagAlgorithm, _agreedAuthTagAlgorithm, WORD_LENGTH);}
+        {CommitLayout::AuthTagAlgorithm::write(dataToSend, _agreedAuthTagAlgorithm);}
 
     /**
      * @brief setAgreedKeyAgreementType setter for agreedKeyAgreementType.
      * @param _agreedKeyAgreementType new key agreement type to set.
      */
     void setAgreedKeyAgreementType (uint8_t* _agreedKeyAgreementType)
-        {memcpy(agreedKeyAgreementType, _agreedKeyAgreementType, WORD_LENGTH);}
+        {CommitLayout::KeyAgreementType::write(dataToSend, _agreedKeyAgreementType);}
 
     /**
      * @brief setAgreedSasType setter for SAS type.
      * @param _agreedSasType new agreedSasType.
      */
     void setAgreedSasType (uint8_t* _agreedSasType)
-        {memcpy(agreedSasType, _agreedSasType, WORD_LENGTH);}
+        {CommitLayout::SasType::write(dataToSend, _agreedSasType);}
 
     /**
      * @brief setHashImage setter for hash image.
      * @param _hashImage new hash image to set.
      */
-    void setHashImageH2(uint8_t* _hashImage) {memcpy(hashImageH2, _hashImage, HASH_LENGTH_SHA256);}
+    void setHashImageH2(uint8_t* _hashImage) {CommitLayout::HashImageH2::write(dataToSend, _hashImage);}
 
     /**
      * @brief setZid setter for zid.
      * @param _zid new zid to set.
      */
-    void setZid(uint8_t* _zid) {memcpy(zid, _zid, ZID_LENGTH);}
+    void setZid(uint8_t* _zid) {CommitLayout::Zid::write(dataToSend, _zid);}
 
     /**
      * @brief setHvi setter for Hvi.
      * @param _hvi new hvi to set.
      */
-    void setHvi(uint8_t* _hvi) {memcpy(hvi, _hvi, HVI_LENGTH);}
+    void setHvi(uint8_t* _hvi) {CommitLayout::Hvi::write(dataToSend, _hvi);}
 
     /**
      * @brief setMac setter for Mac.
      * @param _mac new mac to set.
      */
-    void setMac(uint8_t* _mac);
+    void setMac(uint8_t* _mac) {CommitLayout::Mac::write(dataToSend, _mac);}
 
     /**
      * @brief getHashImage getter for hash image.
      * @return hash image.
      */
-    uint8_t* getHashImageH2() {return hashImageH2;}
+    uint8_t* getHashImageH2() {return CommitLayout::HashImageH2::in(dataToSend);}
 
     /**
      * @brief getZid getter for zid.
      * @return zid.
      */
-    uint8_t* getZid() {return zid;}
+    uint8_t* getZid() {return CommitLayout::Zid::in(dataToSend);}
 
     /**
      * @brief getHvi getter for Hvi.
      * @return hvi.
      */
-    uint8_t* getHvi() {return hvi;}
+    uint8_t* getHvi() {return CommitLayout::Hvi::in(dataToSend);}
 
     /**
      * @brief getMac getter for mac.
      * @return mac.
      */
-    uint8_t* getMac() {return mac;}
+    uint8_t* getMac() {return CommitLayout::Mac::in(dataToSend);}
 
     /**
      * @brief getAgreedHashAlgorithm getter for hash algorithm.
      * @return agreedHashAlgorithm.
      */
-    uint8_t* getAgreedHashAlgorithm() {return agreedHashAlgorithm;}
+    uint8_t* getAgreedHashAlgorithm() {return CommitLayout::HashAlgorithm::in(dataToSend);}
 
     /**
      * @brief getAgreedCipherAlgorithm getter for cipher algorithm.
      * @return agreedCipherAlgorithm
      */
-    uint8_t* getAgreedCipherAlgorithm() {return agreedCipherAlgorithm;}
+    uint8_t* getAgreedCipherAlgorithm() {return CommitLayout::CipherAlgorithm::in(dataToSend);}
 
     /**
      * @brief getAgreedAuthTagAlgorithm getter for auth tag algorithm.
      * @return agreedAuthTagAlgorithm.
      */
-    uint8_t* getAgreedAuthTagAlgorithm() {return agreedAuthTagAlgorithm;}
+    uint8_t* getAgreedAuthTagAlgorithm() {return CommitLayout::AuthTagAlgorithm::in(dataToSend);}
 
     /**
      * @brief getAgreedKeyAgreementType getter for key agreement type,
      * @return agreedKeyAgreementType.
      */
-    uint8_t* getAgreedKeyAgreementType() {return agreedKeyAgreementType;}
+    uint8_t* getAgreedKeyAgreementType() {return CommitLayout::KeyAgreementType::in(dataToSend);}
 
     /**
      * @brief getAgreedSasType getter for sas type.
      * @return agreedSasType.
      */
-    uint8_t* getAgreedSasType() {return agreedSasType;}
+    uint8_t* getAgreedSasType() {return CommitLayout::SasType::in(dataToSend);}
 
     /**
-     * @brief parseCommitMessage parser for received commit message.
-     * @param _messageToFill message to fill with received data.
-     * @param _messageData received data.
-     * @return error code if error occured, 0 otherwise.
+     * @brief parseCommitMessage store received commit message, its fields are read in place.
+     * @param _view view of received data.
+     * @return MALFORMED_PACKET if packet is not Commit in DH mode, N_ERROR otherwise.
      */
-    void parseCommitMessage(CommitMessage* _messageToFill, uint8_t* _messageData);
+    zrtpErrorCode parseCommitMessage(const CommitView& _view);
 
+    /**
+     * @brief initializeMessageData copy packet head, message head and CRC to data, fields are set there already.
+     */
     virtual void initializeMessageData();
 };
 
@@ -19,5 +19,5 @@ void Conf2AckMessage::initializeMessageData(){
     // Copy message head
     initializeMessageHead(dataToSend);
 
-    memcpy(dataToSend + PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH, &crc, sizeof(crc));
+    EmptyMessageLayout::Crc::write(dataToSend, &crc);
 }
@@ -6,6 +6,8 @@
 // Conf2Ack packet is always 28
 #define CONF2ACK_PAKET_SIZE 28
 
+static_assert(EmptyMessageLayout::packetLength == CONF2ACK_PAKET_SIZE, "message without body is 7 words");
+
 /**
  * @brief The conf2AckMessage class represent conf2AckMessage
  */
@@ -8,30 +8,20 @@ ConfirmMessage::ConfirmMessage() {
 
     memset(unusedAndSignature, 0, sizeof(unusedAndSignature));
     flagocet = 0;
+
+    memset(dataToSend, 0, sizeof(dataToSend));
 }
 
 ConfirmMessage::~ConfirmMessage(){
 
 }
 
-void ConfirmMessage::initializeEncryptedPart(){
-
-    uint16_t p = 0;
-
-    // Hash image
-    memcpy(encryptedPart, hashPreimageH0, HASH_LENGTH_SHA256);
-    p += HASH_LENGTH_SHA256;
+void ConfirmMessage::initializeEncryptedPart(uint8_t *_plainPart){
 
-    // Unused bytes
-    memcpy(encryptedPart + p, unusedAndSignature, sizeof(unusedAndSignature));
-    p += sizeof(unusedAndSignature);
-
-    // Flagocet
-    memcpy(encryptedPart + p, &flagocet, sizeof(flagocet));
-    p += sizeof(flagocet);
-
-    // Cache expiration interval
-    memcpy(encryptedPart + p, &cacheExpirationInterval, WORD_LENGTH);
+    ConfirmPlainLayout::HashPreimageH0::write(_plainPart, hashPreimageH0);
+    ConfirmPlainLayout::UnusedAndSignature::write(_plainPart, unusedAndSignature);
+    ConfirmPlainLayout::Flags::write(_plainPart, &flagocet);
+    ConfirmPlainLayout::CacheExpirationInterval::write(_plainPart, &cacheExpirationInterval);
 }
 
 void ConfirmMessage::initializeMessageData(){
@@ -41,54 +31,27 @@ void ConfirmMessage::initializeMessageData(){
 
     // Copy hello data from hello head to sending data.
     initializeMessageHead(dataToSend);
-    uint16_t p = PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH;
-
-    // Confirm mac.
-    memcpy(dataToSend + p, confirm_mac, MAC_LENGTH);
-    p += MAC_LENGTH;
 
-    // CFB initialization vector.
-    memcpy(dataToSend + p, initializationVector, CFB_INITIALIZATION_VECTOR_LENGTH);
-    p += CFB_INITIALIZATION_VECTOR_LENGTH;
-
-    // Encrypted part.
-    memcpy(dataToSend + p, encryptedPart, ENCRYPTED_PART_LENGTH);
-    p += ENCRYPTED_PART_LENGTH;
-
-    // Crc
-    memcpy(dataToSend + p, &crc, sizeof(crc));
+    ConfirmLayout::Crc::write(dataToSend, &crc);
 }
 
-void ConfirmMessage::parseConfirmMessage(ConfirmMessage *_messageToFill, uint8_t *_messageData){
-
-    // Reverse procedure as in initialize()
-    uint16_t p = PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH;
-    _messageToFill->setConfirmMac(_messageData + p);
-    p += MAC_LENGTH;
+zrtpErrorCode ConfirmMessage::parseConfirmMessage(const ConfirmView &_view){
 
-    _messageToFill->setInitializationVector(_messageData + p);
-    p += CFB_INITIALIZATION_VECTOR_LENGTH;
+    if (!_view.isValid()){
+        return MALFORMED_PACKET;
+    }
 
-    _messageToFill->setEncryptedData(_messageData + p);
-    p += ENCRYPTED_PART_LENGTH;
+    copyReceivedPacket(dataToSend, _view);
 
-    _messageToFill->initializeMessageData();
+    return N_ERROR;
 }
 
-void ConfirmMessage::setEncryptedData(uint8_t *_encryptedData){
-    // Store encrypted part
-    memcpy(encryptedPart, _encryptedData, ENCRYPTED_PART_LENGTH);
+void ConfirmMessage::setDecryptedData(uint8_t *_decryptedData){
 
-    // Copy encrypted part to data to send.
-    memcpy(dataToSend + PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH + MAC_LENGTH + CFB_INITIALIZATION_VECTOR_LENGTH,
-           encryptedPart, ENCRYPTED_PART_LENGTH);
-
-    // Set H0 from encrypted part
-    setHashImageH0(_encryptedData);
+    ConfirmPlainLayout::HashPreimageH0::read(_decryptedData, hashPreimageH0);
 
     memset(unusedAndSignature, 0, sizeof(unusedAndSignature));
 
-    // Set flagocet
-    flagocet = *(uint8_t*)(_encryptedData + 35);
+    ConfirmPlainLayout::Flags::read(_decryptedData, &flagocet);
+    ConfirmPlainLayout::CacheExpirationInterval::read(_decryptedData, &cacheExpirationInterval);
 }
-
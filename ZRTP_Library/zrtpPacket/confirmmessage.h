@@ -9,11 +9,58 @@
 #define CONFIRM_PACKET_LENGTH 92
 #define ENCRYPTED_PART_LENGTH 40
 
-class ConfirmMessage : public ZrtpPacket {
+/**
+ * @brief The ConfirmLayout struct describe fields of Confirm packet without signature.
+ */
+struct ConfirmLayout{
+
+    using ConfirmMac           = NextField<PacketHeadLayout::MessageType, MAC_LENGTH>;
+    using InitializationVector = NextField<ConfirmMac, CFB_INITIALIZATION_VECTOR_LENGTH>;
+    using EncryptedPart        = NextField<InitializationVector, ENCRYPTED_PART_LENGTH>;
+    using Crc                  = NextField<EncryptedPart, CRC_LENGTH>;
+
+    static constexpr uint16_t packetLength = Crc::end;
+};
+
+/**
+ * @brief The ConfirmPlainLayout struct describe plaintext of encrypted part, offsets are relative to it.
+ */
+struct ConfirmPlainLayout{
+
+    using HashPreimageH0          = PacketField<0, HASH_LENGTH_SHA256>;
+    using UnusedAndSignature      = NextField<HashPreimageH0, 3>;
+    using Flags                   = NextField<UnusedAndSignature, 1>;
+    using CacheExpirationInterval = NextField<Flags, WORD_LENGTH>;
+};
+
+static_assert(ConfirmLayout::packetLength == CONFIRM_PACKET_LENGTH, "Confirm without signature is 23 words");
+static_assert(ConfirmPlainLayout::CacheExpirationInterval::end == ENCRYPTED_PART_LENGTH,
+              "encrypted part ends with cache expiration interval");
+
+/**
+ * @brief The ConfirmView class represent received Confirm1 or Confirm2.
+ */
+class ConfirmView : public PacketView{
 
-    uint8_t confirm_mac[MAC_LENGTH];
+public:
 
-    uint8_t initializationVector[CFB_INITIALIZATION_VECTOR_LENGTH];
+    ConfirmView(const uint8_t* _data, uint16_t _length) : PacketView(_data, _length) {}
+
+    /**
+     * @brief isValid check if packet is complete and has length of Confirm without signature.
+     * @return true if all fields can be read.
+     */
+    bool isValid() const {return hasLayout<ConfirmLayout>();}
+
+    const uint8_t* getConfirmMac() const {return ConfirmLayout::ConfirmMac::in(data);}
+    const uint8_t* getEncryptedPart() const {return ConfirmLayout::EncryptedPart::in(data);}
+};
+
+/**
+ * @brief The ConfirmMessage class represent Confirm1 and Confirm2 message. Confirm mac, IV and encrypted
+ *        part are stored directly in data of packet, decrypted fields are kept separately.
+ */
+class ConfirmMessage : public ZrtpPacket {
 
     uint8_t hashPreimageH0[HASH_LENGTH_SHA256];
 
@@ -26,8 +73,6 @@ class ConfirmMessage : public ZrtpPacket {
 
     uint32_t cacheExpirationInterval;
 
-    uint8_t encryptedPart[ENCRYPTED_PART_LENGTH];
-
     uint8_t dataToSend[CONFIRM_PACKET_LENGTH];
 
 public:
@@ -46,15 +91,15 @@ public:
      * @brief setConfirmMac setter for parameter confirm mac.
      * @param _confirmMac new value to set.
      */
-    void setConfirmMac (uint8_t * _confirmMac) {memcpy(confirm_mac, _confirmMac, MAC_LENGTH);}
+    void setConfirmMac (uint8_t * _confirmMac) {ConfirmLayout::ConfirmMac::write(dataToSend, _confirmMac);}
 
 
     /**
      * @brief setInitializationVector setter for initialization vector.
      * @param _initializationVector new value to set.
      */
-    void setInitializationVector(uint8_t * _initializationVector) {memcpy(initializationVector, _initializationVector,
-                                                                   CFB_INITIALIZATION_VECTOR_LENGTH);}
+    void setInitializationVector(uint8_t * _initializationVector)
+        {ConfirmLayout::InitializationVector::write(dataToSend, _initializationVector);}
 
     /**
      * @brief setHashImageH0 setter for parameter hash image.
@@ -84,16 +129,23 @@ public:
     void setDisclosureFlag() {flagocet ^= 1;}
 
     /**
-     * @brief initializeEncryptedPart copy correct values to encrypted part.
+     * @brief initializeEncryptedPart copy correct values to plaintext of encrypted part.
+     * @param _plainPart buffer of ENCRYPTED_PART_LENGTH bytes for plaintext.
      */
-    void initializeEncryptedPart();
+    void initializeEncryptedPart(uint8_t* _plainPart);
 
     /**
-     * @brief setEncryptedData setter for encrypted data also parse encrypted data and set correct values.
-     *        copy new enrypted part to data to send.
+     * @brief setEncryptedData copy new encrypted part to data to send.
      * @param _encryptedData new encrypted data.
      */
-    void setEncryptedData(uint8_t* _encryptedData);
+    void setEncryptedData(uint8_t* _encryptedData)
+        {ConfirmLayout::EncryptedPart::write(dataToSend, _encryptedData);}
+
+    /**
+     * @brief setDecryptedData parse decrypted part and set correct values, encrypted part is kept in data.
+     * @param _decryptedData plaintext of encrypted part.
+     */
+    void setDecryptedData(uint8_t* _decryptedData);
 
     /**
      * @brief setCacheExpirationInterval set cache expiration interval.
@@ -105,7 +157,7 @@ public:
      * @brief getEncryptedPard getter for encryped part.
      * @return encrypted part.
      */
-    uint8_t* getEncryptedPart() {return encryptedPart;}
+    uint8_t* getEncryptedPart() {return ConfirmLayout::EncryptedPart::in(dataToSend);}
 
     /**
      * @brief getConfirmData getter for confirm data.
@@ -117,7 +169,7 @@ public:
      * @brief getConfirmMac getter for confirm mac.
      * @return confirm_mac.
      */
-    uint8_t* getConfirmMac() {return confirm_mac;}
+    uint8_t* getConfirmMac() {return ConfirmLayout::ConfirmMac::in(dataToSend);}
 
     /**
      * @brief getCachceExpirationInterval getter for cache expiration interval.
@@ -129,7 +181,7 @@ public:
      * @brief getInitializationVector getter for initialization vector.
      * @return initialization vector.
      */
-    uint8_t* getInitializationVector() {return initializationVector;}
+    uint8_t* getInitializationVector() {return ConfirmLayout::InitializationVector::in(dataToSend);}
 
     /**
      * @brief getHashPreimageH0 getter for hash preimage.
@@ -138,13 +190,15 @@ public:
     uint8_t* getHashPreimageH0() {return hashPreimageH0;}
 
     /**
-     * @brief parseConfirmMessage parser for confirm message.
-     * @param _messageToFill message to fill with parsed data.
-     * @param _messageData data to parse.
-     * @return return error code if something went wrong, 0 otherwise.
+     * @brief parseConfirmMessage store received confirm message, it is decrypted after mac is verified.
+     * @param _view view of received data.
+     * @return MALFORMED_PACKET if packet is not Confirm without signature, N_ERROR otherwise.
      */
-    void parseConfirmMessage(ConfirmMessage* _messageToFill, uint8_t* _messageData);
+    zrtpErrorCode parseConfirmMessage(const ConfirmView& _view);
 
+    /**
+     * @brief initializeMessageData copy packet head, message head and CRC to data, fields are set there already.
+     */
     virtual void initializeMessageData();
 };
 
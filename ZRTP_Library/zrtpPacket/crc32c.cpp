@@ -0,0 +1,126 @@
+#include "zrtpPacket/crc32c.h"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE
+#endif
+
+// Reflected Castagnoli polynomial.
+#define CRC32C_POLYNOMIAL 0x82F63B78
+
+/**
+ * @brief The Crc32cTable struct hold tables for CRC of 8 bytes at once (slicing-by-8), they are generated
+ *        by compiler.
+ */
+struct Crc32cTable{
+
+    uint32_t values[8][256];
+
+    constexpr Crc32cTable() : values(){
+        for (uint32_t i = 0; i < 256; i++){
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++){
+                value = (value & 1) ? (value >> 1) ^ CRC32C_POLYNOMIAL : value >> 1;
+            }
+            values[0][i] = value;
+        }
+
+        for (uint32_t i = 0; i < 256; i++){
+            for (int slice = 1; slice < 8; slice++){
+                values[slice][i] = (values[slice - 1][i] >> 8) ^ values[0][values[slice - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+static constexpr Crc32cTable crcTable;
+
+static uint32_t crc32cTable(const uint8_t* _data, size_t _length, uint32_t _crc){
+
+    const uint32_t (*t)[256] = crcTable.values;
+
+    while (_length >= 8){
+        uint32_t low = _crc ^ ((uint32_t) _data[0] | ((uint32_t) _data[1] << 8) |
+                               ((uint32_t) _data[2] << 16) | ((uint32_t) _data[3] << 24));
+
+        _crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+               t[3][_data[4]] ^ t[2][_data[5]] ^ t[1][_data[6]] ^ t[0][_data[7]];
+
+        _data += 8;
+        _length -= 8;
+    }
+
+    while (_length > 0){
+        _crc = t[0][(_crc ^ *_data) & 0xff] ^ (_crc >> 8);
+        _data++;
+        _length--;
+    }
+
+    return _crc;
+}
+
+#ifdef CRC32C_HARDWARE
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(const uint8_t* _data, size_t _length, uint32_t _crc){
+
+    uint64_t crc = _crc;
+
+    // Packets are word aligned, so all but the last bytes are taken 8 at once.
+    while (_length >= sizeof(uint64_t)){
+        uint64_t word;
+        memcpy(&word, _data, sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+
+        _data += sizeof(word);
+        _length -= sizeof(word);
+    }
+
+    uint32_t result = (uint32_t) crc;
+    while (_length > 0){
+        result = _mm_crc32_u8(result, *_data);
+        _data++;
+        _length--;
+    }
+
+    return result;
+}
+#endif
+
+uint32_t crc32c(const uint8_t *_data, size_t _length){
+
+#ifdef CRC32C_HARDWARE
+    static const bool hardwareSupported = __builtin_cpu_supports("sse4.2");
+
+    if (hardwareSupported){
+        return ~crc32cHardware(_data, _length, 0xFFFFFFFF);
+    }
+#endif
+
+    return ~crc32cTable(_data, _length, 0xFFFFFFFF);
+}
+
+void setPacketCrc(uint8_t *_packet, uint16_t _packetLength){
+
+    uint32_t crc = crc32c(_packet, _packetLength - CRC_LENGTH);
+    uint8_t* crcField = _packet + _packetLength - CRC_LENGTH;
+
+    // CRC is sent in same byte order as in SCTP (RFC 3309), least significant byte first.
+    crcField[0] = crc & 0xff;
+    crcField[1] = (crc >> 8) & 0xff;
+    crcField[2] = (crc >> 16) & 0xff;
+    crcField[3] = (crc >> 24) & 0xff;
+}
+
+bool checkPacketCrc(const uint8_t *_packet, uint16_t _packetLength){
+
+    if (_packet == nullptr || _packetLength <= CRC_LENGTH){
+        return false;
+    }
+
+    const uint8_t* crcField = _packet + _packetLength - CRC_LENGTH;
+    uint32_t receivedCrc = (uint32_t) crcField[0] | ((uint32_t) crcField[1] << 8) |
+                           ((uint32_t) crcField[2] << 16) | ((uint32_t) crcField[3] << 24);
+
+    return crc32c(_packet, _packetLength - CRC_LENGTH) == receivedCrc;
+}
@@ -0,0 +1,36 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC field closes every ZRTP packet.
+#define CRC_LENGTH 4
+
+/**
+ * @brief crc32c compute CRC-32C (Castagnoli polynomial, RFC 3309) of data. SSE4.2 crc32 instruction is
+ *        used when processor supports it, table is used otherwise.
+ * @param _data data to check.
+ * @param _length length of data.
+ * @return CRC of data.
+ */
+uint32_t crc32c(const uint8_t* _data, size_t _length);
+
+/**
+ * @brief setPacketCrc compute CRC across whole packet without CRC field and write it to last word of packet.
+ *        It is called when packet is sent, after MAC of message was set.
+ * @param _packet data of packet.
+ * @param _packetLength length of packet including CRC.
+ */
+void setPacketCrc(uint8_t* _packet, uint16_t _packetLength);
+
+/**
+ * @brief checkPacketCrc check CRC of received packet. Packet which fails is dropped before it reaches
+ *        session, so corrupted or flooded datagrams cost only one pass over their bytes.
+ * @param _packet received data.
+ * @param _packetLength length of received data.
+ * @return true if packet is long enough and its CRC is correct.
+ */
+bool checkPacketCrc(const uint8_t* _packet, uint16_t _packetLength);
+
+#endif // CRC32C_H
@@ -16,16 +16,53 @@
 // Maximum size of DH_Packet, when RFC3526 is used.
 #define DH3K_PACKET_SIZE 484
 
-class DHPart : public ZrtpPacket {
+/**
+ * @brief The DHPartLayout struct describe fields of DHPart packet. Public value has size of negotiated key
+ *        agreement, so mac and crc are placed by packetLength() at run time.
+ */
+struct DHPartLayout{
+
+    using HashImageH1 = NextField<PacketHeadLayout::MessageType, HASH_LENGTH_SHA256>;
+    using Rs1Id       = NextField<HashImageH1, SHARED_SECRET_LENGTH>;
+    using Rs2Id       = NextField<Rs1Id, SHARED_SECRET_LENGTH>;
+    using AuxSecretId = NextField<Rs2Id, SHARED_SECRET_LENGTH>;
+    using PbxSecretId = NextField<AuxSecretId, SHARED_SECRET_LENGTH>;
+
+    static constexpr uint16_t publicValueOffset = PbxSecretId::end;
+
+    static constexpr uint16_t macOffset(uint32_t _keySize) {return publicValueOffset + _keySize;}
+    static constexpr uint16_t packetLength(uint32_t _keySize) {return macOffset(_keySize) + MAC_LENGTH + CRC_LENGTH;}
+};
+
+static_assert(DHPartLayout::publicValueOffset == 88, "public value is at word 22 of DHPart");
+static_assert(DHPartLayout::packetLength(DH3K_PUBLIC_KEY_LENGTH) == DH3K_PACKET_SIZE, "DHPart of DH3k is 121 words");
+
+/**
+ * @brief The DHPartView class represent received DHPart1 or DHPart2.
+ */
+class DHPartView : public PacketView{
+
+public:
+
+    DHPartView(const uint8_t* _data, uint16_t _length) : PacketView(_data, _length) {}
 
-    uint8_t hashImageH1 [HASH_LENGTH_SHA256];
+    /**
+     * @brief isValid check if packet is complete and carries public value of negotiated size.
+     * @param _keySize negotiated size of public value.
+     * @return true if all fields can be read.
+     */
+    bool isValid(uint32_t _keySize) const
+        {return isComplete() && length == DHPartLayout::packetLength(_keySize);}
 
-    uint8_t rs1ID [SHARED_SECRET_LENGTH];
-    uint8_t rs2ID [SHARED_SECRET_LENGTH];
-    uint8_t auxSecretID [SHARED_SECRET_LENGTH];
-    uint8_t pbxSecretID [SHARED_SECRET_LENGTH];
-    uint8_t publicValue [DH3K_PUBLIC_KEY_LENGTH];
-    uint8_t mac [MAC_LENGTH];
+    const uint8_t* getHashImageH1() const {return DHPartLayout::HashImageH1::in(data);}
+    const uint8_t* getPublicValue() const {return data + DHPartLayout::publicValueOffset;}
+};
+
+/**
+ * @brief The DHPart class represent DHPart1 and DHPart2 message. Fields are stored directly in data of
+ *        packet, received DHPart is kept as it came.
+ */
+class DHPart : public ZrtpPacket {
 
     uint32_t negotiatiedKeySize = 0;
     uint8_t dataToSend[DH3K_PACKET_SIZE];
@@ -52,86 +89,86 @@ public:
      * @brief setHashImageH1 is setter for parameter hashImageH1.
      * @param _hashImageH1 new hash to set.
      */
-    void setHashImageH1(uint8_t* _hashImageH1) {memcpy(hashImageH1,_hashImageH1, HASH_LENGTH_SHA256);}
+    void setHashImageH1(uint8_t* _hashImageH1) {DHPartLayout::HashImageH1::write(dataToSend, _hashImageH1);}
 
     /**
      * @brief setRs1ID setter for rs1ID.
      * @param _rs1ID data to set.
      */
-    void setRs1ID(uint8_t* _rs1ID) {memcpy(rs1ID, _rs1ID, SHARED_SECRET_LENGTH);}
+    void setRs1ID(uint8_t* _rs1ID) {DHPartLayout::Rs1Id::write(dataToSend, _rs1ID);}
 
     /**
      * @brief setRs2ID setter for rs2ID.
      * @param _rs2ID data to set.
      */
-    void setRs2ID(uint8_t* _rs2ID) {memcpy(rs2ID, _rs2ID, SHARED_SECRET_LENGTH);}
+    void setRs2ID(uint8_t* _rs2ID) {DHPartLayout::Rs2Id::write(dataToSend, _rs2ID);}
 
     /**
      * @brief setAuxSecretID setter for auxSecretID.
      * @param _auxsecret new auxsecret to set.
      */
-    void setAuxSecretID(uint8_t* _auxsecret) {memcpy(auxSecretID, _auxsecret, SHARED_SECRET_LENGTH);}
+    void setAuxSecretID(uint8_t* _auxsecret) {DHPartLayout::AuxSecretId::write(dataToSend, _auxsecret);}
 
     /**
      * @brief setPbxSecretID setter for pbxSecretID.
      * @param _pbxsecret new pbx secret to set.
      */
-    void setPbxSecretID(uint8_t* _pbx) {memcpy(pbxSecretID, _pbx, SHARED_SECRET_LENGTH);}
+    void setPbxSecretID(uint8_t* _pbx) {DHPartLayout::PbxSecretId::write(dataToSend, _pbx);}
 
     /**
      * @brief setPublicValue setter fo public value.
      * @param _publicValue new value to set.
      */
     void setPublicValue(uint8_t* _publicValue)
-        {memcpy(publicValue, _publicValue, getNegotiatedKeySize());}
+        {memcpy(dataToSend + DHPartLayout::publicValueOffset, _publicValue, getNegotiatedKeySize());}
 
     /**
      * @brief setMac setter for mac.
      * @param _mac new mac to set.
      */
-    void setMac(uint8_t* _mac);
+    void setMac(uint8_t* _mac) {memcpy(getMac(), _mac, MAC_LENGTH);}
 
     /**
      * @brief getHashImageH1 getter for parameter hashImageH1.
      * @return hashImageH1.
      */
-    uint8_t*getHashImageH1() {return hashImageH1;}
+    uint8_t*getHashImageH1() {return DHPartLayout::HashImageH1::in(dataToSend);}
 
     /**
      * @brief getRs1ID getter for parameter rs1ID.
      * @return rs1ID.
      */
-    uint8_t* getRs1ID() {return rs1ID;}
+    uint8_t* getRs1ID() {return DHPartLayout::Rs1Id::in(dataToSend);}
 
     /**
      * @brief getRs2ID getter for parameter rs1ID.
      * @return rs2ID.
      */
-    uint8_t* getRs2ID() {return rs2ID;}
+    uint8_t* getRs2ID() {return DHPartLayout::Rs2Id::in(dataToSend);}
 
     /**
      * @brief getAuxSecret getter for parameter auxSecret.
      * @return auxSecret.
      */
-    uint8_t* getAuxSecret(){return auxSecretID;}
+    uint8_t* getAuxSecret(){return DHPartLayout::AuxSecretId::in(dataToSend);}
 
     /**
      * @brief getPbxSecret getter for parameter auxSecret.
      * @return auxSecret
      */
-    uint8_t* getPbxSecret(){return pbxSecretID;}
+    uint8_t* getPbxSecret(){return DHPartLayout::PbxSecretId::in(dataToSend);}
 
     /**
      * @brief getPublicValue getter for publicValue.
      * @return publicValue.
      */
-    uint8_t* getPublicValue() {return publicValue;}
+    uint8_t* getPublicValue() {return dataToSend + DHPartLayout::publicValueOffset;}
 
     /**
      * @brief getMac getter for parameter mac.
      * @return mac of dhPart message.
      */
-    uint8_t* getMac() {return mac;}
+    uint8_t* getMac() {return dataToSend + DHPartLayout::macOffset(getNegotiatedKeySize());}
 
     /**
      * @brief setNegotiatedKeySize is setter for key size.
@@ -146,13 +183,15 @@ public:
     uint32_t getNegotiatedKeySize() {return negotiatiedKeySize;}
 
     /**
-     * @brief parseDhMessage parser for Dh message.
-     * @param _messageToFill message to fill with parsed data.
-     * @param messageData data to parse.
-     * @return error code or 0 if succesfull
+     * @brief parseDhMessage store received Dh message, its fields are read in place.
+     * @param _view view of received data.
+     * @return MALFORMED_PACKET if public value does not have negotiated size, N_ERROR otherwise.
      */
-    void parseDhMessage(DHPart* _messageToFill, uint8_t* _messageData);
+    zrtpErrorCode parseDhMessage(const DHPartView& _view);
 
+    /**
+     * @brief initializeMessageData copy packet head, message head and CRC to data, fields are set there already.
+     */
     virtual void initializeMessageData();
 };
 
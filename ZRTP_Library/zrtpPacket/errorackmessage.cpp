@@ -16,5 +16,5 @@ void ErrorAckMessage::initializeMessageData(){
 
     initializePacketData(dataToSend);
     initializeMessageHead(dataToSend);
-    memcpy(dataToSend + 24, &crc, sizeof(crc));
+    EmptyMessageLayout::Crc::write(dataToSend, &crc);
 }
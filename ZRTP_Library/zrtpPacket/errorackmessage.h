@@ -5,6 +5,8 @@
 
 #define ERRORACK_PACKET_SIZE 28
 
+static_assert(EmptyMessageLayout::packetLength == ERRORACK_PACKET_SIZE, "message without body is 7 words");
+
 class ErrorAckMessage : public ZrtpPacket{
 
     uint8_t dataToSend[ERRORACK_PACKET_SIZE];
@@ -18,12 +18,12 @@ void ErrorMessage::initializeMessageData(){
     initializePacketData(dataToSend);
     initializeMessageHead(dataToSend);
 
-    memcpy(dataToSend + 24, &currentErrorCode, WORD_LENGTH);
-    memcpy(dataToSend + 28, &crc, sizeof(crc));
+    ErrorLayout::ErrorCode::write(dataToSend, &currentErrorCode);
+    ErrorLayout::Crc::write(dataToSend, &crc);
 }
 
 void ErrorMessage::setErrorCode (zrtpErrorCode _currentErrorCode) {
 
     currentErrorCode = _currentErrorCode;
-    memcpy(dataToSend + 24, &currentErrorCode, WORD_LENGTH);
+    ErrorLayout::ErrorCode::write(dataToSend, &currentErrorCode);
 }
@@ -5,6 +5,20 @@
 
 #define ERROR_MESSAGE_LENGTH 32
 
+/**
+ * @brief The ErrorLayout struct describe fields of Error packet.
+ */
+struct ErrorLayout{
+
+    using ErrorCode = NextField<PacketHeadLayout::MessageType, WORD_LENGTH>;
+    using Crc       = NextField<ErrorCode, CRC_LENGTH>;
+
+    static constexpr uint16_t packetLength = Crc::end;
+};
+
+static_assert(ErrorLayout::packetLength == ERROR_MESSAGE_LENGTH, "Error is 8 words");
+static_assert(sizeof(zrtpErrorCode) == WORD_LENGTH, "error code fills one word");
+
 class ErrorMessage : public ZrtpPacket{
 
     uint8_t dataToSend[ERROR_MESSAGE_LENGTH];
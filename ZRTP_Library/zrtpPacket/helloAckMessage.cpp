@@ -17,7 +17,7 @@ void HelloACKmessage::initializeMessageData(){
     initializePacketData(dataToSend);
     initializeMessageHead(dataToSend);
 
-    memcpy(dataToSend + PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH, &crc, sizeof(crc));
+    EmptyMessageLayout::Crc::write(dataToSend, &crc);
 }
 
 
@@ -5,6 +5,8 @@
 
 #define HELLOACK_PACKET_SIZE 28
 
+static_assert(EmptyMessageLayout::packetLength == HELLOACK_PACKET_SIZE, "message without body is 7 words");
+
 /**
  * @brief The HelloACKmessage class represent HelloACK message.
  */
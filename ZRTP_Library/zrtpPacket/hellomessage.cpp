@@ -3,6 +3,8 @@
 
 HelloMessage::HelloMessage(){
     setMessageType((uint8_t *) "Hello   ");
+
+    memset(dataToSend, 0, sizeof(dataToSend));
     setClientID((uint8_t*) "DURCAK______2015");
 
     currentCounts.ac = 0;
@@ -27,28 +29,9 @@ void HelloMessage::initializeMessageData(){
 
     initFlagsAndCounts();
 
-    // Copy the remaining data to dataTosend
-    tempLength += (PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH);
-
-    // Protocol version
-    memcpy(dataToSend + tempLength, protocolVersion, sizeof(protocolVersion));
-    tempLength += sizeof(protocolVersion);
-
-    // client identifier
-    memcpy(dataToSend + tempLength, clientId, CLIENT_IDENTIFIER_LENGTH);
-    tempLength += CLIENT_IDENTIFIER_LENGTH;
-
-    // hash image H3
-    memcpy(dataToSend + tempLength, hashImageH3, HASH_LENGTH_SHA256);
-    tempLength += HASH_LENGTH_SHA256;
-
-    // zid
-    memcpy(dataToSend + tempLength, zid, ZID_LENGTH);
-    tempLength += ZID_LENGTH;
-
-    // flags and counts.
-    memcpy(dataToSend + tempLength, &flagsAndCount, sizeof(flagsAndCount));
-    tempLength += sizeof(flagsAndCount);
+    // Version, client ID, H3 and ZID are set in data already.
+    HelloLayout::FlagsAndCounts::write(dataToSend, &flagsAndCount);
+    tempLength = HelloLayout::algorithmsOffset;
 
     // Copy supported algorithms lists.
     for (int i = 0; i < (WORD_LENGTH * currentCounts.hc); i++){
@@ -76,7 +59,7 @@ void HelloMessage::initializeMessageData(){
         tempLength++;
     }
 
-    tempLength += sizeof(mac);
+    tempLength += MAC_LENGTH;
     memcpy(dataToSend + tempLength, &crc, sizeof(crc));
     tempLength += sizeof(crc);
 
@@ -132,112 +115,124 @@ void HelloMessage::initFlagsAndCounts(){
     flagsAndCount |= temp;
 }
 
-void HelloMessage::setMac(uint8_t *_mac){
-    memcpy(mac, _mac, MAC_LENGTH);
+bool HelloMessage::hasSameProfile(const uint8_t *_messageData, const HelloMessage *_template){
+
+    const uint8_t* templateData = _template->dataToSend;
 
-    // Copy mac to dataTo send (WORD_LENGTH is crc length).
-    memcpy(dataToSend + (getWholePacketLength() - WORD_LENGTH - MAC_LENGTH), _mac, MAC_LENGTH);
+    // Message length.
+    if (memcmp(PacketHeadLayout::Length::in(_messageData), PacketHeadLayout::Length::in(templateData),
+               PacketHeadLayout::Length::length) != 0){
+        return false;
+    }
+
+    if (memcmp(HelloLayout::ProtocolVersion::in(_messageData), HelloLayout::ProtocolVersion::in(templateData),
+               HelloLayout::ProtocolVersion::length) != 0){
+        return false;
+    }
+
+    // Flags, counts and lists of algorithms end with MAC.
+    uint16_t profileLength = _template->getMessageLength() + PACKET_HEAD_LENGTH - HelloLayout::FlagsAndCounts::offset - MAC_LENGTH;
+
+    return memcmp(HelloLayout::FlagsAndCounts::in(_messageData), HelloLayout::FlagsAndCounts::in(templateData),
+                  profileLength) == 0;
+}
+
+void HelloMessage::initializeFromTemplate(const HelloMessage *_template, uint8_t *_hashImageH3, uint8_t *_zid){
+
+    memcpy(dataToSend, _template->dataToSend, sizeof(dataToSend));
+
+    currentCounts = _template->currentCounts;
+    flagsAndCount = _template->flagsAndCount;
+
+    memcpy(hashAlgorithms, _template->hashAlgorithms, sizeof(hashAlgorithms));
+    memcpy(cipherAlgorithms, _template->cipherAlgorithms, sizeof(cipherAlgorithms));
+    memcpy(authTagAlgorithms, _template->authTagAlgorithms, sizeof(authTagAlgorithms));
+    memcpy(keyAgreementTypes, _template->keyAgreementTypes, sizeof(keyAgreementTypes));
+    memcpy(sasTypes, _template->sasTypes, sizeof(sasTypes));
+
+    setMessageLength(_template->getMessageLength() / WORD_LENGTH);
+
+    // Sequence number and source ID belong to this packet.
+    initializePacketData(dataToSend);
+
+    setHashImageH3(_hashImageH3);
+    setZID(_zid);
 }
 
 void HelloMessage::setProtocolVersion(uint8_t *_protocolVersion){
-     memcpy(protocolVersion, _protocolVersion, PROTOCOL_VERSION_LENGTH);
-     memcpy(dataToSend + PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH, _protocolVersion, PROTOCOL_VERSION_LENGTH);
+     HelloLayout::ProtocolVersion::write(dataToSend, _protocolVersion);
 }
 
-zrtpErrorCode HelloMessage::parseHelloMessage(HelloMessage *_messageToFill, uint8_t *_messageData){
+zrtpErrorCode HelloMessage::parseHelloMessage(HelloMessage *_messageToFill, const HelloView &_view){
 
     zrtpErrorCode tempErrorCode = N_ERROR;
 
-    uint16_t tempLength;
-    uint32_t tempFlagsAndCounts;
-    uint16_t p = 0;
-
-    // Copy length, we skip packet head and 2Bytes - preamble.
-    tempLength = *(uint16_t * )( _messageData + PACKET_HEAD_LENGTH + 2);
-    _messageToFill->setMessageLength(tempLength);
-    p += PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH;
+    if (!_view.isValid()){
+        return MALFORMED_PACKET;
+    }
 
-    // Set and check protocol version
-    _messageToFill->setProtocolVersion((_messageData + p));
-    p += WORD_LENGTH;
-    if ((tempErrorCode = checkProtocolVersion()) != N_ERROR){
+    // Check protocol version of peer.
+    _messageToFill->copyReceivedPacket(_messageToFill->dataToSend, _view);
+    if ((tempErrorCode = _messageToFill->checkProtocolVersion()) != N_ERROR){
         return tempErrorCode;
     }
 
-    // Client ID.
-    _messageToFill->setClientID(_messageData + p);
-    p += CLIENT_IDENTIFIER_LENGTH;
-
-    // Hash image H3.
-    _messageToFill->setHashImageH3(_messageData + p);
-    p += HASH_LENGTH_SHA256;
-
-    // ZID,  check Zids if are equal = error code
-    _messageToFill->setZID(_messageData + p);
+    // Check Zids if are equal = error code
     if(memcmp(this->getZID(), _messageToFill->getZID(), ZID_LENGTH) == 0){
         tempErrorCode = EQUALS_ZID_IN_HELLO;
         return tempErrorCode;
     }
-    p += ZID_LENGTH;
-
-    // Flags and count
-    tempFlagsAndCounts = *(uint32_t*) (_messageData + p);
-    setFlagsAndcounts(tempFlagsAndCounts);
 
-    currentCounts.sc = (tempFlagsAndCounts & 0xf);
-    tempFlagsAndCounts >>= 4;
-    currentCounts.kc = (tempFlagsAndCounts & 0xf);
-    tempFlagsAndCounts >>= 4;
-    currentCounts.ac = (tempFlagsAndCounts & 0xf);
-    tempFlagsAndCounts >>= 4;
-    currentCounts.cc = (tempFlagsAndCounts & 0xf);
-    tempFlagsAndCounts >>= 4;
-    currentCounts.hc = (tempFlagsAndCounts & 0xf);
-    tempFlagsAndCounts >>= 4;
+    return tempErrorCode;
+}
 
-    p += WORD_LENGTH;
+zrtpErrorCode HelloMessage::checkProtocolVersion(){
+    zrtpErrorCode tempError = N_ERROR;
+    const uint8_t minVersion[PROTOCOL_VERSION_LENGTH] = {'1', '.', '1', '0'};
 
-    // Copy lists of algorithms.
-    for (int i = 0; i < currentCounts.hc ; i++){
-       _messageToFill->addHashAlgorithm(_messageData + p);
-       p += WORD_LENGTH;
+    if (memcmp(getProtocolVersion(), minVersion, PROTOCOL_VERSION_LENGTH) < 0){
+        return tempError = UNSUPORTED_ZRTP_VERSION;
     }
 
-    for (int i = 0; i < currentCounts.cc ; i++){
-       _messageToFill->addCipherAlgorithm(_messageData + p);
-       p += WORD_LENGTH;
-    }
+    return tempError;
+}
 
-    for (int i = 0; i < currentCounts.ac ; i++){
-       _messageToFill->addAuthTagType(_messageData + p);
-       p += WORD_LENGTH;
-    }
+bool HelloView::isValid() const{
 
-    for (int i = 0; i < currentCounts.kc ; i++){
-       _messageToFill->addKeyAgreementType(_messageData + p);
-       p += WORD_LENGTH;
+    if (!isComplete() || length > HELLO_PACKET_SIZE ||
+        !hasField(HelloLayout::FlagsAndCounts::offset, HelloLayout::FlagsAndCounts::length)){
+        return false;
     }
 
-    for (int i = 0; i < currentCounts.sc ; i++){
-       _messageToFill->addSasType(_messageData + p);
-       p += WORD_LENGTH;
+    counts helloCounts = getHelloCounts();
+    if (helloCounts.hc > MAXIMUM_COUNT_OF_ALGORITHMS || helloCounts.cc > MAXIMUM_COUNT_OF_ALGORITHMS ||
+        helloCounts.ac > MAXIMUM_COUNT_OF_ALGORITHMS || helloCounts.kc > MAXIMUM_COUNT_OF_ALGORITHMS ||
+        helloCounts.sc > MAXIMUM_COUNT_OF_ALGORITHMS){
+        return false;
     }
 
-    _messageToFill->initializeMessageData();
-    _messageToFill->setMac(_messageData + p);
+    // Lists of algorithms are followed by mac and crc.
+    uint32_t algorithmsCount = helloCounts.hc + helloCounts.cc + helloCounts.ac + helloCounts.kc + helloCounts.sc;
 
-    return tempErrorCode;
+    return HelloLayout::packetLength(algorithmsCount) == length;
 }
 
-zrtpErrorCode HelloMessage::checkProtocolVersion(){
-    zrtpErrorCode tempError = N_ERROR;
-    uint8_t* minVersion = new uint8_t[4];
-    memcpy(minVersion, (const char*) "1.10", 4);
+counts HelloView::getHelloCounts() const{
 
-    if (memcmp(protocolVersion, minVersion, 4) < 0){
-        return tempError = UNSUPORTED_ZRTP_VERSION;
-    }
+    counts helloCounts;
+    uint32_t tempFlagsAndCounts;
 
-    delete [] minVersion;
-    return tempError;
+    HelloLayout::FlagsAndCounts::read(data, &tempFlagsAndCounts);
+
+    helloCounts.sc = (tempFlagsAndCounts & 0xf);
+    tempFlagsAndCounts >>= 4;
+    helloCounts.kc = (tempFlagsAndCounts & 0xf);
+    tempFlagsAndCounts >>= 4;
+    helloCounts.ac = (tempFlagsAndCounts & 0xf);
+    tempFlagsAndCounts >>= 4;
+    helloCounts.cc = (tempFlagsAndCounts & 0xf);
+    tempFlagsAndCounts >>= 4;
+    helloCounts.hc = (tempFlagsAndCounts & 0xf);
+
+    return helloCounts;
 }
@@ -12,6 +12,28 @@
 // Maximum value for hc, cc, ac, kc, sc
 #define MAXIMUM_COUNT_OF_ALGORITHMS 7
 
+/**
+ * @brief The HelloLayout struct describe fields of Hello packet. Lists of algorithms have length given by
+ *        counts in flags word, so mac and crc are placed by packetLength() at run time.
+ */
+struct HelloLayout{
+
+    using ProtocolVersion  = NextField<PacketHeadLayout::MessageType, PROTOCOL_VERSION_LENGTH>;
+    using ClientIdentifier = NextField<ProtocolVersion, CLIENT_IDENTIFIER_LENGTH>;
+    using HashImageH3      = NextField<ClientIdentifier, HASH_LENGTH_SHA256>;
+    using Zid              = NextField<HashImageH3, ZID_LENGTH>;
+    using FlagsAndCounts   = NextField<Zid, WORD_LENGTH>;
+
+    static constexpr uint16_t algorithmsOffset = FlagsAndCounts::end;
+
+    static constexpr uint16_t packetLength(uint32_t _algorithmsCount)
+        {return algorithmsOffset + _algorithmsCount * WORD_LENGTH + MAC_LENGTH + CRC_LENGTH;}
+};
+
+static_assert(HelloLayout::FlagsAndCounts::offset == 88, "flags are at word 22 of Hello");
+static_assert(HelloLayout::packetLength(5 * MAXIMUM_COUNT_OF_ALGORITHMS) <= HELLO_PACKET_SIZE,
+              "Hello with all lists full fits Hello buffer");
+
 /*
  This structure represent algorithm counts in hello message,
  which all have 4bit size.
@@ -25,14 +47,38 @@ struct counts{
 };
 
 /**
- * @brief The HelloMessage class represent Hello message.
+ * @brief The HelloView class represent received Hello.
  */
-class HelloMessage : public ZrtpPacket{
+class HelloView : public PacketView{
+
+public:
+
+    HelloView(const uint8_t* _data, uint16_t _length) : PacketView(_data, _length) {}
+
+    /**
+     * @brief isValid check if packet is complete, no list has more than 7 algorithms and lists end
+     *        exactly with mac of message.
+     * @return true if all fields can be read.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief getHelloCounts read counts of algorithms from flags word.
+     * @return structure with algorithm counts.
+     */
+    counts getHelloCounts() const;
+
+    const uint8_t* getProtocolVersion() const {return HelloLayout::ProtocolVersion::in(data);}
+    const uint8_t* getHashImageH3() const {return HelloLayout::HashImageH3::in(data);}
+    const uint8_t* getZID() const {return HelloLayout::Zid::in(data);}
+};
 
-    uint8_t protocolVersion[PROTOCOL_VERSION_LENGTH];
-    uint8_t clientId[CLIENT_IDENTIFIER_LENGTH];
-    uint8_t hashImageH3[HASH_LENGTH_SHA256];
-    uint8_t zid[ZID_LENGTH];
+/**
+ * @brief The HelloMessage class represent Hello message. Version, client ID, H3, ZID, flags, lists of
+ *        algorithms and mac are stored directly in data of packet, received Hello is kept as it came.
+ *        Counts, flags and lists below only collect own algorithms until initializeMessageData().
+ */
+class HelloMessage : public ZrtpPacket{
 
     counts currentCounts;
 
@@ -45,8 +91,6 @@ class HelloMessage : public ZrtpPacket{
     uint8_t keyAgreementTypes [MAXIMUM_COUNT_OF_ALGORITHMS * WORD_LENGTH]; // = "DH mode with p=3072 prime";
     uint8_t sasTypes          [MAXIMUM_COUNT_OF_ALGORITHMS * WORD_LENGTH]; // = "Short authentication string using base 32";
 
-    uint8_t mac[MAC_LENGTH];
-
     uint8_t dataToSend[HELLO_PACKET_SIZE];
 
 public:
@@ -72,32 +116,32 @@ public:
      * @param _clientID new clientID.
      */
     void setClientID (uint8_t* _clientID)
-        {memcpy(clientId, _clientID, CLIENT_IDENTIFIER_LENGTH);}
+        {HelloLayout::ClientIdentifier::write(dataToSend, _clientID);}
 
     /**
      * @brief setHashImage setter for parameter hashImage.
      * @param _hashImage new hash image.
      */
     void setHashImageH3(uint8_t* _hashImage)
-        {memcpy(hashImageH3, _hashImage, HASH_LENGTH_SHA256);}
+        {HelloLayout::HashImageH3::write(dataToSend, _hashImage);}
 
     /**
      * @brief setZID setter for user´s ZID.
      * @param _zid to set.
      */
-    void setZID(uint8_t* _zid) {memcpy(zid, _zid, ZID_LENGTH);}
+    void setZID(uint8_t* _zid) {HelloLayout::Zid::write(dataToSend, _zid);}
 
     /**
-     * @brief setMac is setter for parameter Mac. This function also copy new value to dataToSend.
+     * @brief setMac is setter for parameter Mac, it follows lists of algorithms.
      * @param _mac is mac to be set.
      */
-    void setMac(uint8_t* _mac);
+    void setMac(uint8_t* _mac) {memcpy(getMac(), _mac, MAC_LENGTH);}
 
     /**
      * @brief getMac getter for hello mac.
      * @return mac.
      */
-    uint8_t* getMac() {return mac;}
+    uint8_t* getMac() {return dataToSend + getWholePacketLength() - WORD_LENGTH - MAC_LENGTH;}
 
     /**
      * @brief setFlagsAndcounts setter for parameter flags and counts.
@@ -154,61 +198,62 @@ public:
      * @brief getProtocolVersion getter for protocol version.
      * @return protocol version.
      */
-    uint8_t * getProtocolVersion () {return protocolVersion;}
+    uint8_t * getProtocolVersion () {return HelloLayout::ProtocolVersion::in(dataToSend);}
 
     /**
      * @brief getClientIdentifier getter for client ID.
      * @return  client identifier.
      */
-    uint8_t * getClientIdentifier() {return clientId;}
+    uint8_t * getClientIdentifier() {return HelloLayout::ClientIdentifier::in(dataToSend);}
 
     /**
      * @brief getHashImageH3 getter for hashImage H3.
      * @return hashImageH3.
      */
-    uint8_t * getHashImageH3() {return hashImageH3;}
+    uint8_t * getHashImageH3() {return HelloLayout::HashImageH3::in(dataToSend);}
 
     /**
      * @brief getZID getter for parameter Zid.
      * @return zid.
      */
-    uint8_t * getZID() {return zid;}
+    uint8_t * getZID() {return HelloLayout::Zid::in(dataToSend);}
 
     /**
      * @brief getHelloData getter for hello data.
      * @return data to send.
      */
     uint8_t* getHelloData() {return dataToSend;}
+    const uint8_t* getHelloData() const {return dataToSend;}
 
     /**
      * @brief getHashAlgorithms getter for hash algorithms.
      * @return hash algorithms.
      */
-    uint8_t* getHashAlgorithms(){return hashAlgorithms;}
+    uint8_t* getHashAlgorithms(){return dataToSend + HelloLayout::algorithmsOffset;}
 
     /**
      * @brief getCipherAlgorithms getter for cipher algorithms.
      * @return cipher algorithms.
      */
-    uint8_t* getCipherAlgorithms(){return cipherAlgorithms;}
+    uint8_t* getCipherAlgorithms(){return getHashAlgorithms() + getHelloCounts().hc * WORD_LENGTH;}
 
     /**
      * @brief getAuthTagTypes getter for auth tagTypes.
      * @return auth tag types.
      */
-    uint8_t* getAuthTagTypes() {return authTagAlgorithms;}
+    uint8_t* getAuthTagTypes() {return getCipherAlgorithms() + getHelloCounts().cc * WORD_LENGTH;}
 
     /**
      * @brief getKeyAgreementTypes getter for key agreement types.
      * @return key agreement types.
      */
-    uint8_t* getKeyAgreementTypes() {return keyAgreementTypes;}
+    uint8_t* getKeyAgreementTypes() {return getAuthTagTypes() + getHelloCounts().ac * WORD_LENGTH;}
 
     /**
      * @brief getSasTypes getter for sas types.
      * @return sas types.
      */
-    uint8_t* getSasTypes() {return sasTypes;}
+    uint8_t* getSasTypes() {return getKeyAgreementTypes() + getHelloCounts().kc * WORD_LENGTH;}
 
     /**
      * @brief initFlagsAndCounts copy flags and current counts to one variable, so they
@@ -217,13 +262,30 @@ public:
     void initFlagsAndCounts();
 
     /**
-     * @brief parseHelloMessage parse and check received hello message and fill new message with correct data.
+     * @brief hasSameProfile check if hello offers same version, flags and algorithms as template.
+     * @param _messageData data of hello packet.
+     * @param _template serialized hello of capability profile.
+     * @return true if profile of hello is equal to template.
+     */
+    static bool hasSameProfile(const uint8_t* _messageData, const HelloMessage* _template);
+
+    /**
+     * @brief initializeFromTemplate build hello from serialized hello of same capability profile.
+     *        Wire image is copied and only packet head, H3 and ZID are written, MAC is set later.
+     * @param _template serialized hello of capability profile.
+     * @param _hashImageH3 hash image H3 of session.
+     * @param _zid ZID of endpoint.
+     */
+    void initializeFromTemplate(const HelloMessage* _template, uint8_t* _hashImageH3, uint8_t* _zid);
+
+    /**
+     * @brief parseHelloMessage check received hello message and store it in new message, its fields are
+     *        read in place.
      * @param _messageToFill message to fill.
-     * @param _messageData received data.
-     * @param length of received message
+     * @param _view view of received data.
      * @return EQUAL_ZID, MALFORMED_PACKET or NOT SUPORTET VERSION error if occured or N_ERROR if parse is OK.
      */
-    zrtpErrorCode parseHelloMessage(HelloMessage* _messageToFill, uint8_t* _messageData);
+    zrtpErrorCode parseHelloMessage(HelloMessage* _messageToFill, const HelloView& _view);
 
     /**
      * @brief checkProtocolVersion check if version is not less than 1.10.
@@ -233,10 +295,13 @@ public:
 
     /**
      * @brief getHelloCounts getter for helloCounts.
-     * @return structure with algorithm counts stored in hello message.
+     * @return structure with algorithm counts stored in hello data.
      */
-    counts getHelloCounts() {return currentCounts;}
+    counts getHelloCounts() const {return HelloView(dataToSend, HELLO_PACKET_SIZE).getHelloCounts();}
 
+    /**
+     * @brief initializeMessageData copy heads, flags, lists of algorithms and CRC to data and set length.
+     */
     virtual void initializeMessageData();
 };
 
@@ -0,0 +1,60 @@
+#include "zrtpPacket/hellotemplatecache.h"
+
+HelloTemplateCache::HelloTemplateCache(){
+
+    templatesCount.store(0);
+}
+
+HelloTemplateCache::~HelloTemplateCache(){
+
+    for (unsigned int i = 0; i < templatesCount.load(); i++){
+        delete templates[i];
+    }
+}
+
+const HelloMessage* HelloTemplateCache::share(const HelloMessage *_hello){
+
+    const HelloMessage* helloTemplate = find(_hello->getHelloData());
+    if (helloTemplate != nullptr){
+        return helloTemplate;
+    }
+
+    std::lock_guard<ProfiledMutex> lock(cacheMutex);
+
+    // Other session could store same profile meanwhile.
+    unsigned int count = templatesCount.load();
+    for (unsigned int i = 0; i < count; i++){
+        if (HelloMessage::hasSameProfile(_hello->getHelloData(), templates[i])){
+            return templates[i];
+        }
+    }
+
+    if (count == HELLO_TEMPLATES_MAX){
+        return nullptr;
+    }
+
+    // Template is written before count is published, find() sees only complete templates.
+    templates[count] = new HelloMessage(*_hello);
+    templatesCount.store(count + 1, std::memory_order_release);
+
+    return templates[count];
+}
+
+const HelloMessage* HelloTemplateCache::find(const uint8_t *_messageData){
+
+    unsigned int count = templatesCount.load(std::memory_order_acquire);
+
+    for (unsigned int i = 0; i < count; i++){
+        if (HelloMessage::hasSameProfile(_messageData, templates[i])){
+            return templates[i];
+        }
+    }
+
+    return nullptr;
+}
+
+HelloTemplateCache& HelloTemplateCache::getInstance(){
+
+    static HelloTemplateCache templateCache;
+    return templateCache;
+}
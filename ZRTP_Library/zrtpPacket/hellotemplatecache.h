@@ -0,0 +1,55 @@
+#ifndef HELLOTEMPLATECACHE_H
+#define HELLOTEMPLATECACHE_H
+
+#include "hellomessage.h"
+#include "lockprofiler.h"
+#include <atomic>
+
+// Count of capability profiles whose hello is kept, hello of other profiles is built as before.
+#define HELLO_TEMPLATES_MAX 16
+
+/**
+ * @brief The HelloTemplateCache class keep serialized hello for every capability profile (version,
+ *        flags and algorithms) used in process. Hellos of one profile differ only in packet head, H3,
+ *        ZID and MAC, so session copies template instead of building hello again. Templates are
+ *        immutable and live until process ends, find() does not lock.
+ */
+class HelloTemplateCache{
+
+    const HelloMessage* templates[HELLO_TEMPLATES_MAX];
+    std::atomic<unsigned int> templatesCount;
+
+    ProfiledMutex cacheMutex{HELLO_TEMPLATE_LOCK};
+
+    HelloTemplateCache();
+
+public:
+
+    ~HelloTemplateCache();
+
+    HelloTemplateCache(const HelloTemplateCache&) = delete;
+    HelloTemplateCache& operator=(const HelloTemplateCache&) = delete;
+
+    /**
+     * @brief share find template of same profile as given hello, copy of hello is stored as new
+     *        template if profile is not known.
+     * @param _hello initialized hello of profile, H3, ZID and MAC are not used.
+     * @return template of profile, nullptr if cache is full.
+     */
+    const HelloMessage* share(const HelloMessage* _hello);
+
+    /**
+     * @brief find find template of profile of hello.
+     * @param _messageData data of hello packet.
+     * @return template of profile, nullptr if profile is not known.
+     */
+    const HelloMessage* find(const uint8_t* _messageData);
+
+    /**
+     * @brief getInstance getter for cache shared by all sessions.
+     * @return hello template cache.
+     */
+    static HelloTemplateCache& getInstance();
+};
+
+#endif // HELLOTEMPLATECACHE_H
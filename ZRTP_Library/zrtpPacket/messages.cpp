@@ -1,39 +1,41 @@
 #include "zrtpPacket/messages.h"
 
-MESSAGE_TYPE decryptMessage(const char *data){
-    char messageType[8];
-
-    memcpy(messageType, data + 16, 8);
-
-    std::string messageTypeString (messageType);
-
-    //std::cout << messageTypeString << std::endl;
-
-    if (messageTypeString.compare("Hello   ") == 0){
-        //std::cout << "HELLO SPRAVA PRIJATA !!!! " << std::endl;
-        return HELLO_MESSAGE;
-    }
-
-    if (messageTypeString.compare("HelloACK") == 0){
-        //std::cout << "HELLO ACK SPRAVA PRIJATA !!!! " << std::endl;
-        return HELLO_ACK_MESSAGE;
-    }
-
-    if (messageTypeString.compare("Commit  ") == 0){
-        //std::cout << "COMMIT SPRAVA PRIJATA !!!! " << std::endl;
-        return COMMIT_MESSAGE;
+// Indexed by MESSAGE_TYPE.
+static const char* const messageTypeStrings[MESSAGE_TYPES_COUNT] = {
+    "Hello   ",
+    "HelloACK",
+    "Commit  ",
+    "DHPart1 ",
+    "DHPart2 ",
+    "Confirm1",
+    "Confirm2",
+    "Conf2ACK",
+    "Error   ",
+    "ErrorACK",
+    "        "
+};
+
+MESSAGE_TYPE classifyMessageType(const uint8_t *_messageType){
+
+    // Compiler merges byte loads to one 64 bit load.
+    uint64_t word = messageTypeWord((const char*) _messageType);
+
+    switch (word){
+        case messageTypeWord("Hello   "): return HELLO_MESSAGE;
+        case messageTypeWord("HelloACK"): return HELLO_ACK_MESSAGE;
+        case messageTypeWord("Commit  "): return COMMIT_MESSAGE;
+        case messageTypeWord("DHPart1 "): return DHPART1_MESSAGE;
+        case messageTypeWord("DHPart2 "): return DHPART2_MESSAGE;
+        case messageTypeWord("Confirm1"): return CONFIRM1_MESSAGE;
+        case messageTypeWord("Confirm2"): return CONFIRM2_MESSAGE;
+        case messageTypeWord("Conf2ACK"): return CONF_ACK_MESSAGE;
+        case messageTypeWord("Error   "): return ERROR_MESSAGE;
+        case messageTypeWord("ErrorACK"): return ERROR_ACK_MESSAGE;
+        default: return UNKNOWN_MESSAGE;
     }
+}
 
-    if (messageTypeString.compare("DHPart1 ") == 0){
-        //std::cout << "DHPART1 SPRAVA PRIJATA !!!! " << std::endl;
-        return DHPART1_MESSAGE;
-    }
+const char* messageTypeString(MESSAGE_TYPE _messageType){
 
-    if (messageTypeString.compare("DHPart2 ") == 0){
-        //std::cout << "DHPART2 SPRAVA PRIJATA !!!! " << std::endl;
-        return DHPART2_MESSAGE;
-    }   else {
-            //std::cout << "NEZNAMA SPRAVA PRIJATA !!!! " << std::endl;
-            return UNKNOWN_MESSAGE;
-        }
+    return messageTypeStrings[(_messageType < UNKNOWN_MESSAGE) ? _messageType : UNKNOWN_MESSAGE];
 }
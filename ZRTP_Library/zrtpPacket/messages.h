@@ -25,4 +25,33 @@ enum MESSAGE_TYPE {
     UNKNOWN_MESSAGE
 };
 
+#define MESSAGE_TYPES_COUNT (UNKNOWN_MESSAGE + 1)
+
+/**
+ * @brief messageTypeWord pack 8 characters of message type to integer, first character is lowest byte.
+ * @param _messageType 8 characters of message type.
+ * @return packed message type.
+ */
+constexpr uint64_t messageTypeWord(const char* _messageType){
+    return  (uint64_t) (uint8_t) _messageType[0]        | (uint64_t) (uint8_t) _messageType[1] << 8  |
+            (uint64_t) (uint8_t) _messageType[2] << 16  | (uint64_t) (uint8_t) _messageType[3] << 24 |
+            (uint64_t) (uint8_t) _messageType[4] << 32  | (uint64_t) (uint8_t) _messageType[5] << 40 |
+            (uint64_t) (uint8_t) _messageType[6] << 48  | (uint64_t) (uint8_t) _messageType[7] << 56;
+}
+
+/**
+ * @brief classifyMessageType find type of message from 8 characters of message type in packet.
+ *        Message type is loaded as one 64 bit word and compared with known types.
+ * @param _messageType pointer to message type in packet.
+ * @return type of message or UNKNOWN_MESSAGE.
+ */
+MESSAGE_TYPE classifyMessageType(const uint8_t* _messageType);
+
+/**
+ * @brief messageTypeString getter for 8 characters of message type which is sent in packet.
+ * @param _messageType type of message.
+ * @return 8 characters of message type (not terminated), spaces for UNKNOWN_MESSAGE.
+ */
+const char* messageTypeString(MESSAGE_TYPE _messageType);
+
 #endif // MESSAGES_H
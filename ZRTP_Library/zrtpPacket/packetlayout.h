@@ -0,0 +1,73 @@
+#ifndef PACKETLAYOUT_H
+#define PACKETLAYOUT_H
+
+#include "zrtpMessageHeader.h"
+#include "crc32c.h"
+
+/**
+ * @brief The PacketField struct describe one field of packet. Offset and length are known to compiler,
+ *        so reading and writing of field is one copy of constant size at constant offset.
+ */
+template <uint16_t Offset, uint16_t Length>
+struct PacketField{
+
+    static constexpr uint16_t offset = Offset;
+    static constexpr uint16_t length = Length;
+    static constexpr uint16_t end = Offset + Length;
+
+    /**
+     * @brief in pointer to field in packet.
+     * @param _packet data of packet.
+     * @return beginning of field.
+     */
+    static uint8_t* in(uint8_t* _packet) {return _packet + offset;}
+    static const uint8_t* in(const uint8_t* _packet) {return _packet + offset;}
+
+    /**
+     * @brief write copy value of field length to packet.
+     * @param _packet data of packet.
+     * @param _value new value of field.
+     */
+    static void write(uint8_t* _packet, const void* _value) {memcpy(_packet + offset, _value, length);}
+
+    /**
+     * @brief read copy value of field length from packet.
+     * @param _packet data of packet.
+     * @param _value buffer for value of field.
+     */
+    static void read(const uint8_t* _packet, void* _value) {memcpy(_value, _packet + offset, length);}
+};
+
+// Field which starts right after previous field.
+template <typename Previous, uint16_t Length>
+using NextField = PacketField<Previous::end, Length>;
+
+/**
+ * @brief The PacketHeadLayout struct describe packet head and message head, which are same for all messages.
+ */
+struct PacketHeadLayout{
+
+    using Head           = PacketField<0, sizeof(uint16_t)>;
+    using SequenceNumber = NextField<Head, sizeof(uint16_t)>;
+    using MagicCookie    = NextField<SequenceNumber, WORD_LENGTH>;
+    using SourceId       = NextField<MagicCookie, sizeof(uint32_t)>;
+
+    using Preamble       = NextField<SourceId, sizeof(uint16_t)>;
+    using Length         = NextField<Preamble, sizeof(uint16_t)>;
+    using MessageType    = NextField<Length, MESSAGE_TYPE_LENGTH>;
+};
+
+static_assert(PacketHeadLayout::SourceId::end == PACKET_HEAD_LENGTH, "packet head is 3 words");
+static_assert(PacketHeadLayout::MessageType::end == PACKET_HEAD_LENGTH + MESSAGE_HEAD_LENGTH, "message head is 3 words");
+
+/**
+ * @brief The EmptyMessageLayout struct describe message without body (HelloACK, Conf2ACK, ErrorACK).
+ */
+struct EmptyMessageLayout{
+
+    using Crc = NextField<PacketHeadLayout::MessageType, CRC_LENGTH>;
+
+    static constexpr uint16_t packetLength = Crc::end;
+};
+
+#endif // PACKETLAYOUT_H
@@ -0,0 +1,75 @@
+#include "zrtpPacket/packetvalidator.h"
+#include <bit>
+
+// First two words of packet, sequence number differs in every packet.
+struct PacketHeadWords{
+    uint16_t head;
+    uint16_t sequenceNumber;
+    uint8_t magicCookie[WORD_LENGTH];
+};
+
+// First word of message head, length is compared with datagram separately.
+struct MessageHeadWord{
+    uint16_t preamble;
+    uint16_t length;
+};
+
+static_assert(sizeof(PacketHeadWords) == PacketHeadLayout::SourceId::offset, "packet head words have no padding");
+static_assert(sizeof(MessageHeadWord) == PacketHeadLayout::MessageType::offset - PacketHeadLayout::Preamble::offset,
+              "message head word has no padding");
+
+// Expected words are built in byte order of packet, so one compare checks head and cookie on every host.
+static constexpr uint64_t packetHeadExpected = std::bit_cast<uint64_t>(PacketHeadWords{ZRTP_PACKET_HEAD, 0, {'Z', 'R', 'T', 'P'}});
+static constexpr uint64_t packetHeadMask = std::bit_cast<uint64_t>(PacketHeadWords{0xffff, 0, {0xff, 0xff, 0xff, 0xff}});
+
+static constexpr uint32_t preambleExpected = std::bit_cast<uint32_t>(MessageHeadWord{ZRTP_MESSAGE_PREAMBLE, 0});
+static constexpr uint32_t preambleMask = std::bit_cast<uint32_t>(MessageHeadWord{0xffff, 0});
+
+struct LengthLimits{
+    uint16_t minimum;
+    uint16_t maximum;
+};
+
+// Indexed by MESSAGE_TYPE, UNKNOWN_MESSAGE accepts no length.
+static constexpr LengthLimits lengthLimits[MESSAGE_TYPES_COUNT] = {
+    {HelloLayout::packetLength(0), HelloLayout::packetLength(5 * MAXIMUM_COUNT_OF_ALGORITHMS)},
+    {EmptyMessageLayout::packetLength, EmptyMessageLayout::packetLength},
+    {CommitLayout::packetLength, CommitLayout::packetLength},
+    {DHPartLayout::packetLength(EC25_PUBLIC_KEY_LENGTH), DHPartLayout::packetLength(DH3K_PUBLIC_KEY_LENGTH)},
+    {DHPartLayout::packetLength(EC25_PUBLIC_KEY_LENGTH), DHPartLayout::packetLength(DH3K_PUBLIC_KEY_LENGTH)},
+    {ConfirmLayout::packetLength, ConfirmLayout::packetLength},
+    {ConfirmLayout::packetLength, ConfirmLayout::packetLength},
+    {EmptyMessageLayout::packetLength, EmptyMessageLayout::packetLength},
+    {ErrorLayout::packetLength, ErrorLayout::packetLength},
+    {EmptyMessageLayout::packetLength, EmptyMessageLayout::packetLength},
+    {UINT16_MAX, 0}
+};
+
+static_assert(DHPartLayout::packetLength(DH3K_PUBLIC_KEY_LENGTH) == MAXIMUM_PACKET_LENGTH, "DHPart of DH3k is longest packet");
+
+MESSAGE_TYPE validatePacket(const uint8_t *_data, size_t _length){
+
+    // Shortest packet is message without body, every word read below lies inside it.
+    if (_length < EmptyMessageLayout::packetLength || _length > MAXIMUM_PACKET_LENGTH){
+        return UNKNOWN_MESSAGE;
+    }
+
+    uint64_t packetHead;
+    uint32_t messageHead;
+    uint16_t declaredLength;
+
+    memcpy(&packetHead, _data, sizeof(packetHead));
+    memcpy(&messageHead, PacketHeadLayout::Preamble::in(_data), sizeof(messageHead));
+    PacketHeadLayout::Length::read(_data, &declaredLength);
+
+    MESSAGE_TYPE messageType = classifyMessageType(PacketHeadLayout::MessageType::in(_data));
+    const LengthLimits& limits = lengthLimits[messageType];
+
+    // Conditions are combined without short circuit, junk packet costs same few compares as valid one.
+    bool valid = ((packetHead & packetHeadMask) == packetHeadExpected) &
+                 ((messageHead & preambleMask) == preambleExpected) &
+                 ((size_t) (declaredLength * WORD_LENGTH + PACKET_WITHOUT_MESSAGE_LENGTH) == _length) &
+                 (_length >= limits.minimum) & (_length <= limits.maximum);
+
+    return valid ? messageType : UNKNOWN_MESSAGE;
+}
@@ -0,0 +1,19 @@
+#ifndef PACKETVALIDATOR_H
+#define PACKETVALIDATOR_H
+
+#include "messages.h"
+
+// Longest packet engine accepts is DHPart with DH3k public value.
+#define MAXIMUM_PACKET_LENGTH DH3K_PACKET_SIZE
+
+/**
+ * @brief validatePacket check received datagram before it is passed to ZRTP point. Packet head, magic
+ *        cookie, preamble, declared length and length limits of message type are checked by few word
+ *        compares, fields of message are checked later by view of message.
+ * @param _data received datagram.
+ * @param _length length of datagram.
+ * @return type of message, UNKNOWN_MESSAGE if datagram is not ZRTP packet of known type and length.
+ */
+MESSAGE_TYPE validatePacket(const uint8_t* _data, size_t _length);
+
+#endif // PACKETVALIDATOR_H
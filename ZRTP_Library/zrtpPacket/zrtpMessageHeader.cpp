@@ -1,10 +1,11 @@
 #include "zrtpPacket/zrtpMessageHeader.h"
+#include "zrtpPacket/packetlayout.h"
 
 void ZrtpMessageHeader::initializeMessageHead(uint8_t *_data) {
 
-    memcpy(_data + PACKET_HEAD_LENGTH, &preamble, sizeof(preamble));
-    memcpy(_data + PACKET_HEAD_LENGTH + sizeof(preamble), &messageLength, sizeof(messageLength));
-    memcpy(_data + PACKET_HEAD_LENGTH + sizeof(preamble) + sizeof(messageLength), messageType, sizeof(messageType));
+    PacketHeadLayout::Preamble::write(_data, &preamble);
+    PacketHeadLayout::Length::write(_data, &messageLength);
+    PacketHeadLayout::MessageType::write(_data, messageType);
 }
 
 ZrtpMessageHeader::ZrtpMessageHeader(){
@@ -22,6 +22,10 @@
 // Include length of preamble, length and message type.
 #define MESSAGE_HEAD_LENGTH 12
 
+// The 0001 and 12 zero bits at begining of packet and preamble of message.
+#define ZRTP_PACKET_HEAD 0x1000
+#define ZRTP_MESSAGE_PREAMBLE 0x505a
+
 typedef unsigned char uint8_t;
 typedef unsigned short int uint16_t;
 typedef unsigned int uint32_t;
@@ -31,7 +35,7 @@ typedef unsigned int uint32_t;
  */
 class ZrtpMessageHeader {
 
-    const uint16_t preamble = 0x505a;
+    const uint16_t preamble = ZRTP_MESSAGE_PREAMBLE;
 
     uint16_t messageLength;
 
@@ -71,7 +75,7 @@ public:
      * @brief getMessageLength is getter for param length.
      * @return length of message.
      */
-    uint16_t getMessageLength() {return messageLength;}
+    uint16_t getMessageLength() const {return messageLength;}
 
     /**
      * @brief initializeMessageHead copy message head to data.
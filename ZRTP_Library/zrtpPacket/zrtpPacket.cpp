@@ -1,37 +1,52 @@
 #include "zrtpPacket/zrtpPacket.h"
 
 ZrtpPacket::ZrtpPacket(){
-    messageHeader = new ZrtpMessageHeader();
 
     srand (time(NULL));
     sequenceNumber = rand() % USHRT_MAX;
     sourceId = rand () % ULONG_MAX;
 
     memcpy(magicCookie, (const char*) "ZRTP", sizeof(magicCookie));
-    crc = 1111;
+    crc = 0;
 }
 
 ZrtpPacket::~ZrtpPacket(){
-    delete messageHeader;
 }
 
 void ZrtpPacket::initializePacketData(uint8_t *_data){
 
-    uint16_t p = 0;
+    PacketHeadLayout::Head::write(_data, &packetHead);
+    PacketHeadLayout::SequenceNumber::write(_data, &sequenceNumber);
+    PacketHeadLayout::MagicCookie::write(_data, magicCookie);
+    PacketHeadLayout::SourceId::write(_data, &sourceId);
+}
 
-    // PacketHead
-    memcpy(_data,  &packetHead, sizeof(packetHead));
-    p += sizeof(packetHead);
+void ZrtpPacket::copyReceivedPacket(uint8_t *_data, const PacketView &_view){
 
-    // Sequence number
-    memcpy(_data + p, &sequenceNumber, sizeof(sequenceNumber));
-    p += sizeof(sequenceNumber);
+    memcpy(_data, _view.getData(), _view.getLength());
 
-    // Magic cookie
-    memcpy(_data + p, &magicCookie, sizeof(magicCookie));
-    p += sizeof(magicCookie);
+    PacketHeadLayout::SequenceNumber::read(_view.getData(), &sequenceNumber);
+    PacketHeadLayout::SourceId::read(_view.getData(), &sourceId);
 
-    // Source ID
-    memcpy(_data + p , &sourceId, sizeof(sourceId));
+    setMessageType((uint8_t*) _view.getMessageType());
+    setMessageLength(_view.getMessageLength() / WORD_LENGTH);
 }
 
+uint16_t PacketView::getMessageLength() const{
+
+    uint16_t messageLength;
+
+    if (!hasField(0, PacketHeadLayout::MessageType::end)){
+        return 0;
+    }
+
+    PacketHeadLayout::Length::read(data, &messageLength);
+
+    return messageLength * WORD_LENGTH;
+}
+
+bool PacketView::isComplete() const{
+
+    return hasField(0, PacketHeadLayout::MessageType::end) &&
+           (uint32_t) getMessageLength() + PACKET_WITHOUT_MESSAGE_LENGTH == length;
+}
@@ -2,19 +2,88 @@
 #define ZRTPPACKET_H
 
 #include "zrtpMessageHeader.h"
+#include "packetlayout.h"
 
 #define HASH_LENGTH_SHA256 32
 #define ZID_LENGTH 12
 #define MAC_LENGTH 8
 #define PACKET_WITHOUT_MESSAGE_LENGTH 16
 
+/**
+ * @brief The PacketView class represent read-only view of received ZRTP packet. Fields are read in place
+ *        at their offsets, nothing is copied. Views of messages check once that all fields lie inside
+ *        received data, their getters are valid only after that check passed.
+ */
+class PacketView{
+
+protected:
+
+    const uint8_t* data;
+    uint16_t length;
+
+public:
+
+    /**
+     * @brief PacketView constructor for view of received data.
+     * @param _data received packet, it must outlive view.
+     * @param _length length of received packet.
+     */
+    PacketView(const uint8_t* _data, uint16_t _length) : data(_data), length(_length) {}
+
+    /**
+     * @brief getData getter for received packet.
+     * @return data of packet.
+     */
+    const uint8_t* getData() const {return data;}
+
+    /**
+     * @brief getLength getter for length of received packet.
+     * @return length in bytes.
+     */
+    uint16_t getLength() const {return length;}
+
+    /**
+     * @brief hasField check if field lies inside received packet.
+     * @param _offset offset of field from beginning of packet.
+     * @param _fieldLength length of field.
+     * @return true if whole field was received.
+     */
+    bool hasField(uint16_t _offset, uint16_t _fieldLength) const
+        {return data != nullptr && (uint32_t) _offset + _fieldLength <= length;}
+
+    /**
+     * @brief getMessageLength read length of message from message head.
+     * @return length of message in bytes, 0 if message head was not received.
+     */
+    uint16_t getMessageLength() const;
+
+    /**
+     * @brief isComplete check if packet has both heads and exactly message length given by message head.
+     * @return true if packet is complete.
+     */
+    bool isComplete() const;
+
+    /**
+     * @brief hasLayout check if packet is complete and has length of message with fixed layout.
+     * @return true if all fields of layout can be read.
+     */
+    template <typename Layout>
+    bool hasLayout() const {return isComplete() && length == Layout::packetLength;}
+
+    /**
+     * @brief getMessageType getter for 8 characters of message type.
+     * @return message type, valid only for complete packet.
+     */
+    const uint8_t* getMessageType() const {return PacketHeadLayout::MessageType::in(data);}
+};
+
 /**
  * @brief The ZrtpPacket class is base class for all ZRTP messages.
  */
 class ZrtpPacket{
 
     // The 0001 and 12 zero bits at begining of packet.
-    const uint16_t packetHead = 0x1000;
+    const uint16_t packetHead = ZRTP_PACKET_HEAD;
 
     //The Sequence Number is a count that is incremented for each ZRTP packet sent.
     uint16_t sequenceNumber;
@@ -25,15 +94,23 @@ class ZrtpPacket{
     // Source Identifier is the SSRC number of the RTP stream to which this ZRTP packet relates.
     uint32_t sourceId;
 
-    // Header of message.
-    ZrtpMessageHeader* messageHeader;
+    // Header of message, it is part of packet, so packet needs no extra allocation.
+    ZrtpMessageHeader messageHeader;
 
 protected:
 
-    // The CRC is calculated across the entire ZRTP packet.
-    // We Do not calculate crc in this implementation, so it is set to default value in constructor.
+    // The CRC is calculated across the entire ZRTP packet. Messages reserve its place, it is computed
+    // when packet is sent (see setPacketCrc()), because MAC of message is set after initialization.
     uint32_t crc;
 
+    /**
+     * @brief copyReceivedPacket store received packet as data of message. Fields of message are then
+     *        read from these data in place, so packet is not parsed and serialized again.
+     * @param _data data of message, it must be big enough for validated packet.
+     * @param _view validated view of received packet.
+     */
+    void copyReceivedPacket(uint8_t* _data, const PacketView& _view);
+
 public:
 
     /**
@@ -86,37 +163,37 @@ public:
      * @brief setMessageLength setter for message length.
      * @param _length new length to set.
      */
-    void setMessageLength(uint16_t _length) {messageHeader->setMessageLength(_length);}
+    void setMessageLength(uint16_t _length) {messageHeader.setMessageLength(_length);}
 
     /**
      * @brief setMessageType setter for message type.
      * @param _messageType new message type to set.
      */
-    void setMessageType(uint8_t * _messageType) {messageHeader->setMessageType(_messageType);}
+    void setMessageType(uint8_t * _messageType) {messageHeader.setMessageType(_messageType);}
 
     /**
      * @brief getMessageType getter for message type.
      * @return type of message.
      */
-    uint8_t* getMessageType() {return messageHeader->getMessageType();}
+    uint8_t* getMessageType() {return messageHeader.getMessageType();}
 
     /**
      * @brief getMessageLength getter for message length.
      * @return length of message in  in WORDS.
      */
-    uint16_t getMessageLength() {return messageHeader->getMessageLength() * WORD_LENGTH ;}
+    uint16_t getMessageLength() const {return messageHeader.getMessageLength() * WORD_LENGTH ;}
 
     /**
      * @brief getWholePacketLength return length of whole packet.
      * @return packet length.
      */
-    uint16_t getWholePacketLength(){return (getMessageLength() + PACKET_WITHOUT_MESSAGE_LENGTH);}
+    uint16_t getWholePacketLength() const {return (getMessageLength() + PACKET_WITHOUT_MESSAGE_LENGTH);}
 
     /**
      * @brief initializeMessageHead initialize message head.
      * @param _data data to be initialized.
      */
-    void initializeMessageHead(uint8_t* _data) {messageHeader->initializeMessageHead(_data);}
+    void initializeMessageHead(uint8_t* _data) {messageHeader.initializeMessageHead(_data);}
 
     /**
      * @brief initializeHead copy head to message`s data.
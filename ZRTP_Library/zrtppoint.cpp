@@ -1,18 +1,122 @@
 #include "zrtppoint.h"
+#include "zrtpPacket/hellotemplatecache.h"
+#include "zrtpPacket/crc32c.h"
+#include "zrtpPacket/packetvalidator.h"
+
+// Every message of handshake and negotiated algorithms fit to first block of arena.
+static_assert(2 * sizeof(HelloMessage) + sizeof(HelloACKmessage) + sizeof(CommitMessage) + 2 * sizeof(DHPart) +
+              2 * sizeof(ConfirmMessage) + sizeof(Conf2AckMessage) + sizeof(ErrorMessage) +
+              sizeof(ErrorAckMessage) + MAX_ALGORITHM_COUNT * sizeof(const char*) <= SESSION_ARENA_SIZE,
+              "Handshake messages do not fit to SESSION_ARENA_SIZE");
+
+// Slabs are shared by all sessions, released handshake state is zeroised by its slab.
+static SlabAllocator& sessionSlab(){
+    static SlabAllocator slab(sizeof(ZrtpPoint));
+    return slab;
+}
 
-ZrtpPoint::ZrtpPoint(role _role, Callbacks *_callbacks){
+static SlabAllocator& handshakeSlab(){
+    static SlabAllocator slab(sizeof(HandshakeState), true);
+    return slab;
+}
 
-    setRole(_role);
-    zrtpPointCallbacks = _callbacks;
-    engine = new StateMachine(this);
+// Secrets are kept in locked memory, which is never swapped out nor written to core dump.
+static SecurePool& keyMaterialPool(){
+    static SecurePool pool(sizeof(srtpKeyMaterial));
+    return pool;
+}
+
+static SecurePool& handshakeSecretsPool(){
+    static SecurePool pool(sizeof(HandshakeSecrets));
+    return pool;
+}
+
+HandshakeState::HandshakeState(std::pmr::memory_resource *_memoryResource) :
+    arena(_memoryResource){
+
+    secrets = (HandshakeSecrets*) handshakeSecretsPool().allocate();
 
     // Init all polar SSL contexts
     sha256_init(&sha256Context);
-    dhm_init( &dhmContext );
-    entropy_init( &entropyContext );
+    dhm_init( &secrets->dhmContext );
+    entropy_init( &secrets->entropyContext );
+
+    negotiatedKeySize = 0;
+    lastSentMessageData = nullptr;
+    lastSentMessageLength = 0;
+    lastSentMessageLeased = false;
+    memset (hvi,0,HVI_LENGTH);
+
+    publicValueReady = false;
+    negotiationStarted = false;
+}
+
+HandshakeState::~HandshakeState(){
+
+    sha256_free(&sha256Context);
+    ctr_drbg_free(&secrets->ctrDrbgContext);
+    entropy_free(&secrets->entropyContext);
+    dhm_free(&secrets->dhmContext);
+    aes_free(&secrets->aesContext);
+
+    handshakeSecretsPool().release(secrets);
+}
+
+void* HandshakeState::operator new(size_t _size){
+
+    return handshakeSlab().allocate(_size);
+}
+
+void HandshakeState::operator delete(void *_state, size_t _size){
+
+    handshakeSlab().release(_state, _size);
+}
+
+void* ZrtpPoint::operator new(size_t _size){
+
+    return sessionSlab().allocate(_size);
+}
+
+void ZrtpPoint::operator delete(void *_session, size_t _size){
+
+    sessionSlab().release(_session, _size);
+}
+
+ZrtpPoint::ZrtpPoint(role _role, Callbacks *_callbacks, std::pmr::memory_resource *_memoryResource){
+
+    setRole(_role);
+    zrtpPointCallbacks = _callbacks;
+    cryptoPool = nullptr;
+    sessionScheduler = nullptr;
+    mailbox = nullptr;
+    pendingEvents.store(0);
+    pendingStarts.store(0);
+    pendingTimeouts.store(0);
+    pendingCryptoResults.store(0);
+    finishedCryptoJob.store(0);
+    droppedPackets.store(0);
+    detaching.store(false);
+    memoryResource = _memoryResource;
+    handshakeState = nullptr;
+    currentSrtpKeyMaterial = (srtpKeyMaterial*) keyMaterialPool().allocate();
+    helloTemplate = nullptr;
+    engine = new StateMachine(this);
 
+    helloMessage = nullptr;
+    respondersHello = nullptr;
+    helloAckmessage = nullptr;
+    commitMessage = nullptr;
+    dhPart1Message = nullptr;
+    dhPart2Message = nullptr;
+    confirmMessage1 = nullptr;
+    confirmMessage2 = nullptr;
+    conf2AckMessage = nullptr;
+    errorMessage = nullptr;
+    errorAckMessage = nullptr;
+
+    openHandshakeState();
     setZID();
-    calculateHashChain();
+    fillWithRandomWalue((uint8_t*) &sourceIdentifier, sizeof(sourceIdentifier));
 
     rs1 = 1;
     rs2 = 2;
@@ -41,25 +145,41 @@ ZrtpPoint::ZrtpPoint(role _role, Callbacks *_callbacks){
     addSupported((const char*) "HS32", 4);
     addSupported((const char*) "DH3k", 5);
     addSupported((const char*) "B32 ", 6);
-
-    memset (hvi,0,HVI_LENGTH);
 }
 
 ZrtpPoint::~ZrtpPoint(){
 
+    // Events posted from now are dropped, worker does not handle them, so it starts no crypto job.
+    detaching.store(true);
+
+    // Worker could still run our events. Session without events is not touched by any worker, so it can
+    // be deleted even after scheduler, which runs all queued sessions when it is destroyed.
+    if (sessionScheduler != nullptr && pendingEvents.load() != 0){
+        sessionScheduler->detach(this);
+    }
+
+    // Running crypto job uses our data, wait for it.
+    if (cryptoPool != nullptr){
+        cryptoPool->cancel(this);
+        cryptoPool->waitForOwner(this);
+    }
+
+    // Completion which was posting its result when we started to detach could schedule us again.
+    if (sessionScheduler != nullptr && pendingEvents.load() != 0){
+        sessionScheduler->detach(this);
+    }
+    delete mailbox;
+
+    releaseLastSentPacket();
     delete zrtpPointCallbacks;
     delete engine;
-    delete zrtpPointEvent;
+    compactSession();
+    keyMaterialPool().release(currentSrtpKeyMaterial);
 
     delete s1;
     delete s2;
     delete s3;
 
-    sha256_free(&sha256Context);
-    ctr_drbg_free(&ctrDrbgContext);
-    entropy_free(&entropyContext);
-    aes_free(&aesContext);
-
     currentUserInfo.protocolVersion.clear();
     currentUserInfo.supportedAuthTagType.clear();
     currentUserInfo.supportedCipherAlhorithm.clear();
@@ -70,53 +190,348 @@ ZrtpPoint::~ZrtpPoint(){
 
 void ZrtpPoint::processMessage(uint8_t *data, unsigned int messageLength){
 
-    zrtpPointEvent = new ZrtpEvent();
+    // Junk packets are dropped before they are queued or parsed, CRC is computed only for datagram
+    // which looks like ZRTP packet of known type and length.
+    if (validatePacket(data, messageLength) == UNKNOWN_MESSAGE){
+        return;
+    }
+
+    processValidatedMessage(data, messageLength);
+}
 
-    zrtpPointEvent->eventType = MESSAGE;
-    zrtpPointEvent->messageData = data;
-    zrtpPointEvent->messageDataLength = messageLength;
+void ZrtpPoint::processValidatedMessage(uint8_t *data, unsigned int messageLength){
 
-    engine->processEvent(zrtpPointEvent);
+    if (!checkPacketCrc(data, messageLength)){
+        return;
+    }
+
+    if (sessionScheduler != nullptr){
+        postEvent(MESSAGE, data, messageLength, 0);
+        return;
+    }
 
-    delete zrtpPointEvent;
+    ZrtpEvent messageEvent = {MESSAGE, data, (int) messageLength, 0};
+    engine->processEvent(&messageEvent);
 }
 
 void ZrtpPoint::processTimeout(){
 
-    zrtpPointEvent = new ZrtpEvent();
-
-    zrtpPointEvent->eventType = TIME;
-    engine->processEvent(zrtpPointEvent);
+    if (sessionScheduler != nullptr){
+        postEvent(TIME, nullptr, 0, 0);
+        return;
+    }
 
-    delete zrtpPointEvent;
+    ZrtpEvent timeEvent = {TIME, nullptr, 0, 0};
+    engine->processEvent(&timeEvent);
 }
 
 void ZrtpPoint::startEngine(){
 
-    zrtpPointEvent = new ZrtpEvent();
+    // Job from previous negotiation could still compute with our DH context.
+    if (cryptoPool != nullptr){
+        cryptoPool->waitForOwner(this);
+    }
 
-    zrtpPointEvent->eventType = START;
-    engine->processEvent(zrtpPointEvent);
+    if (sessionScheduler != nullptr){
+        postEvent(START, nullptr, 0, 0);
+        return;
+    }
 
-    delete zrtpPointEvent;
+    ZrtpEvent startEvent = {START, nullptr, 0, 0};
+    engine->processEvent(&startEvent);
+}
+
+void ZrtpPoint::reset(){
+
+    // Running crypto job uses our data, wait for it.
+    if (cryptoPool != nullptr){
+        cryptoPool->cancel(this);
+        cryptoPool->waitForOwner(this);
+    }
+
+    engine->reset();
+    compactSession();
+
+    secureZero(currentSrtpKeyMaterial, sizeof(srtpKeyMaterial));
+    memset(sasValue, 0, sizeof(sasValue));
+
+    delete s1;
+    delete s2;
+    delete s3;
+    s1 = nullptr;
+    s2 = nullptr;
+    s3 = nullptr;
+}
+
+void ZrtpPoint::prepareNegotiation(){
+
+    getHandshakeState();
+
+    if (!handshakeState->negotiationStarted){
+        calculatePublicValue();
+    }
+}
+
+void ZrtpPoint::setCallbacks(Callbacks *_callbacks){
+
+    if (_callbacks != zrtpPointCallbacks){
+        releaseLastSentPacket();
+        delete zrtpPointCallbacks;
+        zrtpPointCallbacks = _callbacks;
+    }
+}
+
+void ZrtpPoint::processCryptoResult(unsigned int _jobId){
+
+    if (sessionScheduler != nullptr){
+        postEvent(CRYPTO, nullptr, 0, _jobId);
+        return;
+    }
+
+    ZrtpEvent cryptoEvent = {CRYPTO, nullptr, 0, _jobId};
+    engine->processEvent(&cryptoEvent);
+}
+
+void ZrtpPoint::setSessionScheduler(SessionScheduler *_sessionScheduler){
+
+    if (_sessionScheduler != nullptr && mailbox == nullptr){
+        mailbox = new SessionMailbox();
+    }
+
+    sessionScheduler = _sessionScheduler;
+}
+
+bool ZrtpPoint::setCoroutineHandshake(bool _enabled){
+
+    return engine->setCoroutineHandshake(_enabled);
+}
+
+uint16_t ZrtpPoint::getRetransmissionsCount(){
+
+    return engine->getRetransmissionsCount();
+}
+
+void ZrtpPoint::releaseMessages(){
+
+    SessionArena::destroy(helloMessage);
+    SessionArena::destroy(respondersHello);
+    SessionArena::destroy(helloAckmessage);
+    SessionArena::destroy(commitMessage);
+    SessionArena::destroy(dhPart1Message);
+    SessionArena::destroy(dhPart2Message);
+    SessionArena::destroy(confirmMessage1);
+    SessionArena::destroy(confirmMessage2);
+    SessionArena::destroy(conf2AckMessage);
+    SessionArena::destroy(errorMessage);
+    SessionArena::destroy(errorAckMessage);
+
+    if (handshakeState != nullptr){
+        handshakeState->arena.release();
+    }
+}
+
+HandshakeState* ZrtpPoint::getHandshakeState(){
+
+    if (handshakeState == nullptr){
+        openHandshakeState();
+    }
+
+    return handshakeState;
+}
+
+void ZrtpPoint::openHandshakeState(){
+
+    handshakeState = new HandshakeState(memoryResource);
+    calculateHashChain();
+}
+
+void ZrtpPoint::compactSession(){
+
+    if (handshakeState == nullptr){
+        return;
+    }
+
+    // Cancelled job which already runs still writes to handshake state. Its completion is not
+    // waited for, it can need lock held by caller and its result is dropped anyway.
+    if (cryptoPool != nullptr){
+        cryptoPool->waitForComputation(this);
+    }
+
+    releaseLastSentPacket();
+    releaseMessages();
+    delete handshakeState;
+    handshakeState = nullptr;
+}
+
+void ZrtpPoint::releaseLastSentPacket(){
+
+    if (handshakeState == nullptr){
+        return;
+    }
+
+    if (handshakeState->lastSentMessageLeased && zrtpPointCallbacks != nullptr){
+        zrtpPointCallbacks->releaseSendBuffer(handshakeState->lastSentMessageData);
+    }
+
+    handshakeState->lastSentMessageData = nullptr;
+    handshakeState->lastSentMessageLength = 0;
+    handshakeState->lastSentMessageLeased = false;
+}
+
+void ZrtpPoint::beginNegotiation(){
+
+    if (handshakeState != nullptr && handshakeState->negotiationStarted){
+        compactSession();
+    }
+
+    getHandshakeState()->negotiationStarted = true;
+}
+
+void ZrtpPoint::postEvent(ZrtpEventType _eventType, uint8_t *_messageData, unsigned int _messageDataLength,
+                          unsigned int _cryptoJobId){
+
+    if (detaching.load()){
+        return;
+    }
+
+    // Event is stored before it is counted, so counted event can always be taken.
+    switch (_eventType){
+        case MESSAGE:
+            // Full mailbox drops packet same as network would, peer retransmits it.
+            if (!mailbox->post(_messageData, _messageDataLength)){
+                droppedPackets.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            break;
+
+        case CRYPTO: {
+            // Ids are compared as distance, so they can wrap.
+            unsigned int newestJob = finishedCryptoJob.load();
+            while ((int) (_cryptoJobId - newestJob) > 0 &&
+                   !finishedCryptoJob.compare_exchange_weak(newestJob, _cryptoJobId)){
+            }
+            pendingCryptoResults.fetch_add(1);
+            break;
+        }
+
+        case TIME:
+            pendingTimeouts.fetch_add(1);
+            break;
+
+        case START:
+            pendingStarts.fetch_add(1);
+            break;
+
+    // STOP is never posted, ZRTP point has no function for it.
+    default:
+        return;
+    }
+
+    if (pendingEvents.fetch_add(1) == 0){
+        sessionScheduler->schedule(this);
+    }
+}
+
+void ZrtpPoint::runSession(){
+
+    // Only counted events are taken, event which is stored but not counted yet belongs to next run.
+    unsigned int handledEvents = pendingEvents.load();
+
+    if (handledEvents > SESSION_EVENTS_BATCH){
+        handledEvents = SESSION_EVENTS_BATCH;
+    }
+
+    for (unsigned int i = 0; i < handledEvents; i++){
+        ZrtpEvent* event;
+
+        ZrtpEvent controlEvent;
+
+        // Producer which took earlier slot can still copy its packet.
+        while ((event = takeEvent(&controlEvent)) == nullptr){
+            std::this_thread::yield();
+        }
+
+        // Session which is being deleted only drops its events.
+        if (!detaching.load()){
+            engine->processEvent(event);
+        }
+
+        // Handler of event deleted us.
+        if (SessionScheduler::leaveDetachedSession()){
+            return;
+        }
+
+        if (event != &controlEvent){
+            mailbox->pop();
+        }
+    }
+
+    // Events posted meanwhile did not schedule us, so we go back to run queue. Session must not be
+    // touched after last event is accounted, it can be deleted right after.
+    SessionScheduler* scheduler = sessionScheduler;
+    if (pendingEvents.fetch_sub(handledEvents) != handledEvents){
+        scheduler->schedule(this);
+    }   else {
+            scheduler->sessionIdle();
+        }
+}
+
+ZrtpEvent* ZrtpPoint::takeEvent(ZrtpEvent *_controlEvent){
+
+    // Only this thread decreases counters. Control event taken before producer counted it is fine, every
+    // counted event is still stored, so it can be taken.
+    if (pendingStarts.load() != 0){
+        pendingStarts.fetch_sub(1);
+        *_controlEvent = {START, nullptr, 0, 0};
+        return _controlEvent;
+    }
+
+    // Every result gets newest job id, state machine handles it once and drops repeated ones.
+    if (pendingCryptoResults.load() != 0){
+        pendingCryptoResults.fetch_sub(1);
+        *_controlEvent = {CRYPTO, nullptr, 0, finishedCryptoJob.load()};
+        return _controlEvent;
+    }
+
+    if (pendingTimeouts.load() != 0){
+        pendingTimeouts.fetch_sub(1);
+        *_controlEvent = {TIME, nullptr, 0, 0};
+        return _controlEvent;
+    }
+
+    return mailbox->front();
+}
+
+void ZrtpPoint::seedRandomGenerator(){
+
+#ifdef ZRTP_LOCK_PROFILING
+    LockProfiler::profilerClock::time_point start = LockProfiler::profilerClock::now();
+#endif
+
+    assert ((ctr_drbg_init( &handshakeState->secrets->ctrDrbgContext, entropy_func, &handshakeState->secrets->entropyContext, NULL, 0) == 0 ));
+
+#ifdef ZRTP_LOCK_PROFILING
+    LockProfiler::record(ENTROPY_SOURCE, false, std::chrono::duration_cast<std::chrono::nanoseconds>
+                         (LockProfiler::profilerClock::now() - start).count());
+#endif
 }
 
 void ZrtpPoint::fillWithRandomWalue(uint8_t *data, uint32_t length){
 
-    assert ((ctr_drbg_init( &ctrDrbgContext, entropy_func, &entropyContext, NULL, 0) == 0 ));
+    seedRandomGenerator();
 
-    assert ((ctr_drbg_random( &ctrDrbgContext, data, length ) == 0 ));
+    assert ((ctr_drbg_random( &handshakeState->secrets->ctrDrbgContext, data, length ) == 0 ));
 }
 
 void ZrtpPoint::calculateHashChain(){
 
     // Fill myH0 with random value.
-    fillWithRandomWalue(myH0, HASH_LENGTH_SHA256);
+    fillWithRandomWalue(handshakeState->secrets->myH0, HASH_LENGTH_SHA256);
 
     // Calculate rest of hashes.
-    sha256(myH0, HASH_LENGTH_SHA256, myH1, 0);
-    sha256(myH1, HASH_LENGTH_SHA256, myH2, 0);
-    sha256(myH2, HASH_LENGTH_SHA256, myH3, 0);   
+    sha256(handshakeState->secrets->myH0, HASH_LENGTH_SHA256, handshakeState->myH1, 0);
+    sha256(handshakeState->myH1, HASH_LENGTH_SHA256, handshakeState->myH2, 0);
+    sha256(handshakeState->myH2, HASH_LENGTH_SHA256, handshakeState->myH3, 0);   
 }
 
 void ZrtpPoint::calculateMac(uint8_t* _messageData, uint16_t _messageLenght,
@@ -130,10 +545,10 @@ void ZrtpPoint::calculateMac(uint8_t* _messageData, uint16_t _messageLenght,
 
     // Set key according to message.
     switch(_messageType){
-        case HELLO_MESSAGE: memcpy(key, myH2, HASH_LENGTH_SHA256); break;
-        case COMMIT_MESSAGE: memcpy(key, myH1, HASH_LENGTH_SHA256); break;
-        case DHPART1_MESSAGE: memcpy(key, myH0, HASH_LENGTH_SHA256); break;
-        case DHPART2_MESSAGE: memcpy(key, myH0, HASH_LENGTH_SHA256); break;
+        case HELLO_MESSAGE: memcpy(key, handshakeState->myH2, HASH_LENGTH_SHA256); break;
+        case COMMIT_MESSAGE: memcpy(key, handshakeState->myH1, HASH_LENGTH_SHA256); break;
+        case DHPART1_MESSAGE: memcpy(key, handshakeState->secrets->myH0, HASH_LENGTH_SHA256); break;
+        case DHPART2_MESSAGE: memcpy(key, handshakeState->secrets->myH0, HASH_LENGTH_SHA256); break;
     default: break;
     }
 
@@ -162,10 +577,10 @@ bool ZrtpPoint::verifyMac(uint8_t *_messageData, uint16_t _messageLenght, MESSAG
     We calculate this Mac only in Hello, Commit and DhPart1 / DhPart2 message.
     */
     switch(_messageType){
-        case HELLO_MESSAGE: memcpy(key, peersH2, HASH_LENGTH_SHA256); break;
-        case COMMIT_MESSAGE: memcpy(key, peersH1, HASH_LENGTH_SHA256); break;
-        case DHPART1_MESSAGE: memcpy(key, peersH0, HASH_LENGTH_SHA256); break;
-        case DHPART2_MESSAGE: memcpy(key, peersH0, HASH_LENGTH_SHA256); break;
+        case HELLO_MESSAGE: memcpy(key, handshakeState->peersH2, HASH_LENGTH_SHA256); break;
+        case COMMIT_MESSAGE: memcpy(key, handshakeState->peersH1, HASH_LENGTH_SHA256); break;
+        case DHPART1_MESSAGE: memcpy(key, handshakeState->peersH0, HASH_LENGTH_SHA256); break;
+        case DHPART2_MESSAGE: memcpy(key, handshakeState->peersH0, HASH_LENGTH_SHA256); break;
     default: break;
     }
 
@@ -211,49 +626,51 @@ void ZrtpPoint::calculateRandomSecrets(DHPart* dhMessage){
 
 void ZrtpPoint::calculatePublicValue(){   
 
-    assert (ctr_drbg_init( &ctrDrbgContext, entropy_func, &entropyContext, NULL, 0) == 0 );
+    if (handshakeState->publicValueReady){
+        return;
+    }
 
-    assert (mpi_read_string(&dhmContext.P ,16, POLARSSL_DHM_RFC3526_MODP_3072_P) == 0);
+    seedRandomGenerator();
 
-    assert (mpi_read_string(&dhmContext.G ,16, POLARSSL_DHM_RFC3526_MODP_3072_G) == 0);
+    assert (mpi_read_string(&handshakeState->secrets->dhmContext.P ,16, POLARSSL_DHM_RFC3526_MODP_3072_P) == 0);
 
-    assert ((dhm_make_params( &dhmContext, (int) mpi_size( &dhmContext.P ), buf, &n,
-                              ctr_drbg_random, &ctrDrbgContext )) == 0);
+    assert (mpi_read_string(&handshakeState->secrets->dhmContext.G ,16, POLARSSL_DHM_RFC3526_MODP_3072_G) == 0);
+
+    assert ((dhm_make_params( &handshakeState->secrets->dhmContext, (int) mpi_size( &handshakeState->secrets->dhmContext.P ), handshakeState->secrets->buf, &handshakeState->secrets->n,
+                              ctr_drbg_random, &handshakeState->secrets->ctrDrbgContext )) == 0);
 
     //Write public value to myPublicValue.
-    assert (mpi_write_binary(&dhmContext.GX, myPublicValue, sizeof(myPublicValue)) == 0);
+    assert (mpi_write_binary(&handshakeState->secrets->dhmContext.GX, handshakeState->myPublicValue, sizeof(handshakeState->myPublicValue)) == 0);
+
+    handshakeState->publicValueReady = true;
 }
 
 void ZrtpPoint::calculateHvi(HelloMessage *_helloMessage){
 
-    uint8_t* hashData = new uint8_t[respondersHello->getMessageLength() + dhPart2Message->getMessageLength()];
-
    /*
    Hello data and Dhpar2 data contains whole packet, we must skip packet which includes
    head, sequence number, magic cookie and source identifier.
    */
 
-   // Copy hello message data.
-   memcpy(hashData, (_helloMessage->getHelloData() + PACKET_HEAD_LENGTH),
-          _helloMessage->getMessageLength());
-
-   // After hello, we copy dhPart data.
-   memcpy(hashData + _helloMessage->getMessageLength(), dhPart2Message->getDHData() + PACKET_HEAD_LENGTH,
-          dhPart2Message->getMessageLength());
-
-   sha256(hashData, _helloMessage->getMessageLength() + dhPart2Message->getMessageLength(), hvi, 0);
-
-   delete[] hashData;
+   // Hello and DHPart2 are hashed where they are, they are not copied together.
+   sha256_context context;
+   sha256_init(&context);
+   sha256_starts(&context, 0);
+   sha256_update(&context, _helloMessage->getHelloData() + PACKET_HEAD_LENGTH, _helloMessage->getMessageLength());
+   sha256_update(&context, dhPart2Message->getDHData() + PACKET_HEAD_LENGTH, dhPart2Message->getMessageLength());
+   sha256_finish(&context, handshakeState->hvi);
+   sha256_free(&context);
 }
 
 void ZrtpPoint::createEncryptPart(ConfirmMessage *_confirmMessage){
 
-    _confirmMessage->initializeEncryptedPart();
-    aes_init(&aesContext);
+    uint8_t plainPart [ENCRYPTED_PART_LENGTH];
+    _confirmMessage->initializeEncryptedPart(plainPart);
+    aes_init(&handshakeState->secrets->aesContext);
 
     // Set key according to role.
-    (currentRole == INITIATOR) ? (aes_setkey_enc(&aesContext, currentSrtpKeyMaterial.zrtpKeyI, 128)) :
-                                 (aes_setkey_enc(&aesContext, currentSrtpKeyMaterial.zrtpKeyR, 128));
+    (currentRole == INITIATOR) ? (aes_setkey_enc(&handshakeState->secrets->aesContext, currentSrtpKeyMaterial->zrtpKeyI, 128)) :
+                                 (aes_setkey_enc(&handshakeState->secrets->aesContext, currentSrtpKeyMaterial->zrtpKeyR, 128));
 
     uint8_t output [40];
     uint8_t tempIV [16];
@@ -266,7 +683,7 @@ void ZrtpPoint::createEncryptPart(ConfirmMessage *_confirmMessage){
     _confirmMessage->setInitializationVector(tempIV);
 
     // Encoding
-    aes_crypt_cfb128(&aesContext, AES_ENCRYPT, 40, &n, tempIV, _confirmMessage->getEncryptedPart(), output);
+    aes_crypt_cfb128(&handshakeState->secrets->aesContext, AES_ENCRYPT, 40, &n, tempIV, plainPart, output);
 
     _confirmMessage->setEncryptedData(output);
 }
@@ -276,10 +693,10 @@ void ZrtpPoint::calculateConfirmMac(ConfirmMessage* _confirmMessage){
     uint8_t tempConfirmMac [HASH_LENGTH_SHA256];
 
     if (currentRole == INITIATOR) {
-        sha256_hmac(currentSrtpKeyMaterial.macKeyI, KEY_MATERIAL_LENGTH, _confirmMessage->getEncryptedPart(),
+        sha256_hmac(currentSrtpKeyMaterial->macKeyI, KEY_MATERIAL_LENGTH, _confirmMessage->getEncryptedPart(),
                     ENCRYPTED_PART_LENGTH, tempConfirmMac, 0);
     }   else {
-           sha256_hmac(currentSrtpKeyMaterial.macKeyR, KEY_MATERIAL_LENGTH, _confirmMessage->getEncryptedPart(),
+           sha256_hmac(currentSrtpKeyMaterial->macKeyR, KEY_MATERIAL_LENGTH, _confirmMessage->getEncryptedPart(),
                        ENCRYPTED_PART_LENGTH, tempConfirmMac, 0);
         }
 
@@ -291,10 +708,10 @@ bool ZrtpPoint::verifyConfirmMac(ConfirmMessage *_confirmMsg){
     uint8_t tempConfirmMac [HASH_LENGTH_SHA256];
 
     if (currentRole == RESPONDER) {
-        sha256_hmac(currentSrtpKeyMaterial.macKeyI, KEY_MATERIAL_LENGTH, _confirmMsg->getEncryptedPart(),
+        sha256_hmac(currentSrtpKeyMaterial->macKeyI, KEY_MATERIAL_LENGTH, _confirmMsg->getEncryptedPart(),
                     ENCRYPTED_PART_LENGTH, tempConfirmMac, 0);
     }   else {
-            sha256_hmac(currentSrtpKeyMaterial.macKeyR, KEY_MATERIAL_LENGTH, _confirmMsg->getEncryptedPart(),
+            sha256_hmac(currentSrtpKeyMaterial->macKeyR, KEY_MATERIAL_LENGTH, _confirmMsg->getEncryptedPart(),
                         ENCRYPTED_PART_LENGTH, tempConfirmMac, 0);
         }
 
@@ -316,7 +733,8 @@ void ZrtpPoint::keyDerivationFunction(uint8_t *valueToFill, uint16_t _valueToFil
     uint32_t hashedDataLength = sizeof(counter) + strlen((char*)label) + sizeof(delimiter) + contextSize +
                                 sizeof (length);
 
-    uint8_t* dataToHash = new uint8_t[hashedDataLength];
+    uint8_t dataToHash[sizeof(counter) + KDF_LABEL_MAX_LENGTH + sizeof(delimiter) + KDF_CONTEXT_LENGTH + sizeof(length)];
+    assert(hashedDataLength <= sizeof(dataToHash));
 
     // copy all parameters to data.
     uint16_t p = 0;
@@ -334,90 +752,99 @@ void ZrtpPoint::keyDerivationFunction(uint8_t *valueToFill, uint16_t _valueToFil
 
     memcpy(dataToHash + p, &length, sizeof(length));
 
-    uint8_t* tempHash = new uint8_t[HASH_LENGTH_SHA256];
+    uint8_t tempHash[HASH_LENGTH_SHA256];
 
     // Calculate hash from copied data.
     sha256_hmac(KI, KI_length, dataToHash, hashedDataLength, tempHash, 0);
 
     // Copy calculated data to our value.
     memcpy(valueToFill, tempHash, _valueToFillLength);
-
-    delete[] dataToHash;
-    delete[] tempHash;
+    secureZero(tempHash, sizeof(tempHash));
 }
 
 void ZrtpPoint::calculateTotalHash(){
 
-    uint16_t helloMessageLength = 0;
-
     // We must use responder`s hello for total hash calculation
-    (currentRole == INITIATOR) ? (helloMessageLength = respondersHello->getMessageLength()) :
-                                 (helloMessageLength = helloMessage->getMessageLength());
+    HelloMessage* respondersHelloMessage = (currentRole == INITIATOR) ? respondersHello : helloMessage;
+
+    // total_hash = hash(Hello of responder || Commit || DHPart1 || DHPart2), messages are hashed in place.
+    sha256_context context;
+    sha256_init(&context);
+    sha256_starts(&context, 0);
+    sha256_update(&context, respondersHelloMessage->getHelloData() + PACKET_HEAD_LENGTH,
+                  respondersHelloMessage->getMessageLength());
+    sha256_update(&context, commitMessage->getCommitData() + PACKET_HEAD_LENGTH, commitMessage->getMessageLength());
+    sha256_update(&context, dhPart1Message->getDHData() + PACKET_HEAD_LENGTH, dhPart1Message->getMessageLength());
+    sha256_update(&context, dhPart2Message->getDHData() + PACKET_HEAD_LENGTH, dhPart2Message->getMessageLength());
+    sha256_finish(&context, handshakeState->totalHash);
+    sha256_free(&context);
+}
 
-    uint16_t hashedDataLength = (helloMessageLength + commitMessage->getMessageLength() + dhPart1Message->getMessageLength() +
-                                 dhPart2Message->getMessageLength());
+void ZrtpPoint::prepareHelloMessage(){
 
-    uint8_t* dataToHash = new uint8_t[hashedDataLength];
-    uint16_t copiedLength = 0;
+    if (helloTemplate == nullptr){
+        helloTemplate = createHelloTemplate();
+    }
 
-    // Copy all messages data to hash data.
-    if (currentRole == INITIATOR) {
-        memcpy(dataToHash, (respondersHello->getHelloData() + PACKET_HEAD_LENGTH), helloMessageLength );
+    // Hello differs from template only in H3 and ZID, supported algorithms are not copied again.
+    if (helloTemplate != nullptr){
+        helloMessage->initializeFromTemplate(helloTemplate, handshakeState->myH3, zid);
     }   else {
-            memcpy(dataToHash, (helloMessage->getHelloData() + PACKET_HEAD_LENGTH), helloMessageLength);
+            fillHelloMessage(helloMessage);
+            helloMessage->setZID((uint8_t*) zid);
+            helloMessage->setHashImageH3(handshakeState->myH3);
+            helloMessage->initializeMessageData();
         }
 
-    copiedLength += helloMessageLength;
-    memcpy(dataToHash + copiedLength, (commitMessage->getCommitData() + PACKET_HEAD_LENGTH), commitMessage->getMessageLength());
-    copiedLength += commitMessage->getMessageLength();
-    memcpy(dataToHash + copiedLength, (dhPart1Message->getDHData() + PACKET_HEAD_LENGTH), dhPart1Message->getMessageLength());
-    copiedLength += dhPart1Message->getMessageLength();
-    memcpy(dataToHash + copiedLength, (dhPart2Message->getDHData() + PACKET_HEAD_LENGTH), dhPart2Message->getMessageLength());
-
-    sha256(dataToHash, hashedDataLength, totalHash, 0);
-
-    delete[] dataToHash;
+    // When hello is initialized we calculate mac of hello message.
+    calculateMac(helloMessage->getHelloData(), helloMessage->getMessageLength(),
+                 HELLO_MESSAGE);
 }
 
-void ZrtpPoint::prepareHelloMessage(){
+void ZrtpPoint::fillHelloMessage(HelloMessage *_hello){
 
     // We set in hello message version and protocol that user support
-    helloMessage->setProtocolVersion((uint8_t *) currentUserInfo.protocolVersion[0]);
+    _hello->setProtocolVersion((uint8_t *) currentUserInfo.protocolVersion[0]);
 
     // Copy all supported algorithms.
     for (uint16_t i = 0; i < currentUserInfo.supportedAuthTagType.size(); i++){
-           helloMessage->addAuthTagType((uint8_t*) currentUserInfo.supportedAuthTagType[i]);
+           _hello->addAuthTagType((uint8_t*) currentUserInfo.supportedAuthTagType[i]);
     }
 
     for (uint16_t i = 0; i < currentUserInfo.supportedCipherAlhorithm.size(); i++){
-        helloMessage->addCipherAlgorithm((uint8_t*) currentUserInfo.supportedCipherAlhorithm[i]);
+        _hello->addCipherAlgorithm((uint8_t*) currentUserInfo.supportedCipherAlhorithm[i]);
     }
 
     for (uint16_t i = 0; i < currentUserInfo.supportedHashAlgorithm.size(); i++ ){
-        helloMessage->addHashAlgorithm((uint8_t*) currentUserInfo.supportedHashAlgorithm[i]);
+        _hello->addHashAlgorithm((uint8_t*) currentUserInfo.supportedHashAlgorithm[i]);
     }
 
     for (uint16_t i = 0; i < currentUserInfo.supportedKeyAgreementType.size(); i++ ){
-        helloMessage->addKeyAgreementType((uint8_t*) currentUserInfo.supportedKeyAgreementType[i]);
+        _hello->addKeyAgreementType((uint8_t*) currentUserInfo.supportedKeyAgreementType[i]);
     }
 
     for (uint16_t i = 0; i < currentUserInfo.supportedSasType.size(); i++ ) {
-        helloMessage->addSasType((uint8_t*) currentUserInfo.supportedSasType[i]);
+        _hello->addSasType((uint8_t*) currentUserInfo.supportedSasType[i]);
     }
+}
 
-    helloMessage->setZID((uint8_t*) zid);
-    helloMessage->setHashImageH3(myH3);
+const HelloMessage* ZrtpPoint::createHelloTemplate(){
 
-    helloMessage->initializeMessageData();
+    HelloMessage profileHello;
+    uint8_t emptyHash[HASH_LENGTH_SHA256] = {0};
+    uint8_t emptyZid[ZID_LENGTH] = {0};
 
-    // When hello is initialized we calculate mac of hello message.
-    calculateMac(helloMessage->getHelloData(), helloMessage->getMessageLength(),
-                 HELLO_MESSAGE);
+    fillHelloMessage(&profileHello);
+    profileHello.setHashImageH3(emptyHash);
+    profileHello.setZID(emptyZid);
+    profileHello.initializeMessageData();
+
+    return HelloTemplateCache::getInstance().share(&profileHello);
 }
 
 void ZrtpPoint::prepareCommitMessage(){
 
-    commitMessage->setHashImageH2(myH2);
+    commitMessage->setHashImageH2(handshakeState->myH2);
     commitMessage->setZid(zid);
 
     // We set negotiated algorithms. In this implementation are algoritms set default, because both endpoint
@@ -427,7 +854,7 @@ void ZrtpPoint::prepareCommitMessage(){
     commitMessage->setAgreedAuthTagAlgorithm((uint8_t *) currentUserInfo.supportedAuthTagType[0]);
     //commitMessage->setAgreedKeyAgreementType((uint8_t *) currentUserInfo.supportedKeyAgreementType[0]);
     commitMessage->setAgreedSasType((uint8_t *) currentUserInfo.supportedSasType[0]);
-    commitMessage->setHvi(hvi);
+    commitMessage->setHvi(handshakeState->hvi);
 
     commitMessage->initializeMessageData();
 
@@ -438,13 +865,13 @@ void ZrtpPoint::prepareDhPart1Message(){
 
     dhPart1Message->setMessageType((uint8_t*) "DHPart1 ");
 
-    dhPart1Message->setHashImageH1(myH1);
+    dhPart1Message->setHashImageH1(handshakeState->myH1);
 
     // This function set rs1, rs2, aux, pbx to random, because we dont have any shared secret.
     calculateRandomSecrets(dhPart1Message);
     calculatePublicValue();
 
-    dhPart1Message->setPublicValue(myPublicValue);
+    dhPart1Message->setPublicValue(handshakeState->myPublicValue);
     dhPart1Message->initializeMessageData();
 
     // Calculate MAC at the end.
@@ -456,12 +883,12 @@ void ZrtpPoint::prepareDhPart2Message(){
 
     dhPart2Message->setMessageType((uint8_t*) "DHPart2 ");
 
-    dhPart2Message->setHashImageH1(myH1);
+    dhPart2Message->setHashImageH1(handshakeState->myH1);
 
     calculateRandomSecrets(dhPart2Message);
     calculatePublicValue();
 
-    dhPart2Message->setPublicValue(myPublicValue);
+    dhPart2Message->setPublicValue(handshakeState->myPublicValue);
     dhPart2Message->initializeMessageData();
 
     calculateMac(dhPart2Message->getDHData(), dhPart2Message->getMessageLength(),
@@ -471,12 +898,11 @@ void ZrtpPoint::prepareDhPart2Message(){
 void ZrtpPoint::prepareConfirm1Message() {
 
     confirmMessage1->setMessageType((uint8_t *) "Confirm1");
-    confirmMessage1->setHashImageH0(myH0);
+    confirmMessage1->setHashImageH0(handshakeState->secrets->myH0);
 
     // Encrypt part of confirm.
 
     createEncryptPart(confirmMessage1);
-    confirmMessage1->initializeMessageData();
 
     // Calculate confirm mac at the end, this protect encrypted part.
     calculateConfirmMac(confirmMessage1);
@@ -487,10 +913,9 @@ void ZrtpPoint::prepareConfirm1Message() {
 void ZrtpPoint::prepareConfirm2Message() {
 
     confirmMessage2->setMessageType((uint8_t *) "Confirm2");
-    confirmMessage2->setHashImageH0(myH0);
+    confirmMessage2->setHashImageH0(handshakeState->secrets->myH0);
 
     createEncryptPart(confirmMessage2);
-    confirmMessage1->initializeMessageData();
 
     calculateConfirmMac(confirmMessage2);
     confirmMessage2->initializeMessageData();
@@ -498,15 +923,13 @@ void ZrtpPoint::prepareConfirm2Message() {
 
 
 bool ZrtpPoint::compareHashValues(uint8_t *_currentHashValue, uint8_t *_previousHashValue){
-    uint8_t* tempHash = new uint8_t [HASH_LENGTH_SHA256];
+    uint8_t tempHash[HASH_LENGTH_SHA256];
 
     sha256(_previousHashValue, HASH_LENGTH_SHA256, tempHash, 0);
 
     if ((memcmp(_currentHashValue, tempHash, HASH_LENGTH_SHA256) == 0)) {
-        delete[] tempHash;
         return true;
     }   else {
-            delete[] tempHash;
             return false;
         }
 }
@@ -519,18 +942,22 @@ zrtpErrorCode ZrtpPoint::readPublicValue(DHPart *_dhPartMessage){
     mpi_init(&tempMpi);
 
     // testMpi will be initialized to P-1
-    assert (mpi_sub_int(&tempMpi, &dhmContext.P, 1) == 0);
+    assert (mpi_sub_int(&tempMpi, &handshakeState->secrets->dhmContext.P, 1) == 0);
     // read received public value
-    assert (mpi_read_binary(&dhmContext.GY, _dhPartMessage->getPublicValue(), DH3K_PUBLIC_KEY_LENGTH) == 0);
+    assert (mpi_read_binary(&handshakeState->secrets->dhmContext.GY, _dhPartMessage->getPublicValue(), DH3K_PUBLIC_KEY_LENGTH) == 0);
 
     // Compare if is not equal to 1 or p - 1
-    if (mpi_cmp_int(&dhmContext.GY, 1) == 0 || (mpi_cmp_mpi(&tempMpi, &dhmContext.P) == 0)){
+    if (mpi_cmp_int(&handshakeState->secrets->dhmContext.GY, 1) == 0 || (mpi_cmp_mpi(&tempMpi, &handshakeState->secrets->dhmContext.P) == 0)){
+        mpi_free(&tempMpi);
         return tempError = DH_ERROR_BAD_PUBLIC_VALUE;
     }
 
     // Calculate key.
-    assert (dhm_calc_secret( &dhmContext, buf, &n, ctr_drbg_random, &ctrDrbgContext ) == 0);
-    assert (mpi_write_binary(&dhmContext.K, dhResult, sizeof(dhResult)) == 0);
+    assert (dhm_calc_secret( &handshakeState->secrets->dhmContext, handshakeState->secrets->buf, &handshakeState->secrets->n, ctr_drbg_random, &handshakeState->secrets->ctrDrbgContext ) == 0);
+    assert (mpi_write_binary(&handshakeState->secrets->dhmContext.K, handshakeState->secrets->dhResult, sizeof(handshakeState->secrets->dhResult)) == 0);
+
+    // Calculation leaves shared secret in buffer.
+    secureZero(handshakeState->secrets->buf, sizeof(handshakeState->secrets->buf));
 
     mpi_free(&tempMpi);
     return tempError;
@@ -557,10 +984,12 @@ void ZrtpPoint::calculateS0(){
         lenS3 = 0x00000000;
     }
 
-    uint32_t hashDataLength = sizeof(counter) + DH3K_PUBLIC_KEY_LENGTH + strlen(text) + (2 * ZID_LENGTH) + sizeof(totalHash) +
+    uint32_t hashDataLength = sizeof(counter) + DH3K_PUBLIC_KEY_LENGTH + strlen(text) + (2 * ZID_LENGTH) + sizeof(handshakeState->totalHash) +
                               sizeof(lenS1) + lenS1 + sizeof(lenS2) + lenS2 + sizeof(lenS3) + lenS3;
 
-    uint8_t* dataToHash = new uint8_t[(hashDataLength)];
+    uint8_t dataToHash[sizeof(counter) + DH3K_PUBLIC_KEY_LENGTH + KDF_LABEL_MAX_LENGTH + (2 * ZID_LENGTH) + sizeof(handshakeState->totalHash) +
+                       3 * (sizeof(uint32_t) + CACHED_SECRET_LENGTH)];
+    assert(hashDataLength <= sizeof(dataToHash));
 
     // Initialize data for hash
     uint32_t p = 0;
@@ -568,8 +997,8 @@ void ZrtpPoint::calculateS0(){
     p += sizeof(counter);
 
     // Copy dhResult
-    memcpy(dataToHash + p, dhResult, sizeof(dhResult));
-    p += sizeof(dhResult);
+    memcpy(dataToHash + p, handshakeState->secrets->dhResult, sizeof(handshakeState->secrets->dhResult));
+    p += sizeof(handshakeState->secrets->dhResult);
     memcpy(dataToHash + p, text, strlen(text));
     p += strlen(text);
 
@@ -586,7 +1015,7 @@ void ZrtpPoint::calculateS0(){
             p += ZID_LENGTH;
         }
 
-    memcpy(dataToHash + p, totalHash, HASH_LENGTH_SHA256);
+    memcpy(dataToHash + p, handshakeState->totalHash, HASH_LENGTH_SHA256);
     p += HASH_LENGTH_SHA256;
     memcpy(dataToHash + p, &lenS1, sizeof(lenS1));
     p += sizeof(lenS1);
@@ -610,34 +1039,34 @@ void ZrtpPoint::calculateS0(){
         p += lenS3;
     }
 
-    sha256(dataToHash, hashDataLength, s0, 0);
+    sha256(dataToHash, hashDataLength, handshakeState->secrets->s0, 0);
 
     // Set Kdf Context
     if (currentRole == INITIATOR) {
-        (memcpy(kdfContext, helloMessage->getZID(), ZID_LENGTH));
-        (memcpy(kdfContext + ZID_LENGTH, respondersHello->getZID(), ZID_LENGTH));
+        (memcpy(handshakeState->kdfContext, helloMessage->getZID(), ZID_LENGTH));
+        (memcpy(handshakeState->kdfContext + ZID_LENGTH, respondersHello->getZID(), ZID_LENGTH));
     }   else {
-            (memcpy(kdfContext, respondersHello->getZID(), ZID_LENGTH));
-            (memcpy(kdfContext + ZID_LENGTH, helloMessage->getZID(), ZID_LENGTH));
+            (memcpy(handshakeState->kdfContext, respondersHello->getZID(), ZID_LENGTH));
+            (memcpy(handshakeState->kdfContext + ZID_LENGTH, helloMessage->getZID(), ZID_LENGTH));
         }
-    memcpy(kdfContext + (2 * ZID_LENGTH), totalHash, sizeof(totalHash));
+    memcpy(handshakeState->kdfContext + (2 * ZID_LENGTH), handshakeState->totalHash, sizeof(handshakeState->totalHash));
 
-    memset(dhResult, 0, sizeof(dhResult));
-    memset(myPublicValue, 0, sizeof(myPublicValue));
+    secureZero(handshakeState->secrets->dhResult, sizeof(handshakeState->secrets->dhResult));
+    secureZero(dataToHash, sizeof(dataToHash));
+    memset(handshakeState->myPublicValue, 0, sizeof(handshakeState->myPublicValue));
 
-    dhm_free(&dhmContext);
-    memset(myPublicValue, 0, sizeof(myPublicValue));
-    memset(totalHash, 0, sizeof(totalHash));
-
-    delete[] dataToHash;
+    dhm_free(&handshakeState->secrets->dhmContext);
+    handshakeState->publicValueReady = false;
+    memset(handshakeState->myPublicValue, 0, sizeof(handshakeState->myPublicValue));
+    memset(handshakeState->totalHash, 0, sizeof(handshakeState->totalHash));
 }
 
 void ZrtpPoint::calculateZrtpSessAndExportedKey(){
 
-    keyDerivationFunction(zrtpSess, HASH_LENGTH_SHA256, s0, CACHED_SECRET_LENGTH, (uint8_t*) "ZRTP Session Key",
-                          kdfContext, KDF_CONTEXT_LENGTH,256);
-    keyDerivationFunction(exportedKey, HASH_LENGTH_SHA256, s0, CACHED_SECRET_LENGTH,(uint8_t*)  "Exported key",
-                          kdfContext, KDF_CONTEXT_LENGTH, 256);
+    keyDerivationFunction(handshakeState->secrets->zrtpSess, HASH_LENGTH_SHA256, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*) "ZRTP Session Key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH,256);
+    keyDerivationFunction(handshakeState->secrets->exportedKey, HASH_LENGTH_SHA256, handshakeState->secrets->s0, CACHED_SECRET_LENGTH,(uint8_t*)  "Exported key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 256);
 }
 
 void ZrtpPoint::calculateSas(){
@@ -645,37 +1074,38 @@ void ZrtpPoint::calculateSas(){
     uint8_t sashash [HASH_LENGTH_SHA256];
     memset(sashash, 0, HASH_LENGTH_SHA256);
 
-    keyDerivationFunction(sashash, HASH_LENGTH_SHA256, s0, CACHED_SECRET_LENGTH, (uint8_t*)  "SAS",
-                          kdfContext, KDF_CONTEXT_LENGTH, 256);
+    keyDerivationFunction(sashash, HASH_LENGTH_SHA256, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*)  "SAS",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 256);
 
     memcpy(sasValue, sashash, WORD_LENGTH);
+    secureZero(sashash, sizeof(sashash));
 }
 
 void ZrtpPoint::calculateZrtpKeyMaterial(){
 
-    keyDerivationFunction(currentSrtpKeyMaterial.srtpKeyI, DERIVATED_KEY_LENGTH, s0, CACHED_SECRET_LENGTH,(uint8_t*) "Initiator SRTP master key",
-                          kdfContext, KDF_CONTEXT_LENGTH, 128);
+    keyDerivationFunction(currentSrtpKeyMaterial->srtpKeyI, DERIVATED_KEY_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH,(uint8_t*) "Initiator SRTP master key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 128);
 
-    keyDerivationFunction(currentSrtpKeyMaterial.srtpSaltI, SALT_LENGTH, s0, CACHED_SECRET_LENGTH, (uint8_t*) "Initiator SRTP master salt",
-                          kdfContext, KDF_CONTEXT_LENGTH, 112);
+    keyDerivationFunction(currentSrtpKeyMaterial->srtpSaltI, SALT_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*) "Initiator SRTP master salt",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 112);
 
-    keyDerivationFunction(currentSrtpKeyMaterial.srtpKeyR, DERIVATED_KEY_LENGTH, s0, CACHED_SECRET_LENGTH, (uint8_t*)  "Responder SRTP master key",
-                          kdfContext, KDF_CONTEXT_LENGTH, 128);
+    keyDerivationFunction(currentSrtpKeyMaterial->srtpKeyR, DERIVATED_KEY_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*)  "Responder SRTP master key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 128);
 
-    keyDerivationFunction(currentSrtpKeyMaterial.srtpSaltR, SALT_LENGTH, s0, CACHED_SECRET_LENGTH, (uint8_t*) "Responder SRTP master salt",
-                          kdfContext, KDF_CONTEXT_LENGTH, 112);
+    keyDerivationFunction(currentSrtpKeyMaterial->srtpSaltR, SALT_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*) "Responder SRTP master salt",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 112);
 
-    keyDerivationFunction(currentSrtpKeyMaterial.macKeyI, KEY_MATERIAL_LENGTH, s0, CACHED_SECRET_LENGTH, (uint8_t*) "Initiator HMAC key",
-                          kdfContext, KDF_CONTEXT_LENGTH, 256);
+    keyDerivationFunction(currentSrtpKeyMaterial->macKeyI, KEY_MATERIAL_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*) "Initiator HMAC key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 256);
 
-    keyDerivationFunction(currentSrtpKeyMaterial.macKeyR, KEY_MATERIAL_LENGTH, s0, CACHED_SECRET_LENGTH, (uint8_t*) "Responder HMAC key",
-                          kdfContext, KDF_CONTEXT_LENGTH, 256);
+    keyDerivationFunction(currentSrtpKeyMaterial->macKeyR, KEY_MATERIAL_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*) "Responder HMAC key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 256);
 
-    keyDerivationFunction(currentSrtpKeyMaterial.zrtpKeyI, DERIVATED_KEY_LENGTH, s0, CACHED_SECRET_LENGTH, (uint8_t*) "Initiator ZRTP key",
-                          kdfContext, KDF_CONTEXT_LENGTH, 128);
+    keyDerivationFunction(currentSrtpKeyMaterial->zrtpKeyI, DERIVATED_KEY_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*) "Initiator ZRTP key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 128);
 
-    keyDerivationFunction(currentSrtpKeyMaterial.zrtpKeyR, DERIVATED_KEY_LENGTH, s0, CACHED_SECRET_LENGTH, (uint8_t*) "Responder ZRTP key",
-                          kdfContext, KDF_CONTEXT_LENGTH, 128);
+    keyDerivationFunction(currentSrtpKeyMaterial->zrtpKeyR, DERIVATED_KEY_LENGTH, handshakeState->secrets->s0, CACHED_SECRET_LENGTH, (uint8_t*) "Responder ZRTP key",
+                          handshakeState->kdfContext, KDF_CONTEXT_LENGTH, 128);
 }
 
 void ZrtpPoint::calculateAll(){
@@ -686,24 +1116,21 @@ void ZrtpPoint::calculateAll(){
     calculateSas();
     calculateZrtpKeyMaterial();
 
-    memset(s0, 0, CACHED_SECRET_LENGTH);
-    memset(kdfContext, 0, KDF_CONTEXT_LENGTH);
+    secureZero(handshakeState->secrets->s0, CACHED_SECRET_LENGTH);
+    memset(handshakeState->kdfContext, 0, KDF_CONTEXT_LENGTH);
 }
 
-uint8_t* ZrtpPoint::renderSAS(){
+void ZrtpPoint::renderSAS(uint8_t *_rendered){
 
     uint32_t bits;
     memcpy(&bits, sasValue, WORD_LENGTH);
 
     int i, n, shift;
-    uint8_t * result = new uint8_t[WORD_LENGTH];
 
     for (i=0,shift=27; i!=4; ++i,shift-=5){
         n = (bits>>shift) & 31;
-        result[i] = "ybndrfg8ejkmcpqxot1uwisza345h769"[n];
+        _rendered[i] = "ybndrfg8ejkmcpqxot1uwisza345h769"[n];
     }
-
-    return result;
 }
 
 void ZrtpPoint::decryptConfirmMessage(ConfirmMessage *_confirmMsg){
@@ -711,20 +1138,26 @@ void ZrtpPoint::decryptConfirmMessage(ConfirmMessage *_confirmMsg){
     size_t n = 2;
     uint8_t output[40];
 
-    (currentRole == RESPONDER) ? (aes_setkey_enc(&aesContext, currentSrtpKeyMaterial.zrtpKeyI, 128)) :
-                                 (aes_setkey_enc(&aesContext, currentSrtpKeyMaterial.zrtpKeyR, 128));
+    // Cipher updates vector, received packet is kept as it came.
+    uint8_t tempIV [CFB_INITIALIZATION_VECTOR_LENGTH];
+    memcpy(tempIV, _confirmMsg->getInitializationVector(), CFB_INITIALIZATION_VECTOR_LENGTH);
+
+    (currentRole == RESPONDER) ? (aes_setkey_enc(&handshakeState->secrets->aesContext, currentSrtpKeyMaterial->zrtpKeyI, 128)) :
+                                 (aes_setkey_enc(&handshakeState->secrets->aesContext, currentSrtpKeyMaterial->zrtpKeyR, 128));
 
     //Decoding
-    aes_crypt_cfb128(&aesContext, AES_DECRYPT, 40, &n, _confirmMsg->getInitializationVector(),
+    aes_crypt_cfb128(&handshakeState->secrets->aesContext, AES_DECRYPT, 40, &n, tempIV,
                      _confirmMsg->getEncryptedPart(), output);
 
-    _confirmMsg->setEncryptedData(output);
-    _confirmMsg->initializeMessageData();
+    _confirmMsg->setDecryptedData(output);
 
 }
 
 void ZrtpPoint::addSupported(const char *valueToAdd, uint8_t typeOfValue){
 
+    // Profile changes, hello template is found again.
+    helloTemplate = nullptr;
+
     // Add highet supported version at beginin
     if (typeOfValue == 1){
         if (currentUserInfo.protocolVersion.size() == 0){
@@ -785,7 +1218,8 @@ zrtpErrorCode ZrtpPoint::algorithmNegotiation(){
 
     zrtpErrorCode returnCode = N_ERROR;
 
-    std::vector< const char* > intersection;
+    std::pmr::vector< const char* > intersection(handshakeState->arena.getResource());
+    intersection.reserve(MAX_ALGORITHM_COUNT);
 
     for (uint16_t i = 0; i < (respondersHello->getHelloCounts().kc)* WORD_LENGTH; i += WORD_LENGTH){
         for(uint16_t j = 0; j < currentUserInfo.supportedKeyAgreementType.size(); j++){
@@ -804,7 +1238,7 @@ zrtpErrorCode ZrtpPoint::algorithmNegotiation(){
     for (uint16_t i = 0; i < intersection.size(); i++){
         if (memcmp(intersection.at(i), (const char*) "DH2k", WORD_LENGTH) == 0){
             commitMessage->setAgreedKeyAgreementType((uint8_t*) "DH2k");
-            negotiatedKeySize = DH2K_PUBLIC_KEY_LENGTH;
+            handshakeState->negotiatedKeySize = DH2K_PUBLIC_KEY_LENGTH;
             return returnCode;
         }
     }
@@ -812,7 +1246,7 @@ zrtpErrorCode ZrtpPoint::algorithmNegotiation(){
     for (uint16_t i = 0; i < intersection.size(); i++){
         if (memcmp(intersection.at(i), (const char*) "EC25", WORD_LENGTH) == 0){
             commitMessage->setAgreedKeyAgreementType((uint8_t*) "EC25");
-            negotiatedKeySize = EC25_PUBLIC_KEY_LENGTH;
+            handshakeState->negotiatedKeySize = EC25_PUBLIC_KEY_LENGTH;
             return returnCode;
         }
     }
@@ -820,7 +1254,7 @@ zrtpErrorCode ZrtpPoint::algorithmNegotiation(){
     for (uint16_t i = 0; i < intersection.size(); i++){
         if (memcmp(intersection.at(i), (const char*) "DH3k", WORD_LENGTH) == 0){
             commitMessage->setAgreedKeyAgreementType((uint8_t*) "DH3k");
-            negotiatedKeySize = DH3K_PUBLIC_KEY_LENGTH;
+            handshakeState->negotiatedKeySize = DH3K_PUBLIC_KEY_LENGTH;
             return returnCode;
         }
     }
@@ -828,7 +1262,7 @@ zrtpErrorCode ZrtpPoint::algorithmNegotiation(){
     for (uint16_t i = 0; i < intersection.size(); i++){
         if (memcmp(intersection.at(i), (const char*) "EC38", WORD_LENGTH) == 0){
             commitMessage->setAgreedKeyAgreementType((uint8_t*) "EC38");
-            negotiatedKeySize = EC38_PUBLIC_KEY_LENGTH;
+            handshakeState->negotiatedKeySize = EC38_PUBLIC_KEY_LENGTH;
             return returnCode;
         }
     }
@@ -836,7 +1270,7 @@ zrtpErrorCode ZrtpPoint::algorithmNegotiation(){
     for (uint16_t i = 0; i < intersection.size(); i++){
         if (memcmp(intersection.at(i), (const char*) "EC52", WORD_LENGTH) == 0){
             commitMessage->setAgreedKeyAgreementType((uint8_t*) "EC52");
-            negotiatedKeySize = EC52_PUBLIC_KEY_LENGTH;
+            handshakeState->negotiatedKeySize = EC52_PUBLIC_KEY_LENGTH;
             return returnCode;
         }
     }
@@ -846,51 +1280,45 @@ zrtpErrorCode ZrtpPoint::algorithmNegotiation(){
 
 void ZrtpPoint::writeOutKeys(){
 
-    std::cout << std::endl;
-    std::cout << "      SAS to compare: ";
-    uint8_t * rendered = renderSAS();
-    for(int i = 0; i < WORD_LENGTH; i++){
-        std::cout << *(rendered + i);
-    }
-    std::cout << std::endl;
-    delete [] rendered;
+    // Line is written at once and cout flags are not touched, sessions can finish in parallel workers.
+    char line[] = "\n      SAS to compare: ????\n\n";
+    renderSAS((uint8_t*) line + sizeof(line) - WORD_LENGTH - 3);
 
-    std::cout << std::endl;
-    std::cout << std::dec;
+    std::cout.write(line, sizeof(line) - 1).flush();
 }
 
 void ZrtpPoint::writeToFile(fstream &_file){
 
     _file << std::endl;
     _file << "sas: ";
-    uint8_t * rendered = renderSAS();
+    uint8_t rendered[WORD_LENGTH];
+    renderSAS(rendered);
     for(int i = 0; i < WORD_LENGTH; i++){
-        _file << *(rendered + i);
+        _file << rendered[i];
     }
     _file << std::endl;
-    delete [] rendered;
 
     _file << "srtpKeyI:  ";
     for(int i = 0; i < DERIVATED_KEY_LENGTH; i++){
-        _file << std::hex <<  (int)*(currentSrtpKeyMaterial.srtpKeyI + i);
+        _file << std::hex <<  (int)*(currentSrtpKeyMaterial->srtpKeyI + i);
     }
     _file << std::endl;
 
     _file << "srtpSaltI: ";
     for(int i = 0; i < SALT_LENGTH; i++){
-        _file << std::hex << (int)*(currentSrtpKeyMaterial.srtpSaltI + i);
+        _file << std::hex << (int)*(currentSrtpKeyMaterial->srtpSaltI + i);
     }
     _file << std::endl;
 
     _file << "srtpKeyR:  ";
     for(int i = 0; i < DERIVATED_KEY_LENGTH; i++){
-        _file << std::hex << (int)*(currentSrtpKeyMaterial.srtpKeyR + i);
+        _file << std::hex << (int)*(currentSrtpKeyMaterial->srtpKeyR + i);
     }
     _file << std::endl;
 
     _file << "srtpSaltR: ";
     for(int i = 0; i < SALT_LENGTH; i++){
-        _file << std::hex << (int)*(currentSrtpKeyMaterial.srtpSaltR + i);
+        _file << std::hex << (int)*(currentSrtpKeyMaterial->srtpSaltR + i);
     }
     _file << std::endl;
     _file << std::dec;
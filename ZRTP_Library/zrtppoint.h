@@ -6,6 +6,12 @@
 #include "statemachine.h"
 #include "events.h"
 #include "userInfo.h"
+#include "cryptopool.h"
+#include "sessionmailbox.h"
+#include "sessionscheduler.h"
+#include "sessionarena.h"
+#include "slaballocator.h"
+#include "securepool.h"
 #include <fstream>
 #include <iostream>
 #include <assert.h>
@@ -22,6 +28,7 @@
 #define DERIVATED_KEY_LENGTH 16
 #define SALT_LENGTH 14
 #define KDF_CONTEXT_LENGTH 56
+#define KDF_LABEL_MAX_LENGTH 32
 
 class StateMachine;
 
@@ -41,6 +48,90 @@ struct srtpKeyMaterial{
     uint8_t zrtpKeyR [DERIVATED_KEY_LENGTH];
 };
 
+/**
+ * @brief The HandshakeSecrets struct represent secrets of key negotiation, they live in secure pool.
+ *        Polar SSL contexts which hold secrets are here too: DH context keeps private exponent and shared
+ *        secret, AES context keeps key schedule of Confirm key, random generator and entropy context
+ *        decide private exponent and H0.
+ */
+struct HandshakeSecrets{
+    uint8_t myH0[HASH_LENGTH_SHA256];
+    uint8_t s0 [CACHED_SECRET_LENGTH];
+    uint8_t dhResult [DH3K_PUBLIC_KEY_LENGTH];
+    uint8_t zrtpSess [HASH_LENGTH_SHA256];
+    uint8_t exportedKey [HASH_LENGTH_SHA256];
+
+    ctr_drbg_context ctrDrbgContext;
+    entropy_context entropyContext;
+    dhm_context dhmContext;
+    aes_context aesContext;
+
+    // Output buffer of DH calculation
+    size_t n;
+    unsigned char buf[800];
+};
+
+/**
+ * @brief The HandshakeState struct represent data which ZRTP point needs only during key negotiation.
+ *        It is created with point and released when session is secured, secured session keeps only
+ *        derived keys, ZIDs and cached secrets. Released state is zeroised by its slab.
+ */
+struct HandshakeState{
+
+    // Memory of handshake messages.
+    SessionArena arena;
+
+    // H0, s0, DH result, session keys and contexts of DH, AES and random generator, they are kept in
+    // locked memory.
+    HandshakeSecrets* secrets;
+
+    uint8_t myH1[HASH_LENGTH_SHA256];
+    uint8_t myH2[HASH_LENGTH_SHA256];
+    uint8_t myH3[HASH_LENGTH_SHA256];
+
+    uint8_t peersH0[HASH_LENGTH_SHA256];
+    uint8_t peersH1[HASH_LENGTH_SHA256];
+    uint8_t peersH2[HASH_LENGTH_SHA256];
+    uint8_t peersH3[HASH_LENGTH_SHA256];
+
+    uint8_t hvi[HVI_LENGTH];
+    uint16_t negotiatedKeySize;
+
+    // Polar SSL context
+    sha256_context sha256Context;
+
+    uint8_t myPublicValue [DH3K_PUBLIC_KEY_LENGTH];
+    uint8_t totalHash [HASH_LENGTH_SHA256];
+
+    // KDF_CONTEXT = (ZIDi || Zidr || total_hash)
+    uint8_t kdfContext[KDF_CONTEXT_LENGTH];
+
+    // Resending packet refers to data of sent message or to buffer leased from transport, it is not copied.
+    uint8_t* lastSentMessageData;
+    uint16_t lastSentMessageLength;
+    bool lastSentMessageLeased;
+
+    // DH key pair can be computed before negotiation, see ZrtpPoint::prepareNegotiation().
+    bool publicValueReady;
+
+    // Handshake state used by one negotiation is not used again by next one.
+    bool negotiationStarted;
+
+    /**
+     * @brief HandshakeState constructor initialize all polar SSL contexts and take secrets from secure pool.
+     * @param _memoryResource resource for memory of handshake messages.
+     */
+    HandshakeState(std::pmr::memory_resource* _memoryResource);
+
+    /**
+     * @brief ~HandshakeState free all polar SSL contexts and zeroise secrets.
+     */
+    ~HandshakeState();
+
+    static void* operator new(size_t _size);
+    static void operator delete(void* _state, size_t _size);
+};
+
 using namespace std;
 
 /**
@@ -54,7 +145,53 @@ private:
 
     Callbacks * zrtpPointCallbacks;
     StateMachine* engine;
-    ZrtpEvent* zrtpPointEvent;
+
+    // Data of running key negotiation, nullptr when session is secured.
+    HandshakeState* handshakeState;
+    std::pmr::memory_resource* memoryResource;
+
+    // Pool for heavy crypto computation, nullptr means computation in state machine.
+    CryptoPool* cryptoPool;
+
+    // Scheduler which runs this session, nullptr means events are handled in callers thread.
+    SessionScheduler* sessionScheduler;
+    SessionMailbox* mailbox;
+
+    // Count of events posted and not handled yet, session is scheduled when it goes from 0.
+    std::atomic<unsigned int> pendingEvents;
+
+    // START, TIME and CRYPTO events are counted here instead of mailbox slot, full mailbox can not drop them.
+    std::atomic<unsigned int> pendingStarts;
+    std::atomic<unsigned int> pendingTimeouts;
+    std::atomic<unsigned int> pendingCryptoResults;
+
+    // Newest finished crypto job, job ids grow and state machine drops results of older jobs anyway.
+    std::atomic<unsigned int> finishedCryptoJob;
+
+    // Set when point is deleted, scheduled session then drops its events.
+    std::atomic<bool> detaching;
+
+    // Count of received packets dropped because mailbox was full.
+    std::atomic<uint64_t> droppedPackets;
+
+    /**
+     * @brief postEvent put packet to mailbox or count control event and schedule session, if it is not
+     *        scheduled already.
+     * @param _eventType type of event.
+     * @param _messageData received packet for MESSAGE event.
+     * @param _messageDataLength length of received packet.
+     * @param _cryptoJobId id of finished job for CRYPTO event.
+     */
+    void postEvent(ZrtpEventType _eventType, uint8_t* _messageData, unsigned int _messageDataLength,
+                   unsigned int _cryptoJobId);
+
+    /**
+     * @brief takeEvent take next posted event, control events go before packets. Only thread which runs
+     *        session can call it.
+     * @param _controlEvent filled when control event is taken.
+     * @return _controlEvent, event of oldest packet in mailbox or nullptr if no event is posted yet.
+     */
+    ZrtpEvent* takeEvent(ZrtpEvent* _controlEvent);
 
     uint8_t rs1 = 1;
     uint8_t rs2 = 2;
@@ -66,51 +203,26 @@ private:
     uint8_t auxSecretID[SHARED_SECRET_LENGTH];
     uint8_t pbxSecretID[SHARED_SECRET_LENGTH];
 
-    uint8_t myH0[HASH_LENGTH_SHA256];
-    uint8_t myH1[HASH_LENGTH_SHA256];
-    uint8_t myH2[HASH_LENGTH_SHA256];
-    uint8_t myH3[HASH_LENGTH_SHA256];
-
-    uint8_t peersH0[HASH_LENGTH_SHA256];
-    uint8_t peersH1[HASH_LENGTH_SHA256];
-    uint8_t peersH2[HASH_LENGTH_SHA256];
-    uint8_t peersH3[HASH_LENGTH_SHA256];
-
-    uint8_t  s0 [CACHED_SECRET_LENGTH];
     uint8_t* s1;
     uint8_t* s2;
     uint8_t* s3;
 
     uint8_t zid[ZID_LENGTH];
-    uint8_t hvi[HVI_LENGTH];
-
-    role currentRole;
-    srtpKeyMaterial currentSrtpKeyMaterial;
-    userInfo currentUserInfo;
-    uint16_t negotiatedKeySize;
 
-    // Polar SSL context
-    sha256_context sha256Context;
-    ctr_drbg_context ctrDrbgContext;
-    entropy_context entropyContext;
-    dhm_context dhmContext;
-    aes_context aesContext;
-
-    // Attributes for polarSSL calculation
-    size_t n;
-    unsigned char buf[800];
+    // SSRC of RTP stream written to head of every sent packet, transports steer packets of session by it.
+    uint32_t sourceIdentifier;
 
-    uint8_t myPublicValue [DH3K_PUBLIC_KEY_LENGTH];
-    uint8_t dhResult [DH3K_PUBLIC_KEY_LENGTH];
-    uint8_t totalHash [HASH_LENGTH_SHA256];
-    uint8_t zrtpSess [HASH_LENGTH_SHA256];
-    uint8_t exportedKey [HASH_LENGTH_SHA256];
+    role currentRole;
 
-    // KDF_CONTEXT = (ZIDi || Zidr || total_hash)
-    uint8_t kdfContext[KDF_CONTEXT_LENGTH];
+    // Derived keys live in secure pool for whole session.
+    srtpKeyMaterial* currentSrtpKeyMaterial;
+    userInfo currentUserInfo;
     uint8_t sasValue[WORD_LENGTH];
 
-    // Messages
+    // Serialized hello of our capability profile, shared by all points with same profile.
+    const HelloMessage* helloTemplate;
+
+    // Messages, they live in arena of handshake state.
     HelloMessage*    helloMessage;
     HelloMessage*    respondersHello;
     HelloACKmessage* helloAckmessage;
@@ -123,23 +235,89 @@ private:
     ErrorMessage*    errorMessage;
     ErrorAckMessage* errorAckMessage;
 
+    /**
+     * @brief createMessage construct message in given slot. Message which is already in slot is destroyed
+     *        and its memory is reused, so retransmissions and repeated errors do not grow arena.
+     * @param _message slot of message.
+     * @param _args arguments for message constructor.
+     * @return constructed message.
+     */
+    template <typename T, typename... Args>
+    T* createMessage(T*& _message, Args... _args){
+        if (_message != nullptr){
+            _message->~T();
+            return _message = new (_message) T(_args...);
+        }
+        return _message = getHandshakeState()->arena.create<T>(_args...);
+    }
+
+    /**
+     * @brief releaseMessages destroy all messages of handshake and release their memory at once.
+     */
+    void releaseMessages();
+
+    /**
+     * @brief getHandshakeState getter for handshake state. Error sent after session was secured needs
+     *        handshake state again, so it is opened when it does not exist.
+     * @return handshake state.
+     */
+    HandshakeState* getHandshakeState();
+
+    /**
+     * @brief openHandshakeState create handshake state and calculate new hash chain.
+     */
+    void openHandshakeState();
+
+    /**
+     * @brief compactSession release handshake state, when session is secured only keys are kept.
+     *        Task of cancelled crypto job, which still computes, is waited for.
+     */
+    void compactSession();
+
+    /**
+     * @brief releaseLastSentPacket stop resending of last packet, its leased buffer is returned to transport.
+     */
+    void releaseLastSentPacket();
+
+    /**
+     * @brief beginNegotiation prepare handshake state for new negotiation. Prepared state is used,
+     *        state left by previous negotiation is released and new one is opened.
+     */
+    void beginNegotiation();
+
 public:
 
     /**
      * @brief ZRTPpoint create sprecific endpoint according to given role.
      * @param _role INITIATOR or RESPONDER.
+     * @param _callbacks callbacks of application, they are owned by ZRTP point.
+     * @param _memoryResource resource for memory of handshake messages, it must outlive ZRTP point.
      */
-    ZrtpPoint(role _role, Callbacks *_callbacks);
+    ZrtpPoint(role _role, Callbacks *_callbacks,
+              std::pmr::memory_resource* _memoryResource = std::pmr::get_default_resource());
 
     ~ZrtpPoint();
 
+    // Sessions are allocated from slab.
+    static void* operator new(size_t _size);
+    static void operator delete(void* _session, size_t _size);
+
     /**
-     * @brief processMessage function called when message came.
+     * @brief processMessage function called when message came. Datagram which is not ZRTP packet of known
+     *        type and length or has wrong CRC is dropped.
      * @param data of message
      * @param messageLength length of received data
      */
     void processMessage(uint8_t * data, unsigned int messageLength);
 
+    /**
+     * @brief processValidatedMessage function called when message came and caller already passed it
+     *        through validatePacket(). Only CRC is checked, packet with wrong CRC is dropped.
+     * @param data of message
+     * @param messageLength length of received data
+     */
+    void processValidatedMessage(uint8_t * data, unsigned int messageLength);
+
     /**
      * @brief processTimeout this function is called from outside, when Timeout occured.
      */
@@ -150,41 +328,132 @@ public:
      */
     void startEngine();
 
+    /**
+     * @brief reset return ZRTP point to state after construction, so it can be used for new call.
+     *        Keys, SAS and cached secrets are zeroised, role, callbacks, supported algorithms, ZID,
+     *        crypto pool and scheduler are kept. Other events of point must not be handled meanwhile,
+     *        it is safe to call it from keyNegotitationEnded().
+     */
+    void reset();
+
+    /**
+     * @brief prepareNegotiation compute new hash chain and DH key pair in advance, so negotiation
+     *        started later does not compute them on first packet.
+     */
+    void prepareNegotiation();
+
+    /**
+     * @brief processCryptoResult this function is called from crypto pool, when crypto job has finished.
+     * @param _jobId id of finished job.
+     */
+    void processCryptoResult(unsigned int _jobId);
+
+    /**
+     * @brief setCryptoPool set pool which computes DH result and keys outside of critical section.
+     *        Pool is not owned by ZRTP point and must outlive it. Set it before startEngine().
+     * @param _cryptoPool pool to use, nullptr to compute in state machine.
+     */
+    void setCryptoPool(CryptoPool* _cryptoPool) {cryptoPool = _cryptoPool;}
+
+    /**
+     * @brief setSessionScheduler set scheduler which runs this session. Events are then posted to session
+     *        mailbox and handled by scheduler worker, critical section callbacks are not called.
+     *        Scheduler is not owned by ZRTP point and must outlive it. Set it before startEngine().
+     * @param _sessionScheduler scheduler to use, nullptr to handle events in callers thread.
+     */
+    void setSessionScheduler(SessionScheduler* _sessionScheduler);
+
+    /**
+     * @brief isScheduled check if session is run by scheduler.
+     * @return true if scheduler is set.
+     */
+    bool isScheduled() {return sessionScheduler != nullptr;}
+
+    /**
+     * @brief getDroppedPackets getter for count of received packets dropped because session mailbox was full.
+     * @return count of dropped packets.
+     */
+    uint64_t getDroppedPackets() {return droppedPackets.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief runSession handle batch of events from mailbox. It is called only by scheduler worker.
+     */
+    void runSession();
+
+    /**
+     * @brief getPendingEvents getter for count of events posted to scheduled session and not handled yet.
+     * @return count of events.
+     */
+    unsigned int getPendingEvents() {return pendingEvents.load();}
+
+    /**
+     * @brief setCoroutineHandshake select handshake written as coroutine instead of state handlers.
+     *        Set it before startEngine().
+     * @param _enabled true for coroutine handshake.
+     * @return false if compiler does not support coroutines, state handlers are used then.
+     */
+    bool setCoroutineHandshake(bool _enabled);
+
     /**
      * @brief setRole setter for role.
      * @param _role INITIATOR or RESPONDER.
      */
     void setRole(role _role) {currentRole = _role;}
 
+    /**
+     * @brief setCallbacks replace callbacks of application, previous callbacks are deleted.
+     * @param _callbacks new callbacks, they are owned by ZRTP point.
+     */
+    void setCallbacks(Callbacks* _callbacks);
+
     /**
      * @brief getCurrentRole is getter for param currentRole.
      * @return current Role.
      */
     role getCurrentRole() {return currentRole;}
 
+    /**
+     * @brief getSourceIdentifier getter for SSRC written to sent packets.
+     * @return source identifier.
+     */
+    uint32_t getSourceIdentifier() {return sourceIdentifier;}
+
+    /**
+     * @brief setSourceIdentifier set SSRC of RTP stream to which session relates, random SSRC is used
+     *        otherwise. Set it before startEngine().
+     * @param _sourceIdentifier SSRC.
+     */
+    void setSourceIdentifier(uint32_t _sourceIdentifier) {sourceIdentifier = _sourceIdentifier;}
+
+    /**
+     * @brief getRetransmissionsCount count of packets which engine resent after timeout of T1 or T2.
+     * @return retransmissions since negotiation started.
+     */
+    uint16_t getRetransmissionsCount();
+
     /**
      * @brief setMyH0 setter for myH0.
      * @param _myH0 value to set.
      */
-    void setMyH0(uint8_t* _myH0) {memcpy(myH0, _myH0, HASH_LENGTH_SHA256);}
+    void setMyH0(uint8_t* _myH0) {memcpy(getHandshakeState()->secrets->myH0, _myH0, HASH_LENGTH_SHA256);}
 
     /**
      * @brief setMyH1 setter for myH1.
      * @param _myH1 value to set.
      */
-    void setMyH1(uint8_t* _myH1) {memcpy(myH1, _myH1, HASH_LENGTH_SHA256);}
+    void setMyH1(uint8_t* _myH1) {memcpy(getHandshakeState()->myH1, _myH1, HASH_LENGTH_SHA256);}
 
     /**
      * @brief setMyH2 setter for myH2.
      * @param _myH2 value to set.
      */
-    void setMyH2(uint8_t* _myH2) {memcpy(myH2, _myH2, HASH_LENGTH_SHA256);}
+    void setMyH2(uint8_t* _myH2) {memcpy(getHandshakeState()->myH2, _myH2, HASH_LENGTH_SHA256);}
 
     /**
      * @brief setMyH3 setter for myH3.
      * @param _myH3 value to set.
      */
-    void setMyH3(uint8_t* _myH3) {memcpy(myH3, _myH3, HASH_LENGTH_SHA256);}
+    void setMyH3(uint8_t* _myH3) {memcpy(getHandshakeState()->myH3, _myH3, HASH_LENGTH_SHA256);}
 
     /**
      * @brief setPeersHash setter for peers hashes.
@@ -203,6 +472,12 @@ public:
      */
     void calculateHashChain();
 
+    /**
+     * @brief seedRandomGenerator seed random generator of handshake from entropy source.
+     *        !!! IF random initialization fail assert() is called !!!
+     */
+    void seedRandomGenerator();
+
     /**
      * @brief fillWithRandomWalue fill data with random value.
      *        !!! IF random initialization fail assert() is called !!!
@@ -295,6 +570,18 @@ public:
      */
     void prepareHelloMessage();
 
+    /**
+     * @brief fillHelloMessage set version and all supported algorithms to hello.
+     * @param _hello message to fill.
+     */
+    void fillHelloMessage(HelloMessage* _hello);
+
+    /**
+     * @brief createHelloTemplate build hello of our capability profile and share it in template cache.
+     * @return template of profile, nullptr if cache is full.
+     */
+    const HelloMessage* createHelloTemplate();
+
     /**
      * @brief keyDerivationFunction for derive rest of keys from s0.
      * @param valueToFill is value which we want to fill with computed key.
@@ -366,8 +653,9 @@ public:
 
     /**
      * @brief renderSAS function use negotiated SAS type block and render SAS to user
+     * @param _rendered buffer of WORD_LENGTH characters which is filled with SAS, it is not terminated.
      */
-    uint8_t *renderSAS();
+    void renderSAS(uint8_t* _rendered);
 
     /**
      * @brief decryptConfirmMessage decrypt confirm message